@@ -4,6 +4,17 @@
 #include "ReciterTabs.h"
 #include "debug.h"
 
+// Each rule as found by scanning the tables, precomputed by make_reciter_index.py.
+typedef struct _reciter_rule_t {
+	unsigned short address;   // value of mem62 for the rule
+	unsigned char open;       // offset of '('
+	unsigned char close;      // offset of ')'
+	unsigned char equals;     // offset of '='
+	unsigned char second;     // second character in brackets, or 0 if there is only one
+} reciter_rule_t;
+
+#include "genhdr/reciterindex.h"
+
 static unsigned char A, X, Y;
 extern int debug;
 
@@ -51,6 +62,7 @@ int TextToPhonemes(reciter_memory* mem) // Code36484
 	unsigned char mem60;
 	unsigned char mem61;
 	unsigned short mem62;     // memory position of current rule
+	unsigned short rule;      // index of current rule in reciter_rule_index
 
 	unsigned char mem64;      // position of '=' or current character
 	unsigned char mem65;     // position of ')'
@@ -122,8 +134,8 @@ pos36554:
 	mem57 = A;
 	if((A&2) != 0)
 	{
-		mem62 = 37541;
-		goto pos36700;
+		rule = RECITER_RULES2_FIRST;
+		goto pos36703;
 	}
 
 	//pos36630:
@@ -164,7 +176,8 @@ pos36677:
 
 	// go to the right rules for this character.
 	X = mem64 - 'A';
-	mem62 = tab37489[X] | (tab37515[X]<<8);
+	rule = reciter_letter_first[X];
+	goto pos36703;
 
 	// -------------------------------------
 	// go to next rule
@@ -173,42 +186,18 @@ pos36677:
 pos36700:
 
 	// find next rule
-	Y = 0;
-	do
-	{
-		mem62 += 1;
-		A = GetRuleByte(mem62, Y);
-	} while ((A & 128) == 0);
-	Y++;
-
-	//pos36720:
-	// find '('
-	while(1)
-	{
-		A = GetRuleByte(mem62, Y);
-		if (A == '(') break;
-		Y++;
-	}
-	mem66 = Y;
-
-	//pos36732:
-	// find ')'
-	do
-	{
-		Y++;
-		A = GetRuleByte(mem62, Y);
-	} while(A != ')');
-	mem65 = Y;
-
-	//pos36741:
-	// find '='
-	do
-	{
-		Y++;
-		A = GetRuleByte(mem62, Y);
-		A = A & 127;
-	} while (A != '=');
-	mem64 = Y;
+	rule++;
+
+pos36703:
+	// the positions of '(', ')' and '=' come from the index instead of a scan
+	mem62 = reciter_rule_index[rule].address;
+	mem66 = reciter_rule_index[rule].open;
+	mem65 = reciter_rule_index[rule].close;
+	mem64 = reciter_rule_index[rule].equals;
+
+	// reject on the second character in the bracket without reading the rule
+	A = reciter_rule_index[rule].second;
+	if (A != 0 && A != mem->inputtemp[(unsigned char)(mem61 + 1)]) goto pos36700;
 
 	X = mem61;
 	mem60 = X;
@@ -142,23 +142,17 @@ void Write(sam_memory* sam, unsigned char p, unsigned char Y, unsigned char valu
 
 
 // Code48227()
-unsigned char RenderSample(sam_memory* sam, unsigned char *mem66, unsigned sample, unsigned char pos)
-{     
-	int tempA;
-	// current phoneme's index
-    unsigned char mem47;
-    unsigned char mem49 = pos;
-    unsigned char mem53;
-    unsigned char mem56;
+// Get ready to output the sampled consonant given by the phoneme flags.  Once it has
+// finished, frame processing resumes either with the next glottal pulse (resume_pulse)
+// or by skipping ahead two frames.
+static void RenderSampleStart(sam_memory* sam, unsigned char sample, unsigned char resume_pulse)
+{
+    render_state_t *state = &sam->render_state;
 
 	// mask low three bits and subtract 1 get value to 
 	// convert 0 bits on unvoiced samples.
-	unsigned char A = sample&7;
-	unsigned char X = A-1;
+	unsigned char X = (sample&7)-1;
 
-    // store the result
-	mem56 = X;
-	
 	// determine which offset to use from table { 0x18, 0x1A, 0x17, 0x17, 0x17 }
 	// T, S, Z                0          0x18
 	// CH, J, SH, ZH          1          0x1A
@@ -169,133 +163,111 @@ unsigned char RenderSample(sam_memory* sam, unsigned char *mem66, unsigned sampl
     // get value from the table
     if (X >= sizeof(tab48426)) {
         sam_error = "Out-of-buffer read";
+        state->stage = RENDER_STAGE_DONE;
+        return;
     }
-	mem53 = tab48426[X];
-	mem47 = X;      //46016+mem[56]*256
-	
+	state->sample_value = tab48426[X];
+	state->sample_table = X;      //46016+mem[56]*256
+
 	// voiced sample?
-	A = sample & 248;
+	unsigned char A = sample & 248;
 	if(A == 0)
 	{
         // voiced phoneme: Z*, ZH, V*, DH
-		pos = mem49;
-		A = sam->render.pitch[9] >> 4;
-		
-		// jump to voiced portion
-		goto pos48315;
-	}
-	
-	pos = A ^ 255;
-pos48274:
-         
-    // step through the 8 bits in the sample
-	mem56 = 8;
-	
-	// get the next sample from the table
-    // mem47*256 = offset to start of samples
-	A = sampleTable[mem47*256+pos];
-pos48280:
-
-    // left shift to get the high bit
-	tempA = A;
-	A = A << 1;
-	//48281: BCC 48290
-	
-	// bit not set?
-	if ((tempA & 128) == 0)
+        // number of samples?
+		state->sample_voiced = 1;
+		state->sample_counter = (sam->render.pitch[9] >> 4) ^ 255;
+		state->sample_pos = state->mem66;
+	} else
 	{
-        // convert the bit to value from table
-		X = mem53;
-		//mem[54296] = X;
-        // output the byte
-		Output(1, X);
-		// if X != 0, exit loop
-		if(X != 0) goto pos48296;
+		state->sample_voiced = 0;
+		state->sample_pos = A ^ 255;
 	}
-	
-	// output a 5 for the on bit
-	Output(2, 5);
-
-	//48295: NOP
-pos48296:
-
-	X = 0;
-
-    // decrement counter
-	mem56--;
-	
-	// if not done, jump to top of loop
-	if (mem56 != 0) goto pos48280;
-	
-	// increment position
-	pos++;
-	if (pos != 0) goto pos48274;
-	
-	// restore values and return
-	pos = mem49;
-	return pos;
-
-
-	unsigned char phase1;
-
-pos48315:
-// handle voiced samples here
+	state->sample_bits = 0;
+	state->sample_five = 0;
+	state->sample_resume_pulse = resume_pulse;
+	state->stage = RENDER_STAGE_SAMPLE;
+}
 
-   // number of samples?
-	phase1 = A ^ 255;
+// Output the sampled consonant until it has finished, returning true, or until the
+// output is full, returning false.
+static int RenderSampleStep(sam_memory* sam)
+{
+    render_state_t *state = &sam->render_state;
+	unsigned char pos = state->sample_pos;
+	unsigned char bits = state->sample_bits;
+	unsigned char byte = state->sample_byte;
+	int done = 0;
 
-	pos = *mem66;
-	do
+	for (;;)
 	{
-		//pos48321:
-
-        // shift through all 8 bits
-		mem56 = 8;
-		//A = Read(sam, mem47, pos);
-		
-		// fetch value from table
-		A = sampleTable[mem47*256+pos];
+        // step through the 8 bits in the sample
+		if (bits == 0)
+		{
+            // get the next sample from the table
+            // sample_table*256 = offset to start of samples
+			byte = sampleTable[state->sample_table*256+pos];
+			bits = 8;
+		}
 
-        // loop 8 times
-		//pos48327:
-		do
+		unsigned char bit = byte & 128;
+		if (state->sample_voiced)
 		{
-			//48327: ASL A
-			//48328: BCC 48337
-			
-			// left shift and check high bit
-			tempA = A;
-			A = A << 1;
-			if ((tempA & 128) != 0)
+			if (bit != 0)
 			{
                 // if bit set, output 26
-				X = 26;
-				Output(3, X);
+				Output(3, 26);
 			} else
 			{
-				//timetable 4
 				// bit is not set, output a 6
-				X=6;
-				Output(4, X);
+				Output(4, 6);
 			}
+		} else if (bit == 0 && !state->sample_five)
+		{
+            // convert the bit to value from table
+			Output(1, state->sample_value);
+			if (state->sample_value == 0)
+			{
+				// a 5 follows for this bit too
+				state->sample_five = 1;
+				goto next;
+			}
+		} else
+		{
+            // output a 5 for the on bit
+			Output(2, 5);
+			state->sample_five = 0;
+		}
 
-			mem56--;
-		} while(mem56 != 0);
-
-        // move ahead in the table
-		pos++;
-		
-		// continue until counter done
-		phase1++;
+        // left shift to get the next bit
+		byte <<= 1;
+		if (--bits == 0)
+		{
+            // move ahead in the table
+			pos++;
+			if (state->sample_voiced)
+			{
+				// continue until counter done
+				if (++state->sample_counter == 0)
+				{
+					state->mem66 = pos;
+					done = 1;
+					break;
+				}
+			} else if (pos == 0)
+			{
+				done = 1;
+				break;
+			}
+		}
+next:
+		if (SamOutputFull()) break;
+	}
 
-	} while (phase1 != 0);
-	//	if (phase1 != 0) goto pos48321;
-	
-	// restore values and return
-	A = 1;
-	*mem66 = pos;
-	pos = mem49;
-	return pos;
+	state->sample_pos = pos;
+	state->sample_bits = bits;
+	state->sample_byte = byte;
+	return done;
 }
 
 
@@ -712,16 +684,11 @@ void Render(sam_memory* sam)
     		sam->render.pitch[i] -= (sam->render.freq_amp[i].freq1 >> 1);
         }
 	}
-    OutputFrames(sam, mem48);
+    OutputFramesStart(sam, mem48);
 }
 
-void OutputFrames(sam_memory *sam, unsigned char frame_count) {
-
-	unsigned char phase1 = 0;
-	unsigned char phase2 = 0;
-	unsigned char phase3 = 0;
-	unsigned char speedcounter = 72; //sam standard speed
-    unsigned char mem66 = 0;
+void OutputFramesStart(sam_memory *sam, unsigned char frame_count) {
+    render_state_t *state = &sam->render_state;
 
     // RESCALE AMPLITUDE
     // Rescale volume from decibels to a linear scale.
@@ -732,15 +699,23 @@ void OutputFrames(sam_memory *sam, unsigned char frame_count) {
 		sam->render.freq_amp[i].amp3 = amplitudeRescale[sam->render.freq_amp[i].amp3];
 	}
 
-	unsigned char Y = 0;
 	unsigned char A = sam->render.pitch[0];
-	unsigned char glottal_pulse = A;
-	unsigned char count = A - (A>>2);     // 3/4*A ???
+	state->frame = 0;
+	state->frame_count = frame_count;
+	state->glottal_pulse = A;
+	state->count = A - (A>>2);     // 3/4*A ???
+	state->phase1 = 0;
+	state->phase2 = 0;
+	state->phase3 = 0;
+	state->speedcounter = 72; //sam standard speed
+	state->mem66 = 0;
+	state->stage = RENDER_STAGE_FRAMES;
 
     if (debug)
     {
         PrintOutput(sam->render.flags, sam->render.freq_amp, sam->render.pitch, frame_count);
     }
+}
 
 // PROCESS THE FRAMES
 //
@@ -750,91 +725,347 @@ void OutputFrames(sam_memory *sam, unsigned char frame_count) {
 // SAM generates these formants directly with sin and rectangular waves.
 // To simulate them being driven by the glottal pulse, the waveforms are
 // reset at the beginning of each glottal pulse.
+//
+// This outputs values until the output is full or the stage changes, so that
+// rendering can be suspended between any two values without a call per value.
+// The counters and wave phases are kept in locals, and the parameters of the
+// current frame are only unpacked when moving to a new frame.
+//
+// The original multtable[sinus[phase] | amplitude] lookup holds the product of
+// the signed high nibble of the sine and the amplitude, halved and rounded down,
+// so that is computed directly here.  The rectangle wave only has two values,
+// whose products are worked out once per frame.
+
+#define FORMANT(wave, amp) ((((signed char)(wave)) >> 4) * (int)(amp) >> 1)
+
+typedef struct _frame_params_t {
+    int amp1;
+    int amp2;
+    int rect_high; // rectangle wave, phase < 128
+    int rect_low;  // rectangle wave, phase >= 128
+    unsigned char freq1;
+    unsigned char freq2;
+    unsigned char freq3;
+} frame_params_t;
+
+static inline void LoadFrame(sam_memory *sam, unsigned char Y, frame_params_t *frame)
+{
+	render_freq_amp_t fa = sam->render.freq_amp[Y];
+	frame->amp1 = fa.amp1;
+	frame->amp2 = fa.amp2;
+	frame->rect_high = FORMANT(0x90, fa.amp3);
+	frame->rect_low = FORMANT(0x70, fa.amp3);
+	frame->freq1 = fa.freq1;
+	frame->freq2 = fa.freq2;
+	frame->freq3 = fa.freq3;
+}
+
+#if MICROPY_HW_BENCH
+
+// The renderer as it was before OutputFramesStep and RenderSampleStep looped until
+// the output was full: one value per call, with the multtable lookup.  It is kept
+// only so the benchmark suite can time it against the current one, see modbench.c.
+
+int sam_bench_old_renderer = 0;
+
+static int RenderSampleStepOld(sam_memory* sam)
+{
+    render_state_t *state = &sam->render_state;
+
+    // step through the 8 bits in the sample
+	if (state->sample_bits == 0)
+	{
+        // get the next sample from the table
+        // sample_table*256 = offset to start of samples
+		state->sample_byte = sampleTable[state->sample_table*256+state->sample_pos];
+		state->sample_bits = 8;
+	}
+
+	unsigned char bit = state->sample_byte & 128;
+	if (state->sample_voiced)
+	{
+		if (bit != 0)
+		{
+            // if bit set, output 26
+			Output(3, 26);
+		} else
+		{
+			// bit is not set, output a 6
+			Output(4, 6);
+		}
+	} else if (bit == 0 && !state->sample_five)
+	{
+        // convert the bit to value from table
+		Output(1, state->sample_value);
+		if (state->sample_value == 0)
+		{
+			// a 5 follows for this bit too
+			state->sample_five = 1;
+			return 0;
+		}
+	} else
+	{
+        // output a 5 for the on bit
+		Output(2, 5);
+		state->sample_five = 0;
+	}
+
+    // left shift to get the next bit
+	state->sample_byte <<= 1;
+	if (--state->sample_bits != 0) return 0;
+
+    // move ahead in the table
+	state->sample_pos++;
+	if (state->sample_voiced)
+	{
+		// continue until counter done
+		if (++state->sample_counter != 0) return 0;
+		state->mem66 = state->sample_pos;
+		return 1;
+	}
+	return state->sample_pos == 0;
+}
+
+static void OutputFramesStepOld(sam_memory *sam) {
+    render_state_t *state = &sam->render_state;
+	unsigned char Y = state->frame;
+	unsigned char sample = state->flags;
+	unsigned char A;
+
+	if (state->stage == RENDER_STAGE_SAMPLE)
+	{
+		if (!RenderSampleStepOld(sam)) return;
+		state->stage = RENDER_STAGE_FRAMES;
+		if (state->sample_resume_pulse) goto pos48159;
+
+		// skip ahead two in the frame buffer
+		Y += 2;
+		state->frame_count -= 2;
+		goto pos48150;
+	}
 
-	//finally the loop for sound output
 	//pos48078:
-	while(1)
+    // get the sampled information on the phoneme
+	sample = sam->render.flags[Y];
+	state->flags = sample;
+
+	// unvoiced sampled phoneme?
+	if((sample & 248) != 0)
+	{
+        // render the sample for the phoneme
+		RenderSampleStart(sam, sample, 0);
+		return;
+	}
+
+    // simulate the glottal pulse and formants
+	unsigned char accum = multtable[sinus[state->phase1] | sam->render.freq_amp[Y].amp1];
+
+	int carry = 0;
+	if ((accum+multtable[sinus[state->phase2] | sam->render.freq_amp[Y].amp2] ) > 255) carry = 1;
+	accum += multtable[sinus[state->phase2] | sam->render.freq_amp[Y].amp2];
+	A = accum + multtable[rectangle[state->phase3] | sam->render.freq_amp[Y].amp3] + (carry?1:0);
+	A = ((A + 136) & 255) >> 4; //there must be also a carry
+	//mem[54296] = A;
+
+	// output the accumulated value
+	Output(0, A);
+	state->speedcounter--;
+	if (state->speedcounter != 0) goto pos48155;
+	Y++; //go to next amplitude
+
+	// decrement the frame count
+	state->frame_count--;
+
+pos48150:
+	// if the frame count is zero, this group of phonemes is finished
+	if(state->frame_count == 0)
 	{
+		state->stage = state->last_group ? RENDER_STAGE_DONE : RENDER_STAGE_PREPARE;
+		return;
+	}
+	state->speedcounter = sam->common.speed;
+pos48155:
+
+    // decrement the remaining length of the glottal pulse
+	state->glottal_pulse--;
+
+	// finished with a glottal pulse?
+	if(state->glottal_pulse == 0) goto pos48159;
+
+	// decrement the count
+	state->count--;
+
+	// is the count non-zero and the sampled flag is zero?
+	if((state->count != 0) || (sample == 0)) {
+        // reset the phase of the formants to match the pulse
+		state->phase1 += sam->render.freq_amp[Y].freq1;
+		state->phase2 += sam->render.freq_amp[Y].freq2;
+		state->phase3 += sam->render.freq_amp[Y].freq3;
+		state->frame = Y;
+		return;
+	}
+
+	// voiced sampled phonemes interleave the sample with the
+	// glottal pulse. The sample flag is non-zero, so render
+	// the sample for the phoneme.
+	state->frame = Y;
+	RenderSampleStart(sam, sample, 1);
+	return;
+
+pos48159:
+    // fetch the next glottal pulse length
+	A = sam->render.pitch[Y];
+	state->glottal_pulse = A;
+	state->count = A - (A>>2);
+
+	// reset the formant wave generators to keep them in
+	// sync with the glottal pulse
+	state->phase1 = 0;
+	state->phase2 = 0;
+	state->phase3 = 0;
+	state->frame = Y;
+}
+
+#endif
+
+void OutputFramesStep(sam_memory *sam) {
+    render_state_t *state = &sam->render_state;
+	unsigned char Y = state->frame;
+	unsigned char sample = state->flags;
+	unsigned char frame_count = state->frame_count;
+	unsigned char speedcounter = state->speedcounter;
+	unsigned char glottal_pulse = state->glottal_pulse;
+	unsigned char count = state->count;
+	unsigned char phase1 = state->phase1;
+	unsigned char phase2 = state->phase2;
+	unsigned char phase3 = state->phase3;
+	unsigned char speed = sam->common.speed;
+	unsigned char A;
+	int resume = 0;
+	frame_params_t frame;
+
+#if MICROPY_HW_BENCH
+	if (sam_bench_old_renderer)
+	{
+		OutputFramesStepOld(sam);
+		return;
+	}
+#endif
+
+	if (state->stage == RENDER_STAGE_SAMPLE)
+	{
+		if (!RenderSampleStep(sam)) return;
+		state->stage = RENDER_STAGE_FRAMES;
+		resume = 1;
+		if (state->sample_resume_pulse)
+		{
+			LoadFrame(sam, Y, &frame);
+			goto pos48159;
+		}
+
+		// skip ahead two in the frame buffer
+		Y += 2;
+		frame_count -= 2;
+		LoadFrame(sam, Y, &frame);
+		goto pos48150;
+	}
+
+	LoadFrame(sam, Y, &frame);
+	for (;;)
+	{
+		//pos48078:
         // get the sampled information on the phoneme
-		A = sam->render.flags[Y];
-		unsigned char sample = A;
-		
+		sample = sam->render.flags[Y];
+
 		// unvoiced sampled phoneme?
-		A = A & 248;
-		if(A != 0)
+		if((sample & 248) != 0)
 		{
             // render the sample for the phoneme
-			Y = RenderSample(sam, &mem66, sample, Y);
-			
-			// skip ahead two in the frame buffer
-			Y += 2;
-			frame_count -= 2;
-		} else
-		{
-            // simulate the glottal pulse and formants
-			unsigned char accum = multtable[sinus[phase1] | sam->render.freq_amp[Y].amp1];
+			RenderSampleStart(sam, sample, 0);
+			break;
+		}
 
-			int carry = 0;
-			if ((accum+multtable[sinus[phase2] | sam->render.freq_amp[Y].amp2] ) > 255) carry = 1;
-			accum += multtable[sinus[phase2] | sam->render.freq_amp[Y].amp2];
-			A = accum + multtable[rectangle[phase3] | sam->render.freq_amp[Y].amp3] + (carry?1:0);
+        // simulate the glottal pulse and formants
+		{
+			int f1 = FORMANT(sinus[phase1], frame.amp1);
+			int f2 = FORMANT(sinus[phase2], frame.amp2);
+			int f3 = (phase3 & 128) ? frame.rect_low : frame.rect_high;
+			int carry = ((f1 & 255) + (f2 & 255)) >> 8;
+			A = f1 + f2 + f3 + carry;
 			A = ((A + 136) & 255) >> 4; //there must be also a carry
-			//mem[54296] = A;
-			
-			// output the accumulated value
-			Output(0, A);
-			speedcounter--;
-			if (speedcounter != 0) goto pos48155;
-			Y++; //go to next amplitude
-			
-			// decrement the frame count
-			frame_count--;
 		}
-		
-		// if the frame count is zero, exit the loop
-		if(frame_count == 0) 	return;
-		speedcounter = sam->common.speed;
+
+		// output the accumulated value
+		Output(0, A);
+		speedcounter--;
+		if (speedcounter != 0) goto pos48155;
+		Y++; //go to next amplitude
+		LoadFrame(sam, Y, &frame);
+
+		// decrement the frame count
+		frame_count--;
+
+pos48150:
+		// if the frame count is zero, this group of phonemes is finished
+		if(frame_count == 0)
+		{
+			state->stage = state->last_group ? RENDER_STAGE_DONE : RENDER_STAGE_PREPARE;
+			break;
+		}
+		speedcounter = speed;
 pos48155:
-         
+
         // decrement the remaining length of the glottal pulse
 		glottal_pulse--;
-		
+
 		// finished with a glottal pulse?
-		if(glottal_pulse == 0)
-		{
-pos48159:
-            // fetch the next glottal pulse length
-			A = sam->render.pitch[Y];
-			glottal_pulse = A;
-			A = A - (A>>2);
-			count = A;
-			
-			// reset the formant wave generators to keep them in 
-			// sync with the glottal pulse
-			phase1 = 0;
-			phase2 = 0;
-			phase3 = 0;
-			continue;
-		}
-		
+		if(glottal_pulse == 0) goto pos48159;
+
 		// decrement the count
 		count--;
-		
+
 		// is the count non-zero and the sampled flag is zero?
 		if((count != 0) || (sample == 0)) {
             // reset the phase of the formants to match the pulse
-			phase1 += sam->render.freq_amp[Y].freq1;
-			phase2 += sam->render.freq_amp[Y].freq2;
-			phase3 += sam->render.freq_amp[Y].freq3;
-			continue;
+			phase1 += frame.freq1;
+			phase2 += frame.freq2;
+			phase3 += frame.freq3;
+		} else
+		{
+			// voiced sampled phonemes interleave the sample with the
+			// glottal pulse. The sample flag is non-zero, so render
+			// the sample for the phoneme.
+			RenderSampleStart(sam, sample, 1);
+			break;
 		}
-		
-		// voiced sampled phonemes interleave the sample with the
-		// glottal pulse. The sample flag is non-zero, so render
-		// the sample for the phoneme.
-		Y = RenderSample(sam, &mem66, sample, Y);
-		goto pos48159;
+		goto next;
+
+pos48159:
+        // fetch the next glottal pulse length
+		A = sam->render.pitch[Y];
+		glottal_pulse = A;
+		count = A - (A>>2);
+
+		// reset the formant wave generators to keep them in
+		// sync with the glottal pulse
+		phase1 = 0;
+		phase2 = 0;
+		phase3 = 0;
+
+next:
+		// after a sample, let the caller check the output before continuing
+		if (resume || SamOutputFull()) break;
 	}
+
+	state->frame = Y;
+	state->flags = sample;
+	state->frame_count = frame_count;
+	state->speedcounter = speedcounter;
+	state->glottal_pulse = glottal_pulse;
+	state->count = count;
+	state->phase1 = phase1;
+	state->phase2 = phase2;
+	state->phase3 = phase3;
 }
 
 
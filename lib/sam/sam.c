@@ -93,6 +93,17 @@ void  ClearInput(sam_memory* sam) {
 }
 
 int SAMMain(sam_memory* sam)
+{
+    if (!SAMPrepare(sam)) return 0;
+    while (SAMRender(sam)) {
+    }
+    if (strcmp(sam_error, "OK")) {
+        return 0;
+    }
+	return 1;
+}
+
+int SAMPrepare(sam_memory* sam)
 {
 	Init(sam);
 
@@ -131,43 +142,61 @@ int SAMMain(sam_memory* sam)
         PrintPhonemes("Processed phonemes", sam->prepare.phoneme_input);
     }
 
-	PrepareOutput(sam);
-    if (strcmp(sam_error, "OK")) {
-        return 0;
-    }
+    sam->render_state.stage = RENDER_STAGE_PREPARE;
+    sam->render_state.next_input = 0;
 	return 1;
 }
 
+int SAMRender(sam_memory* sam)
+{
+    render_state_t *state = &sam->render_state;
+    do {
+        switch (state->stage) {
+            case RENDER_STAGE_PREPARE:
+                PrepareOutput(sam);
+                if (strcmp(sam_error, "OK")) {
+                    state->stage = RENDER_STAGE_DONE;
+                }
+                break;
+            case RENDER_STAGE_FRAMES:
+            case RENDER_STAGE_SAMPLE:
+                OutputFramesStep(sam);
+                break;
+            default:
+                return 0;
+        }
+    } while (!SamOutputFull());
+    return 1;
+}
+
 
 //void Code48547()
+// Copy the next group of phonemes, up to the end or a breath, to the output and get
+// ready to render it.
 void PrepareOutput(sam_memory* sam)
 {
+    render_state_t *state = &sam->render_state;
 	unsigned char A = 0;
-	unsigned char X = 0;
+	unsigned char X = state->next_input;
 	unsigned char Y = 0;
 
 	//pos48551:
 	while(1)
 	{
 		A = sam->prepare.phoneme_input[X].index;
-		if (A == PHONEME_END)
+		if (A == PHONEME_END || A == PHONEME_END_BREATH)
 		{
 			sam->common.phoneme_output[Y].index = PHONEME_END;
+			state->next_input = X + 1;
+			state->last_group = (A == PHONEME_END);
 			Render(sam);
+			if (state->stage == RENDER_STAGE_PREPARE && state->last_group)
+			{
+				// nothing to output for the last group
+				state->stage = RENDER_STAGE_DONE;
+			}
 			return;
 		}
-		if (A == PHONEME_END_BREATH)
-		{
-			X++;
-			int temp = X;
-			//mem[48546] = X;
-			sam->common.phoneme_output[Y].index = PHONEME_END;
-			Render(sam);
-			//X = mem[48546];
-			X=temp;
-			Y = 0;
-			continue;
-		}
 
 		if (A == 0)
 		{
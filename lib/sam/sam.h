@@ -1,95 +1,141 @@
-#ifndef SAM_H
-#define SAM_H
-
-#define DEFAULT_SING     false
-#define DEFAULT_PITCH    64
-#define DEFAULT_SPEED    72
-#define DEFAULT_MOUTH    128
-#define DEFAULT_THROAT   128
-
-typedef struct _phoneme_t {
-    unsigned char index;
-    unsigned char length;
-    unsigned char stress; //numbers from 0 to 8
-    unsigned char pitch;
-} phoneme_t;
-
-enum {
-    PHONEME_IGNORE=0,
-    PHONEME_END=127,
-    PHONEME_END_BREATH=126
-};
-
-#define RENDER_FRAMES 256
-
-#define INPUT_PHONEMES 128
-#define OUTPUT_PHONEMES (RENDER_FRAMES/4)
-
-typedef struct _prepare_memory {
-    const char *input;
-    unsigned int input_length;
-    phoneme_t phoneme_input[INPUT_PHONEMES];
-} prepare_memory;
-
-
-typedef struct _common_memory {
-    unsigned char speed;
-    unsigned char pitch;
-    unsigned char mouth;
-    unsigned char throat;
-    int singmode;
-    phoneme_t phoneme_output[OUTPUT_PHONEMES];
-} common_memory;
-
-typedef struct _render_freq_amp_t {
-    unsigned int freq1:6;
-    unsigned int freq2:7;
-    unsigned int freq3:7;
-    unsigned int amp1:4;
-    unsigned int amp2:4;
-    unsigned int amp3:4;
-} render_freq_amp_t;
-
-typedef struct _render_memory {
-    render_freq_amp_t freq_amp[RENDER_FRAMES];
-    unsigned char pitch[RENDER_FRAMES];
-    unsigned char flags[RENDER_FRAMES];
-} render_memory;
-
-typedef struct _sam_memory {
-    common_memory common;
-    prepare_memory prepare;
-    render_memory render;
-} sam_memory;
-
-void SetInput(sam_memory* mem, const char *_input, unsigned int len);
-
-int SAMMain(sam_memory* mem);
-
-extern char *sam_error;
-
-char* GetBuffer();
-int GetBufferLength();
-
-//char input[]={"/HAALAOAO MAYN NAAMAEAE IHSTT SAEBAASTTIHAAN \x9b\x9b\0"};
-//unsigned char input[]={"/HAALAOAO \x9b\0"};
-//unsigned char input[]={"AA \x9b\0"};
-//unsigned char input[] = {"GUH5DEHN TAEG\x9b\0"};
-
-//unsigned char input[]={"AY5 AEM EY TAO4LXKIHNX KAX4MPYUX4TAH. GOW4 AH/HEH3D PAHNK.MEYK MAY8 DEY.\x9b\0"};
-//unsigned char input[]={"/HEH3LOW2, /HAW AH YUX2 TUXDEY. AY /HOH3P YUX AH FIYLIHNX OW4 KEY.\x9b\0"};
-//unsigned char input[]={"/HEY2, DHIHS IH3Z GREY2T. /HAH /HAH /HAH.AYL BIY5 BAEK.\x9b\0"};
-//unsigned char input[]={"/HAH /HAH /HAH \x9b\0"};
-//unsigned char input[]={"/HAH /HAH /HAH.\x9b\0"};
-//unsigned char input[]={".TUW BIY5Y3,, OHR NAA3T - TUW BIY5IYIY., DHAE4T IHZ DHAH KWEH4SCHAHN.\x9b\0"};
-//unsigned char input[]={"/HEY2, DHIHS \x9b\0"};
-
-//unsigned char input[]={" IYIHEHAEAAAHAOOHUHUXERAXIX  \x9b\0"};
-//unsigned char input[]={" RLWWYMNNXBDGJZZHVDH \x9b\0"};
-//unsigned char input[]={" SSHFTHPTKCH/H \x9b\0"};
-
-//unsigned char input[]={" EYAYOYAWOWUW ULUMUNQ YXWXRXLX/XDX\x9b\0"};
-
-
-#endif
-
+#ifndef SAM_H
+#define SAM_H
+
+#define DEFAULT_SING     false
+#define DEFAULT_PITCH    64
+#define DEFAULT_SPEED    72
+#define DEFAULT_MOUTH    128
+#define DEFAULT_THROAT   128
+
+typedef struct _phoneme_t {
+    unsigned char index;
+    unsigned char length;
+    unsigned char stress; //numbers from 0 to 8
+    unsigned char pitch;
+} phoneme_t;
+
+enum {
+    PHONEME_IGNORE=0,
+    PHONEME_END=127,
+    PHONEME_END_BREATH=126
+};
+
+#define RENDER_FRAMES 256
+
+#define INPUT_PHONEMES 128
+#define OUTPUT_PHONEMES (RENDER_FRAMES/4)
+
+typedef struct _prepare_memory {
+    const char *input;
+    unsigned int input_length;
+    phoneme_t phoneme_input[INPUT_PHONEMES];
+} prepare_memory;
+
+
+typedef struct _common_memory {
+    unsigned char speed;
+    unsigned char pitch;
+    unsigned char mouth;
+    unsigned char throat;
+    int singmode;
+    phoneme_t phoneme_output[OUTPUT_PHONEMES];
+} common_memory;
+
+typedef struct _render_freq_amp_t {
+    unsigned int freq1:6;
+    unsigned int freq2:7;
+    unsigned int freq3:7;
+    unsigned int amp1:4;
+    unsigned int amp2:4;
+    unsigned int amp3:4;
+} render_freq_amp_t;
+
+typedef struct _render_memory {
+    render_freq_amp_t freq_amp[RENDER_FRAMES];
+    unsigned char pitch[RENDER_FRAMES];
+    unsigned char flags[RENDER_FRAMES];
+} render_memory;
+
+enum {
+    RENDER_STAGE_PREPARE=0, // copying the next group of phonemes to render
+    RENDER_STAGE_FRAMES,    // outputting the frames of the group
+    RENDER_STAGE_SAMPLE,    // outputting a sampled consonant within the frames
+    RENDER_STAGE_DONE
+};
+
+// Everything needed to resume rendering where it left off, so that the output can
+// be generated a bit at a time.
+typedef struct _render_state_t {
+    unsigned char stage;
+    unsigned char last_group;
+    unsigned char next_input;
+    unsigned char frame;
+    unsigned char frame_count;
+    unsigned char speedcounter;
+    unsigned char glottal_pulse;
+    unsigned char count;
+    unsigned char phase1;
+    unsigned char phase2;
+    unsigned char phase3;
+    unsigned char flags;
+    unsigned char mem66;
+    // state of the sampled consonant being output
+    unsigned char sample_resume_pulse;
+    unsigned char sample_voiced;
+    unsigned char sample_table;
+    unsigned char sample_value;
+    unsigned char sample_pos;
+    unsigned char sample_counter;
+    unsigned char sample_byte;
+    unsigned char sample_bits;
+    unsigned char sample_five;
+} render_state_t;
+
+typedef struct _sam_memory {
+    common_memory common;
+    prepare_memory prepare;
+    render_memory render;
+    render_state_t render_state;
+} sam_memory;
+
+void SetInput(sam_memory* mem, const char *_input, unsigned int len);
+
+// Render the whole input, in one go.
+int SAMMain(sam_memory* mem);
+
+// Render the input incrementally: SAMPrepare parses the input, then each call to
+// SAMRender outputs samples until SamOutputFull() returns true.  SAMRender returns
+// false once all the output has been generated.
+int SAMPrepare(sam_memory* mem);
+int SAMRender(sam_memory* mem);
+
+// Provided by the user of the library, returns true when no more samples can be output.
+int SamOutputFull(void);
+
+extern char *sam_error;
+
+char* GetBuffer();
+int GetBufferLength();
+
+//char input[]={"/HAALAOAO MAYN NAAMAEAE IHSTT SAEBAASTTIHAAN \x9b\x9b\0"};
+//unsigned char input[]={"/HAALAOAO \x9b\0"};
+//unsigned char input[]={"AA \x9b\0"};
+//unsigned char input[] = {"GUH5DEHN TAEG\x9b\0"};
+
+//unsigned char input[]={"AY5 AEM EY TAO4LXKIHNX KAX4MPYUX4TAH. GOW4 AH/HEH3D PAHNK.MEYK MAY8 DEY.\x9b\0"};
+//unsigned char input[]={"/HEH3LOW2, /HAW AH YUX2 TUXDEY. AY /HOH3P YUX AH FIYLIHNX OW4 KEY.\x9b\0"};
+//unsigned char input[]={"/HEY2, DHIHS IH3Z GREY2T. /HAH /HAH /HAH.AYL BIY5 BAEK.\x9b\0"};
+//unsigned char input[]={"/HAH /HAH /HAH \x9b\0"};
+//unsigned char input[]={"/HAH /HAH /HAH.\x9b\0"};
+//unsigned char input[]={".TUW BIY5Y3,, OHR NAA3T - TUW BIY5IYIY., DHAE4T IHZ DHAH KWEH4SCHAHN.\x9b\0"};
+//unsigned char input[]={"/HEY2, DHIHS \x9b\0"};
+
+//unsigned char input[]={" IYIHEHAEAAAHAOOHUHUXERAXIX  \x9b\0"};
+//unsigned char input[]={" RLWWYMNNXBDGJZZHVDH \x9b\0"};
+//unsigned char input[]={" SSHFTHPTKCH/H \x9b\0"};
+
+//unsigned char input[]={" EYAYOYAWOWUW ULUMUNQ YXWXRXLX/XDX\x9b\0"};
+
+
+#endif
+
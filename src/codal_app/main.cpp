@@ -25,14 +25,12 @@
  */
 
 #include "main.h"
-
-#define MICROPY_TIMER_EVENT (0x1001)
+#include "microbithal.h"
 
 extern "C" void mp_main(void);
 extern "C" void m_printf(...);
 extern "C" void microbit_hal_timer_callback(void);
-extern "C" void microbit_hal_gesture_callback(int);
-extern "C" void microbit_hal_sound_synth_callback(int);
+extern "C" void microbit_hal_button_callback(int, int);
 extern "C" void microbit_radio_irq_handler(void);
 
 MicroBit uBit;
@@ -41,43 +39,51 @@ void timer_handler(Event evt) {
     microbit_hal_timer_callback();
 }
 
-void gesture_event_handler(Event evt) {
-    microbit_hal_gesture_callback(evt.value);
-}
-
-void sound_synth_event_handler(Event evt) {
-    microbit_hal_sound_synth_callback(evt.value);
+// Button A and B report as 0 and 1.  Touch pin events are handled by the HAL.
+void button_event_handler(Event evt) {
+    if (evt.value != DEVICE_BUTTON_EVT_DOWN && evt.value != DEVICE_BUTTON_EVT_UP) {
+        return;
+    }
+    if (evt.source == DEVICE_ID_BUTTON_A) {
+        microbit_hal_button_callback(0, evt.value);
+    } else if (evt.source == DEVICE_ID_BUTTON_B) {
+        microbit_hal_button_callback(1, evt.value);
+    }
 }
 
 int main() {
     uBit.init();
 
     // Reconfigure the radio IRQ to our custom handler.
-    // This must be done after uBit.init() in case BLE pairing mode is activated there.
-    NVIC_SetVector(RADIO_IRQn, (uint32_t)microbit_radio_irq_handler);
+    // This must be done after uBit.init() in case BLE pairing mode is activated there,
+    // and not at all if BLE is enabled, because then the SoftDevice owns the radio.
+    if (!microbit_hal_ble_running()) {
+        NVIC_SetVector(RADIO_IRQn, (uint32_t)microbit_radio_irq_handler);
+    }
 
     // As well as configuring a larger RX buffer, this needs to be called so it
     // calls Serial::initialiseRx, to set up interrupts.
     uBit.serial.setRxBufferSize(128);
+    uBit.serial.setTxBufferSize(MICROBIT_HAL_SERIAL_TX_BUFFER_SIZE);
 
     uBit.messageBus.listen(MICROPY_TIMER_EVENT, DEVICE_EVT_ANY, timer_handler, MESSAGE_BUS_LISTENER_IMMEDIATE);
     uBit.messageBus.listen(DEVICE_ID_SERIAL, CODAL_SERIAL_EVT_DELIM_MATCH, serial_interrupt_handler, MESSAGE_BUS_LISTENER_IMMEDIATE);
-    uBit.messageBus.listen(DEVICE_ID_GESTURE, DEVICE_EVT_ANY, gesture_event_handler);
-    uBit.messageBus.listen(DEVICE_ID_SOUND_EMOJI_SYNTHESIZER_0, DEVICE_EVT_ANY, sound_synth_event_handler);
+    uBit.messageBus.listen(DEVICE_ID_SERIAL, CODAL_SERIAL_EVT_HEAD_MATCH, serial_rx_event_handler, MESSAGE_BUS_LISTENER_IMMEDIATE);
+    uBit.messageBus.listen(DEVICE_ID_SERIAL, CODAL_SERIAL_EVT_RX_FULL, serial_rx_event_handler, MESSAGE_BUS_LISTENER_IMMEDIATE);
+    microbit_hal_serial_set_rx_ring(NULL, 0);
+    uBit.messageBus.listen(DEVICE_ID_BUTTON_A, DEVICE_EVT_ANY, button_event_handler);
+    uBit.messageBus.listen(DEVICE_ID_BUTTON_B, DEVICE_EVT_ANY, button_event_handler);
 
     // 6ms follows the micro:bit v1 value
     system_timer_event_every(6, MICROPY_TIMER_EVENT, 1);
 
     uBit.display.setBrightness(255);
 
-    // By default the speaker is enabled but no pin is selected.  The audio system will
-    // select the correct pin when any audio related code is first executed.
-    uBit.audio.setSpeakerEnabled(true);
-    uBit.audio.setPinEnabled(false);
-
-    // Initialise the logo pin in capacitive touch mode.
-    uBit.io.logo.isTouched(TouchMode::Capacitative);
+    // The accelerometer's gesture listener, the audio routing and the logo's capacitive
+    // touch sensing are set up by the HAL when they are first used, so a script that
+    // doesn't need them starts sooner and doesn't keep them running.
 
+    boot_time_us = system_timer_current_time_us();
     mp_main();
     return 0;
 }
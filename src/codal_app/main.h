@@ -28,9 +28,13 @@
 
 #include "MicroBit.h"
 
+#define MICROPY_TIMER_EVENT (0x1001)
+
 extern MicroBit uBit;
 extern NRF52Pin *const pin_obj[];
+extern uint32_t boot_time_us;
 
 void serial_interrupt_handler(Event evt);
+void serial_rx_event_handler(Event evt);
 
 #endif // MICROPY_INCLUDED_CODAL_APP_MAIN_H
@@ -30,6 +30,8 @@
 
 #define HAL_ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 
+extern "C" void microbit_hal_gesture_callback(int);
+
 NRF52Pin *const pin_obj[] = {
     &uBit.io.P0,
     &uBit.io.P1,
@@ -79,23 +81,69 @@ static const PullMode pin_pull_mode_mapping[] = {
 
 static uint8_t pin_pull_state[32 + 6];
 static uint16_t touch_state[4];
+static uint8_t touch_pressed;
+static uint8_t touch_listening;
 static uint16_t button_state[2];
+static bool logo_touch_init_done = false;
+static bool accelerometer_init_done = false;
+
+// Time from startup until CODAL was initialised and mp_main() called, set by main().
+uint32_t boot_time_us;
+
+static void gesture_event_handler(Event evt) {
+    microbit_hal_gesture_callback(evt.value);
+}
 
 extern "C" {
 
 #include "microbithal.h"
 
+// Maximum time between runs of the CODAL idle event when polled from the VM hook.
+#define BACKGROUND_PROCESSING_PERIOD_US (5000)
+
+static uint32_t background_processing_last_us;
+
 void microbit_hal_background_processing(void) {
     // This call takes about 200us.
+    background_processing_last_us = system_timer_current_time_us();
     Event(DEVICE_ID_SCHEDULER, DEVICE_SCHEDULER_EVT_IDLE);
 }
 
+// Cheap enough to call every few bytecodes.  The idle event only runs when a fiber has
+// been made ready, for example by an event raised from an interrupt, or when the period
+// has elapsed so that periodic CODAL work still gets done.
+void microbit_hal_background_processing_poll(void) {
+    if (!scheduler_runqueue_empty()
+        || (uint32_t)system_timer_current_time_us() - background_processing_last_us >= BACKGROUND_PROCESSING_PERIOD_US) {
+        microbit_hal_background_processing();
+    }
+}
+
+static void microbit_hal_log_idle(void);
+
 void microbit_hal_idle(void) {
     microbit_hal_background_processing();
+    microbit_hal_log_idle();
     __WFI();
 }
 
+// Microseconds since startup, which unlike mp_hal_ticks_us() never wraps.
+uint64_t microbit_hal_ticks_us64(void) {
+    return system_timer_current_time_us();
+}
+
+// Replace any pending timer callback (including the periodic one set up at startup)
+// with a single one in us microseconds, or with none if us is negative.  This uses a
+// compare channel of the system timer, so is not limited to whole milliseconds.
+void microbit_hal_timer_set_next_us(int64_t us) {
+    system_timer_cancel_event(MICROPY_TIMER_EVENT, 1);
+    if (us >= 0) {
+        system_timer_event_after_us(us, MICROPY_TIMER_EVENT, 1);
+    }
+}
+
 __attribute__((noreturn)) void microbit_hal_reset(void) {
+    microbit_hal_serial_tx_flush();
     microbit_reset();
 }
 
@@ -103,10 +151,21 @@ void microbit_hal_panic(int code) {
     microbit_panic(code);
 }
 
+uint32_t microbit_hal_boot_time_us(void) {
+    return boot_time_us;
+}
+
 int microbit_hal_temperature(void) {
     return uBit.thermometer.getTemperature();
 }
 
+// Wake sources for a light sleep are polled, because the CPU just idles with RAM, the
+// peripherals and the VM state left running.  A pin wakes when it changes from the level
+// it had when the sleep began.
+static uint64_t light_sleep_wake_pins;
+static uint64_t light_sleep_pin_level;
+static uint8_t light_sleep_wake_buttons;
+
 void microbit_hal_power_clear_wake_sources(void) {
     for (size_t i = 0; i < HAL_ARRAY_SIZE(pin_obj); ++i) {
         microbit_hal_power_wake_on_pin(i, false);
@@ -118,17 +177,29 @@ void microbit_hal_power_clear_wake_sources(void) {
 
 void microbit_hal_power_wake_on_button(int button, bool wake_on_active) {
     button_obj[button]->wakeOnActive(wake_on_active);
+    if (wake_on_active) {
+        light_sleep_wake_buttons |= 1 << button;
+    } else {
+        light_sleep_wake_buttons &= ~(1 << button);
+    }
 }
 
 void microbit_hal_power_wake_on_pin(int pin, bool wake_on_active) {
     pin_obj[pin]->wakeOnActive(wake_on_active);
+    if (wake_on_active) {
+        light_sleep_wake_pins |= (uint64_t)1 << pin;
+    } else {
+        light_sleep_wake_pins &= ~((uint64_t)1 << pin);
+    }
 }
 
 void microbit_hal_power_off(void) {
+    microbit_hal_serial_tx_flush();
     uBit.power.off();
 }
 
 bool microbit_hal_power_deep_sleep(bool wake_on_ms, uint32_t ms) {
+    microbit_hal_serial_tx_flush();
     if (wake_on_ms) {
         return uBit.power.deepSleep(ms, true);
     } else {
@@ -137,6 +208,30 @@ bool microbit_hal_power_deep_sleep(bool wake_on_ms, uint32_t ms) {
     }
 }
 
+void microbit_hal_power_light_sleep_begin(void) {
+    light_sleep_pin_level = 0;
+    for (size_t i = 0; i < HAL_ARRAY_SIZE(pin_obj); ++i) {
+        if ((light_sleep_wake_pins & ((uint64_t)1 << i)) && pin_obj[i]->getDigitalValue()) {
+            light_sleep_pin_level |= (uint64_t)1 << i;
+        }
+    }
+}
+
+bool microbit_hal_power_wake_source_active(void) {
+    for (size_t i = 0; i < HAL_ARRAY_SIZE(button_obj); ++i) {
+        if ((light_sleep_wake_buttons & (1 << i)) && button_obj[i]->isPressed()) {
+            return true;
+        }
+    }
+    for (size_t i = 0; i < HAL_ARRAY_SIZE(pin_obj); ++i) {
+        uint64_t mask = (uint64_t)1 << i;
+        if ((light_sleep_wake_pins & mask) && !pin_obj[i]->getDigitalValue() != !(light_sleep_pin_level & mask)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void microbit_hal_pin_set_pull(int pin, int pull) {
     pin_obj[pin]->setPull(pin_pull_mode_mapping[pull]);
     pin_pull_state[pin] = pull;
@@ -179,8 +274,68 @@ int microbit_hal_pin_get_analog_period_us(int pin) {
     }
 }
 
+// Touch pins are scanned in the background by CODAL, which debounces each one and raises
+// an event when it is touched or released.  The state is kept here from those events, so
+// reading it doesn't have to go through CODAL.
+static const uint8_t touch_pins[4] = {
+    MICROBIT_HAL_PIN_P0,
+    MICROBIT_HAL_PIN_P1,
+    MICROBIT_HAL_PIN_P2,
+    MICROBIT_HAL_PIN_LOGO,
+};
+
+static int touch_index(int pin) {
+    return pin == MICROBIT_HAL_PIN_LOGO ? 3 : pin; // pin0/1/2
+}
+
+static void touch_event_handler(Event evt) {
+    for (size_t i = 0; i < sizeof(touch_pins); ++i) {
+        int pin = touch_pins[i];
+        if (pin_obj[pin]->id != evt.source) {
+            continue;
+        }
+        if (evt.value == DEVICE_BUTTON_EVT_DOWN) {
+            touch_pressed |= 1 << i;
+            // Low bit is "was touched at least once", upper bits are "number of touches".
+            touch_state[i] = (touch_state[i] + 2) | 1;
+        } else if (evt.value == DEVICE_BUTTON_EVT_UP) {
+            touch_pressed &= ~(1 << i);
+        } else {
+            return;
+        }
+        microbit_hal_touch_callback(pin, evt.value);
+        return;
+    }
+}
+
+// Start the background scan of a pin in the given TouchMode, or its current one if mode
+// is negative, and take its state from CODAL.
+static void touch_scan_start(int pin, int mode) {
+    int i = touch_index(pin);
+    if (!(touch_listening & (1 << i))) {
+        touch_listening |= 1 << i;
+        uBit.messageBus.listen(pin_obj[pin]->id, DEVICE_EVT_ANY, touch_event_handler);
+    }
+    bool touched;
+    if (mode < 0) {
+        touched = pin_obj[pin]->isTouched();
+    } else {
+        touched = pin_obj[pin]->isTouched((TouchMode)mode);
+    }
+    // Presses counted by CODAL before now are already in touch_state, so discard them.
+    pin_obj[pin]->wasTouched();
+    if (touched) {
+        touch_pressed |= 1 << i;
+    } else {
+        touch_pressed &= ~(1 << i);
+    }
+}
+
 void microbit_hal_pin_set_touch_mode(int pin, int mode) {
-    pin_obj[pin]->isTouched((TouchMode)mode);
+    if (pin == MICROBIT_HAL_PIN_LOGO) {
+        logo_touch_init_done = true;
+    }
+    touch_scan_start(pin, mode);
 }
 
 int microbit_hal_pin_read(int pin) {
@@ -203,21 +358,110 @@ void microbit_hal_pin_write_analog_u10(int pin, int value) {
     pin_obj[pin]->setAnalogValue(value);
 }
 
+// Receives blocks of samples from an ADC channel, which the SAADC fills by EasyDMA at the
+// ADC's sample rate, and copies them into a ring buffer owned by the caller.  This runs
+// from the ADC interrupt.
+class PinSampleSink : public DataSink {
+public:
+    NRF52ADCChannel *channel;
+    int pin;
+    uint8_t *buf;
+    size_t num_samples;
+    size_t sample_size;
+    size_t pos;
+
+    virtual int pullRequest() {
+        ManagedBuffer data = channel->pull();
+        const int16_t *src = (const int16_t *)data.getBytes();
+        size_t n = data.length() / sizeof(int16_t);
+        for (size_t i = 0; i < n; ++i) {
+            int value = src[i] < 0 ? 0 : src[i];
+            if (sample_size == 1) {
+                buf[pos] = value >> 2;
+            } else {
+                ((uint16_t *)buf)[pos] = value;
+            }
+            if (++pos == num_samples / 2) {
+                microbit_hal_pin_sample_callback(0);
+            } else if (pos == num_samples) {
+                pos = 0;
+                microbit_hal_pin_sample_callback(1);
+            }
+        }
+        return DEVICE_OK;
+    }
+};
+
+static PinSampleSink pin_sample_sink;
+
+// Start streaming 10-bit samples from the pin into buf, which must stay valid until
+// microbit_hal_pin_sample_stop() is called.  Samples are 8-bit (the top bits) if
+// sample_size is 1, otherwise 16-bit.  The ADC's sample rate is shared by all of its
+// channels, including the microphone's.
+int microbit_hal_pin_sample_start(int pin, uint32_t rate_hz, void *buf, size_t num_samples, size_t sample_size) {
+    microbit_hal_pin_sample_stop();
+    NRF52ADCChannel *channel = uBit.adc.getChannel(*pin_obj[pin]);
+    if (channel == NULL) {
+        return -1;
+    }
+    pin_sample_sink.channel = channel;
+    pin_sample_sink.pin = pin;
+    pin_sample_sink.buf = (uint8_t *)buf;
+    pin_sample_sink.num_samples = num_samples;
+    pin_sample_sink.sample_size = sample_size;
+    pin_sample_sink.pos = 0;
+    uBit.adc.setSamplePeriod(1000000 / rate_hz);
+    channel->output.connect(pin_sample_sink);
+    return 0;
+}
+
+void microbit_hal_pin_sample_stop(void) {
+    if (pin_sample_sink.channel != NULL) {
+        pin_sample_sink.channel->output.disconnect();
+        uBit.adc.releaseChannel(*pin_obj[pin_sample_sink.pin]);
+        pin_sample_sink.channel = NULL;
+    }
+}
+
+// Edge events are generated by CODAL in the GPIOTE interrupt, with the time they
+// happened, and handled there by an immediate listener.
+static void pin_edge_event_handler(Event evt) {
+    for (size_t i = 0; i <= MICROBIT_HAL_PIN_P20; ++i) {
+        if (pin_obj[i]->id == evt.source) {
+            microbit_hal_pin_edge_callback(i, evt.value == DEVICE_PIN_EVT_RISE, (uint32_t)evt.timestamp);
+            return;
+        }
+    }
+}
+
+int microbit_hal_pin_set_edge_events(int pin, bool enable) {
+    NRF52Pin *p = pin_obj[pin];
+    if (enable) {
+        uBit.messageBus.listen(p->id, DEVICE_PIN_EVT_RISE, pin_edge_event_handler, MESSAGE_BUS_LISTENER_IMMEDIATE);
+        uBit.messageBus.listen(p->id, DEVICE_PIN_EVT_FALL, pin_edge_event_handler, MESSAGE_BUS_LISTENER_IMMEDIATE);
+        if (p->eventOn(DEVICE_PIN_EVENT_ON_EDGE) != DEVICE_OK) {
+            return MICROBIT_HAL_DEVICE_ERROR;
+        }
+    } else {
+        p->eventOn(DEVICE_PIN_EVENT_NONE);
+        uBit.messageBus.ignore(p->id, DEVICE_PIN_EVT_RISE, pin_edge_event_handler);
+        uBit.messageBus.ignore(p->id, DEVICE_PIN_EVT_FALL, pin_edge_event_handler);
+    }
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
 int microbit_hal_pin_touch_state(int pin, int *was_touched, int *num_touches) {
+    if (pin == MICROBIT_HAL_PIN_LOGO && !logo_touch_init_done) {
+        // Unlike the edge pins the logo defaults to capacitive touch, which is only
+        // started once it's used because it keeps sampling in the background.
+        microbit_hal_pin_set_touch_mode(pin, (int)TouchMode::Capacitative);
+    } else if (!(pin_obj[pin]->status & IO_STATUS_TOUCH_IN)) {
+        // First use, or the pin was used for something else since, which stops the scan.
+        touch_scan_start(pin, -1);
+    }
+    int pin_state_index = touch_index(pin);
     if (was_touched != NULL || num_touches != NULL) {
-        int pin_state_index;
-        if (pin == MICROBIT_HAL_PIN_LOGO) {
-            pin_state_index = 3;
-        } else {
-            pin_state_index = pin; // pin0/1/2
-        }
-        int t = pin_obj[pin]->wasTouched();
         uint16_t state = touch_state[pin_state_index];
-        if (t) {
-            // Update state based on number of touches since last call.
-            // Low bit is "was touched at least once", upper bits are "number of touches".
-            state = (state + (t << 1)) | 1;
-        }
         if (was_touched != NULL) {
             *was_touched = state & 1;
             state &= ~1;
@@ -229,11 +473,7 @@ int microbit_hal_pin_touch_state(int pin, int *was_touched, int *num_touches) {
         touch_state[pin_state_index] = state;
     }
 
-    return pin_obj[pin]->isTouched();
-}
-
-void microbit_hal_pin_write_ws2812(int pin, const uint8_t *buf, size_t len) {
-    neopixel_send_buffer(*pin_obj[pin], buf, len);
+    return (touch_pressed >> pin_state_index) & 1;
 }
 
 int microbit_hal_i2c_init(int scl, int sda, int freq) {
@@ -266,6 +506,7 @@ int microbit_hal_i2c_writeto(uint8_t addr, const uint8_t *buf, size_t len, int s
 
 int microbit_hal_uart_init(int tx, int rx, int baudrate, int bits, int parity, int stop) {
     // TODO set bits, parity stop
+    microbit_hal_serial_tx_flush();
     int ret = uBit.serial.redirect(*pin_obj[tx], *pin_obj[rx]);
     if (ret != DEVICE_OK) {
         return ret;
@@ -277,12 +518,17 @@ int microbit_hal_uart_init(int tx, int rx, int baudrate, int bits, int parity, i
     return 0;
 }
 
+// The SPIM instance given to the spi object, which is also used directly to abort a transfer.
+static NRF_SPIM_Type *const spi_spim = NRF_SPIM2;
 static NRF52SPI *spi = NULL;
 
+// Stopping takes at most one byte time at the slowest frequency, 125kHz.
+#define SPI_ABORT_TIMEOUT_US (1000)
+
 int microbit_hal_spi_init(int sclk, int mosi, int miso, int frequency, int bits, int mode) {
     int ret;
     if (spi == NULL) {
-        spi = new NRF52SPI(*pin_obj[mosi], *pin_obj[miso], *pin_obj[sclk], NRF_SPIM2);
+        spi = new NRF52SPI(*pin_obj[mosi], *pin_obj[miso], *pin_obj[sclk], spi_spim);
     } else {
         ret = spi->redirect(*pin_obj[mosi], *pin_obj[miso], *pin_obj[sclk]);
         if (ret != DEVICE_OK) {
@@ -310,6 +556,40 @@ int microbit_hal_spi_transfer(size_t len, const uint8_t *src, uint8_t *dest) {
     return ret;
 }
 
+static void spi_transfer_done_handler(void *arg) {
+    (void)arg;
+    microbit_hal_spi_transfer_done_callback();
+}
+
+// Start a transfer that the SPIM clocks out by EasyDMA, returning straight away.
+// microbit_hal_spi_transfer_done_callback() is called from the SPIM interrupt when the
+// transfer completes, and may start the next one.  The buffers must stay valid until then.
+int microbit_hal_spi_transfer_start(size_t len, const uint8_t *src, uint8_t *dest) {
+    return spi->startTransfer(src, len, dest, dest == NULL ? 0 : len, spi_transfer_done_handler, NULL);
+}
+
+// Stop a transfer started by microbit_hal_spi_transfer_start(), so its buffers can be freed.
+// The done callback may still run if the END event was already pending.
+void microbit_hal_spi_transfer_abort(void) {
+    if (spi == NULL) {
+        return;
+    }
+    spi_spim->EVENTS_STOPPED = 0;
+    spi_spim->TASKS_STOP = 1;
+    uint32_t start = system_timer_current_time_us();
+    while (!spi_spim->EVENTS_STOPPED) {
+        if ((uint32_t)system_timer_current_time_us() - start >= SPI_ABORT_TIMEOUT_US) {
+            // Disabling the peripheral stops EasyDMA for certain.
+            uint32_t enable = spi_spim->ENABLE;
+            spi_spim->ENABLE = 0;
+            spi_spim->ENABLE = enable;
+            break;
+        }
+    }
+    spi_spim->EVENTS_STOPPED = 0;
+    spi_spim->EVENTS_END = 0;
+}
+
 int microbit_hal_button_state(int button, int *was_pressed, int *num_presses) {
     Button *b = button_obj[button];
     if (was_pressed != NULL || num_presses != NULL) {
@@ -350,29 +630,65 @@ int microbit_hal_display_get_pixel(int x, int y) {
     }
 }
 
+// This mapping is designed to give a set of 10 visually distinct levels.
+static const uint8_t display_bright_map[10] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 255 };
+
 void microbit_hal_display_set_pixel(int x, int y, int bright) {
-    // This mapping is designed to give a set of 10 visually distinct levels.
-    static uint8_t bright_map[10] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 255 };
     if (bright < 0) {
         bright = 0;
     } else if (bright > 9) {
         bright = 9;
     }
-    uBit.display.image.setPixelValue(x, y, bright_map[bright]);
+    uBit.display.image.setPixelValue(x, y, display_bright_map[bright]);
+}
+
+// Write a whole 5x5 frame of brightness values (0-9, row major) in one go.
+void microbit_hal_display_commit(const uint8_t *buf) {
+    uint8_t *bitmap = uBit.display.image.getBitmap();
+    for (int i = 0; i < 25; ++i) {
+        bitmap[i] = display_bright_map[buf[i] > 9 ? 9 : buf[i]];
+    }
 }
 
 int microbit_hal_display_read_light_level(void) {
     return uBit.display.readLightLevel();
 }
 
+// Listening for gestures makes CODAL keep the accelerometer sampling, so is only done
+// once the accelerometer is used.
+void microbit_hal_accelerometer_init(void) {
+    if (!accelerometer_init_done) {
+        accelerometer_init_done = true;
+        uBit.messageBus.listen(DEVICE_ID_GESTURE, DEVICE_EVT_ANY, gesture_event_handler);
+    }
+}
+
+// While the hardware FIFO is enabled, reading the sensor's output registers would pop
+// samples from the FIFO, so CODAL is stopped from sampling and these return the sample
+// and gesture seen when the FIFO was enabled.
+static bool accelerometer_fifo_enabled = false;
+static Sample3D accelerometer_fifo_held_sample;
+static Sample3D accelerometer_fifo_held_sample_ned;
+static int accelerometer_fifo_held_gesture;
+
+static Sample3D accelerometer_get_sample(CoordinateSystem system) {
+    if (accelerometer_fifo_enabled) {
+        return system == NORTH_EAST_DOWN ? accelerometer_fifo_held_sample_ned : accelerometer_fifo_held_sample;
+    }
+    return uBit.accelerometer.getSample(system);
+}
+
 void microbit_hal_accelerometer_get_sample(int axis[3]) {
-    Sample3D sample = uBit.accelerometer.getSample();
+    Sample3D sample = accelerometer_get_sample(SIMPLE_CARTESIAN);
     axis[0] = sample.x;
     axis[1] = sample.y;
     axis[2] = sample.z;
 }
 
 int microbit_hal_accelerometer_get_gesture(void) {
+    if (accelerometer_fifo_enabled) {
+        return accelerometer_fifo_held_gesture;
+    }
     return uBit.accelerometer.getGesture();
 }
 
@@ -380,6 +696,131 @@ void microbit_hal_accelerometer_set_range(int r) {
     uBit.accelerometer.setRange(r);
 }
 
+// Registers of the LSM303AGR accelerometer, on the internal I2C bus.
+#define LSM303_A_ADDR (0x32)
+#define LSM303_A_CTRL_REG1 (0x20)
+#define LSM303_A_CTRL_REG5 (0x24)
+#define LSM303_A_OUT_X_L (0x28)
+#define LSM303_A_FIFO_CTRL_REG (0x2e)
+#define LSM303_A_FIFO_SRC_REG (0x2f)
+#define LSM303_A_CTRL_REG5_FIFO_EN (0x40)
+#define LSM303_A_FIFO_MODE_STREAM (0x80)
+#define LSM303_A_FIFO_SRC_FSS_MASK (0x1f)
+#define LSM303_A_FIFO_SRC_OVRN (0x40)
+#define LSM303_A_AUTO_INCREMENT (0x80)
+#define LSM303_A_FIFO_DEPTH (32)
+
+static const uint16_t lsm303_odr_hz[] = { 0, 1, 10, 25, 50, 100, 200, 400 };
+
+// CODAL's status bits that make it poll the accelerometer from the scheduler, saved
+// while the FIFO is enabled.
+static uint16_t accelerometer_fifo_saved_ticks;
+
+// Stop CODAL polling the sensor and updating gestures, keeping its last readings.
+static void accelerometer_codal_sampling_stop(void) {
+    accelerometer_fifo_held_sample = uBit.accelerometer.getSample(SIMPLE_CARTESIAN);
+    accelerometer_fifo_held_sample_ned = uBit.accelerometer.getSample(NORTH_EAST_DOWN);
+    accelerometer_fifo_held_gesture = uBit.accelerometer.getGesture();
+    if (accelerometer_init_done) {
+        uBit.messageBus.ignore(DEVICE_ID_GESTURE, DEVICE_EVT_ANY, gesture_event_handler);
+    }
+    uint16_t ticks = DEVICE_COMPONENT_STATUS_IDLE_TICK | DEVICE_COMPONENT_STATUS_SYSTEM_TICK;
+    accelerometer_fifo_saved_ticks = uBit.accelerometer.status & ticks;
+    uBit.accelerometer.status &= ~ticks;
+}
+
+static void accelerometer_codal_sampling_restart(void) {
+    uBit.accelerometer.status |= accelerometer_fifo_saved_ticks;
+    if (accelerometer_init_done) {
+        uBit.messageBus.listen(DEVICE_ID_GESTURE, DEVICE_EVT_ANY, gesture_event_handler);
+    }
+}
+
+// Enable the accelerometer's hardware FIFO, sampling at (at least) rate_hz, or disable it
+// and hand the sensor back to CODAL if rate_hz is 0.  Returns the rate actually used.
+int microbit_hal_accelerometer_fifo_enable(int rate_hz) {
+    MicroBitI2C &i2c = uBit._i2c;
+    if (!LSM303Accelerometer::isDetected(i2c, LSM303_A_ADDR)) {
+        return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+    }
+
+    uint8_t reg5;
+    if (i2c.readRegister(LSM303_A_ADDR, LSM303_A_CTRL_REG5, &reg5, 1) != DEVICE_OK) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+
+    if (rate_hz == 0) {
+        if (!accelerometer_fifo_enabled) {
+            return 0;
+        }
+        i2c.writeRegister(LSM303_A_ADDR, LSM303_A_FIFO_CTRL_REG, 0);
+        i2c.writeRegister(LSM303_A_ADDR, LSM303_A_CTRL_REG5, reg5 & ~LSM303_A_CTRL_REG5_FIFO_EN);
+        accelerometer_fifo_enabled = false;
+        // Setting the period makes CODAL reconfigure the sensor's data rate.
+        uBit.accelerometer.setPeriod(uBit.accelerometer.getPeriod());
+        accelerometer_codal_sampling_restart();
+        return 0;
+    }
+
+    size_t odr = 1;
+    while (odr < HAL_ARRAY_SIZE(lsm303_odr_hz) - 1 && lsm303_odr_hz[odr] < rate_hz) {
+        ++odr;
+    }
+
+    if (!accelerometer_fifo_enabled) {
+        accelerometer_codal_sampling_stop();
+    }
+
+    // Keep CODAL's power mode and enabled axes, and change only the data rate.  Switching
+    // through bypass mode clears any old samples from the FIFO.
+    uint8_t reg1;
+    if (i2c.readRegister(LSM303_A_ADDR, LSM303_A_CTRL_REG1, &reg1, 1) != DEVICE_OK) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+    i2c.writeRegister(LSM303_A_ADDR, LSM303_A_CTRL_REG1, (odr << 4) | (reg1 & 0x0f));
+    i2c.writeRegister(LSM303_A_ADDR, LSM303_A_FIFO_CTRL_REG, 0);
+    i2c.writeRegister(LSM303_A_ADDR, LSM303_A_CTRL_REG5, reg5 | LSM303_A_CTRL_REG5_FIFO_EN);
+    i2c.writeRegister(LSM303_A_ADDR, LSM303_A_FIFO_CTRL_REG, LSM303_A_FIFO_MODE_STREAM);
+    accelerometer_fifo_enabled = true;
+    return lsm303_odr_hz[odr];
+}
+
+// Read all samples queued in the FIFO, up to max_samples, as interleaved x, y, z values
+// in milli-g along the sensor's own axes.  The samples are read in a single I2C burst;
+// when the FIFO is enabled the sensor's address auto-increment wraps from the last
+// output register back to the first.  Returns the number of samples read.
+int microbit_hal_accelerometer_fifo_read(int16_t *buf, size_t max_samples) {
+    if (!accelerometer_fifo_enabled) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+    MicroBitI2C &i2c = uBit._i2c;
+    uint8_t src;
+    if (i2c.readRegister(LSM303_A_ADDR, LSM303_A_FIFO_SRC_REG, &src, 1) != DEVICE_OK) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+    // The FIFO holds its full depth when it has overrun.
+    size_t n = src & LSM303_A_FIFO_SRC_FSS_MASK;
+    if (src & LSM303_A_FIFO_SRC_OVRN) {
+        n = LSM303_A_FIFO_DEPTH;
+    }
+    if (n > max_samples) {
+        n = max_samples;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    if (i2c.readRegister(LSM303_A_ADDR, LSM303_A_OUT_X_L | LSM303_A_AUTO_INCREMENT, (uint8_t *)buf, n * 6) != DEVICE_OK) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+
+    // The raw values are left-justified, with full scale at the current range (in g).
+    int32_t range = uBit.accelerometer.getRange();
+    for (size_t i = 0; i < n * 3; ++i) {
+        buf[i] = buf[i] * range * 1000 >> 15;
+    }
+    return n;
+}
+
 int microbit_hal_compass_is_calibrated(void) {
     return uBit.compass.isCalibrated();
 }
@@ -399,6 +840,24 @@ void microbit_hal_compass_get_sample(int axis[3]) {
     axis[2] = sample.z;
 }
 
+// One magnetometer sample, both as for microbit_hal_compass_get_sample() and in the
+// north-east-down coordinates used for a tilt-compensated heading, along with the
+// accelerometer sample to compensate it with.
+void microbit_hal_compass_get_samples(int axis[3], int mag_ned[3], int accel_ned[3]) {
+    Sample3D sample = uBit.compass.getSample();
+    axis[0] = sample.x;
+    axis[1] = sample.y;
+    axis[2] = sample.z;
+    sample = uBit.compass.getSample(NORTH_EAST_DOWN);
+    mag_ned[0] = sample.x;
+    mag_ned[1] = sample.y;
+    mag_ned[2] = sample.z;
+    sample = accelerometer_get_sample(NORTH_EAST_DOWN);
+    accel_ned[0] = sample.x;
+    accel_ned[1] = sample.y;
+    accel_ned[2] = sample.z;
+}
+
 int microbit_hal_compass_get_field_strength(void) {
     return uBit.compass.getFieldStrength();
 }
@@ -421,7 +880,125 @@ static int microbit_hal_log_convert_return_value(int result) {
     }
 }
 
+// With the buffered policy, rows are staged in RAM and committed to MicroBitLog in
+// batches from microbit_hal_idle(), so that adding a row doesn't wait for flash to be
+// programmed.  A batch is committed once the oldest row is max_delay_ms old, when the
+// buffer is half full, or straight away if a row doesn't fit.  Errors from a deferred
+// commit are returned by the next call to begin a row or flush.
+//
+// Each staged row is its 32-bit time in milliseconds followed by key\0value\0 pairs and
+// an empty key.  MicroBitLog would stamp rows with the time they are committed, so while
+// buffering its timestamp is turned off and staged rows carry their own time column.
+#define LOG_STAGING_SIZE (2048)
+
+static char log_staging[LOG_STAGING_SIZE];
+static size_t log_staging_len = 0; // complete rows
+static size_t log_row_len = 0; // row being built, which follows the complete rows
+static int log_policy = MICROBIT_HAL_LOG_POLICY_IMMEDIATE;
+static uint32_t log_max_delay_ms;
+static uint32_t log_oldest_ms;
+static int log_pending_error = MICROBIT_HAL_DEVICE_OK;
+static int log_timestamp = MICROBIT_HAL_LOG_TIMESTAMP_NONE;
+
+// Format the time as milliseconds, or otherwise to two decimal places of the unit, whose
+// length is in units of 100ms.  buf must have room for 14 characters.
+static void log_format_time(char *buf, uint32_t ms) {
+    uint32_t value = ms;
+    int decimals = 0;
+    if (log_timestamp != MICROBIT_HAL_LOG_TIMESTAMP_MILLISECONDS) {
+        value = ms / log_timestamp / 10;
+        decimals = 2;
+    }
+    char digits[12];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0 || n <= decimals);
+    while (n > 0) {
+        if (n == decimals) {
+            *buf++ = '.';
+        }
+        *buf++ = digits[--n];
+    }
+    *buf = '\0';
+}
+
+static const char *log_time_heading(void) {
+    switch (log_timestamp) {
+        case MICROBIT_HAL_LOG_TIMESTAMP_MILLISECONDS: return "Time (milliseconds)";
+        case MICROBIT_HAL_LOG_TIMESTAMP_SECONDS: return "Time (seconds)";
+        case MICROBIT_HAL_LOG_TIMESTAMP_MINUTES: return "Time (minutes)";
+        case MICROBIT_HAL_LOG_TIMESTAMP_HOURS: return "Time (hours)";
+        default: return "Time (days)";
+    }
+}
+
+static int log_commit(void) {
+    int ret = MICROBIT_HAL_DEVICE_OK;
+    size_t pos = 0;
+    while (pos < log_staging_len) {
+        uint32_t ms;
+        memcpy(&ms, &log_staging[pos], sizeof(ms));
+        pos += sizeof(ms);
+        uBit.log.beginRow();
+        if (log_timestamp != MICROBIT_HAL_LOG_TIMESTAMP_NONE) {
+            char time_buf[16];
+            log_format_time(time_buf, ms);
+            uBit.log.logData(log_time_heading(), time_buf);
+        }
+        while (log_staging[pos] != '\0') {
+            const char *key = &log_staging[pos];
+            pos += strlen(key) + 1;
+            const char *value = &log_staging[pos];
+            pos += strlen(value) + 1;
+            uBit.log.logData(key, value);
+        }
+        ++pos;
+        int r = microbit_hal_log_convert_return_value(uBit.log.endRow());
+        if (r != MICROBIT_HAL_DEVICE_OK) {
+            ret = r;
+        }
+    }
+
+    // Keep any row that is still being built.
+    memmove(log_staging, &log_staging[log_staging_len], log_row_len);
+    log_staging_len = 0;
+    return ret;
+}
+
+static void microbit_hal_log_idle(void) {
+    if (log_staging_len > 0
+        && (log_staging_len >= LOG_STAGING_SIZE / 2
+            || (uint32_t)system_timer_current_time() - log_oldest_ms >= log_max_delay_ms)) {
+        int ret = log_commit();
+        if (ret != MICROBIT_HAL_DEVICE_OK) {
+            log_pending_error = ret;
+        }
+    }
+}
+
+int microbit_hal_log_flush(void) {
+    int ret = log_commit();
+    if (log_pending_error != MICROBIT_HAL_DEVICE_OK) {
+        ret = log_pending_error;
+        log_pending_error = MICROBIT_HAL_DEVICE_OK;
+    }
+    return ret;
+}
+
+void microbit_hal_log_set_policy(int policy, uint32_t max_delay_ms) {
+    microbit_hal_log_flush();
+    log_row_len = 0;
+    log_policy = policy;
+    log_max_delay_ms = max_delay_ms;
+    uBit.log.setTimeStamp(policy == MICROBIT_HAL_LOG_POLICY_IMMEDIATE ? (TimeStampFormat)log_timestamp : TimeStampFormat::None);
+}
+
 void microbit_hal_log_delete(bool full_erase) {
+    log_staging_len = 0;
+    log_row_len = 0;
+    log_pending_error = MICROBIT_HAL_DEVICE_OK;
     uBit.log.clear(full_erase);
 }
 
@@ -436,19 +1013,72 @@ void microbit_hal_log_set_timestamp(int period) {
     static_assert(MICROBIT_HAL_LOG_TIMESTAMP_MINUTES == (int)TimeStampFormat::Minutes);
     static_assert(MICROBIT_HAL_LOG_TIMESTAMP_HOURS == (int)TimeStampFormat::Hours);
     static_assert(MICROBIT_HAL_LOG_TIMESTAMP_DAYS == (int)TimeStampFormat::Days);
-    uBit.log.setTimeStamp((TimeStampFormat)period);
+    // Rows already staged are committed with the format they were added under.
+    microbit_hal_log_flush();
+    log_timestamp = period;
+    if (log_policy == MICROBIT_HAL_LOG_POLICY_IMMEDIATE) {
+        uBit.log.setTimeStamp((TimeStampFormat)period);
+    }
 }
 
 int microbit_hal_log_begin_row(void) {
-    return microbit_hal_log_convert_return_value(uBit.log.beginRow());
+    if (log_policy == MICROBIT_HAL_LOG_POLICY_IMMEDIATE) {
+        return microbit_hal_log_convert_return_value(uBit.log.beginRow());
+    }
+    int ret = log_pending_error;
+    log_pending_error = MICROBIT_HAL_DEVICE_OK;
+    log_row_len = sizeof(uint32_t);
+    if (log_staging_len + log_row_len > LOG_STAGING_SIZE) {
+        int r = log_commit();
+        if (ret == MICROBIT_HAL_DEVICE_OK) {
+            ret = r;
+        }
+    }
+    return ret;
 }
 
 int microbit_hal_log_end_row(void) {
-    return microbit_hal_log_convert_return_value(uBit.log.endRow());
+    if (log_policy == MICROBIT_HAL_LOG_POLICY_IMMEDIATE) {
+        return microbit_hal_log_convert_return_value(uBit.log.endRow());
+    }
+    if (log_row_len == 0) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+    if (log_staging_len + log_row_len + 1 > LOG_STAGING_SIZE) {
+        log_commit();
+    }
+    uint32_t ms = system_timer_current_time();
+    memcpy(&log_staging[log_staging_len], &ms, sizeof(ms));
+    log_staging[log_staging_len + log_row_len] = '\0';
+    if (log_staging_len == 0) {
+        log_oldest_ms = ms;
+    }
+    log_staging_len += log_row_len + 1;
+    log_row_len = 0;
+    return MICROBIT_HAL_DEVICE_OK;
 }
 
 int microbit_hal_log_data(const char *key, const char *value) {
-    return microbit_hal_log_convert_return_value(uBit.log.logData(key, value));
+    if (log_policy == MICROBIT_HAL_LOG_POLICY_IMMEDIATE) {
+        return microbit_hal_log_convert_return_value(uBit.log.logData(key, value));
+    }
+    if (log_row_len == 0) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+    size_t key_len = strlen(key) + 1;
+    size_t value_len = strlen(value) + 1;
+    // Leave room for the terminating empty key.
+    if (log_staging_len + log_row_len + key_len + value_len + 1 > LOG_STAGING_SIZE) {
+        log_commit();
+        if (log_row_len + key_len + value_len + 1 > LOG_STAGING_SIZE) {
+            return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+        }
+    }
+    char *dest = &log_staging[log_staging_len + log_row_len];
+    memcpy(dest, key, key_len);
+    memcpy(dest + key_len, value, value_len);
+    log_row_len += key_len + value_len;
+    return MICROBIT_HAL_DEVICE_OK;
 }
 
 // This is needed by the microbitfs implementation.
@@ -87,6 +87,11 @@ extern "C" {
 #define MICROBIT_HAL_ACCELEROMETER_EVT_SHAKE        (11)
 #define MICROBIT_HAL_ACCELEROMETER_EVT_2G           (12)
 
+// Button and touch pin events, passed to microbit_hal_button_callback() and
+// microbit_hal_touch_callback().  These match the CODAL values.
+#define MICROBIT_HAL_BUTTON_EVT_DOWN                (1)
+#define MICROBIT_HAL_BUTTON_EVT_UP                  (2)
+
 // Microphone events, passed to microbit_hal_level_detector_callback().
 #define MICROBIT_HAL_MICROPHONE_EVT_THRESHOLD_LOW   (1)
 #define MICROBIT_HAL_MICROPHONE_EVT_THRESHOLD_HIGH  (2)
@@ -96,6 +101,25 @@ extern "C" {
 #define MICROBIT_HAL_MICROPHONE_SET_THRESHOLD_LOW   (0)
 #define MICROBIT_HAL_MICROPHONE_SET_THRESHOLD_HIGH  (1)
 
+// Maximum number of buffers in the audio output ring.
+#define MICROBIT_HAL_AUDIO_MAX_BUFFERS (8)
+
+// Longest chunk of the audio output ring, see microbit_hal_audio_get_buffer().
+#define MICROBIT_HAL_AUDIO_MAX_CHUNK (256)
+
+// Longest chunk that can be streamed by microbit_hal_audio_select_direct().
+#define MICROBIT_HAL_AUDIO_DIRECT_MAX_CHUNK (MICROBIT_HAL_AUDIO_MAX_CHUNK)
+
+// Size of the built-in serial receive ring, and of CODAL's serial transmit buffer.
+#define MICROBIT_HAL_SERIAL_STDIN_RING_SIZE (512)
+#define MICROBIT_HAL_SERIAL_TX_BUFFER_SIZE (254)
+
+// Size of the ring that feeds the BLE stream characteristic, must be a power of 2.
+#define MICROBIT_HAL_BLE_STREAM_RING_SIZE (1024)
+
+// Number of samples the music channel synthesises each time it is pulled.
+#define MICROBIT_HAL_AUDIO_MUSIC_CHUNK_SIZE (128)
+
 #define MICROBIT_HAL_LOG_TIMESTAMP_NONE             (0)
 #define MICROBIT_HAL_LOG_TIMESTAMP_MILLISECONDS     (1)
 #define MICROBIT_HAL_LOG_TIMESTAMP_SECONDS          (10)
@@ -103,7 +127,15 @@ extern "C" {
 #define MICROBIT_HAL_LOG_TIMESTAMP_HOURS            (36000)
 #define MICROBIT_HAL_LOG_TIMESTAMP_DAYS             (864000)
 
+// When log rows are committed to flash, passed to microbit_hal_log_set_policy().
+#define MICROBIT_HAL_LOG_POLICY_IMMEDIATE           (0)
+#define MICROBIT_HAL_LOG_POLICY_BUFFERED            (1)
+
 void microbit_hal_idle(void);
+uint64_t microbit_hal_ticks_us64(void);
+void microbit_hal_timer_set_next_us(int64_t us);
+
+uint32_t microbit_hal_boot_time_us(void);
 
 __attribute__((noreturn)) void microbit_hal_reset(void);
 void microbit_hal_panic(int);
@@ -114,6 +146,8 @@ void microbit_hal_power_wake_on_button(int button, bool wake_on_active);
 void microbit_hal_power_wake_on_pin(int pin, bool wake_on_active);
 void microbit_hal_power_off(void);
 bool microbit_hal_power_deep_sleep(bool wake_on_ms, uint32_t ms);
+void microbit_hal_power_light_sleep_begin(void);
+bool microbit_hal_power_wake_source_active(void);
 
 void microbit_hal_pin_set_pull(int pin, int pull);
 int microbit_hal_pin_get_pull(int pin);
@@ -123,65 +157,130 @@ void microbit_hal_pin_set_touch_mode(int pin, int mode);
 int microbit_hal_pin_read(int pin);
 void microbit_hal_pin_write(int pin, int value);
 int microbit_hal_pin_read_analog_u10(int pin);
+int microbit_hal_pin_sample_start(int pin, uint32_t rate_hz, void *buf, size_t num_samples, size_t sample_size);
+void microbit_hal_pin_sample_stop(void);
+void microbit_hal_pin_sample_callback(size_t half);
+int microbit_hal_pin_set_edge_events(int pin, bool enable);
+void microbit_hal_pin_edge_callback(int pin, int value, uint32_t time_us);
 void microbit_hal_pin_write_analog_u10(int pin, int value);
 int microbit_hal_pin_touch_state(int pin, int *was_touched, int *num_touches);
+void microbit_hal_touch_callback(int pin, int event);
 void microbit_hal_pin_write_ws2812(int pin, const uint8_t *buf, size_t len);
 
+// The ws2812 DMA sequence has one word per bit, then a low period that latches the data.
+#define MICROBIT_HAL_WS2812_RESET_WORDS (240)
+#define MICROBIT_HAL_WS2812_SEQ_LEN(len) ((len) * 8 + MICROBIT_HAL_WS2812_RESET_WORDS)
+#define MICROBIT_HAL_WS2812_MAX_SEQ_LEN (32767)
+#define MICROBIT_HAL_WS2812_MAX_STRIPS (4)
+
+void microbit_hal_ws2812_encode(uint16_t *seq, size_t stride, const uint8_t *buf, size_t len, size_t total_len, int brightness);
+int microbit_hal_ws2812_start(const int *pins, size_t num_pins, const uint16_t *seq, size_t seq_len);
+bool microbit_hal_ws2812_busy(void);
+
 int microbit_hal_i2c_init(int scl, int sda, int freq);
 int microbit_hal_i2c_readfrom(uint8_t addr, uint8_t *buf, size_t len, int stop);
 int microbit_hal_i2c_writeto(uint8_t addr, const uint8_t *buf, size_t len, int stop);
 
 int microbit_hal_uart_init(int tx, int rx, int baudrate, int bits, int parity, int stop);
+void microbit_hal_serial_set_rx_ring(uint8_t *buf, size_t size);
+size_t microbit_hal_serial_read(uint8_t *buf, size_t len);
+void microbit_hal_serial_tx_flush(void);
+
+bool microbit_hal_ble_running(void);
+int microbit_hal_ble_stream_init(void);
+bool microbit_hal_ble_connected(void);
+size_t microbit_hal_ble_stream_space(void);
+size_t microbit_hal_ble_stream_write(const uint8_t *buf, size_t len);
+uint32_t microbit_hal_serial_get_rx_overflow(bool reset);
 
 int microbit_hal_spi_init(int sclk, int mosi, int miso, int frequency, int bits, int mode);
 int microbit_hal_spi_transfer(size_t len, const uint8_t *src, uint8_t *dest);
+int microbit_hal_spi_transfer_start(size_t len, const uint8_t *src, uint8_t *dest);
+void microbit_hal_spi_transfer_abort(void);
+void microbit_hal_spi_transfer_done_callback(void);
 
 int microbit_hal_button_state(int button, int *was_pressed, int *num_presses);
 
 void microbit_hal_display_enable(int value);
 int microbit_hal_display_get_pixel(int x, int y);
 void microbit_hal_display_set_pixel(int x, int y, int bright);
+void microbit_hal_display_commit(const uint8_t *buf);
 int microbit_hal_display_read_light_level(void);
 
+void microbit_hal_accelerometer_init(void);
 void microbit_hal_accelerometer_get_sample(int axis[3]);
 int microbit_hal_accelerometer_get_gesture(void);
 void microbit_hal_accelerometer_set_range(int r);
+int microbit_hal_accelerometer_fifo_enable(int rate_hz);
+int microbit_hal_accelerometer_fifo_read(int16_t *buf, size_t max_samples);
 
 int microbit_hal_compass_is_calibrated(void);
 void microbit_hal_compass_clear_calibration(void);
 void microbit_hal_compass_calibrate(void);
 void microbit_hal_compass_get_sample(int axis[3]);
+void microbit_hal_compass_get_samples(int axis[3], int mag_ned[3], int accel_ned[3]);
 int microbit_hal_compass_get_field_strength(void);
 int microbit_hal_compass_get_heading(void);
 
 void microbit_hal_microphone_init(void);
 void microbit_hal_microphone_set_threshold(int kind, int value);
 int microbit_hal_microphone_get_level(void);
+void microbit_hal_microphone_start_recording(uint8_t *buf, size_t len, uint32_t rate, bool loop);
+void microbit_hal_microphone_stop_recording(void);
+bool microbit_hal_microphone_is_recording(void);
+size_t microbit_hal_microphone_get_recording_pos(void);
+void microbit_hal_microphone_recording_callback(size_t half);
 
 const uint8_t *microbit_hal_get_font_data(char c);
 
 void microbit_hal_log_delete(bool full_erase);
 void microbit_hal_log_set_mirroring(bool serial);
+// A sound effect, with the same parameters as audio.SoundEffect.  Volumes are 0-255.
+typedef struct _microbit_hal_sound_effect_t {
+    uint16_t freq_start;
+    uint16_t freq_end;
+    uint16_t duration;
+    uint16_t steps;
+    uint16_t fx_param;
+    uint16_t fx_steps;
+    uint8_t vol_start;
+    uint8_t vol_end;
+    uint8_t waveform;
+    uint8_t fx;
+    uint8_t shape;
+} microbit_hal_sound_effect_t;
+
 void microbit_hal_log_set_timestamp(int period);
 int microbit_hal_log_begin_row(void);
 int microbit_hal_log_end_row(void);
 int microbit_hal_log_data(const char *key, const char *value);
+void microbit_hal_log_set_policy(int policy, uint32_t max_delay_ms);
+int microbit_hal_log_flush(void);
 
 void microbit_hal_audio_select_pin(int pin);
 void microbit_hal_audio_select_speaker(bool enable);
 void microbit_hal_audio_set_volume(int value);
 bool microbit_hal_audio_is_expression_active(void);
 void microbit_hal_audio_play_expression(const char *expr);
+void microbit_hal_audio_play_effects(const microbit_hal_sound_effect_t *effects, size_t num_effects);
 void microbit_hal_audio_stop_expression(void);
 
 void microbit_hal_audio_init(uint32_t sample_rate);
-void microbit_hal_audio_write_data(const uint8_t *buf, size_t num_samples);
+uint8_t *microbit_hal_audio_get_buffer(size_t index, size_t num_samples);
+bool microbit_hal_audio_write_buffer(size_t index);
+int microbit_hal_audio_select_direct(int pin);
+bool microbit_hal_audio_direct_is_active(void);
+bool microbit_hal_audio_direct_queue_full(void);
 void microbit_hal_audio_ready_callback(void);
+void microbit_hal_audio_direct_ready_callback(bool underrun);
 
 void microbit_hal_audio_speech_init(uint32_t sample_rate);
 void microbit_hal_audio_speech_write_data(const uint8_t *buf, size_t num_samples);
 void microbit_hal_audio_speech_ready_callback(void);
 
+void microbit_hal_audio_music_init(uint32_t sample_rate);
+size_t microbit_hal_audio_music_ready_callback(uint8_t *buf, size_t num_samples);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,20 +26,28 @@
 
 #include "main.h"
 #include "MicroBitDevice.h"
+#include "microbithal.h"
 
 class AudioSource : public DataSource {
 public:
     bool started;
     DataSink *sink;
     ManagedBuffer buf;
+    ManagedBuffer ring[MICROBIT_HAL_AUDIO_MAX_BUFFERS];
     void (*callback)(void);
     MixerChannel *channel;
 
+    bool direct; // data goes straight to a pin instead, see microbit_hal_audio_select_direct()
+
     AudioSource()
-        : started(false) {
+        : started(false), direct(false) {
     }
 
     virtual ManagedBuffer pull() {
+        if (direct) {
+            // Restarted by microbit_hal_audio_select_direct(-1).
+            return ManagedBuffer();
+        }
         callback();
         return buf;
     }
@@ -53,16 +61,119 @@ public:
     }
 };
 
+// Music is synthesised on demand, when the mixer pulls more samples from this channel,
+// so note timing is as accurate as the sample rate.
+class MusicSource : public AudioSource {
+public:
+    bool idle;
+
+    virtual ManagedBuffer pull() {
+        if (microbit_hal_audio_music_ready_callback(buf.getBytes(), buf.length()) == 0) {
+            // Nothing is playing; restarted by microbit_hal_audio_music_init().
+            idle = true;
+            return ManagedBuffer();
+        }
+        return buf;
+    }
+};
+
 static AudioSource data_source;
 static AudioSource speech_source;
+static MusicSource music_source;
+
+extern "C" void microbit_hal_sound_synth_callback(int);
+
+static void sound_synth_event_handler(Event evt) {
+    microbit_hal_sound_synth_callback(evt.value);
+}
 
 extern "C" {
 
 #include "microbithal.h"
 
+// Layout of the sound expression data that CODAL's synthesiser takes: each parameter is a
+// zero-padded decimal number at a fixed offset, and the unused parts are all '0'.
+#define SOUND_EXPR_WAVEFORM_OFFSET              (0)
+#define SOUND_EXPR_WAVEFORM_LENGTH              (1)
+#define SOUND_EXPR_VOLUME_START_OFFSET          (1)
+#define SOUND_EXPR_VOLUME_START_LENGTH          (4)
+#define SOUND_EXPR_FREQUENCY_START_OFFSET       (5)
+#define SOUND_EXPR_FREQUENCY_START_LENGTH       (4)
+#define SOUND_EXPR_DURATION_OFFSET              (9)
+#define SOUND_EXPR_DURATION_LENGTH              (4)
+#define SOUND_EXPR_SHAPE_OFFSET                 (13)
+#define SOUND_EXPR_SHAPE_LENGTH                 (2)
+#define SOUND_EXPR_FREQUENCY_END_OFFSET         (18)
+#define SOUND_EXPR_FREQUENCY_END_LENGTH         (4)
+#define SOUND_EXPR_VOLUME_END_OFFSET            (26)
+#define SOUND_EXPR_VOLUME_END_LENGTH            (4)
+#define SOUND_EXPR_STEPS_OFFSET                 (30)
+#define SOUND_EXPR_STEPS_LENGTH                 (4)
+#define SOUND_EXPR_FX_CHOICE_OFFSET             (34)
+#define SOUND_EXPR_FX_CHOICE_LENGTH             (2)
+#define SOUND_EXPR_FX_PARAM_OFFSET              (36)
+#define SOUND_EXPR_FX_PARAM_LENGTH              (4)
+#define SOUND_EXPR_FX_STEPS_OFFSET              (40)
+#define SOUND_EXPR_FX_STEPS_LENGTH              (4)
+#define SOUND_EXPR_TOTAL_LENGTH                 (72)
+
+#define SOUND_EXPR_ENCODE_VOLUME(v)             (((v) * 1023 + 127) / 255)
+
 static uint8_t sound_synth_active_count = 0;
+static bool audio_routing_init_done = false;
+
+// The data channel can bypass the mixer and stream straight to a pin, using a PWM instance
+// that CODAL leaves free (shared with the ws2812 output, so only one can use it at a time).
+// Each sample is one 16-bit compare word, held for a whole number of PWM periods by the
+// decoder, and EasyDMA plays the two halves of a double buffer in turn.  When one half
+// finishes the other starts without any CPU involvement, and the finished half is then
+// refilled from a short queue of chunks.  Chunks are copied into the queue when they are
+// written, and the interrupt only asks (via microbit_hal_audio_direct_ready_callback())
+// for the queue to be topped up, so a late chunk still plays instead of being replaced.
+#define AUDIO_DIRECT_PWM NRF_PWM3
+#define AUDIO_DIRECT_PWM_IRQn PWM3_IRQn
+#define AUDIO_DIRECT_PWM_CLOCK_HZ (16000000)
+
+// A sample is held for as many PWM periods as fit with at least 8 bits of resolution.
+#define AUDIO_DIRECT_MIN_COUNTERTOP (256)
+
+// Number of chunks that can wait to be played, besides the two halves being played.
+#define AUDIO_DIRECT_QUEUE_LEN (2)
+
+static int audio_direct_pin = -1;
+static uint32_t audio_direct_sample_rate;
+static int audio_direct_volume = 255;
+static uint16_t audio_direct_countertop;
+static uint16_t *audio_direct_seq[2];
+static size_t audio_direct_seq_len; // length of a half when it is filled with silence
+static uint16_t audio_direct_last_word;
+static uint8_t audio_direct_silent; // bit n set if half n holds silence
+static volatile bool audio_direct_running = false;
+static uint8_t *audio_direct_queue[AUDIO_DIRECT_QUEUE_LEN];
+static size_t audio_direct_queue_len[AUDIO_DIRECT_QUEUE_LEN];
+static volatile uint32_t audio_direct_queue_head; // written by the caller
+static volatile uint32_t audio_direct_queue_tail; // written by the interrupt
+
+// By default the speaker is enabled but no pin is selected.  This is set up when any
+// audio related code is first executed, rather than at startup.
+static void audio_routing_init(void) {
+    if (!audio_routing_init_done) {
+        audio_routing_init_done = true;
+        uBit.audio.setSpeakerEnabled(true);
+        uBit.audio.setPinEnabled(false);
+        uBit.messageBus.listen(DEVICE_ID_SOUND_EMOJI_SYNTHESIZER_0, DEVICE_EVT_ANY, sound_synth_event_handler);
+    }
+}
+
+static void sound_expr_encode(char *expr, size_t offset, size_t length, unsigned int value) {
+    for (size_t i = length; i > 0; --i) {
+        expr[offset + i - 1] = '0' + value % 10;
+        value /= 10;
+    }
+}
 
 void microbit_hal_audio_select_pin(int pin) {
+    audio_routing_init();
     if (pin < 0) {
         uBit.audio.setPinEnabled(false);
     } else {
@@ -72,12 +183,15 @@ void microbit_hal_audio_select_pin(int pin) {
 }
 
 void microbit_hal_audio_select_speaker(bool enable) {
+    audio_routing_init();
     uBit.audio.setSpeakerEnabled(enable);
 }
 
 // Input value has range 0-255 inclusive.
 void microbit_hal_audio_set_volume(int value) {
+    audio_routing_init();
     uBit.audio.setVolume(value);
+    audio_direct_volume = value;
 }
 
 void microbit_hal_sound_synth_callback(int event) {
@@ -91,6 +205,7 @@ bool microbit_hal_audio_is_expression_active(void) {
 }
 
 void microbit_hal_audio_play_expression(const char *expr) {
+    audio_routing_init();
     ++sound_synth_active_count;
     uBit.audio.soundExpressions.stop();
 
@@ -101,11 +216,221 @@ void microbit_hal_audio_play_expression(const char *expr) {
     uBit.audio.soundExpressions.playAsync(expr);
 }
 
+// Play a sequence of sound effects, one after the other.  They are encoded together in
+// a single pass, so the sequence starts without any work per effect from the caller.
+void microbit_hal_audio_play_effects(const microbit_hal_sound_effect_t *effects, size_t num_effects) {
+    if (num_effects == 0) {
+        return;
+    }
+
+    // Each effect is followed by a "," separator, the last one by a null terminator.
+    ManagedBuffer buf(num_effects * (SOUND_EXPR_TOTAL_LENGTH + 1));
+    char *expr = (char *)buf.getBytes();
+    memset(expr, '0', buf.length());
+    for (size_t i = 0; i < num_effects; ++i) {
+        const microbit_hal_sound_effect_t *fx = &effects[i];
+        sound_expr_encode(expr, SOUND_EXPR_WAVEFORM_OFFSET, SOUND_EXPR_WAVEFORM_LENGTH, fx->waveform);
+        sound_expr_encode(expr, SOUND_EXPR_VOLUME_START_OFFSET, SOUND_EXPR_VOLUME_START_LENGTH, SOUND_EXPR_ENCODE_VOLUME(fx->vol_start));
+        sound_expr_encode(expr, SOUND_EXPR_FREQUENCY_START_OFFSET, SOUND_EXPR_FREQUENCY_START_LENGTH, fx->freq_start);
+        sound_expr_encode(expr, SOUND_EXPR_DURATION_OFFSET, SOUND_EXPR_DURATION_LENGTH, fx->duration);
+        sound_expr_encode(expr, SOUND_EXPR_SHAPE_OFFSET, SOUND_EXPR_SHAPE_LENGTH, fx->shape);
+        sound_expr_encode(expr, SOUND_EXPR_FREQUENCY_END_OFFSET, SOUND_EXPR_FREQUENCY_END_LENGTH, fx->freq_end);
+        sound_expr_encode(expr, SOUND_EXPR_VOLUME_END_OFFSET, SOUND_EXPR_VOLUME_END_LENGTH, SOUND_EXPR_ENCODE_VOLUME(fx->vol_end));
+        sound_expr_encode(expr, SOUND_EXPR_STEPS_OFFSET, SOUND_EXPR_STEPS_LENGTH, fx->steps);
+        sound_expr_encode(expr, SOUND_EXPR_FX_CHOICE_OFFSET, SOUND_EXPR_FX_CHOICE_LENGTH, fx->fx);
+        sound_expr_encode(expr, SOUND_EXPR_FX_PARAM_OFFSET, SOUND_EXPR_FX_PARAM_LENGTH, fx->fx_param);
+        sound_expr_encode(expr, SOUND_EXPR_FX_STEPS_OFFSET, SOUND_EXPR_FX_STEPS_LENGTH, fx->fx_steps);
+        expr += SOUND_EXPR_TOTAL_LENGTH;
+        *expr++ = ',';
+    }
+    expr[-1] = '\0';
+
+    microbit_hal_audio_play_expression((const char *)buf.getBytes());
+}
+
 void microbit_hal_audio_stop_expression(void) {
     uBit.audio.soundExpressions.stop();
 }
 
+// Convert 8-bit unsigned samples into compare words for one half of the double buffer,
+// scaled by the volume around the mid level.  Bit 15 of each word sets the polarity so that
+// the output is high for the compare value at the start of each period.
+static void audio_direct_fill(int half, const uint8_t *src, size_t len) {
+    if (len > MICROBIT_HAL_AUDIO_DIRECT_MAX_CHUNK) {
+        len = MICROBIT_HAL_AUDIO_DIRECT_MAX_CHUNK;
+    }
+    uint16_t *seq = audio_direct_seq[half];
+    uint32_t top = audio_direct_countertop;
+    int volume = audio_direct_volume;
+    for (size_t i = 0; i < len; ++i) {
+        uint32_t level = (128 << 8) + ((int)src[i] - 128) * volume;
+        seq[i] = 0x8000 | ((level * top) >> 16);
+    }
+    AUDIO_DIRECT_PWM->SEQ[half].PTR = (uint32_t)seq;
+    AUDIO_DIRECT_PWM->SEQ[half].CNT = len;
+    audio_direct_seq_len = len;
+    audio_direct_last_word = seq[len - 1];
+    audio_direct_silent &= ~(1 << half);
+}
+
+// Fill one half with the last sample, so the output holds its level without a click.
+static void audio_direct_fill_silence(int half) {
+    uint16_t *seq = audio_direct_seq[half];
+    for (size_t i = 0; i < audio_direct_seq_len; ++i) {
+        seq[i] = audio_direct_last_word;
+    }
+    AUDIO_DIRECT_PWM->SEQ[half].PTR = (uint32_t)seq;
+    AUDIO_DIRECT_PWM->SEQ[half].CNT = audio_direct_seq_len;
+    audio_direct_silent |= 1 << half;
+}
+
+static void audio_direct_halt(void) {
+    if (audio_direct_running) {
+        AUDIO_DIRECT_PWM->INTEN = 0;
+        AUDIO_DIRECT_PWM->EVENTS_STOPPED = 0;
+        AUDIO_DIRECT_PWM->TASKS_STOP = 1;
+        // Stopping takes at most one PWM period, a few tens of microseconds.
+        while (!AUDIO_DIRECT_PWM->EVENTS_STOPPED) {
+        }
+        AUDIO_DIRECT_PWM->EVENTS_STOPPED = 0;
+        AUDIO_DIRECT_PWM->ENABLE = 0;
+        AUDIO_DIRECT_PWM->PSEL.OUT[0] = PWM_PSEL_OUT_CONNECT_Disconnected << PWM_PSEL_OUT_CONNECT_Pos;
+        audio_direct_running = false;
+    }
+    audio_direct_queue_tail = audio_direct_queue_head;
+}
+
+// Refill the given half, which has just finished playing, with the next queued chunk, then
+// ask for the queue to be topped up.
+static void audio_direct_refill(int half) {
+    bool underrun = audio_direct_queue_head == audio_direct_queue_tail;
+    if (!underrun) {
+        size_t slot = audio_direct_queue_tail % AUDIO_DIRECT_QUEUE_LEN;
+        audio_direct_fill(half, audio_direct_queue[slot], audio_direct_queue_len[slot]);
+        ++audio_direct_queue_tail;
+    } else if (audio_direct_silent & (1 << (1 - half))) {
+        // Both halves would be silent, so there is nothing left to play.
+        audio_direct_halt();
+    } else {
+        audio_direct_fill_silence(half);
+    }
+    microbit_hal_audio_direct_ready_callback(underrun);
+}
+
+static void audio_direct_irq_handler(void) {
+    for (int half = 0; half < 2; ++half) {
+        if (AUDIO_DIRECT_PWM->EVENTS_SEQEND[half]) {
+            AUDIO_DIRECT_PWM->EVENTS_SEQEND[half] = 0;
+            audio_direct_refill(half);
+        }
+    }
+}
+
+// Start playing from idle.  The first chunk is split across both halves, so the next one
+// only has to be queued by the time the first half has played.
+static void audio_direct_start(const uint8_t *src, size_t len) {
+    NVIC_SetVector(AUDIO_DIRECT_PWM_IRQn, (uint32_t)audio_direct_irq_handler);
+    NVIC_SetPriority(AUDIO_DIRECT_PWM_IRQn, 3);
+    NVIC_ClearPendingIRQ(AUDIO_DIRECT_PWM_IRQn);
+    NVIC_EnableIRQ(AUDIO_DIRECT_PWM_IRQn);
+
+    uint32_t ticks_per_sample = AUDIO_DIRECT_PWM_CLOCK_HZ / audio_direct_sample_rate;
+    uint32_t periods_per_sample = ticks_per_sample / AUDIO_DIRECT_MIN_COUNTERTOP;
+    if (periods_per_sample == 0) {
+        periods_per_sample = 1;
+    }
+    audio_direct_countertop = ticks_per_sample / periods_per_sample;
+
+    size_t first = (len + 1) / 2;
+    audio_direct_fill(0, src, first);
+    if (len > first) {
+        audio_direct_fill(1, src + first, len - first);
+    } else {
+        audio_direct_fill_silence(1);
+    }
+
+    AUDIO_DIRECT_PWM->PSEL.OUT[0] = pin_obj[audio_direct_pin]->name;
+    AUDIO_DIRECT_PWM->MODE = PWM_MODE_UPDOWN_Up;
+    AUDIO_DIRECT_PWM->PRESCALER = PWM_PRESCALER_PRESCALER_DIV_1;
+    AUDIO_DIRECT_PWM->COUNTERTOP = audio_direct_countertop;
+    AUDIO_DIRECT_PWM->DECODER = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos)
+        | (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+    for (int half = 0; half < 2; ++half) {
+        AUDIO_DIRECT_PWM->SEQ[half].REFRESH = periods_per_sample - 1;
+        AUDIO_DIRECT_PWM->SEQ[half].ENDDELAY = 0;
+        AUDIO_DIRECT_PWM->EVENTS_SEQEND[half] = 0;
+    }
+    // Play the two halves in turn for as many loops as possible, then start over.
+    AUDIO_DIRECT_PWM->LOOP = PWM_LOOP_CNT_Msk;
+    AUDIO_DIRECT_PWM->SHORTS = PWM_SHORTS_LOOPSDONE_SEQSTART0_Msk;
+    AUDIO_DIRECT_PWM->INTEN = PWM_INTEN_SEQEND0_Msk | PWM_INTEN_SEQEND1_Msk;
+    audio_direct_running = true;
+    AUDIO_DIRECT_PWM->ENABLE = 1;
+    AUDIO_DIRECT_PWM->TASKS_SEQSTART[0] = 1;
+    microbit_hal_audio_direct_ready_callback(false);
+}
+
+// Stream the data channel straight to the given pin, bypassing the mixer and speaker, or
+// pass -1 to go back to the mixer.  The mixer's own pin output should be disabled first.
+int microbit_hal_audio_select_direct(int pin) {
+    audio_routing_init();
+    if (pin == audio_direct_pin) {
+        return MICROBIT_HAL_DEVICE_OK;
+    }
+    audio_direct_halt();
+    if (pin < 0) {
+        free(audio_direct_seq[0]);
+        audio_direct_seq[0] = NULL;
+        audio_direct_seq[1] = NULL;
+        for (size_t i = 0; i < AUDIO_DIRECT_QUEUE_LEN; ++i) {
+            audio_direct_queue[i] = NULL;
+        }
+        audio_direct_pin = -1;
+        data_source.direct = false;
+        if (data_source.started) {
+            data_source.sink->pullRequest();
+        }
+        return MICROBIT_HAL_DEVICE_OK;
+    }
+    if (microbit_hal_ws2812_busy()) {
+        return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+    }
+    if (audio_direct_seq[0] == NULL) {
+        // One allocation holds both halves, followed by the queue.
+        audio_direct_seq[0] = (uint16_t *)malloc(2 * MICROBIT_HAL_AUDIO_DIRECT_MAX_CHUNK * sizeof(uint16_t)
+            + AUDIO_DIRECT_QUEUE_LEN * MICROBIT_HAL_AUDIO_DIRECT_MAX_CHUNK);
+        if (audio_direct_seq[0] == NULL) {
+            return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+        }
+        audio_direct_seq[1] = audio_direct_seq[0] + MICROBIT_HAL_AUDIO_DIRECT_MAX_CHUNK;
+        uint8_t *queue = (uint8_t *)(audio_direct_seq[1] + MICROBIT_HAL_AUDIO_DIRECT_MAX_CHUNK);
+        for (size_t i = 0; i < AUDIO_DIRECT_QUEUE_LEN; ++i) {
+            audio_direct_queue[i] = queue + i * MICROBIT_HAL_AUDIO_DIRECT_MAX_CHUNK;
+        }
+    }
+    pin_obj[pin]->setDigitalValue(0);
+    audio_direct_pin = pin;
+    audio_direct_volume = uBit.audio.getVolume();
+    data_source.direct = true;
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+// While direct output is selected it owns the PWM instance, even when idle.
+bool microbit_hal_audio_direct_is_active(void) {
+    return audio_direct_pin >= 0;
+}
+
+// True if a chunk written to direct output now would have to be dropped.
+bool microbit_hal_audio_direct_queue_full(void) {
+    return audio_direct_running
+        && audio_direct_queue_head - audio_direct_queue_tail >= AUDIO_DIRECT_QUEUE_LEN;
+}
+
 void microbit_hal_audio_init(uint32_t sample_rate) {
+    audio_routing_init();
+    // A new rate takes effect when direct playback next starts from idle.
+    audio_direct_halt();
+    audio_direct_sample_rate = sample_rate;
     if (!data_source.started) {
         MicroBitAudio::requestActivation();
         data_source.started = true;
@@ -116,15 +441,50 @@ void microbit_hal_audio_init(uint32_t sample_rate) {
     }
 }
 
-void microbit_hal_audio_write_data(const uint8_t *buf, size_t num_samples) {
-    if ((size_t)data_source.buf.length() != num_samples) {
-        data_source.buf = ManagedBuffer(num_samples);
+// Returns the data of one of the output ring buffers, for the caller to fill in with
+// num_samples, at most MICROBIT_HAL_AUDIO_MAX_CHUNK.  Each buffer is allocated once at
+// that size, and only its length is changed to give a view of the first num_samples.
+// The caller must not fill a buffer that was passed to microbit_hal_audio_write_buffer()
+// until the next one has been.
+uint8_t *microbit_hal_audio_get_buffer(size_t index, size_t num_samples) {
+    ManagedBuffer &b = data_source.ring[index];
+    if (b.length() == 0) {
+        b = ManagedBuffer(MICROBIT_HAL_AUDIO_MAX_CHUNK);
+    }
+    b.getBufferData()->length = num_samples;
+    return b.getBytes();
+}
+
+// Hand one of the output ring buffers to the audio pipeline.  On the mixer path this only
+// takes a new reference to the buffer, it does not copy the data.  Returns false if direct
+// output had to drop the chunk because its queue was full.
+bool microbit_hal_audio_write_buffer(size_t index) {
+    if (data_source.direct) {
+        // The chunk is copied into the queue, or converted into the DMA double buffer, so
+        // unlike the mixer path the ring buffer is finished with straight away.
+        const ManagedBuffer &b = data_source.ring[index];
+        NVIC_DisableIRQ(AUDIO_DIRECT_PWM_IRQn);
+        if (!audio_direct_running) {
+            audio_direct_start(b.getBytes(), b.length());
+            return true;
+        }
+        bool queued = audio_direct_queue_head - audio_direct_queue_tail < AUDIO_DIRECT_QUEUE_LEN;
+        if (queued) {
+            size_t slot = audio_direct_queue_head % AUDIO_DIRECT_QUEUE_LEN;
+            memcpy(audio_direct_queue[slot], b.getBytes(), b.length());
+            audio_direct_queue_len[slot] = b.length();
+            ++audio_direct_queue_head;
+        }
+        NVIC_EnableIRQ(AUDIO_DIRECT_PWM_IRQn);
+        return queued;
     }
-    memcpy(data_source.buf.getBytes(), buf, num_samples);
+    data_source.buf = data_source.ring[index];
     data_source.sink->pullRequest();
+    return true;
 }
 
 void microbit_hal_audio_speech_init(uint32_t sample_rate) {
+    audio_routing_init();
     if (!speech_source.started) {
         MicroBitAudio::requestActivation();
         speech_source.started = true;
@@ -143,4 +503,18 @@ void microbit_hal_audio_speech_write_data(const uint8_t *buf, size_t num_samples
     speech_source.sink->pullRequest();
 }
 
+void microbit_hal_audio_music_init(uint32_t sample_rate) {
+    audio_routing_init();
+    if (!music_source.started) {
+        MicroBitAudio::requestActivation();
+        music_source.started = true;
+        music_source.idle = false;
+        music_source.buf = ManagedBuffer(MICROBIT_HAL_AUDIO_MUSIC_CHUNK_SIZE);
+        music_source.channel = uBit.audio.mixer.addChannel(music_source, sample_rate, 255);
+    } else if (music_source.idle) {
+        music_source.idle = false;
+        music_source.sink->pullRequest();
+    }
+}
+
 }
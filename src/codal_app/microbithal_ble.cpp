@@ -0,0 +1,264 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "main.h"
+#include "microbithal.h"
+
+#if CONFIG_ENABLED(MICROBIT_BLE_ENABLED)
+
+// A GATT service with one characteristic that streams bytes to a connected central by
+// notification.  Python fills a ring with microbit_hal_ble_stream_write(), and the ring is
+// drained into the SoftDevice's notification queue from whichever context gets there
+// first: the writer itself, or the SoftDevice event for a notification having been sent.
+// The pump can't run with interrupts disabled because it makes SoftDevice calls, so a
+// flag stops it running twice at once and a pending flag makes the running one go again.
+
+// Largest notification payload: a 251 byte link layer packet less the L2CAP and ATT headers.
+#define BLE_STREAM_MAX_PAYLOAD (244)
+
+// Connection interval to ask for, in units of 1.25ms, and supervision timeout in 10ms.
+#define BLE_STREAM_CONN_INTERVAL_MIN (6)
+#define BLE_STREAM_CONN_INTERVAL_MAX (12)
+#define BLE_STREAM_CONN_SUP_TIMEOUT (400)
+
+#ifdef NRF_SDH_BLE_GATT_MAX_MTU_SIZE
+#define BLE_STREAM_MAX_MTU (NRF_SDH_BLE_GATT_MAX_MTU_SIZE)
+#else
+#define BLE_STREAM_MAX_MTU (BLE_GATT_ATT_MTU_DEFAULT)
+#endif
+
+static_assert((MICROBIT_HAL_BLE_STREAM_RING_SIZE & (MICROBIT_HAL_BLE_STREAM_RING_SIZE - 1)) == 0,
+    "MICROBIT_HAL_BLE_STREAM_RING_SIZE must be a power of 2");
+
+static uint8_t ble_stream_ring[MICROBIT_HAL_BLE_STREAM_RING_SIZE];
+static volatile uint32_t ble_stream_head; // bytes written, only changed by the writer
+static volatile uint32_t ble_stream_tail; // bytes sent, only changed by the pump
+static volatile bool ble_stream_pumping;
+static volatile bool ble_stream_pump_pending;
+static volatile bool ble_stream_connected;
+static volatile uint16_t ble_stream_mtu = BLE_GATT_ATT_MTU_DEFAULT;
+
+class MicroPythonStreamService : public MicroBitBLEService {
+public:
+    MicroPythonStreamService();
+    void pump();
+
+protected:
+    void onConnect(const microbit_ble_evt_t *p_ble_evt);
+    void onDisconnect(const microbit_ble_evt_t *p_ble_evt);
+    void onDataWritten(const microbit_ble_evt_write_t *params);
+    bool onBleEvent(const microbit_ble_evt_t *p_ble_evt);
+
+private:
+    typedef enum {
+        mbbs_cIdxSTREAM,
+        mbbs_cIdxCOUNT
+    } mbbs_cIdx;
+
+    static const uint8_t base_uuid[16];
+    static const uint16_t service_uuid;
+    static const uint16_t stream_uuid;
+
+    MicroBitBLEChar chars[mbbs_cIdxCOUNT];
+    uint8_t stream_value[BLE_STREAM_MAX_PAYLOAD];
+
+    int characteristicCount() {
+        return mbbs_cIdxCOUNT;
+    }
+
+    MicroBitBLEChar *characteristicPtr(int idx) {
+        return &chars[idx];
+    }
+};
+
+// 94f40000-6b41-4d8c-9d5f-7a3f1f0e4c2b
+const uint8_t MicroPythonStreamService::base_uuid[16] = {
+    0x94, 0xf4, 0x00, 0x00, 0x6b, 0x41, 0x4d, 0x8c, 0x9d, 0x5f, 0x7a, 0x3f, 0x1f, 0x0e, 0x4c, 0x2b,
+};
+const uint16_t MicroPythonStreamService::service_uuid = 0x0001;
+const uint16_t MicroPythonStreamService::stream_uuid = 0x0002;
+
+MicroPythonStreamService::MicroPythonStreamService() {
+    RegisterBaseUUID(base_uuid);
+    CreateService(service_uuid);
+    CreateCharacteristic(mbbs_cIdxSTREAM, stream_uuid, stream_value, 0, sizeof(stream_value),
+        microbit_propREAD | microbit_propNOTIFY);
+}
+
+void MicroPythonStreamService::onConnect(const microbit_ble_evt_t *p_ble_evt) {
+    uint16_t conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    ble_stream_mtu = BLE_GATT_ATT_MTU_DEFAULT;
+    ble_stream_connected = true;
+
+    // Ask for the longest packets and a short interval, so that several full packets go
+    // in every connection event.  The central has the final say on both.
+    sd_ble_gap_data_length_update(conn_handle, NULL, NULL);
+    ble_gap_conn_params_t params;
+    params.min_conn_interval = BLE_STREAM_CONN_INTERVAL_MIN;
+    params.max_conn_interval = BLE_STREAM_CONN_INTERVAL_MAX;
+    params.slave_latency = 0;
+    params.conn_sup_timeout = BLE_STREAM_CONN_SUP_TIMEOUT;
+    sd_ble_gap_conn_param_update(conn_handle, &params);
+}
+
+void MicroPythonStreamService::onDisconnect(const microbit_ble_evt_t *p_ble_evt) {
+    ble_stream_connected = false;
+}
+
+void MicroPythonStreamService::onDataWritten(const microbit_ble_evt_write_t *params) {
+    // The central enabled notifications, so send anything already queued.
+    pump();
+}
+
+bool MicroPythonStreamService::onBleEvent(const microbit_ble_evt_t *p_ble_evt) {
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST: {
+            uint16_t mtu = p_ble_evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu;
+            ble_stream_mtu = mtu < BLE_STREAM_MAX_MTU ? mtu : BLE_STREAM_MAX_MTU;
+            break;
+        }
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            pump();
+            break;
+    }
+    return MicroBitBLEService::onBleEvent(p_ble_evt);
+}
+
+void MicroPythonStreamService::pump() {
+    target_disable_irq();
+    if (ble_stream_pumping) {
+        ble_stream_pump_pending = true;
+        target_enable_irq();
+        return;
+    }
+    ble_stream_pumping = true;
+    target_enable_irq();
+
+    for (;;) {
+        ble_stream_pump_pending = false;
+        size_t max_payload = ble_stream_mtu - 3;
+        if (max_payload > BLE_STREAM_MAX_PAYLOAD) {
+            max_payload = BLE_STREAM_MAX_PAYLOAD;
+        }
+        while (ble_stream_connected && ble_stream_head != ble_stream_tail) {
+            size_t n = ble_stream_head - ble_stream_tail;
+            if (n > max_payload) {
+                n = max_payload;
+            }
+            // The SoftDevice copies the value, so a packet that wraps the ring can be
+            // gathered into the characteristic's own buffer.
+            for (size_t i = 0; i < n; ++i) {
+                stream_value[i] = ble_stream_ring[(ble_stream_tail + i) & (MICROBIT_HAL_BLE_STREAM_RING_SIZE - 1)];
+            }
+            if (!notifyChrValue(mbbs_cIdxSTREAM, stream_value, n)) {
+                // The SoftDevice's queue is full, or notifications are off.
+                break;
+            }
+            ble_stream_tail += n;
+        }
+        target_disable_irq();
+        if (!ble_stream_pump_pending) {
+            ble_stream_pumping = false;
+            target_enable_irq();
+            break;
+        }
+        target_enable_irq();
+    }
+}
+
+static MicroPythonStreamService *ble_stream_service = NULL;
+
+extern "C" {
+
+bool microbit_hal_ble_running(void) {
+    return ble_running();
+}
+
+int microbit_hal_ble_stream_init(void) {
+    if (!ble_running()) {
+        return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+    }
+    // Services can't be removed from the GATT table, so this one lives until reset.
+    if (ble_stream_service == NULL) {
+        ble_stream_service = new MicroPythonStreamService();
+    }
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+bool microbit_hal_ble_connected(void) {
+    return ble_stream_connected;
+}
+
+size_t microbit_hal_ble_stream_space(void) {
+    return MICROBIT_HAL_BLE_STREAM_RING_SIZE - (ble_stream_head - ble_stream_tail);
+}
+
+size_t microbit_hal_ble_stream_write(const uint8_t *buf, size_t len) {
+    size_t space = microbit_hal_ble_stream_space();
+    if (len > space) {
+        len = space;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        ble_stream_ring[(ble_stream_head + i) & (MICROBIT_HAL_BLE_STREAM_RING_SIZE - 1)] = buf[i];
+    }
+    ble_stream_head += len;
+    if (ble_stream_service != NULL) {
+        ble_stream_service->pump();
+    }
+    return len;
+}
+
+}
+
+#else
+
+extern "C" {
+
+bool microbit_hal_ble_running(void) {
+    return false;
+}
+
+int microbit_hal_ble_stream_init(void) {
+    return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+}
+
+bool microbit_hal_ble_connected(void) {
+    return false;
+}
+
+size_t microbit_hal_ble_stream_space(void) {
+    return 0;
+}
+
+size_t microbit_hal_ble_stream_write(const uint8_t *buf, size_t len) {
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+}
+
+#endif // CONFIG_ENABLED(MICROBIT_BLE_ENABLED)
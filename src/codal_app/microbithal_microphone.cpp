@@ -30,6 +30,49 @@
 
 extern "C" void microbit_hal_level_detector_callback(int);
 
+// Copies 8-bit unsigned samples from a channel of the microphone splitter into a buffer
+// owned by the caller.  In loop mode the buffer is a two-half ring and the caller is told
+// as each half fills, otherwise recording stops when the buffer is full.
+class MicrophoneRecording : public DataSink {
+public:
+    DataSource &upStream;
+    uint8_t *dest;
+    size_t dest_len;
+    volatile size_t dest_pos;
+    bool loop;
+    volatile bool active;
+
+    MicrophoneRecording(DataSource &source) : upStream(source), active(false) {
+    }
+
+    virtual int pullRequest() {
+        ManagedBuffer data = upStream.pull();
+        if (!active) {
+            return DEVICE_OK;
+        }
+        const uint8_t *src = data.getBytes();
+        size_t n = data.length();
+        for (size_t i = 0; i < n; ++i) {
+            dest[dest_pos] = src[i];
+            if (++dest_pos == dest_len / 2 && loop) {
+                microbit_hal_microphone_recording_callback(0);
+            } else if (dest_pos == dest_len) {
+                if (!loop) {
+                    active = false;
+                    microbit_hal_microphone_recording_callback(1);
+                    break;
+                }
+                dest_pos = 0;
+                microbit_hal_microphone_recording_callback(1);
+            }
+        }
+        return DEVICE_OK;
+    }
+};
+
+static SplitterChannel *recording_channel = NULL;
+static MicrophoneRecording *recording = NULL;
+
 static void level_detector_event_handler(Event evt) {
     microbit_hal_level_detector_callback(evt.value);
 }
@@ -59,4 +102,41 @@ int microbit_hal_microphone_get_level(void) {
     return value;
 }
 
+void microbit_hal_microphone_start_recording(uint8_t *buf, size_t len, uint32_t rate, bool loop) {
+    if (recording == NULL) {
+        recording_channel = uBit.audio.splitter->createChannel();
+        recording_channel->setFormat(DATASTREAM_FORMAT_8BIT_UNSIGNED);
+        recording = new MicrophoneRecording(*recording_channel);
+        recording_channel->connect(*recording);
+    }
+
+    recording->active = false;
+    recording->dest = buf;
+    recording->dest_len = len;
+    recording->dest_pos = 0;
+    recording->loop = loop;
+    recording_channel->requestSampleRate(rate);
+    recording->active = true;
+
+    uBit.audio.activateMic();
+    uBit.audio.mic->enable();
+}
+
+void microbit_hal_microphone_stop_recording(void) {
+    if (recording != NULL) {
+        recording->active = false;
+    }
+}
+
+bool microbit_hal_microphone_is_recording(void) {
+    return recording != NULL && recording->active;
+}
+
+size_t microbit_hal_microphone_get_recording_pos(void) {
+    if (recording == NULL) {
+        return 0;
+    }
+    return recording->dest_pos;
+}
+
 }
@@ -0,0 +1,143 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "main.h"
+#include "microbithal.h"
+
+// The ws2812 signal is generated by a PWM instance that CODAL leaves free, streaming one
+// 16-bit compare word per data bit out of RAM by EasyDMA.  The CPU is only needed to start
+// the sequence and to release the pin once it has finished, so a frame can go out while
+// the next one is prepared.  Up to four strips, one per PWM channel, can be driven at once
+// by interleaving their words in the same sequence.  The PWM instance is shared with direct
+// audio output (see microbithal_audio.cpp), so its interrupt vector is set on every start.
+#define WS2812_PWM NRF_PWM3
+#define WS2812_PWM_IRQn PWM3_IRQn
+
+// With the 16MHz PWM clock, 20 ticks give the 1.25us ws2812 bit period.  Bit 15 of each
+// compare word sets the polarity so that every period starts high.
+#define WS2812_COUNTERTOP (20)
+#define WS2812_WORD_0 (0x8000 | 6) // 0.375us high
+#define WS2812_WORD_1 (0x8000 | 13) // 0.8125us high
+#define WS2812_WORD_LOW (0x8000)
+
+static volatile bool ws2812_busy = false;
+
+static void ws2812_irq_handler(void) {
+    if (WS2812_PWM->EVENTS_STOPPED) {
+        WS2812_PWM->EVENTS_STOPPED = 0;
+        WS2812_PWM->ENABLE = 0;
+        for (size_t i = 0; i < MICROBIT_HAL_WS2812_MAX_STRIPS; ++i) {
+            WS2812_PWM->PSEL.OUT[i] = PWM_PSEL_OUT_CONNECT_Disconnected << PWM_PSEL_OUT_CONNECT_Pos;
+        }
+        ws2812_busy = false;
+    }
+}
+
+// Write every stride'th word of seq: the len bytes of buf, then the periods up to
+// total_len bytes and the latch period held low.
+void microbit_hal_ws2812_encode(uint16_t *seq, size_t stride, const uint8_t *buf, size_t len, size_t total_len, int brightness) {
+    for (size_t i = 0; i < len; ++i) {
+        unsigned int b = buf[i];
+        if (brightness < 255) {
+            b = (b * (brightness + 1)) >> 8;
+        }
+        for (unsigned int mask = 0x80; mask != 0; mask >>= 1) {
+            *seq = (b & mask) ? WS2812_WORD_1 : WS2812_WORD_0;
+            seq += stride;
+        }
+    }
+    for (size_t i = len * 8; i < MICROBIT_HAL_WS2812_SEQ_LEN(total_len); ++i) {
+        *seq = WS2812_WORD_LOW;
+        seq += stride;
+    }
+}
+
+// Start sending seq to the given pins.  With one pin seq holds one word per period,
+// otherwise MICROBIT_HAL_WS2812_MAX_STRIPS words per period, one for each channel.
+int microbit_hal_ws2812_start(const int *pins, size_t num_pins, const uint16_t *seq, size_t seq_len) {
+    if (ws2812_busy || microbit_hal_audio_direct_is_active()) {
+        return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+    }
+    if (num_pins == 0 || num_pins > MICROBIT_HAL_WS2812_MAX_STRIPS || seq_len > MICROBIT_HAL_WS2812_MAX_SEQ_LEN) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+
+    NVIC_SetVector(WS2812_PWM_IRQn, (uint32_t)ws2812_irq_handler);
+    NVIC_SetPriority(WS2812_PWM_IRQn, 3);
+    NVIC_ClearPendingIRQ(WS2812_PWM_IRQn);
+    NVIC_EnableIRQ(WS2812_PWM_IRQn);
+
+    // Drive the pins low as GPIOs so they stay low between frames.
+    for (size_t i = 0; i < num_pins; ++i) {
+        pin_obj[pins[i]]->setDigitalValue(0);
+        WS2812_PWM->PSEL.OUT[i] = pin_obj[pins[i]]->name;
+    }
+
+    WS2812_PWM->MODE = PWM_MODE_UPDOWN_Up;
+    WS2812_PWM->PRESCALER = PWM_PRESCALER_PRESCALER_DIV_1;
+    WS2812_PWM->COUNTERTOP = WS2812_COUNTERTOP;
+    WS2812_PWM->LOOP = 0;
+    WS2812_PWM->DECODER = ((num_pins == 1 ? PWM_DECODER_LOAD_Common : PWM_DECODER_LOAD_Individual) << PWM_DECODER_LOAD_Pos)
+        | (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+    WS2812_PWM->SEQ[0].PTR = (uint32_t)seq;
+    WS2812_PWM->SEQ[0].CNT = seq_len;
+    WS2812_PWM->SEQ[0].REFRESH = 0;
+    WS2812_PWM->SEQ[0].ENDDELAY = 0;
+    WS2812_PWM->SHORTS = PWM_SHORTS_SEQEND0_STOP_Msk;
+    WS2812_PWM->INTEN = PWM_INTEN_STOPPED_Msk;
+    WS2812_PWM->EVENTS_STOPPED = 0;
+    ws2812_busy = true;
+    WS2812_PWM->ENABLE = 1;
+    WS2812_PWM->TASKS_SEQSTART[0] = 1;
+
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+bool microbit_hal_ws2812_busy(void) {
+    return ws2812_busy;
+}
+
+void microbit_hal_pin_write_ws2812(int pin, const uint8_t *buf, size_t len) {
+    while (ws2812_busy) {
+        __WFI();
+    }
+    size_t seq_len = MICROBIT_HAL_WS2812_SEQ_LEN(len);
+    uint16_t *seq = (uint16_t *)malloc(seq_len * sizeof(uint16_t));
+    if (seq == NULL) {
+        // Not enough memory for a DMA sequence, so fall back to bit-banging.
+        neopixel_send_buffer(*pin_obj[pin], buf, len);
+        return;
+    }
+    microbit_hal_ws2812_encode(seq, 1, buf, len, len, 255);
+    if (microbit_hal_ws2812_start(&pin, 1, seq, seq_len) == MICROBIT_HAL_DEVICE_OK) {
+        while (ws2812_busy) {
+            __WFI();
+        }
+    } else {
+        neopixel_send_buffer(*pin_obj[pin], buf, len);
+    }
+    free(seq);
+}
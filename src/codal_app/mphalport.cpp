@@ -41,6 +41,64 @@ void serial_interrupt_handler(Event evt) {
     microbit_hal_serial_interrupt_callback();
 }
 
+// Number of bytes received into CODAL's serial buffer before they are moved to the ring.
+#define SERIAL_RX_DRAIN_THRESHOLD (16)
+
+// Receive ring, larger than CODAL's serial buffer (which is at most 255 bytes).  The UARTE
+// receives by EasyDMA into CODAL's buffer, and a HEAD_MATCH event moves the bytes into the
+// ring from the UART interrupt, so bursts at high baud rates are not lost while the VM is
+// busy.  Bytes dropped because either buffer was full are counted.  The built-in ring is
+// big enough for a raw-paste window, and uart.init(rxbuf=...) can replace it.
+static uint8_t serial_rx_stdin_ring[MICROBIT_HAL_SERIAL_STDIN_RING_SIZE];
+static uint8_t *serial_rx_ring = serial_rx_stdin_ring;
+static size_t serial_rx_ring_size = sizeof(serial_rx_stdin_ring);
+static volatile size_t serial_rx_ring_head;
+static volatile size_t serial_rx_ring_len;
+static volatile uint32_t serial_rx_overflow = 0;
+
+// Must be called with interrupts disabled, or from the UART interrupt.
+static void serial_rx_drain(void) {
+    int c;
+    while ((c = uBit.serial.read(ASYNC)) >= 0) {
+        if (serial_rx_ring_len < serial_rx_ring_size) {
+            serial_rx_ring[(serial_rx_ring_head + serial_rx_ring_len) % serial_rx_ring_size] = c;
+            ++serial_rx_ring_len;
+        } else {
+            ++serial_rx_overflow;
+        }
+    }
+    uBit.serial.eventAfter(SERIAL_RX_DRAIN_THRESHOLD);
+}
+
+void serial_rx_event_handler(Event evt) {
+    if (evt.value == CODAL_SERIAL_EVT_RX_FULL) {
+        ++serial_rx_overflow;
+    }
+    serial_rx_drain();
+}
+
+static bool serial_rx_readable(void) {
+    target_disable_irq();
+    serial_rx_drain();
+    bool readable = serial_rx_ring_len > 0;
+    target_enable_irq();
+    return readable;
+}
+
+// Returns the next received byte, or -1 if there is none.
+static int serial_rx_getc(void) {
+    int c = -1;
+    target_disable_irq();
+    serial_rx_drain();
+    if (serial_rx_ring_len > 0) {
+        c = serial_rx_ring[serial_rx_ring_head];
+        serial_rx_ring_head = (serial_rx_ring_head + 1) % serial_rx_ring_size;
+        --serial_rx_ring_len;
+    }
+    target_enable_irq();
+    return c;
+}
+
 extern "C" {
 
 void mp_hal_set_interrupt_char(int c) {
@@ -55,7 +113,7 @@ void mp_hal_set_interrupt_char(int c) {
 uintptr_t mp_hal_stdio_poll(uintptr_t poll_flags) {
     uintptr_t ret = 0;
     if (poll_flags & MP_STREAM_POLL_RD) {
-        if (uBit.serial.isReadable()) {
+        if (serial_rx_readable()) {
             ret |= MP_STREAM_POLL_RD;
         }
     }
@@ -67,17 +125,43 @@ uintptr_t mp_hal_stdio_poll(uintptr_t poll_flags) {
     return ret;
 }
 
+// Output is queued in CODAL's transmit buffer, which the UART interrupt drains, so the VM
+// only waits when the buffer is full rather than for every byte to go out.
 void mp_hal_stdout_tx_strn(const char *str, size_t len) {
-    uBit.serial.send((uint8_t*)str, len, SYNC_SPINWAIT);
+    if (__get_PRIMASK()) {
+        // The buffer can't drain with interrupts off, so wait for each byte as before.
+        uBit.serial.send((uint8_t*)str, len, SYNC_SPINWAIT);
+        return;
+    }
+    while (len > 0) {
+        int n = uBit.serial.send((uint8_t*)str, len, ASYNC);
+        if (n > 0) {
+            str += n;
+            len -= n;
+        } else {
+            // Full, wait for the UART interrupt to make room.
+            __WFI();
+        }
+    }
+}
+
+// Wait for queued output to be sent, before the UART is reconfigured or the CPU stops.
+void microbit_hal_serial_tx_flush(void) {
+    if (__get_PRIMASK()) {
+        return;
+    }
+    while (uBit.serial.txBufferedSize() > 0) {
+        __WFI();
+    }
 }
 
 int mp_hal_stdin_rx_chr(void) {
     for (;;) {
-        while (!uBit.serial.isReadable()) {
+        int c;
+        while ((c = serial_rx_getc()) < 0) {
             mp_handle_pending(true);
             microbit_hal_idle();
         }
-        int c = uBit.serial.read(SYNC_SPINWAIT);
         if (c == last_interrupt_char && num_interrupt_chars) {
             --num_interrupt_chars;
         } else {
@@ -86,6 +170,46 @@ int mp_hal_stdin_rx_chr(void) {
     }
 }
 
+// Read up to len bytes that have already been received, without waiting.
+size_t microbit_hal_serial_read(uint8_t *buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+        int c = serial_rx_getc();
+        if (c < 0) {
+            break;
+        }
+        if (c == last_interrupt_char && num_interrupt_chars) {
+            --num_interrupt_chars;
+        } else {
+            buf[n++] = c;
+        }
+    }
+    return n;
+}
+
+// Use buf as the receive ring, or the built-in one if buf is NULL.
+void microbit_hal_serial_set_rx_ring(uint8_t *buf, size_t size) {
+    if (buf == NULL) {
+        buf = serial_rx_stdin_ring;
+        size = sizeof(serial_rx_stdin_ring);
+    }
+    target_disable_irq();
+    serial_rx_ring = buf;
+    serial_rx_ring_size = size;
+    serial_rx_ring_head = 0;
+    serial_rx_ring_len = 0;
+    serial_rx_drain();
+    target_enable_irq();
+}
+
+uint32_t microbit_hal_serial_get_rx_overflow(bool reset) {
+    uint32_t n = serial_rx_overflow;
+    if (reset) {
+        serial_rx_overflow = 0;
+    }
+    return n;
+}
+
 uint32_t mp_hal_ticks_us(void) {
     return system_timer_current_time_us();
 }
@@ -0,0 +1,77 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <string.h>
+
+#include "py/gc.h"
+#include "py/runtime.h"
+#include "drv_alloc.h"
+
+#if MICROPY_HW_ALLOC_TRACE
+
+// Allocations are only made by the VM thread, so no locking is needed.
+microbit_alloc_site_t microbit_alloc_sites[MICROBIT_ALLOC_NUM_SITES];
+
+void microbit_alloc_reset(void) {
+    memset(microbit_alloc_sites, 0, sizeof(microbit_alloc_sites));
+}
+
+// States of a block in the GC allocation table, 2 bits per block, as in py/gc.c.
+#define ALLOC_BLOCKS_PER_ATB (4)
+#define ALLOC_AT_FREE (0)
+#define ALLOC_AT_HEAD (1)
+
+STATIC void heap_histogram_add(uint32_t *buckets, size_t num_blocks) {
+    size_t bucket = 31 - __builtin_clz(num_blocks);
+    ++buckets[MIN(bucket, MICROBIT_ALLOC_NUM_BUCKETS - 1)];
+}
+
+// Walk the allocation table of the heap, counting the runs of free blocks and the objects
+// by their size.  Many short free runs between live objects are what make a large
+// allocation fail long before the heap is full.
+void microbit_heap_histogram(microbit_heap_histogram_t *hist) {
+    memset(hist, 0, sizeof(*hist));
+    const mp_state_mem_area_t *area = &MP_STATE_MEM(area);
+    size_t num_blocks = area->gc_alloc_table_byte_len * ALLOC_BLOCKS_PER_ATB;
+    size_t run = 0;
+    bool run_free = false;
+    for (size_t block = 0; block < num_blocks; ++block) {
+        unsigned int state = (area->gc_alloc_table_start[block / ALLOC_BLOCKS_PER_ATB] >> (2 * (block % ALLOC_BLOCKS_PER_ATB))) & 3;
+        bool is_free = state == ALLOC_AT_FREE;
+        if (run > 0 && (is_free != run_free || state == ALLOC_AT_HEAD)) {
+            heap_histogram_add(run_free ? hist->free_runs : hist->used_objects, run);
+            run = 0;
+        }
+        if (run == 0) {
+            run_free = is_free;
+        }
+        ++run;
+    }
+    if (run > 0) {
+        heap_histogram_add(run_free ? hist->free_runs : hist->used_objects, run);
+    }
+}
+
+#endif // MICROPY_HW_ALLOC_TRACE
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_DRV_ALLOC_H
+#define MICROPY_INCLUDED_CODAL_PORT_DRV_ALLOC_H
+
+#include "py/mpconfig.h"
+
+// Heap allocation accounting by call site, enabled at build time with
+// MICROPY_HW_ALLOC_TRACE.  Drivers allocating on the heap mark the allocation with
+// MICROBIT_ALLOC_TRACE(site, bytes), which counts the allocations and bytes for that site.
+// The histogram sizes are in GC blocks, with bucket i holding runs of 2^i to 2^(i+1)-1.
+
+#define MICROBIT_ALLOC_NUM_BUCKETS (12)
+
+enum {
+    MICROBIT_ALLOC_SITE_IMAGE,
+    MICROBIT_ALLOC_SITE_AUDIO_FRAME,
+    MICROBIT_ALLOC_SITE_RADIO_RECEIVE,
+    MICROBIT_ALLOC_SITE_ARENA_OVERFLOW, // driver buffers that did not fit in the arena
+    MICROBIT_ALLOC_SITE_NEOPIXEL,
+    MICROBIT_ALLOC_SITE_SPEECH,
+    MICROBIT_ALLOC_SITE_FILE,
+    MICROBIT_ALLOC_NUM_SITES,
+};
+
+#if MICROPY_HW_ALLOC_TRACE
+
+typedef struct _microbit_alloc_site_t {
+    uint32_t count;
+    uint32_t bytes;
+} microbit_alloc_site_t;
+
+typedef struct _microbit_heap_histogram_t {
+    uint32_t free_runs[MICROBIT_ALLOC_NUM_BUCKETS];
+    uint32_t used_objects[MICROBIT_ALLOC_NUM_BUCKETS];
+} microbit_heap_histogram_t;
+
+extern microbit_alloc_site_t microbit_alloc_sites[MICROBIT_ALLOC_NUM_SITES];
+
+void microbit_alloc_reset(void);
+void microbit_heap_histogram(microbit_heap_histogram_t *hist);
+
+#define MICROBIT_ALLOC_TRACE(site, num_bytes) \
+    do { \
+        ++microbit_alloc_sites[(site)].count; \
+        microbit_alloc_sites[(site)].bytes += (num_bytes); \
+    } while (0)
+
+#else
+
+#define MICROBIT_ALLOC_TRACE(site, num_bytes) (void)0
+
+#endif
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_DRV_ALLOC_H
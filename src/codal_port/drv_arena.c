@@ -0,0 +1,67 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "drv_alloc.h"
+#include "drv_arena.h"
+
+// A fixed arena, separate from the GC heap, for long-lived buffers owned by drivers.
+// These buffers are not scanned by the GC and don't fragment the heap when a driver is
+// reconfigured.  Allocation is a bump of the top pointer and only the most recent
+// allocation can be given back, which fits drivers that free and reallocate their buffer
+// when reconfigured.  Anything else is reclaimed when the arena is reset on soft reboot.
+// If the arena is full the buffer comes from the GC heap instead.
+
+STATIC uint32_t arena[MICROPY_HW_ARENA_SIZE / sizeof(uint32_t)];
+STATIC size_t arena_top;
+
+#define ARENA_ROUND_UP(n) (((n) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+void microbit_arena_init(void) {
+    arena_top = 0;
+}
+
+void *microbit_arena_alloc(size_t num_bytes) {
+    size_t num_words = ARENA_ROUND_UP(num_bytes);
+    if (num_words <= MP_ARRAY_SIZE(arena) - arena_top) {
+        void *ptr = &arena[arena_top];
+        arena_top += num_words;
+        return ptr;
+    }
+    MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_ARENA_OVERFLOW, num_bytes);
+    return m_new(uint8_t, num_bytes);
+}
+
+void microbit_arena_free(void *ptr, size_t num_bytes) {
+    uint32_t *p = ptr;
+    if (p >= &arena[0] && p < &arena[MP_ARRAY_SIZE(arena)]) {
+        if (p + ARENA_ROUND_UP(num_bytes) == &arena[arena_top]) {
+            arena_top = p - &arena[0];
+        }
+    } else {
+        m_del(uint8_t, ptr, num_bytes);
+    }
+}
@@ -30,25 +30,52 @@
 #include "py/objstr.h"
 #include "py/mphal.h"
 #include "drv_display.h"
+#include "drv_softtimer.h"
+#include "modprofile.h"
 
-#define MILLISECONDS_PER_MACRO_TICK 6
-
-#define ASYNC_MODE_STOPPED 0
-#define ASYNC_MODE_ANIMATION 1
-#define ASYNC_MODE_CLEAR 2
-
-static uint8_t async_mode;
 static mp_obj_t async_iterator = NULL;
 static volatile bool wakeup_event = false;
-static mp_uint_t async_delay = 1000;
-static mp_uint_t async_tick = 0;
 static bool async_clear = false;
 
+// Animations are driven by a periodic soft timer that expires at each frame, and is
+// only on the soft timer heap while an animation is running.
+static microbit_soft_timer_entry_t display_timer;
+static bool display_timer_armed = false;
+static bool display_timer_in_callback = false;
+
+// Copy of what was last sent to the HAL, so unchanged frames can be skipped.
+static uint8_t display_framebuffer[MICROBIT_DISPLAY_HEIGHT * MICROBIT_DISPLAY_WIDTH];
+static bool display_framebuffer_valid = false;
+
+STATIC void display_timer_callback(microbit_soft_timer_entry_t *entry);
+
+STATIC void display_timer_disarm(void) {
+    if (!display_timer_armed) {
+        return;
+    }
+    display_timer_armed = false;
+    if (display_timer_in_callback) {
+        // The soft timer handler has taken the entry off the heap to run it, and
+        // will not put it back if it is no longer periodic.
+        display_timer.mode = MICROBIT_SOFT_TIMER_MODE_ONE_SHOT;
+    } else {
+        microbit_soft_timer_remove(&display_timer);
+    }
+}
+
+STATIC void display_timer_arm(mp_uint_t delay_ms) {
+    display_timer_disarm();
+    display_timer.flags = 0;
+    display_timer.mode = MICROBIT_SOFT_TIMER_MODE_PERIODIC;
+    display_timer.delta_us = (uint64_t)MAX(delay_ms, 1) * 1000;
+    display_timer.c_callback = display_timer_callback;
+    display_timer_armed = true;
+    microbit_soft_timer_insert(&display_timer, display_timer.delta_us);
+}
+
 STATIC void async_stop(void) {
+    display_timer_disarm();
     async_iterator = NULL;
-    async_mode = ASYNC_MODE_STOPPED;
-    async_tick = 0;
-    async_delay = 1000;
     async_clear = false;
     MP_STATE_PORT(display_data) = NULL;
     wakeup_event = true;
@@ -56,9 +83,11 @@ STATIC void async_stop(void) {
 
 void microbit_display_init(void) {
     async_stop();
+    display_framebuffer_valid = false;
 }
 
 void microbit_display_stop(void) {
+    display_timer_disarm();
     MP_STATE_PORT(display_data) = NULL;
 }
 
@@ -89,7 +118,7 @@ static void draw_object(mp_obj_t obj) {
         mp_uint_t len;
         const char *str = mp_obj_str_get_data(obj, &len);
         if (len == 1) {
-            microbit_display_show(microbit_image_for_char(str[0]));
+            microbit_display_show(microbit_const_image_for_char(str[0]));
         } else {
             async_stop();
         }
@@ -99,76 +128,72 @@ static void draw_object(mp_obj_t obj) {
     }
 }
 
-// TODO: pass in current timestamp as arg
-void microbit_display_update(void) {
-    async_tick += MILLISECONDS_PER_MACRO_TICK;
-    if (async_tick < async_delay) {
-        return;
-    }
-    async_tick = 0;
-    switch (async_mode) {
-        case ASYNC_MODE_ANIMATION:
-        {
-            if (MP_STATE_PORT(display_data) == NULL) {
-                async_stop();
-                break;
-            }
-            mp_obj_t obj;
-            nlr_buf_t nlr;
-            gc_lock();
-            if (nlr_push(&nlr) == 0) {
-                obj = mp_iternext_allow_raise(async_iterator);
-                nlr_pop();
-                gc_unlock();
-            } else {
-                gc_unlock();
-                if (!mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(((mp_obj_base_t*)nlr.ret_val)->type),
-                    MP_OBJ_FROM_PTR(&mp_type_StopIteration))) {
-                    if (mp_obj_get_type(nlr.ret_val) == &mp_type_MemoryError) {
-                        mp_printf(&mp_plat_print, "Allocation in interrupt handler");
-                    }
-                    mp_sched_exception(MP_OBJ_FROM_PTR(nlr.ret_val));
+// Called by the soft timer handler, at interrupt priority, when the next frame is due.
+STATIC void display_timer_callback(microbit_soft_timer_entry_t *entry) {
+    (void)entry;
+    #if MICROPY_PY_PROFILE
+    uint32_t t = microbit_profile_begin();
+    #endif
+    display_timer_in_callback = true;
+    if (MP_STATE_PORT(display_data) == NULL) {
+        async_stop();
+    } else {
+        mp_obj_t obj;
+        nlr_buf_t nlr;
+        gc_lock();
+        if (nlr_push(&nlr) == 0) {
+            obj = mp_iternext_allow_raise(async_iterator);
+            nlr_pop();
+            gc_unlock();
+        } else {
+            gc_unlock();
+            if (!mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(((mp_obj_base_t*)nlr.ret_val)->type),
+                MP_OBJ_FROM_PTR(&mp_type_StopIteration))) {
+                if (mp_obj_get_type(nlr.ret_val) == &mp_type_MemoryError) {
+                    mp_printf(&mp_plat_print, "Allocation in interrupt handler");
                 }
-                obj = MP_OBJ_STOP_ITERATION;
+                mp_sched_exception(MP_OBJ_FROM_PTR(nlr.ret_val));
             }
-            draw_object(obj);
-            break;
+            obj = MP_OBJ_STOP_ITERATION;
         }
-        case ASYNC_MODE_CLEAR:
-            microbit_display_show(BLANK_IMAGE);
-            async_stop();
-            break;
+        draw_object(obj);
     }
+    display_timer_in_callback = false;
+    #if MICROPY_PY_PROFILE
+    microbit_profile_end(MICROBIT_PROFILE_DISPLAY, t);
+    #endif
 }
 
 void microbit_display_clear(void) {
-    // Reset repeat state, cancel animation and clear screen.
-    // The actual screen clearing will be done by microbit_display_update.
-    wakeup_event = false;
-    async_mode = ASYNC_MODE_CLEAR;
-    async_tick = async_delay - MILLISECONDS_PER_MACRO_TICK;
-    wait_for_event();
+    // Cancel any animation, then clear the screen.
+    async_stop();
+    microbit_display_show(BLANK_IMAGE);
 }
 
 void microbit_display_show(microbit_image_obj_t *image) {
-    mp_int_t w = MIN(image_width(image), 5);
-    mp_int_t h = MIN(image_height(image), 5);
-    mp_int_t x = 0;
-    for (; x < w; ++x) {
-        mp_int_t y = 0;
-        for (; y < h; ++y) {
-            uint8_t pix = image_get_pixel(image, x, y);
-            microbit_hal_display_set_pixel(x, y, pix);
-        }
-        for (; y < 5; ++y) {
-            microbit_hal_display_set_pixel(x, y, 0);
+    uint8_t frame[MICROBIT_DISPLAY_HEIGHT * MICROBIT_DISPLAY_WIDTH] = { 0 };
+    mp_int_t w = MIN(image_width(image), MICROBIT_DISPLAY_WIDTH);
+    mp_int_t h = MIN(image_height(image), MICROBIT_DISPLAY_HEIGHT);
+    for (mp_int_t y = 0; y < h; ++y) {
+        for (mp_int_t x = 0; x < w; ++x) {
+            frame[y * MICROBIT_DISPLAY_WIDTH + x] = image_get_pixel(image, x, y);
         }
     }
-    for (; x < 5; ++x) {
-        for (mp_int_t y = 0; y < 5; ++y) {
-            microbit_hal_display_set_pixel(x, y, 0);
-        }
+    microbit_display_commit(frame);
+}
+
+void microbit_display_commit(const uint8_t *frame) {
+    if (display_framebuffer_valid && memcmp(frame, display_framebuffer, sizeof(display_framebuffer)) == 0) {
+        return;
     }
+    memcpy(display_framebuffer, frame, sizeof(display_framebuffer));
+    display_framebuffer_valid = true;
+    microbit_hal_display_commit(display_framebuffer);
+}
+
+void microbit_display_write_pixel(mp_int_t x, mp_int_t y, mp_int_t bright) {
+    display_framebuffer[y * MICROBIT_DISPLAY_WIDTH + x] = bright;
+    microbit_hal_display_set_pixel(x, y, bright);
 }
 
 void microbit_display_scroll(const char *str) {
@@ -178,19 +203,23 @@ void microbit_display_scroll(const char *str) {
 
 void microbit_display_animate(mp_obj_t iterable, mp_int_t delay, bool clear, bool wait) {
     // Reset the repeat state.
-    MP_STATE_PORT(display_data) = NULL;
+    microbit_display_stop();
     async_iterator = mp_getiter(iterable, NULL);
-    async_delay = delay;
     async_clear = clear;
     MP_STATE_PORT(display_data) = async_iterator;
     wakeup_event = false;
     mp_obj_t obj = mp_iternext_allow_raise(async_iterator);
     draw_object(obj);
-    async_tick = 0;
-    async_mode = ASYNC_MODE_ANIMATION;
+    if (MP_STATE_PORT(display_data) != NULL) {
+        display_timer_arm(delay);
+    }
     if (wait) {
         wait_for_event();
     }
 }
 
+bool microbit_display_is_animating(void) {
+    return MP_STATE_PORT(display_data) != NULL;
+}
+
 MP_REGISTER_ROOT_POINTER(void *display_data);
@@ -37,11 +37,13 @@
 
 void microbit_display_init(void);
 void microbit_display_stop(void);
-void microbit_display_update(void);
 
 void microbit_display_clear(void);
 void microbit_display_show(microbit_image_obj_t *image);
+void microbit_display_commit(const uint8_t *frame);
+void microbit_display_write_pixel(mp_int_t x, mp_int_t y, mp_int_t bright);
 void microbit_display_scroll(const char *str);
 void microbit_display_animate(mp_obj_t iterable, mp_int_t delay, bool clear, bool wait);
+bool microbit_display_is_animating(void);
 
 #endif // MICROPY_INCLUDED_CODAL_PORT_DRV_DISPLAY_H
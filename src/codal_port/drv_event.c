@@ -0,0 +1,84 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "drv_event.h"
+
+// A ring of timestamped events from the sensors and buttons, filled by the HAL callbacks
+// (which run in CODAL's event handlers) and drained by microbit.events().  When the ring
+// is full the oldest event is overwritten, and counted as dropped.
+static microbit_event_t event_queue[MICROPY_HW_EVENT_QUEUE_DEPTH];
+static size_t event_head = 0;
+static size_t event_len = 0;
+static size_t event_dropped = 0;
+
+void microbit_event_reset(void) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    event_head = 0;
+    event_len = 0;
+    event_dropped = 0;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+void microbit_event_push(uint8_t source, uint8_t id, uint8_t value) {
+    uint32_t time_ms = mp_hal_ticks_ms();
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    microbit_event_t *event = &event_queue[(event_head + event_len) % MICROPY_HW_EVENT_QUEUE_DEPTH];
+    if (event_len < MICROPY_HW_EVENT_QUEUE_DEPTH) {
+        ++event_len;
+    } else {
+        event_head = (event_head + 1) % MICROPY_HW_EVENT_QUEUE_DEPTH;
+        ++event_dropped;
+    }
+    event->time_ms = time_ms;
+    event->source = source;
+    event->id = id;
+    event->value = value;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+bool microbit_event_pop(microbit_event_t *event) {
+    bool found = false;
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    if (event_len > 0) {
+        *event = event_queue[event_head];
+        event_head = (event_head + 1) % MICROPY_HW_EVENT_QUEUE_DEPTH;
+        --event_len;
+        found = true;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    return found;
+}
+
+// Return the number of events dropped since the last call.
+size_t microbit_event_take_dropped(void) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    size_t dropped = event_dropped;
+    event_dropped = 0;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    return dropped;
+}
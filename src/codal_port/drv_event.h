@@ -0,0 +1,47 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_DRV_EVENT_H
+#define MICROPY_INCLUDED_CODAL_PORT_DRV_EVENT_H
+
+// Sources of events in the shared event queue.
+#define MICROBIT_EVENT_SOURCE_GESTURE (0) // value is a MICROBIT_HAL_ACCELEROMETER_EVT_xxx
+#define MICROBIT_EVENT_SOURCE_SOUND (1) // value is the index of a SoundEvent
+#define MICROBIT_EVENT_SOURCE_BUTTON (2) // id is the button, value a MICROBIT_HAL_BUTTON_EVT_xxx
+#define MICROBIT_EVENT_SOURCE_TOUCH (3) // id is the pin, value a MICROBIT_HAL_BUTTON_EVT_xxx
+
+typedef struct _microbit_event_t {
+    uint32_t time_ms;
+    uint8_t source;
+    uint8_t id;
+    uint8_t value;
+} microbit_event_t;
+
+void microbit_event_reset(void);
+void microbit_event_push(uint8_t source, uint8_t id, uint8_t value);
+bool microbit_event_pop(microbit_event_t *event);
+size_t microbit_event_take_dropped(void);
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_DRV_EVENT_H
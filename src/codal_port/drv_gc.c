@@ -0,0 +1,87 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/gc.h"
+#include "py/runtime.h"
+#include "drv_gc.h"
+#include "drv_stats.h"
+
+// The collector stops the world, and a full mark and sweep of the heap takes long
+// enough to be noticed by display animation, audio and radio.  So that a collection is
+// rarely needed in the middle of them, one is done while the script is sleeping, once
+// enough has been allocated since the last one and the sleep is long enough to hide it.
+
+static size_t gc_idle_threshold_blocks;
+static microbit_gc_pauses_t gc_pauses;
+
+void microbit_gc_init(void) {
+    microbit_gc_set_idle_threshold(MICROBIT_GC_IDLE_THRESHOLD_DEFAULT);
+    gc_pauses.count = 0;
+    gc_pauses.last_us = 0;
+    gc_pauses.max_us = 0;
+}
+
+// A threshold of 0 disables collection while sleeping.
+void microbit_gc_set_idle_threshold(size_t bytes) {
+    gc_idle_threshold_blocks = (bytes + MICROPY_BYTES_PER_GC_BLOCK - 1) / MICROPY_BYTES_PER_GC_BLOCK;
+}
+
+size_t microbit_gc_get_idle_threshold(void) {
+    return gc_idle_threshold_blocks * MICROPY_BYTES_PER_GC_BLOCK;
+}
+
+void microbit_gc_get_pauses(microbit_gc_pauses_t *pauses, bool reset) {
+    *pauses = gc_pauses;
+    if (reset) {
+        gc_pauses.count = 0;
+        gc_pauses.max_us = 0;
+    }
+}
+
+// Called at the end of every collection, however it was started.
+void microbit_gc_collect_done(uint32_t pause_us) {
+    ++gc_pauses.count;
+    gc_pauses.last_us = pause_us;
+    if (pause_us > gc_pauses.max_us) {
+        gc_pauses.max_us = pause_us;
+    }
+    #if MICROPY_HW_LATENCY_STATS
+    microbit_stats_record(MICROBIT_STATS_GC_COLLECT, pause_us);
+    #endif
+}
+
+// Called while sleeping, with the time left until the script runs again.  The previous
+// pause is taken as an estimate of how long this one will be.  Returns true if it
+// collected, so that the caller can check the time again.
+bool microbit_gc_background(uint32_t remaining_ms) {
+    if (gc_idle_threshold_blocks == 0
+        || MP_STATE_MEM(gc_alloc_amount) < gc_idle_threshold_blocks
+        || (uint64_t)remaining_ms * 1000 < gc_pauses.last_us) {
+        return false;
+    }
+    gc_collect();
+    return true;
+}
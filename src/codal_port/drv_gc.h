@@ -0,0 +1,50 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_DRV_GC_H
+#define MICROPY_INCLUDED_CODAL_PORT_DRV_GC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "py/mpconfig.h"
+
+// By default a collection is done while the script sleeps once this much has been
+// allocated since the last one.
+#define MICROBIT_GC_IDLE_THRESHOLD_DEFAULT (MICROPY_HW_HEAP_SIZE / 4)
+
+typedef struct _microbit_gc_pauses_t {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+} microbit_gc_pauses_t;
+
+void microbit_gc_init(void);
+void microbit_gc_set_idle_threshold(size_t bytes);
+size_t microbit_gc_get_idle_threshold(void);
+void microbit_gc_get_pauses(microbit_gc_pauses_t *pauses, bool reset);
+void microbit_gc_collect_done(uint32_t pause_us);
+bool microbit_gc_background(uint32_t remaining_ms);
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_DRV_GC_H
@@ -26,9 +26,26 @@
  */
 
 #include <string.h>
+#include "drv_alloc.h"
 #include "drv_image.h"
 #include "drv_display.h"
 
+#if __ARM_FEATURE_SIMD32
+#include <arm_acle.h>
+#endif
+
+// Greyscale pixels are packed two per byte in row-major order, and hold values no
+// greater than 15, so operations that treat every pixel alike can work on the packed
+// data directly, 8 pixels per 32-bit word.
+#define NIBBLES_LO (0x0f0f0f0f)
+#define BYTES_9 (0x09090909)
+
+typedef enum {
+    WORD_OP_ADD,
+    WORD_OP_SUBTRACT,
+    WORD_OP_INVERT,
+} word_op_t;
+
 const monochrome_5by5_t microbit_blank_image = {
     { &microbit_image_type },
     1, 0, 0, 0,
@@ -44,28 +61,44 @@ STATIC uint8_t monochrome_get_pixel(monochrome_5by5_t *self, mp_int_t x, mp_int_
 
 greyscale_t *greyscale_new(mp_int_t w, mp_int_t h) {
     greyscale_t *result = m_new_obj_var(greyscale_t, byte_data, uint8_t, (w*h+1)>>1);
+    MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_IMAGE, sizeof(greyscale_t) + ((w*h+1)>>1));
+    result->base.type = &microbit_image_type;
+    result->five = 0;
+    result->ref = 0;
+    result->width = w;
+    result->height = h;
+    return result;
+}
+
+greyscale_ref_t *greyscale_ref_new(mp_int_t w, mp_int_t h, const uint8_t *data, mp_obj_t owner) {
+    greyscale_ref_t *result = m_new_obj(greyscale_ref_t);
+    MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_IMAGE, sizeof(greyscale_ref_t));
     result->base.type = &microbit_image_type;
     result->five = 0;
+    result->ref = 1;
     result->width = w;
     result->height = h;
+    result->byte_data = data;
+    result->owner = owner;
     return result;
 }
 
+STATIC size_t greyscale_data_len(const greyscale_t *self) {
+    return (self->width * self->height + 1) >> 1;
+}
+
 void greyscale_clear(greyscale_t *self) {
-    memset(&self->byte_data, 0, (self->width*self->height+1)>>1);
+    memset(&self->byte_data, 0, greyscale_data_len(self));
 }
 
 void greyscale_fill(greyscale_t *self, mp_int_t val) {
-    mp_int_t byte = (val<<4) | val;
-    for (int i = 0; i < ((self->width*self->height+1)>>1); i++) {
-        self->byte_data[i] = byte;
-    }
+    memset(&self->byte_data, (val << 4) | val, greyscale_data_len(self));
 }
 
 uint8_t greyscale_get_pixel(greyscale_t *self, mp_int_t x, mp_int_t y) {
     unsigned int index = y*self->width+x;
     unsigned int shift = ((index<<2)&4);
-    return (self->byte_data[index>>1] >> shift)&15;
+    return (greyscale_data(self)[index>>1] >> shift)&15;
 }
 
 void greyscale_set_pixel(greyscale_t *self, mp_int_t x, mp_int_t y, mp_int_t val) {
@@ -75,6 +108,129 @@ void greyscale_set_pixel(greyscale_t *self, mp_int_t x, mp_int_t y, mp_int_t val
     self->byte_data[index>>1] = (self->byte_data[index>>1] & mask) | (val << shift);
 }
 
+STATIC inline uint8_t greyscale_get_nibble(const greyscale_t *self, size_t index) {
+    return (greyscale_data(self)[index >> 1] >> ((index & 1) << 2)) & 15;
+}
+
+STATIC inline void greyscale_set_nibble(greyscale_t *self, size_t index, uint8_t val) {
+    unsigned int shift = (index & 1) << 2;
+    self->byte_data[index >> 1] = (self->byte_data[index >> 1] & (240 >> shift)) | (val << shift);
+}
+
+// Set n consecutive pixels, starting at packed index, to val.
+STATIC void greyscale_fill_span(greyscale_t *self, size_t index, size_t n, uint8_t val) {
+    if (n > 0 && (index & 1)) {
+        greyscale_set_nibble(self, index++, val);
+        --n;
+    }
+    memset(&self->byte_data[index >> 1], (val << 4) | val, n >> 1);
+    if (n & 1) {
+        greyscale_set_nibble(self, index + n - 1, val);
+    }
+}
+
+// Copy n consecutive pixels from src to dest, which may be the same image with the spans
+// overlapping.  When both spans start at the same nibble the bulk is a byte memmove.
+STATIC void greyscale_move_span(greyscale_t *dest, size_t di, const greyscale_t *src, size_t si, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    bool backwards = dest == src && di > si;
+    if ((di ^ si) & 1) {
+        if (backwards) {
+            for (size_t i = n; i-- > 0;) {
+                greyscale_set_nibble(dest, di + i, greyscale_get_nibble(src, si + i));
+            }
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                greyscale_set_nibble(dest, di + i, greyscale_get_nibble(src, si + i));
+            }
+        }
+        return;
+    }
+    size_t head = di & 1;
+    size_t tail = (n - head) & 1;
+    size_t bytes = (n - head) >> 1;
+    if (!backwards && head) {
+        greyscale_set_nibble(dest, di, greyscale_get_nibble(src, si));
+    }
+    if (backwards && tail) {
+        greyscale_set_nibble(dest, di + n - 1, greyscale_get_nibble(src, si + n - 1));
+    }
+    memmove(&dest->byte_data[(di + head) >> 1], &greyscale_data(src)[(si + head) >> 1], bytes);
+    if (backwards && head) {
+        greyscale_set_nibble(dest, di, greyscale_get_nibble(src, si));
+    }
+    if (!backwards && tail) {
+        greyscale_set_nibble(dest, di + n - 1, greyscale_get_nibble(src, si + n - 1));
+    }
+}
+
+// Each byte of s must be at most 0x7f; returns each byte clamped to 9.
+STATIC inline uint32_t bytes_min_9(uint32_t s) {
+    #if __ARM_FEATURE_SIMD32
+    return __uqsub8(__uqadd8(s, 0xf6f6f6f6), 0xf6f6f6f6);
+    #else
+    uint32_t over = (((s + 0x76767676) >> 7) & 0x01010101) * 0xff;
+    return (s & ~over) | (BYTES_9 & over);
+    #endif
+}
+
+// Each byte of a and b must be at most 0x7f; returns max(0, a - b) for each byte.
+STATIC inline uint32_t bytes_sub_sat(uint32_t a, uint32_t b) {
+    #if __ARM_FEATURE_SIMD32
+    return __uqsub8(a, b);
+    #else
+    uint32_t d = (a | 0x80808080) - b;
+    uint32_t keep = ((d >> 7) & 0x01010101) * 0xff;
+    return d & 0x7f7f7f7f & keep;
+    #endif
+}
+
+STATIC inline uint32_t word_op(word_op_t op, uint32_t a, uint32_t b) {
+    if (op == WORD_OP_INVERT) {
+        // No nibble is above 9 so there are no borrows between them.
+        return 0x99999999 - a;
+    }
+    // Spread the nibbles out into bytes so each pixel has headroom.
+    uint32_t a_lo = a & NIBBLES_LO, a_hi = (a >> 4) & NIBBLES_LO;
+    uint32_t b_lo = b & NIBBLES_LO, b_hi = (b >> 4) & NIBBLES_LO;
+    if (op == WORD_OP_ADD) {
+        a_lo = bytes_min_9(a_lo + b_lo);
+        a_hi = bytes_min_9(a_hi + b_hi);
+    } else {
+        a_lo = bytes_sub_sat(a_lo, b_lo);
+        a_hi = bytes_sub_sat(a_hi, b_hi);
+    }
+    return a_lo | (a_hi << 4);
+}
+
+// Apply op to images of the same size a word at a time; dest may be a or b.
+STATIC void greyscale_word_map(word_op_t op, greyscale_t *dest, const greyscale_t *a, const greyscale_t *b) {
+    size_t len = greyscale_data_len(dest);
+    size_t i = 0;
+    const uint8_t *da = greyscale_data(a);
+    const uint8_t *db = b != NULL ? greyscale_data(b) : NULL;
+    uint32_t wa, wb = 0, wr;
+    for (; i + 4 <= len; i += 4) {
+        memcpy(&wa, &da[i], 4);
+        if (db != NULL) {
+            memcpy(&wb, &db[i], 4);
+        }
+        wr = word_op(op, wa, wb);
+        memcpy(&dest->byte_data[i], &wr, 4);
+    }
+    if (i < len) {
+        wa = 0;
+        memcpy(&wa, &da[i], len - i);
+        if (db != NULL) {
+            memcpy(&wb, &db[i], len - i);
+        }
+        wr = word_op(op, wa, wb);
+        memcpy(&dest->byte_data[i], &wr, len - i);
+    }
+}
+
 mp_int_t image_width(microbit_image_obj_t *self) {
     if (self->base.five) {
         return 5;
@@ -103,6 +259,10 @@ greyscale_t *image_copy(microbit_image_obj_t *self) {
     mp_int_t w = image_width(self);
     mp_int_t h = image_height(self);
     greyscale_t *result = greyscale_new(w, h);
+    if (!self->base.five) {
+        memcpy(result->byte_data, greyscale_data(&self->greyscale), greyscale_data_len(result));
+        return result;
+    }
     for (mp_int_t y = 0; y < h; y++) {
         for (mp_int_t x = 0; x < w; ++x) {
             greyscale_set_pixel(result, x,y, image_get_pixel(self, x,y));
@@ -112,22 +272,50 @@ greyscale_t *image_copy(microbit_image_obj_t *self) {
 }
 
 greyscale_t *image_invert(microbit_image_obj_t *self) {
-    mp_int_t w = image_width(self);
-    mp_int_t h = image_height(self);
-    greyscale_t *result = greyscale_new(w, h);
-    for (mp_int_t y = 0; y < h; y++) {
-        for (mp_int_t x = 0; x < w; ++x) {
-            greyscale_set_pixel(result,x,y, MICROBIT_DISPLAY_MAX_BRIGHTNESS - image_get_pixel(self,x,y));
-        }
-    }
+    greyscale_t *result = greyscale_new(image_width(self), image_height(self));
+    image_invert_into(result, self);
     return result;
 }
 
+void image_invert_into(greyscale_t *dest, microbit_image_obj_t *src) {
+    if (src->base.five) {
+        src = (microbit_image_obj_t *)image_copy(src);
+    }
+    greyscale_word_map(WORD_OP_INVERT, dest, &src->greyscale, NULL);
+}
+
+void image_sum(greyscale_t *dest, microbit_image_obj_t *lhs, microbit_image_obj_t *rhs, bool add) {
+    if (lhs->base.five) {
+        lhs = (microbit_image_obj_t *)image_copy(lhs);
+    }
+    if (rhs->base.five) {
+        rhs = (microbit_image_obj_t *)image_copy(rhs);
+    }
+    greyscale_word_map(add ? WORD_OP_ADD : WORD_OP_SUBTRACT, dest, &lhs->greyscale, &rhs->greyscale);
+}
+
+void image_dim(greyscale_t *dest, microbit_image_obj_t *src, mp_float_t fval) {
+    // Scale each of the 16 possible pixel values once, then scale the image by lookup.
+    uint8_t scaled[16];
+    for (int i = 0; i < 16; ++i) {
+        mp_float_t val = i * fval + (mp_float_t)0.5;
+        scaled[i] = val > MICROBIT_DISPLAY_MAX_BRIGHTNESS ? MICROBIT_DISPLAY_MAX_BRIGHTNESS : (int)val;
+    }
+    if (src->base.five) {
+        src = (microbit_image_obj_t *)image_copy(src);
+    }
+    const uint8_t *in = greyscale_data(&src->greyscale);
+    for (size_t i = 0, len = greyscale_data_len(dest); i < len; ++i) {
+        dest->byte_data[i] = scaled[in[i] & 15] | scaled[in[i] >> 4] << 4;
+    }
+}
+
 static void clear_rect(greyscale_t *img, mp_int_t x0, mp_int_t y0,mp_int_t x1, mp_int_t y1) {
-    for (int i = x0; i < x1; ++i) {
-        for (int j = y0; j < y1; ++j) {
-            greyscale_set_pixel(img, i, j, 0);
-        }
+    if (x0 >= x1) {
+        return;
+    }
+    for (int j = y0; j < y1; ++j) {
+        greyscale_fill_span(img, j * img->width + x0, x1 - x0, 0);
     }
 }
 
@@ -162,10 +350,18 @@ void image_blit(microbit_image_obj_t *src, greyscale_t *dest, mp_int_t x, mp_int
     } else {
         ystart = intersect_y1 - 1; yend = intersect_y0 - 1; ydel = -1;
     }
-    for (int i = xstart; i != xend; i += xdel) {
+    if (!src->base.five) {
+        // Copy whole rows at a time.
         for (int j = ystart; j != yend; j += ydel) {
-            int val = image_get_pixel(src, i, j);
-            greyscale_set_pixel(dest, i+xdest-x, j+ydest-y, val);
+            greyscale_move_span(dest, (j + ydest - y) * dest->width + intersect_x0 + xdest - x,
+                &src->greyscale, j * src->greyscale.width + intersect_x0, intersect_x1 - intersect_x0);
+        }
+    } else {
+        for (int i = xstart; i != xend; i += xdel) {
+            for (int j = ystart; j != yend; j += ydel) {
+                int val = image_get_pixel(src, i, j);
+                greyscale_set_pixel(dest, i+xdest-x, j+ydest-y, val);
+            }
         }
     }
     // Adjust intersection rectange to dest
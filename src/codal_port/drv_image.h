@@ -45,10 +45,11 @@
 
 // We reserve a couple of bits so we won't need to modify the
 // layout if we need to add more functionality or subtypes.
+// ref marks a greyscale_ref_t.
 #define TYPE_AND_FLAGS \
     mp_obj_base_t base; \
     uint8_t five:1; \
-    uint8_t reserved1:1; \
+    uint8_t ref:1; \
     uint8_t reserved2:1
 
 typedef struct _image_base_t {
@@ -68,12 +69,32 @@ typedef struct _greyscale_t {
     uint8_t byte_data[];
 } greyscale_t;
 
+// A read-only greyscale image whose packed pixels are not its own, such as part of a
+// bytes object frozen into flash.  Laid out like greyscale_t up to the pixel data.
+typedef struct _greyscale_ref_t {
+    TYPE_AND_FLAGS;
+    uint8_t height;
+    uint8_t width;
+    const uint8_t *byte_data;
+    mp_obj_t owner; // keeps byte_data alive
+} greyscale_ref_t;
+
 typedef union _microbit_image_obj_t {
     image_base_t base;
     monochrome_5by5_t monochrome_5by5;
     greyscale_t greyscale;
+    greyscale_ref_t greyscale_ref;
 } microbit_image_obj_t;
 
+// The packed pixels of a greyscale image, for reading.
+static inline const uint8_t *greyscale_data(const greyscale_t *self) {
+    return self->ref ? ((const greyscale_ref_t *)self)->byte_data : self->byte_data;
+}
+
+static inline bool image_is_mutable(const microbit_image_obj_t *self) {
+    return !self->base.five && !self->base.ref;
+}
+
 extern const mp_obj_type_t microbit_const_image_type;
 extern const mp_obj_type_t microbit_image_type;
 
@@ -81,6 +102,7 @@ extern const monochrome_5by5_t microbit_blank_image;
 extern const monochrome_5by5_t microbit_const_image_heart_obj;
 
 greyscale_t *greyscale_new(mp_int_t w, mp_int_t h);
+greyscale_ref_t *greyscale_ref_new(mp_int_t w, mp_int_t h, const uint8_t *data, mp_obj_t owner);
 void greyscale_clear(greyscale_t *self);
 void greyscale_fill(greyscale_t *self, mp_int_t val);
 uint8_t greyscale_get_pixel(greyscale_t *self, mp_int_t x, mp_int_t y);
@@ -91,12 +113,17 @@ mp_int_t image_height(microbit_image_obj_t *self);
 uint8_t image_get_pixel(microbit_image_obj_t *self, mp_int_t x, mp_int_t y);
 greyscale_t *image_copy(microbit_image_obj_t *self);
 greyscale_t *image_invert(microbit_image_obj_t *self);
+void image_invert_into(greyscale_t *dest, microbit_image_obj_t *src);
+void image_sum(greyscale_t *dest, microbit_image_obj_t *lhs, microbit_image_obj_t *rhs, bool add);
+void image_dim(greyscale_t *dest, microbit_image_obj_t *src, mp_float_t fval);
 void image_blit(microbit_image_obj_t *src, greyscale_t *dest, mp_int_t x, mp_int_t y, mp_int_t w, mp_int_t h, mp_int_t xdest, mp_int_t ydest);
 
 // Return a facade object that presents the string as a sequence of images
 mp_obj_t microbit_string_facade(mp_obj_t string);
 
 microbit_image_obj_t *microbit_image_for_char(char c);
+// Return the constant font image for a character, without allocating
+microbit_image_obj_t *microbit_const_image_for_char(char c);
 microbit_image_obj_t *microbit_image_dim(microbit_image_obj_t *lhs, mp_float_t fval);
 
 // ref argument exists so that we can pull a string out of an object and not have it GC'ed while oterating over it
@@ -29,14 +29,219 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/mperrno.h"
+#include "drv_arena.h"
 #include "drv_radio.h"
+#include "drv_radiostream.h"
+#include "drv_radiosync.h"
+#include "drv_softtimer.h"
+#include "drv_stats.h"
+
+// 1 byte for len, 1 byte for RSSI, 4 bytes for time, 1 byte for group, 1 byte for channel
+#define RADIO_PACKET_OVERHEAD (1 + 1 + 4 + 1 + 1)
+
+// A "len" byte with this value marks the point where the producer wrapped back to the
+// start of the RX queue.  It can never be a valid length because max_payload <= 251.
+#define RADIO_RX_QUEUE_WRAP (0xff)
+
+// The RX queue is a single-producer/single-consumer ring of variable-length packet
+// records.  The radio IRQ is the only writer of rx_head and the main thread (via peek
+// and pop) is the only writer of rx_tail, so no locking is needed between them.
+//
+// Records are always stored contiguously.  If there is not enough room at the end of
+// the ring for an incoming packet then a RADIO_RX_QUEUE_WRAP marker is written (if
+// there is room for it) and the packet is stored at the start of the ring instead.
+// The queue is empty when rx_head == rx_tail, and rx_head is never allowed to catch
+// up to rx_tail from behind, so the two cases can't be confused.
+static uint8_t *rx_queue = NULL; // start of the RX queue, within radio_buf
+static size_t rx_queue_size = 0; // size in bytes of the RX queue
+static volatile size_t rx_head = 0; // offset where the IRQ writes the next packet
+static volatile size_t rx_tail = 0; // offset of the next packet to be read
+
+// The TX queue is a FIFO of fixed-size slots, each the same size as the tx/rx buffer.
+// The main thread is the only writer of tx_head and the radio IRQ is the only writer
+// of tx_tail; both are free-running counters so tx_head - tx_tail is the queue length.
+// While tx_active is true the radio is in TX mode and the IRQ sends the queued packets
+// back-to-back, then switches the radio back to RX when the queue is empty.
+static uint8_t *tx_queue = NULL; // start of the TX queue, within radio_buf
+static size_t tx_queue_len = 0; // number of slots in the TX queue
+static size_t tx_slot_size = 0; // size in bytes of each slot
+static volatile uint32_t tx_head = 0;
+static volatile uint32_t tx_tail = 0;
+static volatile bool tx_active = false;
+static volatile uint32_t tx_last_end_us = 0; // time that the last packet finished sending
+
+// A reply is a packet that the IRQ sends straight after receiving the one it answers,
+// with the radio turning around to TX by itself.  It goes before anything queued.
+static uint8_t *reply_buf = NULL; // within radio_buf
+static volatile bool reply_active = false;
+
+// Link statistics, written by the RADIO IRQ and by synchronous sends.  The RX queue
+// depth is the number of packets pushed by the IRQ minus the number popped.
+static microbit_radio_stats_t radio_stats;
+static volatile uint32_t rx_pushed = 0;
+static volatile uint32_t rx_popped = 0;
+static uint32_t tx_busy_start_us; // when the radio last left RX mode to send
+
+// When hopping, the soft timer moves the receiver to the next channel in the list every
+// hop interval.  If the radio is sending, or receiving a packet, then the hop is left
+// pending and the IRQ takes it as soon as the radio is done, before listening again.
+static microbit_soft_timer_entry_t hop_timer;
+static bool hop_timer_inserted = false;
+static uint8_t hop_channels[MICROBIT_RADIO_MAX_HOP_CHANNELS];
+static size_t hop_num_channels = 0;
+static size_t hop_index = 0;
+static volatile bool hop_pending = false;
+
+// These are the shorts used while the radio is in RX mode and controlled synchronously.
+#define RADIO_SHORTS_RX (RADIO_SHORTS_ADDRESS_RSSISTART_Msk)
+
+// These shorts let the radio move between RX and TX modes without waiting on the CPU.
+#define RADIO_SHORTS_TO_TX (RADIO_SHORTS_RX | RADIO_SHORTS_DISABLED_TXEN_Msk | RADIO_SHORTS_READY_START_Msk)
+#define RADIO_SHORTS_TO_RX (RADIO_SHORTS_RX | RADIO_SHORTS_DISABLED_RXEN_Msk | RADIO_SHORTS_READY_START_Msk)
+
+STATIC bool rx_queue_reserve(size_t head, size_t len, size_t *offset) {
+    size_t tail = rx_tail;
+    if (head >= tail) {
+        // Free space is at the end of the ring and before the tail at the start.
+        if (head + len <= rx_queue_size) {
+            *offset = head;
+            return true;
+        }
+        if (len < tail) {
+            if (head < rx_queue_size) {
+                rx_queue[head] = RADIO_RX_QUEUE_WRAP;
+            }
+            *offset = 0;
+            return true;
+        }
+    } else {
+        // Producer has wrapped, free space is between the head and the tail.
+        if (head + len < tail) {
+            *offset = head;
+            return true;
+        }
+    }
+    return false;
+}
 
-#define RADIO_PACKET_OVERHEAD (1 + 1 + 4) // 1 byte for len, 1 byte for RSSI, 4 bytes for time
+// Move to the next hop channel.  The new frequency is used from the next RXEN.
+STATIC void radio_hop_next(void) {
+    hop_pending = false;
+    hop_index = (hop_index + 1) % hop_num_channels;
+    NRF_RADIO->FREQUENCY = hop_channels[hop_index];
+}
 
-static uint8_t *rx_buf_end = NULL; // pointer to the end of the allocated RX queue
-static uint8_t *rx_buf = NULL; // pointer to last packet on the RX queue
+STATIC inline uint8_t *tx_queue_slot(uint32_t index) {
+    return tx_queue + (index % tx_queue_len) * tx_slot_size;
+}
+
+// Called by the IRQ when a queued packet has been sent.
+STATIC void radio_tx_end(void) {
+    tx_last_end_us = mp_hal_ticks_us();
+    ++radio_stats.tx_packets;
+    ++tx_tail;
+    if (tx_head != tx_tail) {
+        // The radio is in TXIDLE, so the next packet can be sent straight away.
+        NRF_RADIO->PACKETPTR = (uint32_t)tx_queue_slot(tx_tail);
+        NRF_RADIO->TASKS_START = 1;
+    } else {
+        // Nothing more to send, so go back to listening via DISABLE -> RXEN -> START.
+        radio_stats.tx_busy_us += tx_last_end_us - tx_busy_start_us;
+        tx_active = false;
+        if (hop_pending) {
+            radio_hop_next();
+        }
+        NRF_RADIO->PACKETPTR = (uint32_t)MP_STATE_PORT(radio_buf);
+        NRF_RADIO->SHORTS = RADIO_SHORTS_TO_RX;
+        NRF_RADIO->TASKS_DISABLE = 1;
+    }
+}
+
+// Called by the IRQ when a reply has been sent.
+STATIC void radio_reply_end(void) {
+    ++radio_stats.tx_packets;
+    reply_active = false;
+    if (tx_head != tx_tail) {
+        // Packets were queued while the reply was going out, and the radio is in TXIDLE.
+        tx_active = true;
+        NRF_RADIO->PACKETPTR = (uint32_t)tx_queue_slot(tx_tail);
+        NRF_RADIO->TASKS_START = 1;
+    } else {
+        radio_stats.tx_busy_us += mp_hal_ticks_us() - tx_busy_start_us;
+        if (hop_pending) {
+            radio_hop_next();
+        }
+        NRF_RADIO->PACKETPTR = (uint32_t)MP_STATE_PORT(radio_buf);
+        NRF_RADIO->SHORTS = RADIO_SHORTS_TO_RX;
+        NRF_RADIO->TASKS_DISABLE = 1;
+    }
+}
+
+// Longest time a queued packet or reply can take to send: a full payload at 250kbit/s
+// takes about 8.5ms.
+#define RADIO_TX_PACKET_TIMEOUT_MS (10)
+
+// Wait for any queued packets to be sent, then put the radio in a state where it can
+// be controlled synchronously.  Returns false if they weren't all sent in time, which
+// happens if an END event is lost; the TX queue is then emptied and the IRQ is left
+// disabled, for the caller to restart the radio.
+STATIC bool radio_tx_flush(void) {
+    uint32_t timeout_ms = RADIO_TX_PACKET_TIMEOUT_MS * (tx_head - tx_tail + 1);
+    uint32_t start_ms = mp_hal_ticks_ms();
+    while (tx_active || reply_active) {
+        if (mp_hal_ticks_ms() - start_ms >= timeout_ms) {
+            NVIC_DisableIRQ(RADIO_IRQn);
+            tx_tail = tx_head;
+            tx_active = false;
+            reply_active = false;
+            radio_stats.tx_busy_us += mp_hal_ticks_us() - tx_busy_start_us;
+            NRF_RADIO->PACKETPTR = (uint32_t)MP_STATE_PORT(radio_buf);
+            NRF_RADIO->SHORTS = RADIO_SHORTS_RX;
+            return false;
+        }
+        microbit_hal_idle();
+    }
+    NRF_RADIO->SHORTS = RADIO_SHORTS_RX;
+    return true;
+}
+
+// Abandon whatever the radio is doing and start receiving again, with the IRQ enabled.
+STATIC void radio_rx_restart(void) {
+    NRF_RADIO->EVENTS_DISABLED = 0;
+    NRF_RADIO->TASKS_DISABLE = 1;
+    while (NRF_RADIO->EVENTS_DISABLED == 0) {
+    }
+    NRF_RADIO->EVENTS_READY = 0;
+    NRF_RADIO->TASKS_RXEN = 1;
+    while (NRF_RADIO->EVENTS_READY == 0) {
+    }
+    NRF_RADIO->EVENTS_ADDRESS = 0;
+    NRF_RADIO->EVENTS_END = 0;
+    NRF_RADIO->TASKS_START = 1;
+    NVIC_ClearPendingIRQ(RADIO_IRQn);
+    NVIC_EnableIRQ(RADIO_IRQn);
+}
+
+STATIC void radio_irq_handler(void) {
+    if (tx_active || reply_active) {
+        // Only an END event in TXIDLE state is for a sent packet.  Anything else is left
+        // over from the RX mode that was interrupted to start sending.
+        if (NRF_RADIO->EVENTS_END) {
+            NRF_RADIO->EVENTS_END = 0;
+            NRF_RADIO->EVENTS_ADDRESS = 0;
+            NRF_RADIO->EVENTS_READY = 0;
+            if (NRF_RADIO->STATE == RADIO_STATE_STATE_TxIdle) {
+                if (reply_active) {
+                    radio_reply_end();
+                } else {
+                    radio_tx_end();
+                }
+            }
+        }
+        return;
+    }
 
-void microbit_radio_irq_handler(void) {
     if (NRF_RADIO->EVENTS_READY) {
         NRF_RADIO->EVENTS_READY = 0;
         NRF_RADIO->TASKS_START = 1;
@@ -44,6 +249,7 @@ void microbit_radio_irq_handler(void) {
 
     if (NRF_RADIO->EVENTS_END) {
         NRF_RADIO->EVENTS_END = 0;
+        NRF_RADIO->EVENTS_ADDRESS = 0;
 
         size_t max_len = NRF_RADIO->PCNF1 & 0xff;
         uint8_t *pkt = MP_STATE_PORT(radio_buf);
@@ -53,38 +259,177 @@ void microbit_radio_irq_handler(void) {
             pkt[0] = len;
         }
 
-        // if the CRC was valid, and there's enough room in the RX queue, then accept the packet
-        if (NRF_RADIO->CRCSTATUS == 1 && rx_buf + RADIO_PACKET_OVERHEAD + len <= rx_buf_end) {
+        // get the microsecond timestamp as close as possible to the END event
+        uint32_t time = mp_hal_ticks_us();
+
+        // Stream fragments and acks are handled here, and some need an immediate reply.
+        int reply_len = -1;
+        if (NRF_RADIO->CRCSTATUS != 1) {
+            ++radio_stats.crc_errors;
+        } else {
+            ++radio_stats.rx_packets;
+            reply_len = microbit_radio_stream_handle_rx(pkt, reply_buf);
+            if (reply_len > 0) {
+                // Turn around via DISABLE -> TXEN -> START, then back in radio_reply_end.
+                tx_busy_start_us = time;
+                reply_active = true;
+                NRF_RADIO->PACKETPTR = (uint32_t)reply_buf;
+                NRF_RADIO->SHORTS = RADIO_SHORTS_TO_TX;
+                NRF_RADIO->TASKS_DISABLE = 1;
+                return;
+            }
+        }
+
+        // if the CRC was valid, the packet is not a stream or time-sync packet, and
+        // there's enough room in the RX queue, then accept the packet
+        size_t offset;
+        if (NRF_RADIO->CRCSTATUS != 1
+            || reply_len >= 0
+            || microbit_radio_sync_handle_rx(pkt, time)) {
+            // Not for the RX queue.
+        } else if (!rx_queue_reserve(rx_head, RADIO_PACKET_OVERHEAD + len, &offset)) {
+            ++radio_stats.rx_queue_full;
+        } else {
+            uint8_t *rx_buf = &rx_queue[offset];
+
             // copy the data to the queue
             memcpy(rx_buf, pkt, 1 + len);
 
             // store RSSI as last byte in packet (needs to be negated to get actual dBm value)
             rx_buf[1 + len] = NRF_RADIO->RSSISAMPLE;
 
-            // get and store the microsecond timestamp
-            uint32_t time = mp_hal_ticks_us();
+            // store the microsecond timestamp
             rx_buf[1 + len + 1] = time & 0xff;
             rx_buf[1 + len + 2] = (time >> 8) & 0xff;
             rx_buf[1 + len + 3] = (time >> 16) & 0xff;
             rx_buf[1 + len + 4] = (time >> 24) & 0xff;
 
-            // move the RX queue pointer to end of this new packet
-            rx_buf += RADIO_PACKET_OVERHEAD + len;
+            // store the group (the prefix of the matching logical address) and channel
+            uint32_t match = NRF_RADIO->RXMATCH;
+            uint32_t prefix = match < 4 ? NRF_RADIO->PREFIX0 : NRF_RADIO->PREFIX1;
+            rx_buf[1 + len + 5] = prefix >> (8 * (match & 3));
+            rx_buf[1 + len + 6] = NRF_RADIO->FREQUENCY;
+
+            // publish the packet to the consumer, only after all its data is written
+            __DMB();
+            rx_head = offset + RADIO_PACKET_OVERHEAD + len;
+            uint32_t depth = ++rx_pushed - rx_popped;
+            if (depth > radio_stats.rx_queue_peak) {
+                radio_stats.rx_queue_peak = depth;
+            }
+            microbit_radio_rx_callback();
         }
 
-        NRF_RADIO->TASKS_START = 1;
+        if (hop_pending) {
+            // Take the hop that was deferred while this packet came in.
+            radio_hop_next();
+            NRF_RADIO->SHORTS = RADIO_SHORTS_TO_RX;
+            NRF_RADIO->TASKS_DISABLE = 1;
+        } else {
+            NRF_RADIO->TASKS_START = 1;
+        }
+    }
+}
+
+void microbit_radio_irq_handler(void) {
+    MICROBIT_STATS_BEGIN(stats_start);
+    radio_irq_handler();
+    MICROBIT_STATS_END(MICROBIT_STATS_RADIO_IRQ, stats_start);
+}
+
+// Set up BASE0/PREFIX0 as logical address 0 to send and receive on, and any extra
+// groups as logical addresses 1-7, using BASE1 with the same value as BASE0.
+STATIC void radio_set_addresses(microbit_radio_config_t *config) {
+    uint32_t prefix[2] = { config->prefix0, 0 };
+    for (size_t i = 0; i < config->num_rx_groups; ++i) {
+        size_t n = 1 + i;
+        prefix[n / 4] |= config->rx_groups[i] << (8 * (n % 4));
+    }
+    NRF_RADIO->BASE0 = config->base0;
+    NRF_RADIO->BASE1 = config->base0;
+    NRF_RADIO->PREFIX0 = prefix[0];
+    NRF_RADIO->PREFIX1 = prefix[1];
+    NRF_RADIO->TXADDRESS = 0; // transmit on logical address 0
+    NRF_RADIO->RXADDRESSES = (1 << (1 + config->num_rx_groups)) - 1; // a bit mask of logical addresses
+}
+
+// This runs at the soft timer's interrupt priority.
+STATIC void radio_hop_callback(microbit_soft_timer_entry_t *entry) {
+    (void)entry;
+    if (!NVIC_GetEnableIRQ(RADIO_IRQn)) {
+        // The radio is being controlled synchronously.
+        return;
+    }
+    NVIC_DisableIRQ(RADIO_IRQn);
+    // Don't interrupt a send, or retune while a packet is coming in (its address has
+    // matched but it hasn't ended) or before a received packet is tagged.  The IRQ
+    // takes the hop once the radio is done.
+    if (tx_active || reply_active || NRF_RADIO->EVENTS_ADDRESS || NRF_RADIO->EVENTS_END) {
+        hop_pending = true;
+    } else {
+        // The new frequency is used via DISABLE -> RXEN -> START.
+        radio_hop_next();
+        NRF_RADIO->SHORTS = RADIO_SHORTS_TO_RX;
+        NRF_RADIO->TASKS_DISABLE = 1;
+    }
+    NVIC_EnableIRQ(RADIO_IRQn);
+}
+
+STATIC void radio_hop_stop(void) {
+    if (hop_timer_inserted) {
+        microbit_soft_timer_remove(&hop_timer);
+        hop_timer_inserted = false;
+    }
+    hop_num_channels = 0;
+    hop_pending = false;
+}
+
+// Returns the channel to start receiving on.  This must be called with the radio IRQ
+// disabled, so the hop timer can't run until the radio has been set up.
+STATIC uint8_t radio_hop_start(microbit_radio_config_t *config) {
+    radio_hop_stop();
+    if (config->num_hop_channels == 0) {
+        return config->channel;
+    }
+    memcpy(hop_channels, config->hop_channels, config->num_hop_channels);
+    hop_num_channels = config->num_hop_channels;
+    hop_index = 0;
+    if (hop_num_channels > 1) {
+        hop_timer.flags = 0;
+        hop_timer.mode = MICROBIT_SOFT_TIMER_MODE_PERIODIC;
+        hop_timer.delta_us = config->hop_interval_ms * 1000;
+        hop_timer.c_callback = radio_hop_callback;
+        microbit_soft_timer_insert(&hop_timer, hop_timer.delta_us);
+        hop_timer_inserted = true;
     }
+    return hop_channels[0];
 }
 
 void microbit_radio_enable(microbit_radio_config_t *config) {
+    // The SoftDevice owns the RADIO while BLE is running.
+    if (microbit_hal_ble_running()) {
+        mp_raise_OSError(MP_EBUSY);
+    }
     microbit_radio_disable();
 
-    // allocate tx and rx buffers
+    // allocate tx and rx buffers, laid out as: tx/rx buffer, reply buffer, TX queue, RX queue
+    // The RX queue has one extra packet's worth of space to account for the bytes that
+    // are lost at the end of the ring when it wraps, so queue_len packets always fit.
     size_t max_payload = config->max_payload + RADIO_PACKET_OVERHEAD;
-    size_t queue_len = config->queue_len + 1; // one extra for tx/rx buffer
-    MP_STATE_PORT(radio_buf) = m_new(uint8_t, max_payload * queue_len);
-    rx_buf_end = MP_STATE_PORT(radio_buf) + max_payload * queue_len;
-    rx_buf = MP_STATE_PORT(radio_buf) + max_payload; // start is tx/rx buffer
+    tx_queue_len = config->tx_queue_len;
+    tx_slot_size = max_payload;
+    rx_queue_size = max_payload * (config->queue_len + 1);
+    MP_STATE_PORT(radio_buf) = microbit_arena_alloc(max_payload + 1 + MICROBIT_RADIO_STREAM_ACK_LEN + tx_queue_len * tx_slot_size + rx_queue_size);
+    reply_buf = MP_STATE_PORT(radio_buf) + max_payload; // start is tx/rx buffer
+    tx_queue = reply_buf + 1 + MICROBIT_RADIO_STREAM_ACK_LEN;
+    rx_queue = tx_queue + tx_queue_len * tx_slot_size;
+    tx_head = 0;
+    tx_tail = 0;
+    rx_head = 0;
+    rx_tail = 0;
+    rx_pushed = 0;
+    rx_popped = 0;
+    microbit_radio_stream_reset();
 
     // Enable the High Frequency clock on the processor. This is a pre-requisite for
     // the RADIO module. Without this clock, no communication is possible.
@@ -97,7 +442,7 @@ void microbit_radio_enable(microbit_radio_config_t *config) {
     NRF_RADIO->TXPOWER = config->power_dbm;
 
     // should be between 0 and 100 inclusive (actual physical freq is 2400MHz + this register)
-    NRF_RADIO->FREQUENCY = config->channel;
+    NRF_RADIO->FREQUENCY = radio_hop_start(config);
 
     // configure data rate
     NRF_RADIO->MODE = config->data_rate;
@@ -105,12 +450,10 @@ void microbit_radio_enable(microbit_radio_config_t *config) {
     // The radio supports filtering packets at the hardware level based on an address.
     // We use a 5-byte address comprised of 4 bytes (set by BALEN=4 below) from the BASEx
     // register, plus 1 byte from PREFIXm.APn.
-    // The (x,m,n) values are selected by the logical address.  We use logical address 0
-    // which means using BASE0 with PREFIX0.AP0.
-    NRF_RADIO->BASE0 = config->base0;
-    NRF_RADIO->PREFIX0 = config->prefix0;
-    NRF_RADIO->TXADDRESS = 0; // transmit on logical address 0
-    NRF_RADIO->RXADDRESSES = 1; // a bit mask, listen only to logical address 0
+    // The (x,m,n) values are selected by the logical address.  We send on logical
+    // address 0 which means using BASE0 with PREFIX0.AP0, and receive on that plus any
+    // extra groups, which use BASE1 with PREFIX0.AP1-3 and PREFIX1.AP4-7.
+    radio_set_addresses(config);
 
     // LFLEN=8 bits, S0LEN=0, S1LEN=0
     NRF_RADIO->PCNF0 = 0x00000008;
@@ -134,7 +477,7 @@ void microbit_radio_enable(microbit_radio_config_t *config) {
     NVIC_ClearPendingIRQ(RADIO_IRQn);
     NVIC_EnableIRQ(RADIO_IRQn);
 
-    NRF_RADIO->SHORTS |= RADIO_SHORTS_ADDRESS_RSSISTART_Msk;
+    NRF_RADIO->SHORTS = RADIO_SHORTS_RX;
 
     // enable receiver
     NRF_RADIO->EVENTS_READY = 0;
@@ -142,26 +485,45 @@ void microbit_radio_enable(microbit_radio_config_t *config) {
     while (NRF_RADIO->EVENTS_READY == 0) {
     }
 
+    NRF_RADIO->EVENTS_ADDRESS = 0;
     NRF_RADIO->EVENTS_END = 0;
     NRF_RADIO->TASKS_START = 1;
 }
 
 void microbit_radio_disable(void) {
+    if (microbit_hal_ble_running()) {
+        // Never enabled, and the RADIO can't be touched.
+        return;
+    }
+    if (MP_STATE_PORT(radio_buf) == NULL) {
+        // Already off.  The RADIO may never have been enabled, in which case DISABLED
+        // would never fire and the wait below would hang.
+        return;
+    }
+    (void)radio_tx_flush(); // on a timeout the queued packets are just dropped
     NVIC_DisableIRQ(RADIO_IRQn);
+    radio_hop_stop();
     NRF_RADIO->EVENTS_DISABLED = 0;
     NRF_RADIO->TASKS_DISABLE = 1;
     while (NRF_RADIO->EVENTS_DISABLED == 0) {
     }
 
-    // free any old buffers
-    if (MP_STATE_PORT(radio_buf) != NULL) {
-        m_del(uint8_t, MP_STATE_PORT(radio_buf), rx_buf_end - MP_STATE_PORT(radio_buf));
-        MP_STATE_PORT(radio_buf) = NULL;
-    }
+    // free the old buffers
+    microbit_radio_stream_reset();
+    microbit_arena_free(MP_STATE_PORT(radio_buf), rx_queue + rx_queue_size - MP_STATE_PORT(radio_buf));
+    MP_STATE_PORT(radio_buf) = NULL;
+    reply_buf = NULL;
+    tx_queue = NULL;
+    rx_queue = NULL;
+}
+
+bool microbit_radio_is_enabled(void) {
+    return MP_STATE_PORT(radio_buf) != NULL;
 }
 
 void microbit_radio_update_config(microbit_radio_config_t *config) {
     // disable radio
+    bool flushed = radio_tx_flush();
     NVIC_DisableIRQ(RADIO_IRQn);
     NRF_RADIO->EVENTS_DISABLED = 0;
     NRF_RADIO->TASKS_DISABLE = 1;
@@ -170,10 +532,9 @@ void microbit_radio_update_config(microbit_radio_config_t *config) {
 
     // change state
     NRF_RADIO->TXPOWER = config->power_dbm;
-    NRF_RADIO->FREQUENCY = config->channel;
+    NRF_RADIO->FREQUENCY = radio_hop_start(config);
     NRF_RADIO->MODE = config->data_rate;
-    NRF_RADIO->BASE0 = config->base0;
-    NRF_RADIO->PREFIX0 = config->prefix0;
+    radio_set_addresses(config);
 
     // need to set RXEN for FREQUENCY decision point
     NRF_RADIO->EVENTS_READY = 0;
@@ -182,26 +543,21 @@ void microbit_radio_update_config(microbit_radio_config_t *config) {
     }
 
     // need to set START for BASE0 and PREFIX0 decision point
+    NRF_RADIO->EVENTS_ADDRESS = 0;
     NRF_RADIO->EVENTS_END = 0;
     NRF_RADIO->TASKS_START = 1;
 
     NVIC_ClearPendingIRQ(RADIO_IRQn);
     NVIC_EnableIRQ(RADIO_IRQn);
-}
-
-// This assumes the radio is enabled.
-void microbit_radio_send(const void *buf, size_t len, const void *buf2, size_t len2) {
-    // transmission will occur synchronously
-    NVIC_DisableIRQ(RADIO_IRQn);
 
-    // Turn off the transceiver.
-    NRF_RADIO->EVENTS_DISABLED = 0;
-    NRF_RADIO->TASKS_DISABLE = 1;
-    while (NRF_RADIO->EVENTS_DISABLED == 0) {
+    // The new config is in use, but queued packets were dropped.
+    if (!flushed) {
+        mp_raise_OSError(MP_ETIMEDOUT);
     }
+}
 
-    // construct the packet
-    // note: we must send from RAM
+// Construct a packet in dest, truncating the data to the maximum payload length.
+STATIC void radio_build_packet(uint8_t *dest, const void *buf, size_t len, const void *buf2, size_t len2) {
     size_t max_len = NRF_RADIO->PCNF1 & 0xff;
     if (len + len2 > max_len) {
         if (len > max_len) {
@@ -211,13 +567,34 @@ void microbit_radio_send(const void *buf, size_t len, const void *buf2, size_t l
             len2 = max_len - len;
         }
     }
-    MP_STATE_PORT(radio_buf)[0] = len + len2;
-    memcpy(MP_STATE_PORT(radio_buf) + 1, buf, len);
+    dest[0] = len + len2;
+    memcpy(dest + 1, buf, len);
     if (len2 != 0) {
-        memcpy(MP_STATE_PORT(radio_buf) + 1 + len, buf2, len2);
+        memcpy(dest + 1 + len, buf2, len2);
+    }
+}
+
+// This assumes the radio is enabled.
+void microbit_radio_send(const void *buf, size_t len, const void *buf2, size_t len2) {
+    // transmission will occur synchronously, after anything already queued
+    if (!radio_tx_flush()) {
+        radio_rx_restart();
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+    NVIC_DisableIRQ(RADIO_IRQn);
+
+    // Turn off the transceiver.
+    NRF_RADIO->EVENTS_DISABLED = 0;
+    NRF_RADIO->TASKS_DISABLE = 1;
+    while (NRF_RADIO->EVENTS_DISABLED == 0) {
     }
 
+    // construct the packet
+    // note: we must send from RAM
+    radio_build_packet(MP_STATE_PORT(radio_buf), buf, len, buf2, len2);
+
     // Turn on the transmitter, and wait for it to signal that it's ready to use.
+    uint32_t start_us = mp_hal_ticks_us();
     NRF_RADIO->EVENTS_READY = 0;
     NRF_RADIO->TASKS_TXEN = 1;
     while (NRF_RADIO->EVENTS_READY == 0) {
@@ -228,6 +605,9 @@ void microbit_radio_send(const void *buf, size_t len, const void *buf2, size_t l
     NRF_RADIO->EVENTS_END = 0;
     while (NRF_RADIO->EVENTS_END == 0) {
     }
+    tx_last_end_us = mp_hal_ticks_us();
+    ++radio_stats.tx_packets;
+    radio_stats.tx_busy_us += tx_last_end_us - start_us;
 
     // Turn off the transmitter.
     NRF_RADIO->EVENTS_DISABLED = 0;
@@ -241,6 +621,7 @@ void microbit_radio_send(const void *buf, size_t len, const void *buf2, size_t l
     while (NRF_RADIO->EVENTS_READY == 0) {
     }
 
+    NRF_RADIO->EVENTS_ADDRESS = 0;
     NRF_RADIO->EVENTS_END = 0;
     NRF_RADIO->TASKS_START = 1;
 
@@ -248,40 +629,104 @@ void microbit_radio_send(const void *buf, size_t len, const void *buf2, size_t l
     NVIC_EnableIRQ(RADIO_IRQn);
 }
 
-const uint8_t *microbit_radio_peek(void) {
-    // Disable the radio IRQ while we peek for packet.
+// Send a packet through the TX queue and wait for it to go out, returning the time of
+// its END event as latched by radio_tx_end() in the IRQ.  Unlike the time taken after
+// microbit_radio_send(), this doesn't include the latency of polling in thread mode.
+// This assumes the radio is enabled.
+uint32_t microbit_radio_send_timed(const void *buf, size_t len, const void *buf2, size_t len2) {
+    // Start from an empty queue, so the packet is the only one sent.
+    bool sent = radio_tx_flush();
     NVIC_DisableIRQ(RADIO_IRQn);
+    radio_rx_restart();
+    if (sent) {
+        microbit_radio_send_async(buf, len, buf2, len2);
+        sent = radio_tx_flush();
+        NVIC_DisableIRQ(RADIO_IRQn);
+        radio_rx_restart();
+    }
+    if (!sent) {
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+    return tx_last_end_us;
+}
 
-    // Get the pointer to the next waiting packet.
-    const uint8_t *buf = MP_STATE_PORT(radio_buf) + (NRF_RADIO->PCNF1 & 0xff) + RADIO_PACKET_OVERHEAD; // skip tx buf
-
-    // Return NULL if there are no packets waiting.
-    if (rx_buf == buf) {
-        buf = NULL;
+// Queue a packet to be sent by the radio IRQ, and return straight away.
+// Returns false if the TX queue is full.  This assumes the radio is enabled.
+bool microbit_radio_send_async(const void *buf, size_t len, const void *buf2, size_t len2) {
+    if (tx_head - tx_tail >= tx_queue_len) {
+        return false;
     }
+    radio_build_packet(tx_queue_slot(tx_head), buf, len, buf2, len2);
+    __DMB();
+    ++tx_head;
 
-    // Re-enable the radio IRQ.
+    // Start sending if the IRQ is not already working through the queue.  If it's sending
+    // a reply then it will start on the queue after that.
+    NVIC_DisableIRQ(RADIO_IRQn);
+    if (!tx_active && !reply_active && tx_head != tx_tail) {
+        // Any packet being received is abandoned, same as for a synchronous send.
+        tx_busy_start_us = mp_hal_ticks_us();
+        tx_active = true;
+        NRF_RADIO->PACKETPTR = (uint32_t)tx_queue_slot(tx_tail);
+        NRF_RADIO->SHORTS = RADIO_SHORTS_TO_TX;
+        NRF_RADIO->TASKS_DISABLE = 1;
+    }
     NVIC_EnableIRQ(RADIO_IRQn);
 
-    return buf;
+    return true;
 }
 
-void microbit_radio_pop(void) {
-    // Disable the radio IRQ while we pop the packet.
-    NVIC_DisableIRQ(RADIO_IRQn);
+// Returns the number of packets that microbit_radio_send_async() can queue right now.
+size_t microbit_radio_tx_queue_space(void) {
+    return tx_queue_len - (tx_head - tx_tail);
+}
+
+// Returns the microsecond time at which the most recent packet finished sending.
+uint32_t microbit_radio_get_last_tx_time_us(void) {
+    return tx_last_end_us;
+}
+
+// The peek and pop functions are only called by the consumer, and don't need to disable
+// the radio IRQ because the RX queue is lock free.
+const uint8_t *microbit_radio_peek(void) {
+    size_t tail = rx_tail;
 
-    // Get the pointer to the next packet, skipping the TX buffer at the start.
-    uint8_t *buf = MP_STATE_PORT(radio_buf) + (NRF_RADIO->PCNF1 & 0xff) + RADIO_PACKET_OVERHEAD;
+    // Return NULL if there are no packets waiting.
+    if (tail == rx_head) {
+        return NULL;
+    }
 
-    if (rx_buf != buf) {
-        // Copy all subsequent packets down over the first one.
-        size_t len = buf[0];
-        memmove(buf, buf + RADIO_PACKET_OVERHEAD + len, rx_buf - (buf + RADIO_PACKET_OVERHEAD + len));
-        rx_buf -= RADIO_PACKET_OVERHEAD + len;
+    // Follow the producer back to the start of the ring if it wrapped here.
+    if (tail == rx_queue_size || rx_queue[tail] == RADIO_RX_QUEUE_WRAP) {
+        tail = 0;
+        rx_tail = 0;
     }
 
-    // Re-enable the radio IRQ.
-    NVIC_EnableIRQ(RADIO_IRQn);
+    // Make sure the packet data is read after the head index.
+    __DMB();
+
+    return &rx_queue[tail];
+}
+
+void microbit_radio_pop(void) {
+    const uint8_t *buf = microbit_radio_peek();
+    if (buf != NULL) {
+        // Make sure the packet has been fully read before handing its space back to the IRQ.
+        __DMB();
+        rx_tail = buf - rx_queue + RADIO_PACKET_OVERHEAD + buf[0];
+        ++rx_popped;
+    }
+}
+
+// Counters are kept across radio off/on and config changes, until reset.
+void microbit_radio_get_stats(microbit_radio_stats_t *stats, bool reset) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    *stats = radio_stats;
+    stats->rx_queue_depth = rx_pushed - rx_popped;
+    if (reset) {
+        memset(&radio_stats, 0, sizeof(radio_stats));
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
 }
 
 MP_REGISTER_ROOT_POINTER(uint8_t *radio_buf);
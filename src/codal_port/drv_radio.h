@@ -31,6 +31,8 @@
 //  data - "len" bytes
 //  RSSI - byte
 //  time - 4 bytes, little endian, microsecond timestamp
+//  group - byte, the group (address prefix) the packet was received on
+//  channel - byte, the channel the packet was received on
 // Both "len" and "data" are written by the hardware, the others are computed.
 #define MICROBIT_RADIO_PACKET_LEN(p)        ((p)[0])
 #define MICROBIT_RADIO_PACKET_PAYLOAD(p)    (&(p)[1])
@@ -45,29 +47,59 @@
 
 #define MICROBIT_RADIO_DEFAULT_MAX_PAYLOAD  (32)
 #define MICROBIT_RADIO_DEFAULT_QUEUE_LEN    (3)
+#define MICROBIT_RADIO_DEFAULT_TX_QUEUE_LEN (3)
 #define MICROBIT_RADIO_DEFAULT_CHANNEL      (7)
 #define MICROBIT_RADIO_DEFAULT_POWER_DBM    (0)
 #define MICROBIT_RADIO_DEFAULT_BASE0        (0x75626974) // "uBit"
 #define MICROBIT_RADIO_DEFAULT_PREFIX0      (0)
 #define MICROBIT_RADIO_DEFAULT_DATA_RATE    (RADIO_MODE_MODE_Nrf_1Mbit)
 
+#define MICROBIT_RADIO_DEFAULT_HOP_INTERVAL_MS (100)
+
 #define MICROBIT_RADIO_MAX_CHANNEL          (83) // maximum allowed frequency is 2483.5 MHz
+#define MICROBIT_RADIO_MAX_RX_GROUPS        (7) // logical addresses 1-7, in addition to 0
+#define MICROBIT_RADIO_MAX_HOP_CHANNELS     (16)
 
 typedef struct _microbit_radio_config_t {
     uint8_t max_payload;    // 1-251 inclusive
     uint8_t queue_len;      // 1-254 inclusive
+    uint8_t tx_queue_len;   // 1-254 inclusive
     uint8_t channel;        // 0-100 inclusive
     int8_t power_dbm;       // one of: -30, -20, -16, -12, -8, -4, 0, 4
     uint32_t base0;         // for BASE0 register
     uint8_t prefix0;        // for PREFIX0 register (lower 8 bits only)
     uint8_t data_rate;      // one of: RADIO_MODE_MODE_Nrf_{250Kbit,1Mbit,2Mbit}
+    uint8_t num_rx_groups;  // 0-7 inclusive
+    uint8_t rx_groups[MICROBIT_RADIO_MAX_RX_GROUPS]; // extra prefixes to receive on, with BASE0
+    uint8_t num_hop_channels; // 0 to stay on channel, otherwise 1-16 inclusive
+    uint8_t hop_channels[MICROBIT_RADIO_MAX_HOP_CHANNELS]; // each 0-83 inclusive
+    uint16_t hop_interval_ms; // time spent on each hop channel
 } microbit_radio_config_t;
 
+typedef struct _microbit_radio_stats_t {
+    uint32_t rx_packets;    // received with a valid CRC, including stream and sync packets
+    uint32_t tx_packets;    // sent, including stream acks
+    uint32_t crc_errors;    // received with an invalid CRC and discarded
+    uint32_t rx_queue_full; // discarded because the RX queue was full
+    uint32_t rx_queue_depth; // packets in the RX queue now
+    uint32_t rx_queue_peak; // most packets that have been in the RX queue at once
+    uint32_t tx_busy_us;    // time spent out of RX mode to send
+} microbit_radio_stats_t;
+
 void microbit_radio_enable(microbit_radio_config_t *config);
 void microbit_radio_disable(void);
+bool microbit_radio_is_enabled(void);
 void microbit_radio_update_config(microbit_radio_config_t *config);
 void microbit_radio_send(const void *buf, size_t len, const void *buf2, size_t len2);
+bool microbit_radio_send_async(const void *buf, size_t len, const void *buf2, size_t len2);
+uint32_t microbit_radio_send_timed(const void *buf, size_t len, const void *buf2, size_t len2);
+size_t microbit_radio_tx_queue_space(void);
+void microbit_radio_get_stats(microbit_radio_stats_t *stats, bool reset);
+uint32_t microbit_radio_get_last_tx_time_us(void);
 const uint8_t *microbit_radio_peek(void);
 void microbit_radio_pop(void);
 
+// Called from the RADIO IRQ each time a packet is added to the RX queue.
+void microbit_radio_rx_callback(void);
+
 #endif // MICROPY_INCLUDED_CODAL_PORT_DRV_RADIO_H
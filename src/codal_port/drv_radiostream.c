@@ -0,0 +1,316 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "drv_radio.h"
+#include "drv_radiostream.h"
+#include "drv_system.h"
+
+#define STREAM_RX_IDLE      (0) // no buffer to receive into
+#define STREAM_RX_WAITING   (1) // waiting for the first fragment of a message
+#define STREAM_RX_RECEIVING (2) // reassembling message stream_rx_msg
+#define STREAM_RX_DONE      (3) // message stream_rx_msg is complete, for the main thread
+
+// Sender state.  The main thread starts a message and the RADIO IRQ records its acks.
+// Message numbers start from a random point, so that after a reset the first message
+// is unlikely to look like a resend of one the receiver already has.
+static bool stream_tx_next_msg_valid = false;
+static uint8_t stream_tx_next_msg;
+static volatile bool stream_tx_active = false;
+static volatile uint8_t stream_tx_msg;
+static volatile uint8_t stream_tx_base;
+static volatile uint32_t stream_tx_bits;
+
+// Receiver state.  The main thread hands over a buffer and the RADIO IRQ fills it in.
+static volatile uint8_t stream_rx_state = STREAM_RX_IDLE;
+static uint8_t *stream_rx_buf;
+static size_t stream_rx_buf_len;
+static bool stream_rx_complete; // every fragment of stream_rx_msg has been received
+static uint8_t stream_rx_msg;
+static uint8_t stream_rx_count;
+static uint8_t stream_rx_base;
+static uint32_t stream_rx_received[(MICROBIT_RADIO_STREAM_MAX_FRAGMENTS + 31) / 32];
+static size_t stream_rx_len;
+
+STATIC inline bool stream_rx_has(size_t index) {
+    return stream_rx_received[index / 32] & (1 << (index % 32));
+}
+
+// Must be called with the RADIO IRQ disabled, or from it.
+void microbit_radio_stream_reset(void) {
+    stream_tx_active = false;
+    stream_rx_state = STREAM_RX_IDLE;
+    stream_rx_buf = NULL;
+    stream_rx_complete = false;
+}
+
+STATIC size_t stream_make_ack(uint8_t *reply) {
+    uint32_t bits = 0;
+    for (size_t i = 0; i < 32 && stream_rx_base + 1 + i < stream_rx_count; ++i) {
+        if (stream_rx_has(stream_rx_base + 1 + i)) {
+            bits |= 1 << i;
+        }
+    }
+    reply[0] = MICROBIT_RADIO_STREAM_ACK_LEN;
+    uint8_t *buf = reply + 1;
+    memcpy(buf, MICROBIT_RADIO_STREAM_HEADER, MICROBIT_RADIO_STREAM_HEADER_LEN);
+    buf += MICROBIT_RADIO_STREAM_HEADER_LEN;
+    buf[0] = MICROBIT_RADIO_STREAM_TYPE_ACK;
+    buf[1] = stream_rx_msg;
+    buf[2] = stream_rx_base;
+    buf[3] = bits & 0xff;
+    buf[4] = (bits >> 8) & 0xff;
+    buf[5] = (bits >> 16) & 0xff;
+    buf[6] = (bits >> 24) & 0xff;
+    return 1 + MICROBIT_RADIO_STREAM_ACK_LEN;
+}
+
+STATIC int stream_handle_data(const uint8_t *buf, size_t payload_len, uint8_t *reply) {
+    bool poll = buf[0] & MICROBIT_RADIO_STREAM_FLAG_POLL;
+    uint8_t msg = buf[1];
+    size_t index = buf[2];
+    size_t count = buf[3];
+    size_t size = buf[4];
+    const uint8_t *payload = buf + 5;
+    if (index >= count || (index + 1 < count && payload_len != size)) {
+        return 0;
+    }
+
+    if (stream_rx_complete && msg == stream_rx_msg) {
+        // A resend from a sender that missed the final ack.
+        return poll || index + 1 == count ? stream_make_ack(reply) : 0;
+    }
+
+    if (stream_rx_state == STREAM_RX_WAITING
+        || (stream_rx_state == STREAM_RX_RECEIVING && msg != stream_rx_msg)) {
+        // The first fragment of a new message, or the sender gave up on the last one.
+        stream_rx_state = STREAM_RX_RECEIVING;
+        stream_rx_complete = false;
+        stream_rx_msg = msg;
+        stream_rx_count = count;
+        stream_rx_base = 0;
+        stream_rx_len = 0;
+        memset(stream_rx_received, 0, sizeof(stream_rx_received));
+    } else if (stream_rx_state != STREAM_RX_RECEIVING) {
+        // Nowhere to put it, so don't ack it and the sender will try again later.
+        return 0;
+    }
+
+    size_t offset = index * size;
+    if (count != stream_rx_count || offset + payload_len > stream_rx_buf_len) {
+        return 0;
+    }
+    if (!stream_rx_has(index)) {
+        memcpy(stream_rx_buf + offset, payload, payload_len);
+        stream_rx_received[index / 32] |= 1 << (index % 32);
+        if (index + 1 == count) {
+            stream_rx_len = offset + payload_len;
+        }
+        while (stream_rx_base < count && stream_rx_has(stream_rx_base)) {
+            ++stream_rx_base;
+        }
+        if (stream_rx_base == count) {
+            stream_rx_complete = true;
+            stream_rx_buf = NULL;
+            stream_rx_state = STREAM_RX_DONE;
+        }
+    }
+
+    return poll || index + 1 == count ? stream_make_ack(reply) : 0;
+}
+
+STATIC void stream_handle_ack(const uint8_t *buf) {
+    if (!stream_tx_active || buf[1] != stream_tx_msg) {
+        return;
+    }
+    uint8_t base = buf[2];
+    uint32_t bits = buf[3] | buf[4] << 8 | buf[5] << 16 | buf[6] << 24;
+    if (base > stream_tx_base) {
+        stream_tx_base = base;
+        stream_tx_bits = bits;
+    } else if (base == stream_tx_base) {
+        stream_tx_bits |= bits;
+    }
+}
+
+// Called by the RADIO IRQ for each valid packet.  Returns a negative value if it isn't
+// a stream packet, 0 if it was consumed, or the length of the packet written to reply
+// (len byte included) which the IRQ must send straight away.
+int microbit_radio_stream_handle_rx(const uint8_t *pkt, uint8_t *reply) {
+    size_t len = pkt[0];
+    if (len < MICROBIT_RADIO_STREAM_HEADER_LEN + 1
+        || memcmp(pkt + 1, MICROBIT_RADIO_STREAM_HEADER, MICROBIT_RADIO_STREAM_HEADER_LEN) != 0) {
+        return -1;
+    }
+    const uint8_t *buf = pkt + 1 + MICROBIT_RADIO_STREAM_HEADER_LEN;
+    uint8_t type = buf[0] & ~MICROBIT_RADIO_STREAM_FLAG_POLL;
+    if (type == MICROBIT_RADIO_STREAM_TYPE_DATA && len >= MICROBIT_RADIO_STREAM_DATA_OVERHEAD) {
+        return stream_handle_data(buf, len - MICROBIT_RADIO_STREAM_DATA_OVERHEAD, reply);
+    } else if (type == MICROBIT_RADIO_STREAM_TYPE_ACK && len == MICROBIT_RADIO_STREAM_ACK_LEN) {
+        stream_handle_ack(buf);
+    }
+    return 0;
+}
+
+// Send a message of up to MICROBIT_RADIO_STREAM_MAX_FRAGMENTS fragments of fragment_size
+// bytes, waiting until all of it has been acknowledged.  Returns false if that didn't
+// happen within timeout_ms.  The number of fragments sent more than once is stored in
+// resent.  This assumes the radio is enabled.
+bool microbit_radio_stream_send(const uint8_t *buf, size_t len, size_t fragment_size, uint32_t timeout_ms, size_t *resent) {
+    size_t count = len == 0 ? 1 : (len + fragment_size - 1) / fragment_size;
+
+    if (!stream_tx_next_msg_valid) {
+        stream_tx_next_msg_valid = true;
+        stream_tx_next_msg = rng_generate_random_word();
+    }
+
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    stream_tx_msg = stream_tx_next_msg++;
+    stream_tx_base = 0;
+    stream_tx_bits = 0;
+    stream_tx_active = true;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+
+    // Time each fragment in the window was last sent, in a slot indexed by its number.
+    uint16_t slot_fragment[32];
+    uint32_t slot_sent_us[32];
+    memset(slot_fragment, 0xff, sizeof(slot_fragment));
+
+    *resent = 0;
+    uint32_t start_ms = mp_hal_ticks_ms();
+    for (;;) {
+        atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        size_t base = stream_tx_base;
+        uint32_t bits = stream_tx_bits;
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        if (base >= count) {
+            break;
+        }
+
+        // Pick the fragments in the window that are due, as many as the TX queue takes.
+        uint8_t burst[MICROBIT_RADIO_STREAM_WINDOW];
+        size_t burst_len = 0;
+        size_t space = microbit_radio_tx_queue_space();
+        uint32_t now_us = mp_hal_ticks_us();
+        for (size_t i = base; i < MIN(base + MICROBIT_RADIO_STREAM_WINDOW, count) && burst_len < space; ++i) {
+            if (i > base && (bits & (1 << (i - base - 1)))) {
+                continue;
+            }
+            size_t slot = i % 32;
+            if (slot_fragment[slot] == i && now_us - slot_sent_us[slot] < MICROBIT_RADIO_STREAM_RESEND_US) {
+                continue;
+            }
+            burst[burst_len++] = i;
+        }
+
+        for (size_t j = 0; j < burst_len; ++j) {
+            size_t i = burst[j];
+            size_t offset = i * fragment_size;
+            uint8_t header[MICROBIT_RADIO_STREAM_DATA_OVERHEAD];
+            memcpy(header, MICROBIT_RADIO_STREAM_HEADER, MICROBIT_RADIO_STREAM_HEADER_LEN);
+            header[3] = MICROBIT_RADIO_STREAM_TYPE_DATA;
+            if (j + 1 == burst_len) {
+                header[3] |= MICROBIT_RADIO_STREAM_FLAG_POLL;
+            }
+            header[4] = stream_tx_msg;
+            header[5] = i;
+            header[6] = count;
+            header[7] = fragment_size;
+            microbit_radio_send_async(header, sizeof(header), buf + offset, MIN(fragment_size, len - offset));
+            size_t slot = i % 32;
+            if (slot_fragment[slot] == i) {
+                ++*resent;
+            }
+            slot_fragment[slot] = i;
+            slot_sent_us[slot] = now_us;
+        }
+
+        if (mp_hal_ticks_ms() - start_ms >= timeout_ms) {
+            stream_tx_active = false;
+            return false;
+        }
+
+        // Wait for an ack, the TX queue to drain, or the next fragment to be due.
+        mp_handle_pending(true);
+        microbit_system_timer_wake_within_us(MICROBIT_RADIO_STREAM_RESEND_US);
+        microbit_hal_idle();
+    }
+
+    stream_tx_active = false;
+    return true;
+}
+
+// Wait for a message and reassemble it into buf, storing its length in len.  Returns
+// false if no message was complete within timeout_ms, or UINT32_MAX to wait forever.
+// This assumes the radio is enabled.
+bool microbit_radio_stream_receive(uint8_t *buf, size_t max_len, uint32_t timeout_ms, size_t *len) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    stream_rx_buf = buf;
+    stream_rx_buf_len = max_len;
+    stream_rx_state = STREAM_RX_WAITING;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+
+    // The IRQ writes into buf, so it must be taken back however this returns.
+    bool done;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        uint32_t start_ms = mp_hal_ticks_ms();
+        for (;;) {
+            if (stream_rx_state == STREAM_RX_DONE) {
+                break;
+            }
+            uint32_t dt = mp_hal_ticks_ms() - start_ms;
+            if (timeout_ms != UINT32_MAX) {
+                if (dt >= timeout_ms) {
+                    break;
+                }
+                microbit_system_timer_wake_within(timeout_ms - dt);
+            }
+            mp_handle_pending(true);
+            microbit_hal_idle();
+        }
+        nlr_pop();
+    } else {
+        atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        stream_rx_buf = NULL;
+        stream_rx_state = STREAM_RX_IDLE;
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        nlr_jump(nlr.ret_val);
+    }
+
+    // The message may have completed since it was last checked.
+    atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    done = stream_rx_state == STREAM_RX_DONE;
+    stream_rx_buf = NULL;
+    stream_rx_state = STREAM_RX_IDLE;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+
+    *len = stream_rx_len;
+    return done;
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_DRV_RADIOSTREAM_H
+#define MICROPY_INCLUDED_CODAL_PORT_DRV_RADIOSTREAM_H
+
+// Streams are messages of up to 255 fragments, each sent as a radio packet of the form:
+//  header  - 3 bytes, MICROBIT_RADIO_STREAM_HEADER
+//  type    - byte, MICROBIT_RADIO_STREAM_TYPE_DATA, or'd with MICROBIT_RADIO_STREAM_FLAG_POLL
+//  msg     - byte, identifies the message the fragment belongs to
+//  index   - byte, index of this fragment within the message
+//  count   - byte, number of fragments in the message
+//  size    - byte, number of payload bytes in every fragment but the last
+//  payload - the rest of the packet
+// The radio is half duplex, so the sender sends fragments in bursts and sets the poll
+// flag on the last fragment of each burst.  For that one, and for the last fragment of
+// the message, the receiver's RADIO IRQ replies at once with an acknowledgement:
+//  header  - 3 bytes, MICROBIT_RADIO_STREAM_HEADER
+//  type    - byte, MICROBIT_RADIO_STREAM_TYPE_ACK
+//  msg     - byte, the message being acknowledged
+//  base    - byte, all fragments before this index have been received
+//  bits    - 4 bytes, little endian, bit i set if fragment base + 1 + i has been received
+// The sender keeps a window of fragments in flight and resends those that have not been
+// acknowledged after a timeout.
+#define MICROBIT_RADIO_STREAM_HEADER "\x01\x00\x54"
+#define MICROBIT_RADIO_STREAM_HEADER_LEN (3)
+#define MICROBIT_RADIO_STREAM_DATA_OVERHEAD (MICROBIT_RADIO_STREAM_HEADER_LEN + 5)
+#define MICROBIT_RADIO_STREAM_ACK_LEN (MICROBIT_RADIO_STREAM_HEADER_LEN + 3 + 4)
+#define MICROBIT_RADIO_STREAM_TYPE_DATA (0)
+#define MICROBIT_RADIO_STREAM_TYPE_ACK (1)
+#define MICROBIT_RADIO_STREAM_FLAG_POLL (0x80)
+
+#define MICROBIT_RADIO_STREAM_MAX_FRAGMENTS (255)
+
+// Number of fragments that may be unacknowledged at once, at most 32.
+#define MICROBIT_RADIO_STREAM_WINDOW (16)
+
+// Time after which an unacknowledged fragment is sent again.
+#define MICROBIT_RADIO_STREAM_RESEND_US (4000)
+
+void microbit_radio_stream_reset(void);
+bool microbit_radio_stream_send(const uint8_t *buf, size_t len, size_t fragment_size, uint32_t timeout_ms, size_t *resent);
+bool microbit_radio_stream_receive(uint8_t *buf, size_t max_len, uint32_t timeout_ms, size_t *len);
+int microbit_radio_stream_handle_rx(const uint8_t *pkt, uint8_t *reply);
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_DRV_RADIOSTREAM_H
@@ -0,0 +1,155 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "drv_radiosync.h"
+
+// Leader state, only used by the main thread.
+static uint8_t sync_seq;
+static bool sync_last_sent_valid;
+static uint32_t sync_last_sent_us;
+
+// Follower state, written by the RADIO IRQ.
+static volatile bool sync_follow = false;
+static bool sync_last_rx_valid;
+static uint8_t sync_last_rx_seq;
+static uint32_t sync_last_rx_us;
+static uint32_t sync_remote_us[MICROBIT_RADIO_SYNC_NUM_SAMPLES];
+static uint32_t sync_local_us[MICROBIT_RADIO_SYNC_NUM_SAMPLES];
+static size_t sync_sample_index;
+static size_t sync_num_samples;
+
+void microbit_radio_sync_reset(void) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    sync_follow = false;
+    sync_seq = 0;
+    sync_last_sent_valid = false;
+    sync_last_rx_valid = false;
+    sync_sample_index = 0;
+    sync_num_samples = 0;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+void microbit_radio_sync_set_follow(bool follow) {
+    sync_follow = follow;
+}
+
+// Write the next beacon to buf, which must be at least MICROBIT_RADIO_SYNC_BEACON_LEN
+// bytes, and return its length.
+size_t microbit_radio_sync_make_beacon(uint8_t *buf) {
+    memcpy(buf, MICROBIT_RADIO_SYNC_HEADER, MICROBIT_RADIO_SYNC_HEADER_LEN);
+    buf += MICROBIT_RADIO_SYNC_HEADER_LEN;
+    buf[0] = sync_seq;
+    buf[1] = sync_last_sent_valid ? MICROBIT_RADIO_SYNC_FLAG_TIME_VALID : 0;
+    buf[2] = sync_last_sent_us & 0xff;
+    buf[3] = (sync_last_sent_us >> 8) & 0xff;
+    buf[4] = (sync_last_sent_us >> 16) & 0xff;
+    buf[5] = (sync_last_sent_us >> 24) & 0xff;
+    return MICROBIT_RADIO_SYNC_BEACON_LEN;
+}
+
+// Called once the beacon from microbit_radio_sync_make_beacon has been sent.
+void microbit_radio_sync_beacon_sent(uint32_t time_us) {
+    sync_last_sent_us = time_us;
+    sync_last_sent_valid = true;
+    ++sync_seq;
+}
+
+// Called by the RADIO IRQ for each valid packet, with the same time that is stored in
+// the RX queue.  Returns true if the packet was a beacon and consumed by the follower.
+bool microbit_radio_sync_handle_rx(const uint8_t *pkt, uint32_t time_us) {
+    if (!sync_follow
+        || pkt[0] != MICROBIT_RADIO_SYNC_BEACON_LEN
+        || memcmp(pkt + 1, MICROBIT_RADIO_SYNC_HEADER, MICROBIT_RADIO_SYNC_HEADER_LEN) != 0) {
+        return false;
+    }
+
+    const uint8_t *buf = pkt + 1 + MICROBIT_RADIO_SYNC_HEADER_LEN;
+    uint8_t seq = buf[0];
+
+    // The time in this beacon is for the previous one, so it can only be used if the
+    // previous beacon was received too.
+    if ((buf[1] & MICROBIT_RADIO_SYNC_FLAG_TIME_VALID)
+        && sync_last_rx_valid && (uint8_t)(sync_last_rx_seq + 1) == seq) {
+        sync_remote_us[sync_sample_index] = buf[2] | buf[3] << 8 | buf[4] << 16 | buf[5] << 24;
+        sync_local_us[sync_sample_index] = sync_last_rx_us;
+        sync_sample_index = (sync_sample_index + 1) % MICROBIT_RADIO_SYNC_NUM_SAMPLES;
+        if (sync_num_samples < MICROBIT_RADIO_SYNC_NUM_SAMPLES) {
+            ++sync_num_samples;
+        }
+    }
+
+    sync_last_rx_valid = true;
+    sync_last_rx_seq = seq;
+    sync_last_rx_us = time_us;
+
+    return true;
+}
+
+// Fit a line through the collected samples with least squares.  Times are converted to
+// signed offsets from the most recent sample so the fit works across timer wrap-around.
+bool microbit_radio_sync_get_estimate(microbit_radio_sync_estimate_t *estimate) {
+    uint32_t remote_us[MICROBIT_RADIO_SYNC_NUM_SAMPLES];
+    uint32_t local_us[MICROBIT_RADIO_SYNC_NUM_SAMPLES];
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    size_t n = sync_num_samples;
+    size_t latest = (sync_sample_index + MICROBIT_RADIO_SYNC_NUM_SAMPLES - 1) % MICROBIT_RADIO_SYNC_NUM_SAMPLES;
+    memcpy(remote_us, sync_remote_us, sizeof(remote_us));
+    memcpy(local_us, sync_local_us, sizeof(local_us));
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+
+    if (n == 0) {
+        return false;
+    }
+
+    uint32_t r0 = remote_us[latest];
+    uint32_t l0 = local_us[latest];
+    float mean_x = 0;
+    float mean_y = 0;
+    for (size_t i = 0; i < n; ++i) {
+        mean_x += (int32_t)(remote_us[i] - r0);
+        mean_y += (int32_t)(local_us[i] - l0);
+    }
+    mean_x /= n;
+    mean_y /= n;
+    float sxx = 0;
+    float sxy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        float dx = (int32_t)(remote_us[i] - r0) - mean_x;
+        float dy = (int32_t)(local_us[i] - l0) - mean_y;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    estimate->rate = sxx > 0 ? sxy / sxx : 1.0f;
+    estimate->remote_us = r0;
+    estimate->local_us = l0 + (int32_t)(mean_y - estimate->rate * mean_x);
+    estimate->num_samples = n;
+    return true;
+}
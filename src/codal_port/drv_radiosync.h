@@ -0,0 +1,59 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_DRV_RADIOSYNC_H
+#define MICROPY_INCLUDED_CODAL_PORT_DRV_RADIOSYNC_H
+
+// Time-sync beacons are radio packets of the form:
+//  header  - 3 bytes, MICROBIT_RADIO_SYNC_HEADER
+//  seq     - byte, sequence number of this beacon
+//  flags   - byte, bit 0 set if the following time field is valid
+//  time    - 4 bytes, little endian, microsecond time the previous beacon was sent
+// The time a beacon is sent is only known once it has gone out, so it is carried in
+// the next beacon.  The follower pairs it with the time it received that previous
+// beacon, both timestamps being taken in the RADIO IRQ at the END event.
+#define MICROBIT_RADIO_SYNC_HEADER "\x01\x00\x53"
+#define MICROBIT_RADIO_SYNC_HEADER_LEN (3)
+#define MICROBIT_RADIO_SYNC_BEACON_LEN (MICROBIT_RADIO_SYNC_HEADER_LEN + 1 + 1 + 4)
+#define MICROBIT_RADIO_SYNC_FLAG_TIME_VALID (1)
+
+// Number of (remote, local) timestamp pairs used to estimate offset and drift.
+#define MICROBIT_RADIO_SYNC_NUM_SAMPLES (8)
+
+typedef struct _microbit_radio_sync_estimate_t {
+    uint32_t remote_us; // remote time of the most recent sample
+    uint32_t local_us; // local time of the most recent sample
+    float rate; // local microseconds per remote microsecond
+    size_t num_samples;
+} microbit_radio_sync_estimate_t;
+
+void microbit_radio_sync_reset(void);
+void microbit_radio_sync_set_follow(bool follow);
+size_t microbit_radio_sync_make_beacon(uint8_t *buf);
+void microbit_radio_sync_beacon_sent(uint32_t time_us);
+bool microbit_radio_sync_handle_rx(const uint8_t *pkt, uint32_t time_us);
+bool microbit_radio_sync_get_estimate(microbit_radio_sync_estimate_t *estimate);
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_DRV_RADIOSYNC_H
@@ -26,27 +26,35 @@
 
 #include "py/mphal.h"
 #include "drv_softtimer.h"
+#include "drv_system.h"
 
-#define TICKS_PERIOD 0x80000000
-#define TICKS_DIFF(t1, t0) ((int32_t)(((t1 - t0 + TICKS_PERIOD / 2) & (TICKS_PERIOD - 1)) - TICKS_PERIOD / 2))
-
+// Timers are kept on a pairing heap ordered by their expiry time in microseconds, and the
+// system timer is programmed for the earliest one, so they are not tied to a tick.
 static bool microbit_soft_timer_paused = false;
 
 STATIC int microbit_soft_timer_lt(mp_pairheap_t *n1, mp_pairheap_t *n2) {
     microbit_soft_timer_entry_t *e1 = (microbit_soft_timer_entry_t *)n1;
     microbit_soft_timer_entry_t *e2 = (microbit_soft_timer_entry_t *)n2;
-    return TICKS_DIFF(e1->expiry_ms, e2->expiry_ms) < 0;
+    return e1->expiry_us < e2->expiry_us;
+}
+
+STATIC bool microbit_soft_timer_is_py(microbit_soft_timer_entry_t *entry, void *arg) {
+    (void)arg;
+    return entry->flags & (MICROBIT_SOFT_TIMER_FLAG_PY_CALLBACK | MICROBIT_SOFT_TIMER_FLAG_GC_ALLOCATED);
 }
 
+// Remove all Python timers, including those on the GC heap with a C callback.  Other
+// timers with a C callback are owned by a driver, which is responsible for removing them
+// itself, so they are kept.
 void microbit_soft_timer_deinit(void) {
-    MP_STATE_PORT(soft_timer_heap) = NULL;
+    microbit_soft_timer_remove_if(microbit_soft_timer_is_py, NULL);
     microbit_soft_timer_paused = false;
 }
 
 static void microbit_soft_timer_handler_run(bool run_callbacks) {
-    uint32_t ticks_ms = mp_hal_ticks_ms();
+    uint64_t ticks_us = microbit_hal_ticks_us64();
     microbit_soft_timer_entry_t *heap = MP_STATE_PORT(soft_timer_heap);
-    while (heap != NULL && TICKS_DIFF(heap->expiry_ms, ticks_ms) <= 0) {
+    while (heap != NULL && heap->expiry_us <= ticks_us) {
         microbit_soft_timer_entry_t *entry = heap;
         heap = (microbit_soft_timer_entry_t *)mp_pairheap_pop(microbit_soft_timer_lt, &heap->pairheap);
         if (run_callbacks) {
@@ -57,7 +65,7 @@ static void microbit_soft_timer_handler_run(bool run_callbacks) {
             }
         }
         if (entry->mode == MICROBIT_SOFT_TIMER_MODE_PERIODIC) {
-            entry->expiry_ms += entry->delta_ms;
+            entry->expiry_us += entry->delta_us;
             heap = (microbit_soft_timer_entry_t *)mp_pairheap_push(microbit_soft_timer_lt, &heap->pairheap, &entry->pairheap);
         }
     }
@@ -71,12 +79,37 @@ void microbit_soft_timer_handler(void) {
     }
 }
 
-void microbit_soft_timer_insert(microbit_soft_timer_entry_t *entry, uint32_t initial_delta_ms) {
+void microbit_soft_timer_insert(microbit_soft_timer_entry_t *entry, uint64_t initial_delta_us) {
     mp_pairheap_init_node(microbit_soft_timer_lt, &entry->pairheap);
-    entry->expiry_ms = mp_hal_ticks_ms() + initial_delta_ms;
+    entry->expiry_us = microbit_hal_ticks_us64() + initial_delta_us;
     uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
     MP_STATE_PORT(soft_timer_heap) = (microbit_soft_timer_entry_t *)mp_pairheap_push(microbit_soft_timer_lt, &MP_STATE_PORT(soft_timer_heap)->pairheap, &entry->pairheap);
     MICROPY_END_ATOMIC_SECTION(atomic_state);
+    microbit_system_timer_wake_within_us(initial_delta_us);
+}
+
+// The entry must currently be on the heap.
+void microbit_soft_timer_remove(microbit_soft_timer_entry_t *entry) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    MP_STATE_PORT(soft_timer_heap) = (microbit_soft_timer_entry_t *)mp_pairheap_delete(microbit_soft_timer_lt, &MP_STATE_PORT(soft_timer_heap)->pairheap, &entry->pairheap);
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+// Remove all the entries for which match() returns true, in one pass over the heap and
+// one atomic section, rather than one at a time.  match() must not modify the heap.
+void microbit_soft_timer_remove_if(bool (*match)(microbit_soft_timer_entry_t *, void *), void *arg) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    microbit_soft_timer_entry_t *heap = MP_STATE_PORT(soft_timer_heap);
+    microbit_soft_timer_entry_t *keep = NULL;
+    while (heap != NULL) {
+        microbit_soft_timer_entry_t *entry = heap;
+        heap = (microbit_soft_timer_entry_t *)mp_pairheap_pop(microbit_soft_timer_lt, &heap->pairheap);
+        if (!match(entry, arg)) {
+            keep = (microbit_soft_timer_entry_t *)mp_pairheap_push(microbit_soft_timer_lt, &keep->pairheap, &entry->pairheap);
+        }
+    }
+    MP_STATE_PORT(soft_timer_heap) = keep;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
 }
 
 void microbit_soft_timer_set_pause(bool paused, bool run_callbacks) {
@@ -85,18 +118,25 @@ void microbit_soft_timer_set_pause(bool paused, bool run_callbacks) {
         microbit_soft_timer_handler_run(run_callbacks);
     }
     microbit_soft_timer_paused = paused;
+    if (!paused) {
+        microbit_system_timer_update();
+    }
+}
+
+bool microbit_soft_timer_is_paused(void) {
+    return microbit_soft_timer_paused;
 }
 
-uint32_t microbit_soft_timer_get_ms_to_next_expiry(void) {
+uint64_t microbit_soft_timer_get_us_to_next_expiry(void) {
     microbit_soft_timer_entry_t *heap = MP_STATE_PORT(soft_timer_heap);
     if (heap == NULL) {
-        return UINT32_MAX;
+        return UINT64_MAX;
     }
-    int32_t dt = TICKS_DIFF(heap->expiry_ms, mp_hal_ticks_ms());
-    if (dt <= 0) {
+    uint64_t ticks_us = microbit_hal_ticks_us64();
+    if (heap->expiry_us <= ticks_us) {
         return 0;
     }
-    return dt;
+    return heap->expiry_us - ticks_us;
 }
 
 MP_REGISTER_ROOT_POINTER(struct _microbit_soft_timer_entry_t *soft_timer_heap);
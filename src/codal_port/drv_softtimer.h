@@ -38,8 +38,8 @@ typedef struct _microbit_soft_timer_entry_t {
     mp_pairheap_t pairheap;
     uint16_t flags;
     uint16_t mode;
-    uint32_t expiry_ms;
-    uint32_t delta_ms; // for periodic mode
+    uint64_t expiry_us; // from microbit_hal_ticks_us64(), so never wraps
+    uint64_t delta_us; // for periodic mode
     union {
         void (*c_callback)(struct _microbit_soft_timer_entry_t *);
         mp_obj_t py_callback;
@@ -50,8 +50,11 @@ extern bool microbit_outer_nlr_will_handle_soft_timer_exceptions;
 
 void microbit_soft_timer_deinit(void);
 void microbit_soft_timer_handler(void);
-void microbit_soft_timer_insert(microbit_soft_timer_entry_t *entry, uint32_t initial_delta_ms);
+void microbit_soft_timer_insert(microbit_soft_timer_entry_t *entry, uint64_t initial_delta_us);
+void microbit_soft_timer_remove(microbit_soft_timer_entry_t *entry);
+void microbit_soft_timer_remove_if(bool (*match)(microbit_soft_timer_entry_t *, void *), void *arg);
 void microbit_soft_timer_set_pause(bool paused, bool run_callbacks);
-uint32_t microbit_soft_timer_get_ms_to_next_expiry(void);
+bool microbit_soft_timer_is_paused(void);
+uint64_t microbit_soft_timer_get_us_to_next_expiry(void);
 
 #endif // MICROPY_INCLUDED_CODAL_PORT_DRV_SOFTTIMER_H
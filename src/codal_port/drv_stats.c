@@ -0,0 +1,61 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "drv_stats.h"
+
+#if MICROPY_HW_LATENCY_STATS
+
+microbit_stats_hook_t microbit_stats_hooks[MICROBIT_STATS_NUM_HOOKS];
+
+// May be called from any interrupt priority.
+void microbit_stats_record(unsigned int hook, uint32_t duration_us) {
+    size_t bucket = 0;
+    if (duration_us >= 16) {
+        bucket = MIN(28 - __builtin_clz(duration_us), MICROBIT_STATS_NUM_BUCKETS - 1);
+    }
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    microbit_stats_hook_t *h = &microbit_stats_hooks[hook];
+    if (h->count == 0 || duration_us < h->min_us) {
+        h->min_us = duration_us;
+    }
+    if (duration_us > h->max_us) {
+        h->max_us = duration_us;
+    }
+    ++h->count;
+    ++h->buckets[bucket];
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+void microbit_stats_reset(void) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    memset(microbit_stats_hooks, 0, sizeof(microbit_stats_hooks));
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+#endif // MICROPY_HW_LATENCY_STATS
@@ -0,0 +1,70 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_DRV_STATS_H
+#define MICROPY_INCLUDED_CODAL_PORT_DRV_STATS_H
+
+#include "py/mphal.h"
+
+// Latency accounting for interrupt handlers and scheduled callbacks, enabled at build time
+// with MICROPY_HW_LATENCY_STATS.  Each hook records the count, min, max and a histogram
+// of durations, with bucket i holding durations under 16 << i microseconds.
+
+#define MICROBIT_STATS_NUM_BUCKETS (8)
+
+enum {
+    MICROBIT_STATS_TIMER_CALLBACK,
+    MICROBIT_STATS_RADIO_IRQ,
+    MICROBIT_STATS_AUDIO_FETCH,
+    MICROBIT_STATS_AUDIO_SCHED_DELAY, // from scheduling the audio fetcher until it runs
+    MICROBIT_STATS_GC_COLLECT,
+    MICROBIT_STATS_NUM_HOOKS,
+};
+
+#if MICROPY_HW_LATENCY_STATS
+
+typedef struct _microbit_stats_hook_t {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t buckets[MICROBIT_STATS_NUM_BUCKETS];
+} microbit_stats_hook_t;
+
+extern microbit_stats_hook_t microbit_stats_hooks[MICROBIT_STATS_NUM_HOOKS];
+
+void microbit_stats_record(unsigned int hook, uint32_t duration_us);
+void microbit_stats_reset(void);
+
+#define MICROBIT_STATS_BEGIN(var) uint32_t var = mp_hal_ticks_us()
+#define MICROBIT_STATS_END(hook, var) microbit_stats_record((hook), mp_hal_ticks_us() - (var))
+
+#else
+
+#define MICROBIT_STATS_BEGIN(var)
+#define MICROBIT_STATS_END(hook, var)
+
+#endif
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_DRV_STATS_H
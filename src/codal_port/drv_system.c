@@ -25,27 +25,110 @@
  */
 
 #include "py/runtime.h"
+#include "py/mphal.h"
+#include "drv_event.h"
 #include "drv_softtimer.h"
+#include "drv_stats.h"
 #include "drv_system.h"
 #include "drv_display.h"
+#include "modaudio.h"
 #include "modmusic.h"
+#include "modprofile.h"
 
 extern volatile bool accelerometer_up_to_date;
+extern volatile bool compass_up_to_date;
+
+#if MICROPY_HW_TICKLESS_TIMER
+// Rather than running every MICROBIT_SYSTEM_TICK_MS, the timer callback is programmed
+// for the earliest deadline of the work it does, and not at all when that is idle.
+// Anything that creates a new deadline from outside the callback must then call
+// microbit_system_timer_update().
+static bool system_timer_pending = false;
+static uint64_t system_timer_expiry_us;
+
+STATIC uint64_t system_timer_us_to_next_event(void) {
+    uint64_t us = UINT64_MAX;
+    if (!microbit_soft_timer_is_paused()) {
+        us = microbit_soft_timer_get_us_to_next_expiry();
+    }
+    uint32_t music_ms = microbit_music_get_ms_to_next_event();
+    if (music_ms != UINT32_MAX) {
+        us = MIN(us, (uint64_t)music_ms * 1000);
+    }
+    #if MICROPY_PY_PROFILE
+    if (microbit_profile_active) {
+        // The profiler samples on every tick.
+        us = MIN(us, MICROBIT_SYSTEM_TICK_MS * 1000);
+    }
+    #endif
+    return us;
+}
+
+// Make sure the timer callback runs within the given time.  May be called at any priority.
+void microbit_system_timer_wake_within_us(uint64_t us) {
+    us = MAX(us, MICROBIT_SYSTEM_TIMER_MIN_US);
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint64_t expiry_us = microbit_hal_ticks_us64() + us;
+    if (!system_timer_pending || system_timer_expiry_us > expiry_us) {
+        system_timer_pending = true;
+        system_timer_expiry_us = expiry_us;
+        microbit_hal_timer_set_next_us(us);
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+void microbit_system_timer_wake_within(uint32_t ms) {
+    microbit_system_timer_wake_within_us((uint64_t)ms * 1000);
+}
+
+void microbit_system_timer_update(void) {
+    uint64_t us = system_timer_us_to_next_event();
+    if (us != UINT64_MAX) {
+        microbit_system_timer_wake_within_us(us);
+    }
+}
+#endif
 
 void microbit_system_init(void) {
     accelerometer_up_to_date = false;
+    compass_up_to_date = false;
+    microbit_audio_frame_pool_init();
+    microbit_event_reset();
 }
 
-// Called every 6ms on a hardware interrupt.
-// TODO: should only enable this when system is ready
-// TODO: perhaps only schedule the callback when we need it
+// Called on a hardware interrupt, every MICROBIT_SYSTEM_TICK_MS or when the next
+// deadline is due if the timer is tickless.
 void microbit_hal_timer_callback(void) {
-    // Invalidate accelerometer data for gestures so sample is taken on next gesture call.
-    accelerometer_up_to_date = false;
+    MICROBIT_STATS_BEGIN(stats_start);
 
-    microbit_display_update();
+    #if MICROPY_HW_TICKLESS_TIMER
+    system_timer_pending = false;
+    #endif
+
+    #if MICROPY_PY_PROFILE
+    // Display animation runs from a soft timer, so is also counted in its time.
+    microbit_profile_tick();
+    uint32_t t = microbit_profile_begin();
     microbit_music_tick();
+    t = microbit_profile_end(MICROBIT_PROFILE_MUSIC, t);
     microbit_soft_timer_handler();
+    microbit_profile_end(MICROBIT_PROFILE_SOFT_TIMER, t);
+    #else
+    microbit_music_tick();
+    microbit_soft_timer_handler();
+    #endif
+
+    #if MICROPY_HW_TICKLESS_TIMER
+    uint64_t us = system_timer_us_to_next_event();
+    if (us != UINT64_MAX) {
+        microbit_system_timer_wake_within_us(us);
+    } else if (!system_timer_pending) {
+        // Nothing to do until something new is started.
+        microbit_hal_timer_set_next_us(-1);
+    }
+    #endif
+
+    MICROBIT_STATS_END(MICROBIT_STATS_TIMER_CALLBACK, stats_start);
 }
 
 void microbit_hal_serial_interrupt_callback(void) {
@@ -26,9 +26,26 @@
 #ifndef MICROPY_INCLUDED_CODAL_PORT_DRV_SYSTEM_H
 #define MICROPY_INCLUDED_CODAL_PORT_DRV_SYSTEM_H
 
+// Period of the system timer callback when it is not tickless, and while profiling.
+#define MICROBIT_SYSTEM_TICK_MS (6)
+
+// Shortest time the tickless system timer is programmed for, so a run of timers that
+// are close together is handled by one callback.
+#define MICROBIT_SYSTEM_TIMER_MIN_US (50)
+
 extern uint8_t microbit_global_volume;
 
 void microbit_system_init(void);
 void microbit_system_set_global_volume(uint8_t volume);
 
+#if MICROPY_HW_TICKLESS_TIMER
+void microbit_system_timer_update(void);
+void microbit_system_timer_wake_within(uint32_t ms);
+void microbit_system_timer_wake_within_us(uint64_t us);
+#else
+#define microbit_system_timer_update()
+#define microbit_system_timer_wake_within(ms)
+#define microbit_system_timer_wake_within_us(us)
+#endif
+
 #endif // MICROPY_INCLUDED_CODAL_PORT_DRV_SYSTEM_H
@@ -37,19 +37,27 @@
 #include "shared/runtime/gchelper.h"
 #include "shared/runtime/pyexec.h"
 #include "ports/nrf/modules/os/microbitfs.h"
+#include "microbitfs_ext.h"
+#include "drv_arena.h"
+#include "drv_radio.h"
 #include "drv_softtimer.h"
 #include "drv_system.h"
 #include "drv_display.h"
+#include "drv_gc.h"
+#include "modaudio.h"
 #include "modmicrobit.h"
 
 #define MAIN_PY "main.py"
 
 // Use a fixed static buffer for the heap.
-static char heap[64 * 1024];
+static char heap[MICROPY_HW_HEAP_SIZE];
 
 // Set to true if a soft-timer callback can use mp_sched_exception to propagate out an exception.
 bool microbit_outer_nlr_will_handle_soft_timer_exceptions;
 
+// Time from startup until main.py (or the REPL) started running after the last reset.
+uint32_t microbit_main_start_us;
+
 void microbit_pyexec_file(const char *filename);
 
 void mp_main(void) {
@@ -58,17 +66,20 @@ void mp_main(void) {
 
     for (;;) {
         microbit_system_init();
+        microbit_arena_init();
         microbit_display_init();
         #if MICROPY_MBFS
         microbit_filesystem_init();
         #endif
 
         gc_init(heap, heap + sizeof(heap));
+        microbit_gc_init();
         mp_init();
 
+        microbit_main_start_us = microbit_hal_ticks_us64();
         if (pyexec_mode_kind == PYEXEC_MODE_FRIENDLY_REPL) {
             const char *main_py = MAIN_PY;
-            if (mp_import_stat(main_py) == MP_IMPORT_STAT_FILE) {
+            if (os_mbfs_import_stat(main_py) == MP_IMPORT_STAT_FILE) {
                 // exec("main.py")
                 microbit_pyexec_file(main_py);
             } else {
@@ -91,6 +102,15 @@ void mp_main(void) {
 
         mp_printf(MP_PYTHON_PRINTER, "MPY: soft reboot\n");
         microbit_soft_timer_deinit();
+        microbit_hal_log_flush(); // commit log rows still buffered in RAM
+        microbit_radio_disable(); // its buffers are in the arena, which is reset
+        microbit_speech_deinit(); // background speech and cached translations are on the heap
+        microbit_pin_sample_stop(); // ADC samples are written into a heap buffer
+        microbit_microphone_stop_recording(); // as are microphone samples
+        microbit_pin_irq_deinit(); // edge rings are on the heap
+        microbit_spi_deinit(); // let queued transfers finish with their heap buffers
+        microbit_uart_deinit(); // the receive ring is on the heap
+        microbit_neopixel_deinit(); // let the last ws2812 frame finish with its heap buffer
         gc_sweep_all();
         mp_deinit();
     }
@@ -135,11 +155,15 @@ STATIC void microbit_display_exception(mp_obj_t exc_in) {
 void microbit_pyexec_file(const char *filename) {
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
-        // Parse and comple the file.
+        // Parse and comple the file, or load it from the compile cache.
+        #if MICROPY_MBFS_MPY_CACHE
+        mp_obj_t module_fun = microbit_mpy_cache_compile_file(filename);
+        #else
         mp_lexer_t *lex = mp_lexer_new_from_file(qstr_from_str(filename));
         qstr source_name = lex->source_name;
         mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
         mp_obj_t module_fun = mp_compile(&parse_tree, source_name, false);
+        #endif
 
         // Execute the code.
         mp_hal_set_interrupt_char(CHAR_CTRL_C); // allow ctrl-C to interrupt us
@@ -191,6 +215,9 @@ void microbit_file_opened_for_writing(const char *name, size_t name_len) {
         // The file main.py is changed, so invalidate the data logging storage (fast erase).
         microbit_hal_log_delete(false);
     }
+    #if MICROPY_MBFS_MPY_CACHE
+    microbit_mpy_cache_invalidate(name, name_len);
+    #endif
 }
 
 #if MICROPY_MBFS
@@ -199,9 +226,19 @@ mp_lexer_t *mp_lexer_new_from_file(qstr filename) {
 }
 
 mp_import_stat_t mp_import_stat(const char *path) {
+    #if MICROPY_MBFS_MPY_CACHE
+    return microbit_mpy_cache_import_stat(path);
+    #else
     return os_mbfs_import_stat(path);
+    #endif
 }
 
+#if MICROPY_MBFS_MPY_CACHE
+void mp_reader_new_file(mp_reader_t *reader, qstr filename) {
+    microbit_mpy_cache_reader_new(reader, qstr_str(filename));
+}
+#endif
+
 mp_obj_t mp_builtin_open(size_t n_args, const mp_obj_t *args, mp_map_t *kwargs) {
     return os_mbfs_open(n_args, args);
 }
@@ -209,9 +246,11 @@ MP_DEFINE_CONST_FUN_OBJ_KW(mp_builtin_open_obj, 1, mp_builtin_open);
 #endif
 
 void gc_collect(void) {
+    uint32_t start_us = mp_hal_ticks_us();
     gc_collect_start();
     gc_helper_collect_regs_and_stack();
     gc_collect_end();
+    microbit_gc_collect_done(mp_hal_ticks_us() - start_us);
 }
 
 void nlr_jump_fail(void *val) {
@@ -0,0 +1,87 @@
+"""
+Generate header file with a constant 5x5 image for every glyph in the CODAL system font.
+
+The font is read from the BitmapFont source in codal-core, so the images always match
+what BitmapFont::getSystemFont() would return at runtime.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+FONT_FIRST_CHAR = 32
+FONT_LAST_CHAR = 126
+FONT_WIDTH = 5
+FONT_HEIGHT = 5
+
+
+def read_font_data(filename, array_name):
+    with open(filename, "r") as f:
+        source = f.read()
+    match = re.search(
+        r"\b%s\s*\[[^\]]*\]\s*=\s*\{([^}]*)\}" % re.escape(array_name), source, re.DOTALL
+    )
+    if match is None:
+        sys.exit("error: font array %s not found in %s" % (array_name, filename))
+    body = re.sub(r"/\*.*?\*/|//[^\n]*", "", match.group(1), flags=re.DOTALL)
+    data = [int(value, 0) for value in re.findall(r"0[xX][0-9a-fA-F]+|\d+", body)]
+    num_chars = FONT_LAST_CHAR - FONT_FIRST_CHAR + 1
+    if len(data) < num_chars * FONT_HEIGHT:
+        sys.exit("error: font array %s is too short" % array_name)
+    return data
+
+
+def glyph_pixels(data, char):
+    rows = data[(char - FONT_FIRST_CHAR) * FONT_HEIGHT :][:FONT_HEIGHT]
+    return [(row >> (FONT_WIDTH - 1 - x)) & 1 for row in rows for x in range(FONT_WIDTH)]
+
+
+def make_font_header(font_filename, array_name, filename):
+    data = read_font_data(font_filename, array_name)
+
+    lines = [
+        "// This file was generated by make_font_images.py",
+        "#define MICROBIT_FONT_FIRST_CHAR (%u)" % FONT_FIRST_CHAR,
+        "#define MICROBIT_FONT_LAST_CHAR (%u)" % FONT_LAST_CHAR,
+        "const monochrome_5by5_t microbit_font_images[] = {",
+    ]
+    for char in range(FONT_FIRST_CHAR, FONT_LAST_CHAR + 1):
+        pixels = ", ".join(str(p) for p in glyph_pixels(data, char))
+        comment = "'\\\\'" if chr(char) == "\\" else "'%s'" % chr(char)
+        lines.append("    SMALL_IMAGE(%s), // %s" % (pixels, comment))
+    lines.append("};")
+    file_data = "\n".join(lines) + "\n"
+
+    # Check if the file contents changed from last time
+    write_file = True
+    if os.path.isfile(filename):
+        with open(filename, "r") as f:
+            existing_data = f.read()
+        if existing_data == file_data:
+            write_file = False
+
+    # Only write the file if we need to
+    if write_file:
+        print("GEN %s" % filename)
+        with open(filename, "w") as f:
+            f.write(file_data)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "-a",
+        "--array-name",
+        default="pendolino3",
+        help="name of the font data array in the font source",
+    )
+    parser.add_argument("font", nargs=1, help="path to BitmapFont.cpp")
+    parser.add_argument("dest", nargs=1, help="output file path")
+    args = parser.parse_args()
+
+    make_font_header(args.font[0], args.array_name, args.dest[0])
+
+
+if __name__ == "__main__":
+    main()
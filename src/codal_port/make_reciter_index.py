@@ -0,0 +1,139 @@
+"""
+Generate header file with an index of the rules in the SAM reciter tables.
+
+The reciter finds each candidate rule by scanning the rule bytes for the end of the
+previous rule and then for the '(', ')' and '=' that delimit it.  This script does that
+scan once at build time, so at runtime the reciter can step straight from one rule to the
+next and reject most non-matching rules without touching the rule bytes.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# Virtual addresses used by the reciter for the start of each rule table.
+RULES_ADDRESS = 32000
+RULES2_ADDRESS = 37541
+
+NUM_LETTERS = 26
+
+
+def read_table(source, array_name):
+    match = re.search(
+        r"\b%s\s*\[\s*\]\s*=\s*\{(.*?)\n\};" % re.escape(array_name), source, re.DOTALL
+    )
+    if match is None:
+        sys.exit("error: table %s not found" % array_name)
+    body = re.sub(r"/\*.*?\*/|//[^\n]*", "", match.group(1), flags=re.DOTALL)
+    data = []
+    for token in re.findall(r"'(?:\\.|[^'])'(?:\s*\|\s*0x80)?|0[xX][0-9a-fA-F]+|\d+", body):
+        if token.startswith("'"):
+            char, _, flag = token.partition("|")
+            char = char.strip()[1:-1]
+            if char.startswith("\\"):
+                char = char[1:]
+            value = ord(char) | (0x80 if flag else 0)
+        else:
+            value = int(token, 0)
+        data.append(value)
+    return data
+
+
+def find(data, start, y, pred):
+    # Mirror the reciter's scan, where the offset y is an 8-bit register.
+    while True:
+        y = (y + 1) & 0xFF
+        if start + y >= len(data):
+            return None
+        if pred(data[start + y]):
+            return y
+
+
+def index_rules(data, address):
+    # Every byte with its top bit set ends a rule, and the reciter treats it as the base
+    # of the next candidate rule.
+    rules = []
+    for base in range(len(data)):
+        if not data[base] & 0x80:
+            continue
+        y_open = find(data, base, 0, lambda c: c == ord("("))
+        if y_open is None:
+            break
+        y_close = find(data, base, y_open, lambda c: c == ord(")"))
+        if y_close is None:
+            break
+        y_equals = find(data, base, y_close, lambda c: c & 0x7F == ord("="))
+        if y_equals is None:
+            break
+        if y_open + 2 < y_close:
+            second = data[base + y_open + 2]
+        else:
+            second = 0
+        rules.append((address + base, y_open, y_close, y_equals, second))
+    return rules
+
+
+def first_rule_after(rules, address):
+    for i, rule in enumerate(rules):
+        if rule[0] > address:
+            return i
+    sys.exit("error: no rule follows address %u" % address)
+
+
+def make_reciter_index(tabs_filename, filename):
+    with open(tabs_filename, "r") as f:
+        source = f.read()
+    rules = index_rules(read_table(source, "rules"), RULES_ADDRESS)
+    rules2 = index_rules(read_table(source, "rules2"), RULES2_ADDRESS)
+    tab_lo = read_table(source, "tab37489")
+    tab_hi = read_table(source, "tab37515")
+    if len(tab_lo) != NUM_LETTERS or len(tab_hi) != NUM_LETTERS:
+        sys.exit("error: letter tables must have %u entries" % NUM_LETTERS)
+    all_rules = rules + rules2
+
+    lines = [
+        "// This file was generated by make_reciter_index.py",
+        "#define RECITER_RULES2_FIRST (%u)" % first_rule_after(all_rules, RULES2_ADDRESS),
+        "static const reciter_rule_t reciter_rule_index[] = {",
+    ]
+    for address, y_open, y_close, y_equals, second in all_rules:
+        lines.append(
+            "    { %u, %u, %u, %u, %u }," % (address, y_open, y_close, y_equals, second)
+        )
+    lines.append("};")
+    lines.append("static const unsigned short reciter_letter_first[] = {")
+    for letter in range(NUM_LETTERS):
+        address = tab_lo[letter] | tab_hi[letter] << 8
+        lines.append(
+            "    %u, // '%s'" % (first_rule_after(rules, address), chr(ord("A") + letter))
+        )
+    lines.append("};")
+    file_data = "\n".join(lines) + "\n"
+
+    # Check if the file contents changed from last time
+    write_file = True
+    if os.path.isfile(filename):
+        with open(filename, "r") as f:
+            existing_data = f.read()
+        if existing_data == file_data:
+            write_file = False
+
+    # Only write the file if we need to
+    if write_file:
+        print("GEN %s" % filename)
+        with open(filename, "w") as f:
+            f.write(file_data)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("tabs", nargs=1, help="path to ReciterTabs.h")
+    parser.add_argument("dest", nargs=1, help="output file path")
+    args = parser.parse_args()
+
+    make_reciter_index(args.tabs[0], args.dest[0])
+
+
+if __name__ == "__main__":
+    main()
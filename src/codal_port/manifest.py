@@ -1 +1,3 @@
-freeze("modules", "neopixel.py", opt=3)
+# Python modules to freeze into the firmware; neopixel is now implemented in C (modneopixel.c).
+include("$(MPY_DIR)/extmod/asyncio")
+module("aiomicrobit.py", base_path="$(PORT_DIR)/modules")
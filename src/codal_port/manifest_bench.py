@@ -0,0 +1,3 @@
+# The firmware manifest plus the benchmark suite, used by "make bench".
+include("manifest.py")
+module("bench.py", base_path="$(PORT_DIR)/modules")
@@ -26,7 +26,10 @@
 
 #include <math.h>
 #include "py/runtime.h"
+#include "py/mperrno.h"
 #include "py/mphal.h"
+#include "drv_event.h"
+#include "drv_system.h"
 #include "modmicrobit.h"
 
 #define GESTURE_LIST_SIZE (8)
@@ -66,16 +69,29 @@ STATIC uint32_t gesture_from_obj(mp_obj_t gesture_in) {
     mp_raise_ValueError(MP_ERROR_TEXT("invalid gesture"));
 }
 
-STATIC void update_for_gesture(void) {
-    if (!accelerometer_up_to_date) {
+// Get the current sample, reading a new one from the sensor (which also updates CODAL's
+// gesture detection) at most once per system tick.  This lets get_x(), get_y() and get_z()
+// called together share one I2C transaction.
+STATIC const int *accelerometer_get_sample(void) {
+    static uint32_t sample_ms;
+    static int sample_axis[3];
+    uint32_t now_ms = mp_hal_ticks_ms();
+    if (!accelerometer_up_to_date || now_ms - sample_ms >= MICROBIT_SYSTEM_TICK_MS) {
+        microbit_hal_accelerometer_init();
         accelerometer_up_to_date = true;
-        int axis[3];
-        microbit_hal_accelerometer_get_sample(axis);
+        sample_ms = now_ms;
+        microbit_hal_accelerometer_get_sample(sample_axis);
     }
+    return sample_axis;
+}
+
+STATIC void update_for_gesture(void) {
+    accelerometer_get_sample();
 }
 
 void microbit_hal_gesture_callback(int value) {
     if (value > MICROBIT_HAL_ACCELEROMETER_EVT_NONE && value <= MICROBIT_HAL_ACCELEROMETER_EVT_2G) {
+        microbit_event_push(MICROBIT_EVENT_SOURCE_GESTURE, 0, value);
         gesture_state |= 1 << value;
         if (gesture_list_cur < 2 * GESTURE_LIST_SIZE) {
             uint8_t entry = gesture_list[gesture_list_cur >> 1];
@@ -90,34 +106,31 @@ void microbit_hal_gesture_callback(int value) {
     }
 }
 
+mp_obj_t microbit_accelerometer_gesture_obj(uint8_t gesture) {
+    return MP_OBJ_NEW_QSTR(gesture_name_map[gesture]);
+}
+
 STATIC mp_obj_t microbit_accelerometer_get_x(mp_obj_t self_in) {
     (void)self_in;
-    int axis[3];
-    microbit_hal_accelerometer_get_sample(axis);
-    return mp_obj_new_int(axis[0]);
+    return mp_obj_new_int(accelerometer_get_sample()[0]);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_accelerometer_get_x_obj, microbit_accelerometer_get_x);
 
 STATIC mp_obj_t microbit_accelerometer_get_y(mp_obj_t self_in) {
     (void)self_in;
-    int axis[3];
-    microbit_hal_accelerometer_get_sample(axis);
-    return mp_obj_new_int(axis[1]);
+    return mp_obj_new_int(accelerometer_get_sample()[1]);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_accelerometer_get_y_obj, microbit_accelerometer_get_y);
 
 STATIC mp_obj_t microbit_accelerometer_get_z(mp_obj_t self_in) {
     (void)self_in;
-    int axis[3];
-    microbit_hal_accelerometer_get_sample(axis);
-    return mp_obj_new_int(axis[2]);
+    return mp_obj_new_int(accelerometer_get_sample()[2]);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_accelerometer_get_z_obj, microbit_accelerometer_get_z);
 
 STATIC mp_obj_t microbit_accelerometer_get_values(mp_obj_t self_in) {
     (void)self_in;
-    int axis[3];
-    microbit_hal_accelerometer_get_sample(axis);
+    const int *axis = accelerometer_get_sample();
     mp_obj_t tuple[3] = {
         mp_obj_new_int(axis[0]),
         mp_obj_new_int(axis[1]),
@@ -129,8 +142,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_accelerometer_get_values_obj, microbit
 
 STATIC mp_obj_t microbit_accelerometer_get_strength(mp_obj_t self_in) {
     (void)self_in;
-    int axis[3];
-    microbit_hal_accelerometer_get_sample(axis);
+    const int *axis = accelerometer_get_sample();
     int strength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
     return mp_obj_new_int(strength);
 }
@@ -181,10 +193,46 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_accelerometer_get_gestures_obj, microb
 STATIC mp_obj_t microbit_accelerometer_set_range(mp_obj_t self_in, mp_obj_t g) {
     (void)self_in;
     microbit_hal_accelerometer_set_range(mp_obj_get_int(g));
+    accelerometer_up_to_date = false;
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(microbit_accelerometer_set_range_obj, microbit_accelerometer_set_range);
 
+STATIC mp_obj_t microbit_accelerometer_set_fifo(mp_obj_t self_in, mp_obj_t rate_in) {
+    (void)self_in;
+    mp_int_t rate = 0;
+    if (rate_in != mp_const_none) {
+        rate = mp_obj_get_int(rate_in);
+        if (rate <= 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid rate"));
+        }
+    }
+    int ret = microbit_hal_accelerometer_fifo_enable(rate);
+    if (ret == MICROBIT_HAL_DEVICE_NO_RESOURCES) {
+        mp_raise_OSError(MP_ENODEV);
+    } else if (ret < 0) {
+        mp_raise_OSError(MP_EIO);
+    }
+    accelerometer_up_to_date = false;
+    return MP_OBJ_NEW_SMALL_INT(ret);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(microbit_accelerometer_set_fifo_obj, microbit_accelerometer_set_fifo);
+
+STATIC mp_obj_t microbit_accelerometer_read_fifo(mp_obj_t self_in, mp_obj_t buf_in) {
+    (void)self_in;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.typecode != 'h') {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer must be an 'h' array"));
+    }
+    int n = microbit_hal_accelerometer_fifo_read(bufinfo.buf, bufinfo.len / (3 * sizeof(int16_t)));
+    if (n < 0) {
+        mp_raise_OSError(MP_EIO);
+    }
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(microbit_accelerometer_read_fifo_obj, microbit_accelerometer_read_fifo);
+
 STATIC const mp_rom_map_elem_t microbit_accelerometer_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_get_x), MP_ROM_PTR(&microbit_accelerometer_get_x_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_y), MP_ROM_PTR(&microbit_accelerometer_get_y_obj) },
@@ -196,6 +244,8 @@ STATIC const mp_rom_map_elem_t microbit_accelerometer_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_was_gesture), MP_ROM_PTR(&microbit_accelerometer_was_gesture_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_gestures), MP_ROM_PTR(&microbit_accelerometer_get_gestures_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_range), MP_ROM_PTR(&microbit_accelerometer_set_range_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_fifo), MP_ROM_PTR(&microbit_accelerometer_set_fifo_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_fifo), MP_ROM_PTR(&microbit_accelerometer_read_fifo_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_accelerometer_locals_dict, microbit_accelerometer_locals_dict_table);
 
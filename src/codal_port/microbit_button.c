@@ -26,6 +26,7 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "drv_event.h"
 #include "modmicrobit.h"
 
 typedef struct _microbit_button_obj_t {
@@ -34,6 +35,11 @@ typedef struct _microbit_button_obj_t {
     uint8_t button_id;
 } microbit_button_obj_t;
 
+// Called from CODAL's event handler when a button goes down or up.
+void microbit_hal_button_callback(int button, int event) {
+    microbit_event_push(MICROBIT_EVENT_SOURCE_BUTTON, button, event);
+}
+
 mp_obj_t microbit_button_is_pressed(mp_obj_t self_in) {
     microbit_button_obj_t *self = (microbit_button_obj_t *)self_in;
     return mp_obj_new_bool(microbit_hal_button_state(self->button_id, NULL, NULL));
@@ -25,6 +25,8 @@
  */
 
 #include "py/runtime.h"
+#include "py/mphal.h"
+#include "drv_system.h"
 #include "microbithal.h"
 #include "modmicrobit.h"
 
@@ -32,6 +34,121 @@ typedef struct _microbit_compass_obj_t {
     mp_obj_base_t base;
 } microbit_compass_obj_t;
 
+typedef struct _compass_reading_t {
+    int axis[3];
+    int field_strength;
+    int heading;
+} compass_reading_t;
+
+volatile bool compass_up_to_date = false;
+
+// atan(2^-i) in degrees, as 16.16 fixed point.
+STATIC const int32_t compass_atan_table[] = {
+    2949120, 1740967, 919879, 466945, 234379, 117304, 58666, 29335,
+    14668, 7334, 3667, 1833, 917, 458, 229, 115,
+};
+
+STATIC uint32_t compass_isqrt(uint64_t n) {
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > n) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// atan2(y, x) in degrees, as 16.16 fixed point in the range -180 to 180, using CORDIC.
+STATIC int32_t compass_atan2(int64_t y, int64_t x) {
+    // Scale down so the vector can't overflow as CORDIC grows it by about 1.65.
+    while (x > (1 << 28) || x < -(1 << 28) || y > (1 << 28) || y < -(1 << 28)) {
+        x >>= 1;
+        y >>= 1;
+    }
+    int32_t xi = x;
+    int32_t yi = y;
+    int32_t angle = 0;
+    if (xi < 0) {
+        // Rotate by 180 degrees into the right half-plane.
+        angle = yi >= 0 ? 180 << 16 : -(180 << 16);
+        xi = -xi;
+        yi = -yi;
+    }
+    for (size_t i = 0; i < MP_ARRAY_SIZE(compass_atan_table); ++i) {
+        int32_t x_shift = xi >> i;
+        if (yi > 0) {
+            xi += yi >> i;
+            yi -= x_shift;
+            angle += compass_atan_table[i];
+        } else {
+            xi -= yi >> i;
+            yi += x_shift;
+            angle -= compass_atan_table[i];
+        }
+    }
+    return angle;
+}
+
+// The tilt-compensated heading in whole degrees clockwise from north, computed the same
+// way as CODAL's Compass::heading() but in integer arithmetic.  With roll phi and pitch
+// theta from the accelerometer, sin and cos of both are ratios of the acceleration
+// components, so the bearing atan2 can be taken of the vector scaled by g * |(ay, az)|
+// without needing any trigonometry for the angles themselves.  Results match to within a
+// degree, the difference being where CODAL's float result is truncated.
+STATIC int compass_tilt_compensated_heading(const int mag[3], const int accel[3]) {
+    int64_t ax = accel[0];
+    int64_t ay = accel[1];
+    int64_t az = accel[2];
+    int64_t roll_sq = ay * ay + az * az;
+    // g has 8 fractional bits, and north is scaled to match.
+    int64_t g = compass_isqrt((ax * ax + roll_sq) << 16);
+    int64_t north = (mag[0] * roll_sq - ax * (mag[1] * ay + mag[2] * az)) << 8;
+    int64_t east = (mag[2] * ay - mag[1] * az) * g;
+    int32_t bearing = (90 << 16) - compass_atan2(north, east);
+    if (bearing < 0) {
+        bearing += 360 << 16;
+    }
+    return bearing >> 16;
+}
+
+// Get the current reading, taking a new sample at most once per system tick, so get_x(),
+// get_y(), get_z(), get_field_strength() and heading() called together share one.
+STATIC const compass_reading_t *compass_get_reading(void) {
+    static uint32_t reading_ms;
+    static compass_reading_t reading;
+    uint32_t now_ms = mp_hal_ticks_ms();
+    if (!compass_up_to_date || now_ms - reading_ms >= MICROBIT_SYSTEM_TICK_MS) {
+        int mag_ned[3];
+        int accel_ned[3];
+        microbit_hal_compass_get_samples(reading.axis, mag_ned, accel_ned);
+        int64_t x = reading.axis[0];
+        int64_t y = reading.axis[1];
+        int64_t z = reading.axis[2];
+        reading.field_strength = compass_isqrt(x * x + y * y + z * z);
+        reading.heading = compass_tilt_compensated_heading(mag_ned, accel_ned);
+        compass_up_to_date = true;
+        reading_ms = now_ms;
+    }
+    return &reading;
+}
+
+// As for CODAL's heading(), the compass has to be calibrated before it gives a heading.
+STATIC const compass_reading_t *compass_get_calibrated_reading(void) {
+    if (!microbit_hal_compass_is_calibrated()) {
+        microbit_hal_compass_calibrate();
+        compass_up_to_date = false;
+    }
+    return compass_get_reading();
+}
+
 STATIC mp_obj_t microbit_compass_is_calibrated(mp_obj_t self_in) {
     (void)self_in;
     return mp_obj_new_bool(microbit_hal_compass_is_calibrated());
@@ -41,6 +158,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_is_calibrated_obj, microbit_co
 STATIC mp_obj_t microbit_compass_calibrate(mp_obj_t self_in) {
     (void)self_in;
     microbit_hal_compass_calibrate();
+    compass_up_to_date = false;
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_calibrate_obj, microbit_compass_calibrate);
@@ -48,46 +166,56 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_calibrate_obj, microbit_compas
 STATIC mp_obj_t microbit_compass_clear_calibration(mp_obj_t self_in) {
     (void)self_in;
     microbit_hal_compass_clear_calibration();
+    compass_up_to_date = false;
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_clear_calibration_obj, microbit_compass_clear_calibration);
 
 STATIC mp_obj_t microbit_compass_heading(mp_obj_t self_in) {
     (void)self_in;
-    return mp_obj_new_int(microbit_hal_compass_get_heading());
+    return mp_obj_new_int(compass_get_calibrated_reading()->heading);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_heading_obj, microbit_compass_heading);
 
 STATIC mp_obj_t microbit_compass_get_x(mp_obj_t self_in) {
     (void)self_in;
-    int axis[3];
-    microbit_hal_compass_get_sample(axis);
-    return mp_obj_new_int(axis[0]);
+    return mp_obj_new_int(compass_get_reading()->axis[0]);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_get_x_obj, microbit_compass_get_x);
 
 STATIC mp_obj_t microbit_compass_get_y(mp_obj_t self_in) {
     (void)self_in;
-    int axis[3];
-    microbit_hal_compass_get_sample(axis);
-    return mp_obj_new_int(axis[1]);
+    return mp_obj_new_int(compass_get_reading()->axis[1]);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_get_y_obj, microbit_compass_get_y);
 
 STATIC mp_obj_t microbit_compass_get_z(mp_obj_t self_in) {
     (void)self_in;
-    int axis[3];
-    microbit_hal_compass_get_sample(axis);
-    return mp_obj_new_int(axis[2]);
+    return mp_obj_new_int(compass_get_reading()->axis[2]);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_get_z_obj, microbit_compass_get_z);
 
 STATIC mp_obj_t microbit_compass_get_field_strength(mp_obj_t self_in) {
     (void)self_in;
-    return mp_obj_new_int(microbit_hal_compass_get_field_strength());
+    return mp_obj_new_int(compass_get_reading()->field_strength);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_get_field_strength_obj, microbit_compass_get_field_strength);
 
+// Return (x, y, z, field_strength, heading) from a single sample.
+STATIC mp_obj_t microbit_compass_read_all(mp_obj_t self_in) {
+    (void)self_in;
+    const compass_reading_t *reading = compass_get_calibrated_reading();
+    mp_obj_t items[5] = {
+        mp_obj_new_int(reading->axis[0]),
+        mp_obj_new_int(reading->axis[1]),
+        mp_obj_new_int(reading->axis[2]),
+        mp_obj_new_int(reading->field_strength),
+        MP_OBJ_NEW_SMALL_INT(reading->heading),
+    };
+    return mp_obj_new_tuple(5, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_compass_read_all_obj, microbit_compass_read_all);
+
 STATIC const mp_rom_map_elem_t microbit_compass_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_heading), MP_ROM_PTR(&microbit_compass_heading_obj) },
     { MP_ROM_QSTR(MP_QSTR_is_calibrated), MP_ROM_PTR(&microbit_compass_is_calibrated_obj) },
@@ -97,6 +225,7 @@ STATIC const mp_rom_map_elem_t microbit_compass_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_get_y), MP_ROM_PTR(&microbit_compass_get_y_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_z), MP_ROM_PTR(&microbit_compass_get_z_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_field_strength), MP_ROM_PTR(&microbit_compass_get_field_strength_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_all), MP_ROM_PTR(&microbit_compass_read_all_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_compass_locals_dict, microbit_compass_locals_dict_table);
 
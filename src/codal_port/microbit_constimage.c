@@ -26,9 +26,18 @@
 
 #include "py/runtime.h"
 #include "modmicrobit.h"
+#include "genhdr/microbitfont.h"
 
 #define IMAGE_T const monochrome_5by5_t
 
+microbit_image_obj_t *microbit_const_image_for_char(char c) {
+    unsigned char index = c;
+    if (index < MICROBIT_FONT_FIRST_CHAR || index > MICROBIT_FONT_LAST_CHAR) {
+        index = '?';
+    }
+    return (microbit_image_obj_t *)&microbit_font_images[index - MICROBIT_FONT_FIRST_CHAR];
+}
+
 IMAGE_T microbit_const_image_heart_obj = SMALL_IMAGE(
     0,1,0,1,0,
     1,1,1,1,1,
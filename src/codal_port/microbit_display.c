@@ -74,7 +74,7 @@ mp_obj_t microbit_display_show_func(mp_uint_t n_args, const mp_obj_t *pos_args,
         } else if (len == 1) {
             if (!clear && !loop) {
                 // A single char; convert to an image and print that.
-                image = microbit_image_for_char(str[0]);
+                image = microbit_const_image_for_char(str[0]);
                 goto single_image_immediate;
             }
         }
@@ -175,7 +175,7 @@ void microbit_display_set_pixel(microbit_display_obj_t *display, mp_int_t x, mp_
     if (bright < 0 || bright > MICROBIT_DISPLAY_MAX_BRIGHTNESS) {
         mp_raise_ValueError(MP_ERROR_TEXT("brightness out of bounds"));
     }
-    microbit_hal_display_set_pixel(x, y, bright);
+    microbit_display_write_pixel(x, y, bright);
 }
 
 STATIC mp_obj_t microbit_display_set_pixel_func(mp_uint_t n_args, const mp_obj_t *args) {
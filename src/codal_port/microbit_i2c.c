@@ -140,11 +140,99 @@ STATIC mp_obj_t microbit_i2c_write(mp_uint_t n_args, const mp_obj_t *pos_args, m
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(microbit_i2c_write_obj, 1, microbit_i2c_write);
 
+// Run a list of (addr, write, read_len) operations in one call.  write is a buffer, or an
+// int for a single register address, and is followed by a repeated start if read_len is
+// non-zero.  Read data is returned as a list of bytes, one per operation, or packed into
+// the into buffer, in which case the number of bytes read is returned.
+STATIC mp_obj_t microbit_i2c_transact(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_ops, ARG_into };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_ops,      MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_into,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+
+    // Parse arguments.
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    size_t num_ops;
+    mp_obj_t *ops;
+    mp_obj_get_array(args[ARG_ops].u_obj, &num_ops, &ops);
+
+    mp_buffer_info_t into = { .buf = NULL, .len = 0 };
+    mp_obj_t result = MP_OBJ_NULL;
+    if (args[ARG_into].u_obj != mp_const_none) {
+        mp_get_buffer_raise(args[ARG_into].u_obj, &into, MP_BUFFER_WRITE);
+    } else {
+        result = mp_obj_new_list(num_ops, NULL);
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < num_ops; ++i) {
+        mp_obj_t *op;
+        mp_obj_get_array_fixed_n(ops[i], 3, &op);
+        mp_int_t addr = mp_obj_get_int(op[0]);
+        mp_int_t read_len = mp_obj_get_int(op[2]);
+        if (read_len < 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid number of bytes"));
+        }
+
+        // Get the data to write.
+        uint8_t reg;
+        mp_buffer_info_t write = { .buf = NULL, .len = 0 };
+        if (mp_obj_is_int(op[1])) {
+            reg = mp_obj_get_int(op[1]);
+            write.buf = &reg;
+            write.len = 1;
+        } else if (op[1] != mp_const_none) {
+            mp_get_buffer_raise(op[1], &write, MP_BUFFER_READ);
+        }
+
+        // Get where to read to.
+        vstr_t vstr;
+        uint8_t *dest;
+        if (result == MP_OBJ_NULL) {
+            if (total + read_len > into.len) {
+                mp_raise_ValueError(MP_ERROR_TEXT("into buffer too small"));
+            }
+            dest = (uint8_t *)into.buf + total;
+        } else {
+            vstr_init_len(&vstr, read_len);
+            dest = (uint8_t *)vstr.buf;
+        }
+
+        // Do the I2C operation.
+        int err = 0;
+        if (write.len > 0 || read_len == 0) {
+            err = microbit_hal_i2c_writeto(addr, write.buf, write.len, read_len == 0);
+        }
+        if (err == 0 && read_len > 0) {
+            err = microbit_hal_i2c_readfrom(addr, dest, read_len, true);
+        }
+        if (err != 0) {
+            // Assume an error means there is no I2C device with addr.
+            mp_raise_OSError(MP_ENODEV);
+        }
+
+        total += read_len;
+        if (result != MP_OBJ_NULL) {
+            mp_obj_list_store(result, MP_OBJ_NEW_SMALL_INT(i), mp_obj_new_bytes_from_vstr(&vstr));
+        }
+    }
+
+    if (result == MP_OBJ_NULL) {
+        return MP_OBJ_NEW_SMALL_INT(total);
+    }
+    return result;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(microbit_i2c_transact_obj, 1, microbit_i2c_transact);
+
 STATIC const mp_rom_map_elem_t microbit_i2c_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&microbit_i2c_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_scan), MP_ROM_PTR(&microbit_i2c_scan_obj) },
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&microbit_i2c_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&microbit_i2c_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_transact), MP_ROM_PTR(&microbit_i2c_transact_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_i2c_locals_dict, microbit_i2c_locals_dict_table);
 
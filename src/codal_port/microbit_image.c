@@ -169,6 +169,35 @@ STATIC mp_obj_t microbit_image_make_new(const mp_obj_type_t *type_in, mp_uint_t
     }
 }
 
+// Image.from_packed(width, height, data, offset=0) makes a read-only image that uses the
+// pixels in data directly rather than copying them.  data must be a bytes object, such as
+// one frozen into flash or read from a file, and holds rows of pixels two to a byte, the
+// first in the low nibble.  A sprite sheet can hold many frames, picked out by offset.
+STATIC mp_obj_t microbit_image_from_packed(size_t n_args, const mp_obj_t *args) {
+    mp_int_t w = mp_obj_get_int(args[0]);
+    mp_int_t h = mp_obj_get_int(args[1]);
+    if (!mp_obj_is_type(args[2], &mp_type_bytes)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("expecting bytes"));
+    }
+    mp_int_t offset = n_args > 3 ? mp_obj_get_int(args[3]) : 0;
+    size_t len;
+    const uint8_t *data = (const uint8_t *)mp_obj_str_get_data(args[2], &len);
+    if (w < 0 || h < 0 || w > 255 || h > 255 || offset < 0
+        || (size_t)offset > len || (size_t)((w * h + 1) >> 1) > len - offset) {
+        mp_raise_ValueError(MP_ERROR_TEXT("image data is incorrect size"));
+    }
+    data += offset;
+    // Check once here, since the pixels are never clamped when they are read.
+    for (mp_int_t i = 0; i < w * h; ++i) {
+        if (((data[i >> 1] >> ((i & 1) << 2)) & 15) > MICROBIT_DISPLAY_MAX_BRIGHTNESS) {
+            mp_raise_ValueError(MP_ERROR_TEXT("brightness out of bounds"));
+        }
+    }
+    return greyscale_ref_new(w, h, data, args[2]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(microbit_image_from_packed_obj, 3, 4, microbit_image_from_packed);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(microbit_image_from_packed_staticmethod_obj, MP_ROM_PTR(&microbit_image_from_packed_obj));
+
 greyscale_t *image_shift(microbit_image_obj_t *self, mp_int_t x, mp_int_t y) {
     int w = image_width(self);
     int h = image_height(self);
@@ -217,7 +246,7 @@ MP_DEFINE_CONST_FUN_OBJ_3(microbit_image_get_pixel_obj, microbit_image_get_pixel
 
 /* Raise an exception if not mutable */
 static void check_mutability(microbit_image_obj_t *self) {
-    if (self->base.five) {
+    if (!image_is_mutable(self)) {
         mp_raise_TypeError(MP_ERROR_TEXT("image cannot be modified (try copying first)"));
     }
 }
@@ -298,6 +327,22 @@ mp_obj_t microbit_image_crop(mp_uint_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(microbit_image_crop_obj, 5, 5, microbit_image_crop);
 
+// Validate an image passed in to hold the result of an operation.
+STATIC greyscale_t *image_get_dest(mp_obj_t dest_in) {
+    if (mp_obj_get_type(dest_in) != &microbit_image_type) {
+        mp_raise_TypeError(MP_ERROR_TEXT("expecting an image"));
+    }
+    check_mutability((microbit_image_obj_t *)dest_in);
+    return &((microbit_image_obj_t *)dest_in)->greyscale;
+}
+
+// Shift into an existing image, which may be the source; pixels that have no source are cleared.
+STATIC mp_obj_t image_shift_into(mp_obj_t self_in, mp_obj_t dest_in, mp_int_t x, mp_int_t y) {
+    greyscale_t *dest = image_get_dest(dest_in);
+    image_blit((microbit_image_obj_t *)self_in, dest, x, y, dest->width, dest->height, 0, 0);
+    return dest_in;
+}
+
 mp_obj_t microbit_image_shift_left(mp_obj_t self_in, mp_obj_t n_in) {
     microbit_image_obj_t *self = (microbit_image_obj_t *)self_in;
     mp_int_t n = mp_obj_get_int(n_in);
@@ -326,6 +371,31 @@ mp_obj_t microbit_image_shift_down(mp_obj_t self_in, mp_obj_t n_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(microbit_image_shift_down_obj, microbit_image_shift_down);
 
+mp_obj_t microbit_image_shift_left_into(mp_obj_t self_in, mp_obj_t dest_in, mp_obj_t n_in) {
+    return image_shift_into(self_in, dest_in, mp_obj_get_int(n_in), 0);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(microbit_image_shift_left_into_obj, microbit_image_shift_left_into);
+
+mp_obj_t microbit_image_shift_right_into(mp_obj_t self_in, mp_obj_t dest_in, mp_obj_t n_in) {
+    return image_shift_into(self_in, dest_in, -mp_obj_get_int(n_in), 0);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(microbit_image_shift_right_into_obj, microbit_image_shift_right_into);
+
+mp_obj_t microbit_image_shift_up_into(mp_obj_t self_in, mp_obj_t dest_in, mp_obj_t n_in) {
+    return image_shift_into(self_in, dest_in, 0, mp_obj_get_int(n_in));
+}
+MP_DEFINE_CONST_FUN_OBJ_3(microbit_image_shift_up_into_obj, microbit_image_shift_up_into);
+
+mp_obj_t microbit_image_shift_down_into(mp_obj_t self_in, mp_obj_t dest_in, mp_obj_t n_in) {
+    return image_shift_into(self_in, dest_in, 0, -mp_obj_get_int(n_in));
+}
+MP_DEFINE_CONST_FUN_OBJ_3(microbit_image_shift_down_into_obj, microbit_image_shift_down_into);
+
+mp_obj_t microbit_image_crop_into(mp_obj_t self_in, mp_obj_t dest_in, mp_obj_t x_in, mp_obj_t y_in) {
+    return image_shift_into(self_in, dest_in, mp_obj_get_int(x_in), mp_obj_get_int(y_in));
+}
+MP_DEFINE_CONST_FUN_OBJ_4(microbit_image_crop_into_obj, microbit_image_crop_into);
+
 mp_obj_t microbit_image_copy(mp_obj_t self_in) {
     microbit_image_obj_t *self = (microbit_image_obj_t *)self_in;
     return image_copy(self);
@@ -338,6 +408,17 @@ mp_obj_t microbit_image_invert(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(microbit_image_invert_obj, microbit_image_invert);
 
+mp_obj_t microbit_image_invert_into(mp_obj_t self_in, mp_obj_t dest_in) {
+    microbit_image_obj_t *self = (microbit_image_obj_t *)self_in;
+    greyscale_t *dest = image_get_dest(dest_in);
+    if (dest->width != image_width(self) || dest->height != image_height(self)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("images must be the same size"));
+    }
+    image_invert_into(dest, self);
+    return dest_in;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(microbit_image_invert_into_obj, microbit_image_invert_into);
+
 STATIC const mp_rom_map_elem_t microbit_image_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_width), MP_ROM_PTR(&microbit_image_width_obj) },
     { MP_ROM_QSTR(MP_QSTR_height), MP_ROM_PTR(&microbit_image_height_obj) },
@@ -347,11 +428,18 @@ STATIC const mp_rom_map_elem_t microbit_image_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_shift_right), MP_ROM_PTR(&microbit_image_shift_right_obj) },
     { MP_ROM_QSTR(MP_QSTR_shift_up), MP_ROM_PTR(&microbit_image_shift_up_obj) },
     { MP_ROM_QSTR(MP_QSTR_shift_down), MP_ROM_PTR(&microbit_image_shift_down_obj) },
+    { MP_ROM_QSTR(MP_QSTR_shift_left_into), MP_ROM_PTR(&microbit_image_shift_left_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_shift_right_into), MP_ROM_PTR(&microbit_image_shift_right_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_shift_up_into), MP_ROM_PTR(&microbit_image_shift_up_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_shift_down_into), MP_ROM_PTR(&microbit_image_shift_down_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_copy), MP_ROM_PTR(&microbit_image_copy_obj) },
     { MP_ROM_QSTR(MP_QSTR_crop), MP_ROM_PTR(&microbit_image_crop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_crop_into), MP_ROM_PTR(&microbit_image_crop_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_invert), MP_ROM_PTR(&microbit_image_invert_obj) },
+    { MP_ROM_QSTR(MP_QSTR_invert_into), MP_ROM_PTR(&microbit_image_invert_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_fill), MP_ROM_PTR(&microbit_image_fill_obj) },
     { MP_ROM_QSTR(MP_QSTR_blit), MP_ROM_PTR(&microbit_image_blit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_from_packed), MP_ROM_PTR(&microbit_image_from_packed_staticmethod_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_HEART), MP_ROM_PTR(&microbit_const_image_heart_obj) },
     { MP_ROM_QSTR(MP_QSTR_HEART_SMALL), MP_ROM_PTR(&microbit_const_image_heart_small_obj) },
@@ -435,55 +523,36 @@ STATIC mp_int_t get_pixel_from_font_data(const unsigned char *data, int x, int y
     return ((data[y] >> (4 - x)) & 1);
 }
 
-STATIC void microbit_image_set_from_char(greyscale_t *img, char c) {
-    const unsigned char *data = get_font_data_from_char(c);
-    for (int x = 0; x < MICROBIT_DISPLAY_WIDTH; ++x) {
-        for (int y = 0; y < MICROBIT_DISPLAY_HEIGHT; ++y) {
-            greyscale_set_pixel(img, x, y, get_pixel_from_font_data(data, x, y)*MICROBIT_DISPLAY_MAX_BRIGHTNESS);
-        }
-    }
-}
-
 microbit_image_obj_t *microbit_image_for_char(char c) {
-    greyscale_t *result = greyscale_new(MICROBIT_DISPLAY_WIDTH, MICROBIT_DISPLAY_HEIGHT);
-    microbit_image_set_from_char(result, c);
-    return (microbit_image_obj_t *)result;
+    // Image(c) must be mutable, so copy the constant glyph.
+    return (microbit_image_obj_t *)image_copy(microbit_const_image_for_char(c));
 }
 
-microbit_image_obj_t *microbit_image_dim(microbit_image_obj_t *lhs, mp_float_t fval) {
+STATIC void check_brightness_multiplier(mp_float_t fval) {
     if (fval < 0) {
         mp_raise_ValueError(MP_ERROR_TEXT("brightness multiplier must not be negative"));
     }
+}
+
+microbit_image_obj_t *microbit_image_dim(microbit_image_obj_t *lhs, mp_float_t fval) {
+    check_brightness_multiplier(fval);
     greyscale_t *result = greyscale_new(image_width(lhs), image_height(lhs));
-    for (int x = 0; x < image_width(lhs); ++x) {
-        for (int y = 0; y < image_width(lhs); ++y) {
-            int val = MIN((int)image_get_pixel(lhs, x, y) * fval + 0.5, MICROBIT_DISPLAY_MAX_BRIGHTNESS);
-            greyscale_set_pixel(result, x, y, val);
-        }
-    }
+    image_dim(result, lhs, fval);
     return (microbit_image_obj_t *)result;
 }
 
+STATIC void check_same_size(microbit_image_obj_t *lhs, microbit_image_obj_t *rhs) {
+    if (image_height(rhs) != image_height(lhs) || image_width(rhs) != image_width(lhs)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("images must be the same size"));
+    }
+}
+
 STATIC microbit_image_obj_t *microbit_image_sum(microbit_image_obj_t *lhs, microbit_image_obj_t *rhs, bool add) {
     mp_int_t h = image_height(lhs);
     mp_int_t w = image_width(lhs);
-    if (image_height(rhs) != h || image_width(rhs) != w) {
-        mp_raise_ValueError(MP_ERROR_TEXT("images must be the same size"));
-    }
+    check_same_size(lhs, rhs);
     greyscale_t *result = greyscale_new(w, h);
-    for (int x = 0; x < w; ++x) {
-        for (int y = 0; y < h; ++y) {
-            int val;
-            int lval = image_get_pixel(lhs, x, y);
-            int rval = image_get_pixel(rhs, x, y);
-            if (add) {
-                val = MIN(lval + rval, MICROBIT_DISPLAY_MAX_BRIGHTNESS);
-            } else {
-                val = MAX(0, lval - rval);
-            }
-            greyscale_set_pixel(result, x, y, val);
-        }
-    }
+    image_sum(result, lhs, rhs, add);
     return (microbit_image_obj_t *)result;
 }
 
@@ -492,6 +561,33 @@ STATIC mp_obj_t image_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs
         return MP_OBJ_NULL; // op not supported
     }
     microbit_image_obj_t *lhs = (microbit_image_obj_t *)lhs_in;
+    if (image_is_mutable(lhs)) {
+        // Mutable images are updated in place by the augmented assignments, so
+        // animation loops need not allocate.  Constant images fall back to the
+        // normal operators, which return a new image.
+        mp_float_t fval;
+        switch (op) {
+            case MP_BINARY_OP_INPLACE_ADD:
+            case MP_BINARY_OP_INPLACE_SUBTRACT:
+                if (mp_obj_get_type(rhs_in) != &microbit_image_type) {
+                    return MP_OBJ_NULL; // op not supported
+                }
+                check_same_size(lhs, (microbit_image_obj_t *)rhs_in);
+                image_sum(&lhs->greyscale, lhs, (microbit_image_obj_t *)rhs_in, op == MP_BINARY_OP_INPLACE_ADD);
+                return lhs_in;
+            case MP_BINARY_OP_INPLACE_MULTIPLY:
+            case MP_BINARY_OP_INPLACE_TRUE_DIVIDE:
+                fval = mp_obj_get_float(rhs_in);
+                if (op == MP_BINARY_OP_INPLACE_TRUE_DIVIDE) {
+                    fval = 1.0 / fval;
+                }
+                check_brightness_multiplier(fval);
+                image_dim(&lhs->greyscale, lhs, fval);
+                return lhs_in;
+            default:
+                break;
+        }
+    }
     switch(op) {
         case MP_BINARY_OP_ADD:
         case MP_BINARY_OP_SUBTRACT:
@@ -542,8 +638,15 @@ typedef struct _scrolling_string_iterator_t {
     bool monospace;
     bool repeat;
     char right;
+    // If not NULL, the whole string pre-rendered as one bitmask per column.
+    uint8_t *strip;
+    uint16_t strip_len;
+    uint16_t strip_pos;
 } scrolling_string_iterator_t;
 
+// Longest string, in display columns, that is pre-rendered when scrolling.
+#define SCROLLING_STRING_MAX_STRIP_LEN (1024)
+
 extern const mp_obj_type_t microbit_scrolling_string_type;
 extern const mp_obj_type_t microbit_scrolling_string_iterator_type;
 
@@ -594,6 +697,66 @@ static void restart(scrolling_string_iterator_t *iter) {
     }
 }
 
+STATIC bool scrolling_string_at_end(scrolling_string_iterator_t *iter) {
+    return iter->next_char == iter->end && iter->offset == 5;
+}
+
+// Advance by one column and return the column entering on the right, with bit y set
+// if the pixel in row y is lit.
+STATIC uint8_t scrolling_string_next_column(scrolling_string_iterator_t *iter) {
+    uint8_t column = 0;
+    const unsigned char *font_data;
+    if (iter->offset < iter->offset_limit) {
+        font_data = get_font_data_from_char(iter->right);
+        for (int y = 0; y < MICROBIT_DISPLAY_HEIGHT; ++y) {
+            column |= get_pixel_from_font_data(font_data, iter->offset, y) << y;
+        }
+    } else if (iter->offset == iter->offset_limit) {
+        ++iter->next_char;
+        if (iter->next_char == iter->end) {
+            iter->right = ' ';
+            iter->offset_limit = 5;
+            iter->offset = 0;
+        } else {
+            iter->right = *iter->next_char;
+            font_data = get_font_data_from_char(iter->right);
+            if (iter->monospace) {
+                iter->offset = -1;
+                iter->offset_limit = 5;
+            } else {
+                iter->offset = -font_column_non_blank(font_data, 0);
+                iter->offset_limit = rightmost_non_blank_column(font_data)+1;
+            }
+        }
+    }
+    ++iter->offset;
+    return column;
+}
+
+// Render all the columns of the string up front, so that each step of the scroll
+// is just a window over the strip.  Long strings are left to be rendered as they go.
+STATIC void scrolling_string_prerender(scrolling_string_iterator_t *iter) {
+    scrolling_string_iterator_t scratch = *iter;
+    size_t len = 0;
+    while (!scrolling_string_at_end(&scratch)) {
+        scrolling_string_next_column(&scratch);
+        if (++len > SCROLLING_STRING_MAX_STRIP_LEN) {
+            return;
+        }
+    }
+    uint8_t *strip = m_new_maybe(uint8_t, len);
+    if (strip == NULL) {
+        return;
+    }
+    scratch = *iter;
+    for (size_t i = 0; i < len; ++i) {
+        strip[i] = scrolling_string_next_column(&scratch);
+    }
+    iter->strip = strip;
+    iter->strip_len = len;
+    iter->strip_pos = 0;
+}
+
 STATIC mp_obj_t get_microbit_scrolling_string_iter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
     (void)iter_buf; // not big enough to hold scrolling_string_iterator_t
     scrolling_string_t *str = (scrolling_string_t *)o_in;
@@ -605,13 +768,32 @@ STATIC mp_obj_t get_microbit_scrolling_string_iter(mp_obj_t o_in, mp_obj_iter_bu
     result->monospace = str->monospace;
     result->end = result->start + str->len;
     result->repeat = str->repeat;
+    result->strip = NULL;
     restart(result);
+    scrolling_string_prerender(result);
     return result;
 }
 
 STATIC mp_obj_t microbit_scrolling_string_iter_next(mp_obj_t o_in) {
     scrolling_string_iterator_t *iter = (scrolling_string_iterator_t *)o_in;
-    if (iter->next_char == iter->end && iter->offset == 5) {
+    if (iter->strip != NULL) {
+        if (iter->strip_pos == iter->strip_len) {
+            if (!iter->repeat) {
+                return MP_OBJ_STOP_ITERATION;
+            }
+            iter->strip_pos = 0;
+        }
+        ++iter->strip_pos;
+        for (int x = 0; x < MICROBIT_DISPLAY_WIDTH; ++x) {
+            int col = iter->strip_pos - MICROBIT_DISPLAY_WIDTH + x;
+            uint8_t column = col < 0 ? 0 : iter->strip[col];
+            for (int y = 0; y < MICROBIT_DISPLAY_HEIGHT; ++y) {
+                greyscale_set_pixel(iter->img, x, y, ((column >> y) & 1) * MICROBIT_DISPLAY_MAX_BRIGHTNESS);
+            }
+        }
+        return iter->img;
+    }
+    if (scrolling_string_at_end(iter)) {
         if (iter->repeat) {
             restart(iter);
             greyscale_clear(iter->img);
@@ -624,35 +806,10 @@ STATIC mp_obj_t microbit_scrolling_string_iter_next(mp_obj_t o_in) {
             greyscale_set_pixel(iter->img, x, y, greyscale_get_pixel(iter->img, x+1, y));
         }
     }
+    uint8_t column = scrolling_string_next_column(iter);
     for (int y = 0; y < MICROBIT_DISPLAY_HEIGHT; y++) {
-        greyscale_set_pixel(iter->img, 4, y, 0);
-    }
-    const unsigned char *font_data;
-    if (iter->offset < iter->offset_limit) {
-        font_data = get_font_data_from_char(iter->right);
-        for (int y = 0; y < MICROBIT_DISPLAY_HEIGHT; ++y) {
-            int pix = get_pixel_from_font_data(font_data, iter->offset, y)*MICROBIT_DISPLAY_MAX_BRIGHTNESS;
-            greyscale_set_pixel(iter->img, 4, y, pix);
-        }
-    } else if (iter->offset == iter->offset_limit) {
-        ++iter->next_char;
-        if (iter->next_char == iter->end) {
-            iter->right = ' ';
-            iter->offset_limit = 5;
-            iter->offset = 0;
-        } else {
-            iter->right = *iter->next_char;
-            font_data = get_font_data_from_char(iter->right);
-            if (iter->monospace) {
-                iter->offset = -1;
-                iter->offset_limit = 5;
-            } else {
-                iter->offset = -font_column_non_blank(font_data, 0);
-                iter->offset_limit = rightmost_non_blank_column(font_data)+1;
-            }
-        }
+        greyscale_set_pixel(iter->img, 4, y, ((column >> y) & 1) * MICROBIT_DISPLAY_MAX_BRIGHTNESS);
     }
-    ++iter->offset;
     return iter->img;
 }
 
@@ -680,7 +837,6 @@ MP_DEFINE_CONST_OBJ_TYPE(
 typedef struct _string_image_facade_t {
     mp_obj_base_t base;
     mp_obj_t string;
-    greyscale_t *image;
 } string_image_facade_t;
 
 static mp_obj_t string_image_facade_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t value) {
@@ -690,8 +846,7 @@ static mp_obj_t string_image_facade_subscr(mp_obj_t self_in, mp_obj_t index_in,
         mp_uint_t len;
         const char *text = mp_obj_str_get_data(self->string, &len);
         mp_uint_t index = mp_get_index(self->base.type, len, index_in, false);
-        microbit_image_set_from_char(self->image, text[index]);
-        return self->image;
+        return microbit_const_image_for_char(text[index]);
     } else {
         return MP_OBJ_NULL; // op not supported
     }
@@ -724,14 +879,12 @@ typedef struct _facade_iterator_t {
     mp_obj_base_t base;
     mp_obj_t string;
     mp_uint_t index;
-    greyscale_t *image;
 } facade_iterator_t;
 
 mp_obj_t microbit_string_facade(mp_obj_t string) {
     string_image_facade_t *result = m_new_obj(string_image_facade_t);
     result->base.type = &string_image_facade_type;
     result->string = string;
-    result->image = greyscale_new(MICROBIT_DISPLAY_WIDTH, MICROBIT_DISPLAY_HEIGHT);
     return result;
 }
 
@@ -742,9 +895,7 @@ static mp_obj_t microbit_facade_iter_next(mp_obj_t iter_in) {
     if (iter->index >= len) {
         return MP_OBJ_STOP_ITERATION;
     }
-    microbit_image_set_from_char(iter->image, text[iter->index]);
-    iter->index++;
-    return iter->image;
+    return microbit_const_image_for_char(text[iter->index++]);
 }
 
 MP_DEFINE_CONST_OBJ_TYPE(
@@ -760,7 +911,6 @@ static mp_obj_t microbit_facade_iterator(mp_obj_t iterable_in, mp_obj_iter_buf_t
     string_image_facade_t *iterable = (string_image_facade_t *)iterable_in;
     result->base.type = &microbit_facade_iterator_type;
     result->string = iterable->string;
-    result->image = iterable->image;
     result->index = 0;
     return result;
 }
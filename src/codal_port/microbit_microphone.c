@@ -26,10 +26,14 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "drv_event.h"
 #include "modmicrobit.h"
 
 #define EVENT_HISTORY_SIZE (8)
 
+#define RECORDING_DEFAULT_RATE (7812)
+#define RECORDING_MAX_RATE (16000) // the splitter resamples from the microphone ADC channel
+
 #define SOUND_EVENT_QUIET (0)
 #define SOUND_EVENT_LOUD (1)
 #define SOUND_EVENT_CLAP (2)
@@ -64,6 +68,7 @@ void microbit_hal_level_detector_callback(int value) {
     }
 
     // Set the sound event as active, and add it to the history.
+    microbit_event_push(MICROBIT_EVENT_SOURCE_SOUND, 0, ev);
     sound_event_current = ev;
     sound_event_active_mask |= 1 << ev;
     if (sound_event_history_index < EVENT_HISTORY_SIZE) {
@@ -71,6 +76,25 @@ void microbit_hal_level_detector_callback(int value) {
     }
 }
 
+// Called from the microphone's interrupt when a half of a stream buffer has been filled,
+// or when a single recording is complete.
+void microbit_hal_microphone_recording_callback(size_t half) {
+    mp_obj_t callback = MP_STATE_PORT(microphone_recording_callback);
+    if (callback != MP_OBJ_NULL && callback != mp_const_none) {
+        mp_sched_schedule(callback, MP_OBJ_NEW_SMALL_INT(half));
+    }
+}
+
+void microbit_microphone_stop_recording(void) {
+    microbit_hal_microphone_stop_recording();
+    MP_STATE_PORT(microphone_recording_buf) = MP_OBJ_NULL;
+    MP_STATE_PORT(microphone_recording_callback) = MP_OBJ_NULL;
+}
+
+mp_obj_t microbit_microphone_sound_event_obj(uint8_t sound) {
+    return (mp_obj_t)sound_event_obj_map[sound];
+}
+
 STATIC void microphone_init(void) {
     microbit_hal_microphone_init();
 }
@@ -151,6 +175,82 @@ STATIC mp_obj_t microbit_microphone_get_events(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_microphone_get_events_obj, microbit_microphone_get_events);
 
+STATIC mp_obj_t microphone_start_recording(mp_obj_t buf_in, mp_int_t rate, mp_obj_t callback, bool loop) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < 2) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+    }
+    if (rate < 1 || rate > RECORDING_MAX_RATE) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid rate"));
+    }
+    if (callback != mp_const_none && !mp_obj_is_callable(callback)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("callback must be callable"));
+    }
+    microphone_init();
+    microbit_microphone_stop_recording();
+
+    // Keep the buffer alive while the HAL writes samples into it.
+    MP_STATE_PORT(microphone_recording_buf) = buf_in;
+    MP_STATE_PORT(microphone_recording_callback) = callback;
+    microbit_hal_microphone_start_recording(bufinfo.buf, bufinfo.len, rate, loop);
+    return mp_const_none;
+}
+
+STATIC mp_obj_t microbit_microphone_record_into(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buffer, ARG_rate, ARG_wait };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buffer, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_rate, MP_ARG_INT, {.u_int = RECORDING_DEFAULT_RATE} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    microphone_start_recording(args[ARG_buffer].u_obj, args[ARG_rate].u_int, mp_const_none, false);
+    if (args[ARG_wait].u_bool) {
+        while (microbit_hal_microphone_is_recording()) {
+            mp_handle_pending(true);
+            microbit_hal_idle();
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(microbit_microphone_record_into_obj, 1, microbit_microphone_record_into);
+
+STATIC mp_obj_t microbit_microphone_stream_into(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buffer, ARG_rate, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buffer, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_rate, MP_ARG_INT, {.u_int = RECORDING_DEFAULT_RATE} },
+        { MP_QSTR_callback, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    return microphone_start_recording(args[ARG_buffer].u_obj, args[ARG_rate].u_int, args[ARG_callback].u_obj, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(microbit_microphone_stream_into_obj, 1, microbit_microphone_stream_into);
+
+STATIC mp_obj_t microbit_microphone_is_recording(mp_obj_t self_in) {
+    (void)self_in;
+    return mp_obj_new_bool(microbit_hal_microphone_is_recording());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_microphone_is_recording_obj, microbit_microphone_is_recording);
+
+STATIC mp_obj_t microbit_microphone_stop_recording_(mp_obj_t self_in) {
+    (void)self_in;
+    microbit_microphone_stop_recording();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_microphone_stop_recording_obj, microbit_microphone_stop_recording_);
+
+STATIC mp_obj_t microbit_microphone_recorded(mp_obj_t self_in) {
+    (void)self_in;
+    return MP_OBJ_NEW_SMALL_INT(microbit_hal_microphone_get_recording_pos());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_microphone_recorded_obj, microbit_microphone_recorded);
+
 STATIC const mp_rom_map_elem_t microbit_microphone_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_set_threshold), MP_ROM_PTR(&microbit_microphone_set_threshold_obj) },
     { MP_ROM_QSTR(MP_QSTR_sound_level), MP_ROM_PTR(&microbit_microphone_sound_level_obj) },
@@ -158,6 +258,11 @@ STATIC const mp_rom_map_elem_t microbit_microphone_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_is_event), MP_ROM_PTR(&microbit_microphone_is_event_obj) },
     { MP_ROM_QSTR(MP_QSTR_was_event), MP_ROM_PTR(&microbit_microphone_was_event_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_events), MP_ROM_PTR(&microbit_microphone_get_events_obj) },
+    { MP_ROM_QSTR(MP_QSTR_record_into), MP_ROM_PTR(&microbit_microphone_record_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stream_into), MP_ROM_PTR(&microbit_microphone_stream_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_is_recording), MP_ROM_PTR(&microbit_microphone_is_recording_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop_recording), MP_ROM_PTR(&microbit_microphone_stop_recording_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recorded), MP_ROM_PTR(&microbit_microphone_recorded_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_microphone_locals_dict, microbit_microphone_locals_dict_table);
 
@@ -171,3 +276,6 @@ MP_DEFINE_CONST_OBJ_TYPE(
 const microbit_microphone_obj_t microbit_microphone_obj = {
     { &microbit_microphone_type },
 };
+
+MP_REGISTER_ROOT_POINTER(mp_obj_t microphone_recording_buf);
+MP_REGISTER_ROOT_POINTER(mp_obj_t microphone_recording_callback);
@@ -25,9 +25,14 @@
  */
 
 #include "py/runtime.h"
+#include "py/mperrno.h"
 #include "py/mphal.h"
+#include "drv_event.h"
 #include "modmicrobit.h"
 
+// The SAADC needs at least 5us per conversion when sampling with EasyDMA.
+#define MICROBIT_PIN_SAMPLE_RATE_MAX (100000)
+
 const microbit_pin_obj_t microbit_p0_obj  = {{&microbit_touch_pin_type}, 0, MICROBIT_HAL_PIN_P0,  MODE_UNUSED};
 const microbit_pin_obj_t microbit_p1_obj  = {{&microbit_touch_pin_type}, 1, MICROBIT_HAL_PIN_P1,  MODE_UNUSED};
 const microbit_pin_obj_t microbit_p2_obj  = {{&microbit_touch_pin_type}, 2, MICROBIT_HAL_PIN_P2,  MODE_UNUSED};
@@ -128,6 +133,74 @@ mp_obj_t microbit_pin_read_analog(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(microbit_pin_read_analog_obj, microbit_pin_read_analog);
 
+// Called from CODAL's event handler when a touch pin is touched or released.
+void microbit_hal_touch_callback(int pin, int event) {
+    microbit_event_push(MICROBIT_EVENT_SOURCE_TOUCH, pin, event);
+}
+
+// Called from the ADC interrupt each time half of the sample buffer has been filled.
+void microbit_hal_pin_sample_callback(size_t half) {
+    mp_obj_t callback = MP_STATE_PORT(pin_sample_callback);
+    if (callback != MP_OBJ_NULL && callback != mp_const_none) {
+        mp_sched_schedule(callback, MP_OBJ_NEW_SMALL_INT(half));
+    }
+}
+
+void microbit_pin_sample_stop(void) {
+    microbit_hal_pin_sample_stop();
+    MP_STATE_PORT(pin_sample_buf) = MP_OBJ_NULL;
+    MP_STATE_PORT(pin_sample_callback) = MP_OBJ_NULL;
+}
+
+STATIC mp_obj_t microbit_pin_sample_into(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_rate, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_rate, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_callback, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    microbit_pin_obj_t *self = (microbit_pin_obj_t *)pos_args[0];
+
+    // Samples are stored as 16-bit values in 'H' and 'h' arrays, otherwise as 8-bit values.
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    size_t sample_size = (bufinfo.typecode == 'H' || bufinfo.typecode == 'h') ? 2 : 1;
+    size_t num_samples = bufinfo.len / sample_size;
+    if (num_samples < 2) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+    }
+    mp_int_t rate = args[ARG_rate].u_int;
+    if (rate < 1 || rate > MICROBIT_PIN_SAMPLE_RATE_MAX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid rate"));
+    }
+    mp_obj_t callback = args[ARG_callback].u_obj;
+    if (callback != mp_const_none && !mp_obj_is_callable(callback)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("callback must be callable"));
+    }
+
+    // Only one pin can be streamed at a time, so stop any existing stream.
+    microbit_pin_sample_stop();
+    microbit_obj_pin_acquire(self, microbit_pin_mode_unused);
+    MP_STATE_PORT(pin_sample_buf) = args[ARG_buf].u_obj;
+    MP_STATE_PORT(pin_sample_callback) = callback;
+    if (microbit_hal_pin_sample_start(self->name, rate, bufinfo.buf, num_samples, sample_size) != 0) {
+        microbit_pin_sample_stop();
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(microbit_pin_sample_into_obj, 1, microbit_pin_sample_into);
+
+STATIC mp_obj_t microbit_pin_sample_stop_(mp_obj_t self_in) {
+    (void)self_in;
+    microbit_pin_sample_stop();
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(microbit_pin_sample_stop_obj, microbit_pin_sample_stop_);
+
 mp_obj_t microbit_pin_set_analog_period(mp_obj_t self_in, mp_obj_t period_in) {
     microbit_pin_obj_t *self = (microbit_pin_obj_t*)self_in;
     mp_int_t period = mp_obj_get_int(period_in) * 1000;
@@ -200,6 +273,15 @@ MP_DEFINE_CONST_FUN_OBJ_2(microbit_pin_set_touch_mode_obj, microbit_pin_set_touc
     { MP_ROM_QSTR(MP_QSTR_PULL_DOWN), MP_ROM_INT(MICROBIT_HAL_PIN_PULL_DOWN) }, \
     { MP_ROM_QSTR(MP_QSTR_NO_PULL), MP_ROM_INT(MICROBIT_HAL_PIN_PULL_NONE) }
 
+#define IRQ_CONSTANTS \
+    { MP_ROM_QSTR(MP_QSTR_IRQ_RISING), MP_ROM_INT(1) }, \
+    { MP_ROM_QSTR(MP_QSTR_IRQ_FALLING), MP_ROM_INT(2) }
+
+#define IRQ_METHODS \
+    { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&microbit_pin_irq_obj) }, \
+    { MP_ROM_QSTR(MP_QSTR_edges), MP_ROM_PTR(&microbit_pin_edges_obj) }, \
+    { MP_ROM_QSTR(MP_QSTR_edge_count), MP_ROM_PTR(&microbit_pin_edge_count_obj) }
+
 #define TOUCH_CONSTANTS \
     { MP_ROM_QSTR(MP_QSTR_RESISTIVE), MP_ROM_INT(MICROBIT_HAL_PIN_TOUCH_RESISTIVE) }, \
     { MP_ROM_QSTR(MP_QSTR_CAPACITIVE), MP_ROM_INT(MICROBIT_HAL_PIN_TOUCH_CAPACITIVE) }
@@ -214,7 +296,9 @@ STATIC const mp_rom_map_elem_t microbit_dig_pin_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_get_pull), MP_ROM_PTR(&microbit_pin_get_pull_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_pull), MP_ROM_PTR(&microbit_pin_set_pull_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_mode), MP_ROM_PTR(&microbit_pin_get_mode_obj) },
+    IRQ_METHODS,
     PULL_CONSTANTS,
+    IRQ_CONSTANTS,
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_dig_pin_locals_dict, microbit_dig_pin_locals_dict_table);
 
@@ -230,13 +314,17 @@ STATIC const mp_rom_map_elem_t microbit_ann_pin_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read_digital), MP_ROM_PTR(&microbit_pin_read_digital_obj) },
     { MP_ROM_QSTR(MP_QSTR_write_analog), MP_ROM_PTR(&microbit_pin_write_analog_obj) },
     { MP_ROM_QSTR(MP_QSTR_read_analog), MP_ROM_PTR(&microbit_pin_read_analog_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sample_into), MP_ROM_PTR(&microbit_pin_sample_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sample_stop), MP_ROM_PTR(&microbit_pin_sample_stop_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_analog_period), MP_ROM_PTR(&microbit_pin_set_analog_period_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_analog_period_microseconds), MP_ROM_PTR(&microbit_pin_set_analog_period_microseconds_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_analog_period_microseconds), MP_ROM_PTR(&microbit_pin_get_analog_period_microseconds_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_pull), MP_ROM_PTR(&microbit_pin_get_pull_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_pull), MP_ROM_PTR(&microbit_pin_set_pull_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_mode), MP_ROM_PTR(&microbit_pin_get_mode_obj) },
+    IRQ_METHODS,
     PULL_CONSTANTS,
+    IRQ_CONSTANTS,
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_ann_pin_locals_dict, microbit_ann_pin_locals_dict_table);
 
@@ -252,6 +340,8 @@ STATIC const mp_rom_map_elem_t microbit_touch_pin_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read_digital), MP_ROM_PTR(&microbit_pin_read_digital_obj) },
     { MP_ROM_QSTR(MP_QSTR_write_analog), MP_ROM_PTR(&microbit_pin_write_analog_obj) },
     { MP_ROM_QSTR(MP_QSTR_read_analog), MP_ROM_PTR(&microbit_pin_read_analog_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sample_into), MP_ROM_PTR(&microbit_pin_sample_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sample_stop), MP_ROM_PTR(&microbit_pin_sample_stop_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_analog_period), MP_ROM_PTR(&microbit_pin_set_analog_period_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_analog_period_microseconds), MP_ROM_PTR(&microbit_pin_set_analog_period_microseconds_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_analog_period_microseconds), MP_ROM_PTR(&microbit_pin_get_analog_period_microseconds_obj) },
@@ -262,7 +352,9 @@ STATIC const mp_rom_map_elem_t microbit_touch_pin_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_set_pull), MP_ROM_PTR(&microbit_pin_set_pull_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_mode), MP_ROM_PTR(&microbit_pin_get_mode_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_touch_mode), MP_ROM_PTR(&microbit_pin_set_touch_mode_obj) },
+    IRQ_METHODS,
     PULL_CONSTANTS,
+    IRQ_CONSTANTS,
     TOUCH_CONSTANTS,
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_touch_pin_locals_dict, microbit_touch_pin_locals_dict_table);
@@ -302,3 +394,6 @@ const microbit_pin_obj_t *microbit_obj_get_pin(mp_const_obj_t o) {
 uint8_t microbit_obj_get_pin_name(mp_obj_t o) {
     return microbit_obj_get_pin(o)->name;
 }
+
+MP_REGISTER_ROOT_POINTER(mp_obj_t pin_sample_buf);
+MP_REGISTER_ROOT_POINTER(mp_obj_t pin_sample_callback);
@@ -24,13 +24,30 @@
  * THE SOFTWARE.
  */
 
+#include "py/mperrno.h"
 #include "microbithal.h"
 #include "modmicrobit.h"
 
 // The currently selected pin output for the audio.
 STATIC const microbit_pin_obj_t *audio_routed_pin = NULL;
 
+// Whether audio.play() output goes straight to audio_routed_pin by DMA, instead of
+// through the mixer.
+STATIC bool audio_routed_direct = false;
+
+STATIC void audio_direct_deselect(void) {
+    if (audio_routed_direct) {
+        audio_routed_direct = false;
+        microbit_hal_audio_select_direct(-1);
+    }
+}
+
 void microbit_pin_audio_select(mp_const_obj_t select, const microbit_pinmode_t *pinmode) {
+    // Anything else selecting the audio pin takes it back for the mixer, which then plays
+    // any remaining audio.play() output as well.
+    bool was_direct = audio_routed_direct;
+    audio_direct_deselect();
+
     // Work out which pins are requested for the audio output.
     const microbit_pin_obj_t *pin_selected;
     if (select == mp_const_none) {
@@ -56,10 +73,30 @@ void microbit_pin_audio_select(mp_const_obj_t select, const microbit_pinmode_t *
     } else if (audio_routed_pin != NULL) {
         // Update the pin acquisition mode, to make sure pin.get_mode() reflects the current mode.
         microbit_pin_set_mode(audio_routed_pin, pinmode);
+        if (was_direct) {
+            microbit_hal_audio_select_pin(audio_routed_pin->name);
+        }
+    }
+}
+
+// Route the output of audio.play() straight to a pin, streamed to a PWM peripheral by DMA
+// rather than mixed with the other sounds, and not played on the speaker.
+void microbit_pin_audio_select_direct(mp_const_obj_t select, const microbit_pinmode_t *pinmode) {
+    if (select == mp_const_none || select == MP_OBJ_FROM_PTR(&microbit_pin_speaker_obj)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("direct output needs a pin"));
+    }
+    microbit_pin_audio_select(select, pinmode);
+    // Only the direct stream drives the pin, so take it away from the mixer.
+    microbit_hal_audio_select_pin(-1);
+    if (microbit_hal_audio_select_direct(audio_routed_pin->name) != MICROBIT_HAL_DEVICE_OK) {
+        microbit_hal_audio_select_pin(audio_routed_pin->name);
+        mp_raise_OSError(MP_EBUSY);
     }
+    audio_routed_direct = true;
 }
 
 void microbit_pin_audio_free(void) {
+    audio_direct_deselect();
     if (audio_routed_pin != NULL) {
         microbit_obj_pin_free(audio_routed_pin);
         audio_routed_pin = NULL;
@@ -0,0 +1,214 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "modmicrobit.h"
+
+// Edge interrupts on the GPIO pins P0-P20.  CODAL detects the edges with GPIOTE PORT
+// events and timestamps them in the interrupt handler.  Each pin with an irq has its own
+// ring of timestamped edges and an edge counter, both updated in the interrupt, so no
+// edges are lost even if Python is busy; the handler, if any, is scheduled once per
+// batch of edges and drains them with pin.edges().
+
+#define PIN_IRQ_NUM_PINS (MICROBIT_HAL_PIN_P20 + 1)
+#define PIN_IRQ_DEFAULT_DEPTH (32)
+
+#define PIN_IRQ_RISING (1)
+#define PIN_IRQ_FALLING (2)
+
+typedef struct _microbit_pin_irq_edge_t {
+    uint32_t time_us;
+    uint8_t value;
+} microbit_pin_irq_edge_t;
+
+typedef struct _microbit_pin_irq_t {
+    const microbit_pin_obj_t *pin;
+    mp_obj_t handler;
+    volatile uint32_t count;
+    volatile uint16_t head;
+    volatile uint16_t len;
+    uint16_t depth;
+    uint8_t trigger;
+    volatile bool scheduled;
+    microbit_pin_irq_edge_t edges[];
+} microbit_pin_irq_t;
+
+STATIC mp_obj_t pin_irq_dispatch(mp_obj_t pin_in) {
+    microbit_pin_irq_t *irq = MP_STATE_PORT(pin_irq)[microbit_obj_get_pin_name(pin_in)];
+    if (irq != NULL) {
+        irq->scheduled = false;
+        if (irq->handler != mp_const_none) {
+            mp_call_function_1(irq->handler, pin_in);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pin_irq_dispatch_obj, pin_irq_dispatch);
+
+// Called from the GPIOTE interrupt, via CODAL, on every edge of a pin with edge events.
+void microbit_hal_pin_edge_callback(int pin, int value, uint32_t time_us) {
+    if (MP_STATE_PORT(pin_irq) == NULL || pin >= PIN_IRQ_NUM_PINS) {
+        return;
+    }
+    microbit_pin_irq_t *irq = MP_STATE_PORT(pin_irq)[pin];
+    if (irq == NULL || !(irq->trigger & (value ? PIN_IRQ_RISING : PIN_IRQ_FALLING))) {
+        return;
+    }
+    ++irq->count;
+    if (irq->len < irq->depth) {
+        microbit_pin_irq_edge_t *edge = &irq->edges[(irq->head + irq->len) % irq->depth];
+        edge->time_us = time_us;
+        edge->value = value;
+        ++irq->len;
+    }
+    if (irq->handler != mp_const_none && !irq->scheduled) {
+        irq->scheduled = mp_sched_schedule(MP_OBJ_FROM_PTR(&pin_irq_dispatch_obj), MP_OBJ_FROM_PTR(irq->pin));
+    }
+}
+
+STATIC void pin_irq_disable(uint8_t name) {
+    microbit_hal_pin_set_edge_events(name, false);
+    MP_STATE_PORT(pin_irq)[name] = NULL;
+}
+
+void microbit_pin_irq_deinit(void) {
+    if (MP_STATE_PORT(pin_irq) != NULL) {
+        for (size_t i = 0; i < PIN_IRQ_NUM_PINS; ++i) {
+            if (MP_STATE_PORT(pin_irq)[i] != NULL) {
+                pin_irq_disable(i);
+            }
+        }
+        MP_STATE_PORT(pin_irq) = NULL;
+    }
+}
+
+STATIC microbit_pin_irq_t *pin_irq_get(mp_obj_t self_in) {
+    uint8_t name = microbit_obj_get_pin_name(self_in);
+    if (MP_STATE_PORT(pin_irq) == NULL || name >= PIN_IRQ_NUM_PINS || MP_STATE_PORT(pin_irq)[name] == NULL) {
+        mp_raise_ValueError(MP_ERROR_TEXT("irq not enabled"));
+    }
+    return MP_STATE_PORT(pin_irq)[name];
+}
+
+STATIC mp_obj_t microbit_pin_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_handler, ARG_trigger, ARG_depth };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_handler, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_trigger, MP_ARG_INT, {.u_int = PIN_IRQ_RISING | PIN_IRQ_FALLING} },
+        { MP_QSTR_depth, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = PIN_IRQ_DEFAULT_DEPTH} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    const microbit_pin_obj_t *pin = microbit_obj_get_pin(pos_args[0]);
+    if (pin->name >= PIN_IRQ_NUM_PINS) {
+        mp_raise_ValueError(MP_ERROR_TEXT("pin does not support irq"));
+    }
+    mp_obj_t handler = args[ARG_handler].u_obj;
+    mp_int_t trigger = args[ARG_trigger].u_int;
+    mp_int_t depth = args[ARG_depth].u_int;
+    if (handler != mp_const_none && !mp_obj_is_callable(handler)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("handler must be callable"));
+    }
+    if (trigger & ~(PIN_IRQ_RISING | PIN_IRQ_FALLING)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid trigger"));
+    }
+    if (depth < 1 || depth > 0xffff) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid depth"));
+    }
+
+    if (MP_STATE_PORT(pin_irq) == NULL) {
+        MP_STATE_PORT(pin_irq) = m_new0(microbit_pin_irq_t *, PIN_IRQ_NUM_PINS);
+    }
+    if (MP_STATE_PORT(pin_irq)[pin->name] != NULL) {
+        pin_irq_disable(pin->name);
+    }
+    if (trigger == 0) {
+        return mp_const_none;
+    }
+
+    microbit_pin_irq_t *irq = m_new_obj_var(microbit_pin_irq_t, edges, microbit_pin_irq_edge_t, depth);
+    irq->pin = pin;
+    irq->handler = handler;
+    irq->count = 0;
+    irq->head = 0;
+    irq->len = 0;
+    irq->depth = depth;
+    irq->trigger = trigger;
+    irq->scheduled = false;
+
+    microbit_obj_pin_acquire(pin, microbit_pin_mode_read_digital);
+    MP_STATE_PORT(pin_irq)[pin->name] = irq;
+    if (microbit_hal_pin_set_edge_events(pin->name, true) != MICROBIT_HAL_DEVICE_OK) {
+        pin_irq_disable(pin->name);
+        mp_raise_OSError(MP_EIO);
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(microbit_pin_irq_obj, 1, microbit_pin_irq);
+
+// Return the captured edges as a list of (time_us, value) tuples, oldest first, and clear
+// them.  The times are in the same units as time.ticks_us().
+STATIC mp_obj_t microbit_pin_edges(mp_obj_t self_in) {
+    microbit_pin_irq_t *irq = pin_irq_get(self_in);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (;;) {
+        uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        if (irq->len == 0) {
+            MICROPY_END_ATOMIC_SECTION(atomic_state);
+            break;
+        }
+        microbit_pin_irq_edge_t edge = irq->edges[irq->head];
+        irq->head = (irq->head + 1) % irq->depth;
+        --irq->len;
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        mp_obj_t items[2] = {
+            MP_OBJ_NEW_SMALL_INT(edge.time_us & (MICROPY_PY_TIME_TICKS_PERIOD - 1)),
+            MP_OBJ_NEW_SMALL_INT(edge.value),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(2, items));
+    }
+    return list;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(microbit_pin_edges_obj, microbit_pin_edges);
+
+// Return the number of edges seen since irq() was called, including any that did not fit
+// in the ring, optionally resetting the count to zero.
+STATIC mp_obj_t microbit_pin_edge_count(size_t n_args, const mp_obj_t *args) {
+    microbit_pin_irq_t *irq = pin_irq_get(args[0]);
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t count = irq->count;
+    if (n_args > 1 && mp_obj_is_true(args[1])) {
+        irq->count = 0;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    return mp_obj_new_int_from_uint(count);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(microbit_pin_edge_count_obj, 1, 2, microbit_pin_edge_count);
+
+MP_REGISTER_ROOT_POINTER(struct _microbit_pin_irq_t **pin_irq);
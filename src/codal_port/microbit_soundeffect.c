@@ -27,31 +27,8 @@
 #include "py/runtime.h"
 #include "modmicrobit.h"
 #include "modaudio.h"
+#include "microbithal.h"
 
-#define SOUND_EXPR_WAVEFORM_OFFSET              (0)
-#define SOUND_EXPR_WAVEFORM_LENGTH              (1)
-#define SOUND_EXPR_VOLUME_START_OFFSET          (1)
-#define SOUND_EXPR_VOLUME_START_LENGTH          (4)
-#define SOUND_EXPR_FREQUENCY_START_OFFSET       (5)
-#define SOUND_EXPR_FREQUENCY_START_LENGTH       (4)
-#define SOUND_EXPR_DURATION_OFFSET              (9)
-#define SOUND_EXPR_DURATION_LENGTH              (4)
-#define SOUND_EXPR_SHAPE_OFFSET                 (13)
-#define SOUND_EXPR_SHAPE_LENGTH                 (2)
-#define SOUND_EXPR_FREQUENCY_END_OFFSET         (18)
-#define SOUND_EXPR_FREQUENCY_END_LENGTH         (4)
-#define SOUND_EXPR_VOLUME_END_OFFSET            (26)
-#define SOUND_EXPR_VOLUME_END_LENGTH            (4)
-#define SOUND_EXPR_STEPS_OFFSET                 (30)
-#define SOUND_EXPR_STEPS_LENGTH                 (4)
-#define SOUND_EXPR_FX_CHOICE_OFFSET             (34)
-#define SOUND_EXPR_FX_CHOICE_LENGTH             (2)
-#define SOUND_EXPR_FX_PARAM_OFFSET              (36)
-#define SOUND_EXPR_FX_PARAM_LENGTH              (4)
-#define SOUND_EXPR_FX_STEPS_OFFSET              (40)
-#define SOUND_EXPR_FX_STEPS_LENGTH              (4)
-
-#define SOUND_EXPR_ENCODE_VOLUME(v)             (((v) * 1023 + 127) / 255)
 #define SOUND_EXPR_DECODE_VOLUME(v)             (((v) * 255 + 511) / 1023)
 
 #define SOUND_EFFECT_WAVEFORM_SINE              (0)
@@ -86,18 +63,22 @@
 #define SOUND_EFFECT_DEFAULT_FX                 (SOUND_EFFECT_FX_NONE)
 #define SOUND_EFFECT_DEFAULT_SHAPE              (SOUND_EFFECT_SHAPE_LOG)
 
+// The parameters are kept in binary, in the form the HAL plays them.
 typedef struct _microbit_soundeffect_obj_t {
     mp_obj_base_t base;
     bool is_mutable;
-    char sound_expr[SOUND_EXPR_TOTAL_LENGTH];
+    microbit_hal_sound_effect_t fx;
 } microbit_soundeffect_obj_t;
 
 typedef struct _soundeffect_attr_t {
     uint16_t qst;
-    uint8_t offset;
-    uint8_t length;
+    uint8_t offset; // of the field in microbit_hal_sound_effect_t
+    uint8_t size;
+    uint16_t max;
 } soundeffect_attr_t;
 
+#define ATTR(name, max) { MP_QSTR_ ## name, offsetof(microbit_hal_sound_effect_t, name), sizeof(((microbit_hal_sound_effect_t *)0)->name), max }
+
 STATIC const uint16_t waveform_to_qstr_table[5] = {
     [SOUND_EFFECT_WAVEFORM_SINE] = MP_QSTR_WAVEFORM_SINE,
     [SOUND_EFFECT_WAVEFORM_SAWTOOTH] = MP_QSTR_WAVEFORM_SAWTOOTH,
@@ -114,14 +95,14 @@ STATIC const uint16_t fx_to_qstr_table[4] = {
 };
 
 STATIC const soundeffect_attr_t soundeffect_attr_table[] = {
-    { MP_QSTR_freq_start, SOUND_EXPR_FREQUENCY_START_OFFSET, SOUND_EXPR_FREQUENCY_START_LENGTH },
-    { MP_QSTR_freq_end, SOUND_EXPR_FREQUENCY_END_OFFSET, SOUND_EXPR_FREQUENCY_END_LENGTH },
-    { MP_QSTR_duration, SOUND_EXPR_DURATION_OFFSET, SOUND_EXPR_DURATION_LENGTH },
-    { MP_QSTR_vol_start, SOUND_EXPR_VOLUME_START_OFFSET, SOUND_EXPR_VOLUME_START_LENGTH },
-    { MP_QSTR_vol_end, SOUND_EXPR_VOLUME_END_OFFSET, SOUND_EXPR_VOLUME_END_LENGTH },
-    { MP_QSTR_waveform, SOUND_EXPR_WAVEFORM_OFFSET, SOUND_EXPR_WAVEFORM_LENGTH },
-    { MP_QSTR_fx, SOUND_EXPR_FX_CHOICE_OFFSET, SOUND_EXPR_FX_CHOICE_LENGTH },
-    { MP_QSTR_shape, SOUND_EXPR_SHAPE_OFFSET, SOUND_EXPR_SHAPE_LENGTH },
+    ATTR(freq_start, 9999),
+    ATTR(freq_end, 9999),
+    ATTR(duration, 9999),
+    ATTR(vol_start, 255),
+    ATTR(vol_end, 255),
+    ATTR(waveform, 9),
+    ATTR(fx, 99),
+    ATTR(shape, 99),
 };
 
 static const uint8_t fx_default_param[] = {
@@ -136,55 +117,58 @@ static const uint16_t fx_default_steps[] = {
     [SOUND_EFFECT_FX_WARBLE] = SOUND_EFFECT_FX_WARBLE_DEFAULT_STEPS,
 };
 
-const char *microbit_soundeffect_get_sound_expr_data(mp_obj_t self_in) {
+const microbit_hal_sound_effect_t *microbit_soundeffect_get_effect(mp_obj_t self_in) {
     const microbit_soundeffect_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    return &self->sound_expr[0];
+    return &self->fx;
 }
 
-STATIC void sound_expr_encode(microbit_soundeffect_obj_t *self, size_t offset, size_t length, unsigned int value) {
-    if (offset == SOUND_EXPR_VOLUME_START_OFFSET || offset == SOUND_EXPR_VOLUME_END_OFFSET) {
-        if (value > 255) {
-            mp_raise_ValueError(MP_ERROR_TEXT("maximum value is 255"));
-        }
-        value = SOUND_EXPR_ENCODE_VOLUME(value);
+STATIC void soundeffect_attr_store(microbit_soundeffect_obj_t *self, const soundeffect_attr_t *attr, mp_int_t value) {
+    if (value < 0 || value > attr->max) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("maximum value is %d"), attr->max);
     }
-    for (size_t i = length; i > 0; --i) {
-        self->sound_expr[offset + i - 1] = '0' + value % 10;
-        value /= 10;
+    uint8_t *field = (uint8_t *)&self->fx + attr->offset;
+    if (attr->size == 1) {
+        *field = value;
+    } else {
+        *(uint16_t *)field = value;
     }
-    if (value != 0) {
-        if (length == 1) {
-            mp_raise_ValueError(MP_ERROR_TEXT("maximum value is 9"));
-        } else if (length == 2) {
-            mp_raise_ValueError(MP_ERROR_TEXT("maximum value is 99"));
-        } else {
-            mp_raise_ValueError(MP_ERROR_TEXT("maximum value is 9999"));
-        }
+}
+
+STATIC mp_int_t soundeffect_attr_load(const microbit_soundeffect_obj_t *self, const soundeffect_attr_t *attr) {
+    const uint8_t *field = (const uint8_t *)&self->fx + attr->offset;
+    if (attr->size == 1) {
+        return *field;
+    } else {
+        return *(const uint16_t *)field;
     }
 }
 
-STATIC unsigned int sound_expr_decode(const microbit_soundeffect_obj_t *self, size_t offset, size_t length) {
+STATIC unsigned int sound_expr_decode(const char *str, size_t len, size_t offset, size_t length) {
     unsigned int value = 0;
-    for (size_t i = 0; i < length; ++i) {
-        value = value * 10 + self->sound_expr[offset + i] - '0';
-    }
-    if (offset == SOUND_EXPR_VOLUME_START_OFFSET || offset == SOUND_EXPR_VOLUME_END_OFFSET) {
-        value = SOUND_EXPR_DECODE_VOLUME(value);
+    for (size_t i = offset; i < offset + length; ++i) {
+        value = value * 10 + (i < len ? str[i] - '0' : 0);
     }
     return value;
 }
 
+STATIC void soundeffect_set_fx_defaults(microbit_soundeffect_obj_t *self) {
+    if (self->fx.fx < MP_ARRAY_SIZE(fx_default_param)) {
+        self->fx.fx_param = fx_default_param[self->fx.fx];
+        self->fx.fx_steps = fx_default_steps[self->fx.fx];
+    }
+}
+
 STATIC void microbit_soundeffect_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     const microbit_soundeffect_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
-    unsigned int freq_start = sound_expr_decode(self, SOUND_EXPR_FREQUENCY_START_OFFSET, SOUND_EXPR_FREQUENCY_START_LENGTH);
-    unsigned int freq_end = sound_expr_decode(self, SOUND_EXPR_FREQUENCY_END_OFFSET, SOUND_EXPR_FREQUENCY_END_LENGTH);
-    unsigned int duration = sound_expr_decode(self, SOUND_EXPR_DURATION_OFFSET, SOUND_EXPR_DURATION_LENGTH);
-    unsigned int vol_start = sound_expr_decode(self, SOUND_EXPR_VOLUME_START_OFFSET, SOUND_EXPR_VOLUME_START_LENGTH);
-    unsigned int vol_end = sound_expr_decode(self, SOUND_EXPR_VOLUME_END_OFFSET, SOUND_EXPR_VOLUME_END_LENGTH);
-    unsigned int waveform = sound_expr_decode(self, SOUND_EXPR_WAVEFORM_OFFSET, SOUND_EXPR_WAVEFORM_LENGTH);
-    unsigned int fx = sound_expr_decode(self, SOUND_EXPR_FX_CHOICE_OFFSET, SOUND_EXPR_FX_CHOICE_LENGTH);
-    unsigned int shape = sound_expr_decode(self, SOUND_EXPR_SHAPE_OFFSET, SOUND_EXPR_SHAPE_LENGTH);
+    unsigned int freq_start = self->fx.freq_start;
+    unsigned int freq_end = self->fx.freq_end;
+    unsigned int duration = self->fx.duration;
+    unsigned int vol_start = self->fx.vol_start;
+    unsigned int vol_end = self->fx.vol_end;
+    unsigned int waveform = self->fx.waveform;
+    unsigned int fx = self->fx.fx;
+    unsigned int shape = self->fx.shape;
 
     if (kind == PRINT_STR) {
         mp_printf(print, "SoundEffect("
@@ -229,7 +213,7 @@ STATIC void microbit_soundeffect_print(const mp_print_t *print, mp_obj_t self_in
 // Constructor:
 // SoundEffect(freq_start, freq_end, duration, vol_start, vol_end, waveform, fx, shape)
 STATIC mp_obj_t microbit_soundeffect_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args_in) {
-    enum { ARG_freq_start, ARG_freq_end, ARG_duration, ARG_vol_start, ARG_vol_end, ARG_waveform, ARG_fx, ARG_shape };
+    // These are in the same order as soundeffect_attr_table.
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_freq_start,       MP_ARG_INT, {.u_int = SOUND_EFFECT_DEFAULT_FREQ_START} },
         { MP_QSTR_freq_end,         MP_ARG_INT, {.u_int = SOUND_EFFECT_DEFAULT_FREQ_END} },
@@ -250,21 +234,16 @@ STATIC mp_obj_t microbit_soundeffect_make_new(const mp_obj_type_t *type, size_t
     self->base.type = type;
     self->is_mutable = true;
 
-    // Initialise base parameters of the sound expression data.
-    memset(&self->sound_expr[0], '0', SOUND_EXPR_TOTAL_LENGTH);
-    sound_expr_encode(self, SOUND_EXPR_STEPS_OFFSET, SOUND_EXPR_STEPS_LENGTH, 128);
-    sound_expr_encode(self, SOUND_EXPR_FX_PARAM_OFFSET, SOUND_EXPR_FX_PARAM_LENGTH, 1);
-    sound_expr_encode(self, SOUND_EXPR_FX_STEPS_OFFSET, SOUND_EXPR_FX_STEPS_LENGTH, 24);
+    // Initialise base parameters of the sound effect.
+    memset(&self->fx, 0, sizeof(self->fx));
+    self->fx.steps = 128;
+    self->fx.fx_param = 1;
+    self->fx.fx_steps = 24;
 
     // Modify any given parameters.
-    sound_expr_encode(self, SOUND_EXPR_FREQUENCY_START_OFFSET, SOUND_EXPR_FREQUENCY_START_LENGTH, args[ARG_freq_start].u_int);
-    sound_expr_encode(self, SOUND_EXPR_FREQUENCY_END_OFFSET, SOUND_EXPR_FREQUENCY_END_LENGTH, args[ARG_freq_end].u_int);
-    sound_expr_encode(self, SOUND_EXPR_DURATION_OFFSET, SOUND_EXPR_DURATION_LENGTH, args[ARG_duration].u_int);
-    sound_expr_encode(self, SOUND_EXPR_VOLUME_START_OFFSET, SOUND_EXPR_VOLUME_START_LENGTH, args[ARG_vol_start].u_int);
-    sound_expr_encode(self, SOUND_EXPR_VOLUME_END_OFFSET, SOUND_EXPR_VOLUME_END_LENGTH, args[ARG_vol_end].u_int);
-    sound_expr_encode(self, SOUND_EXPR_WAVEFORM_OFFSET, SOUND_EXPR_WAVEFORM_LENGTH, args[ARG_waveform].u_int);
-    sound_expr_encode(self, SOUND_EXPR_FX_CHOICE_OFFSET, SOUND_EXPR_FX_CHOICE_LENGTH, args[ARG_fx].u_int);
-    sound_expr_encode(self, SOUND_EXPR_SHAPE_OFFSET, SOUND_EXPR_SHAPE_LENGTH, args[ARG_shape].u_int);
+    for (size_t i = 0; i < MP_ARRAY_SIZE(soundeffect_attr_table); ++i) {
+        soundeffect_attr_store(self, &soundeffect_attr_table[i], args[i].u_int);
+    }
 
     // Return new sound effect object
     return MP_OBJ_FROM_PTR(self);
@@ -286,17 +265,14 @@ STATIC void microbit_soundeffect_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
     }
     if (dest[0] == MP_OBJ_NULL) {
         // Load attribute.
-        unsigned int value = sound_expr_decode(self, soundeffect_attr->offset, soundeffect_attr->length);
-        dest[0] = MP_OBJ_NEW_SMALL_INT(value);
+        dest[0] = MP_OBJ_NEW_SMALL_INT(soundeffect_attr_load(self, soundeffect_attr));
     } else if (dest[1] != MP_OBJ_NULL) {
         // Store attribute.
         if (self->is_mutable) {
-            unsigned int value = mp_obj_get_int(dest[1]);
-            sound_expr_encode(self, soundeffect_attr->offset, soundeffect_attr->length, value);
-            if (soundeffect_attr->offset == SOUND_EXPR_FX_CHOICE_OFFSET) {
+            soundeffect_attr_store(self, soundeffect_attr, mp_obj_get_int(dest[1]));
+            if (soundeffect_attr->qst == MP_QSTR_fx) {
                 // Changing the fx choice, so also update the fx parameters for that choice.
-                sound_expr_encode(self, SOUND_EXPR_FX_PARAM_OFFSET, SOUND_EXPR_FX_PARAM_LENGTH, fx_default_param[value]);
-                sound_expr_encode(self, SOUND_EXPR_FX_STEPS_OFFSET, SOUND_EXPR_FX_STEPS_LENGTH, fx_default_steps[value]);
+                soundeffect_set_fx_defaults(self);
             }
             dest[0] = MP_OBJ_NULL; // Indicate store succeeded.
         }
@@ -308,14 +284,22 @@ STATIC mp_obj_t microbit_soundeffect_from_string(mp_obj_t str_in) {
     self->base.type = &microbit_soundeffect_type;
     self->is_mutable = true;
 
-    // Initialise the sound expression data with the preset values.
-    memset(&self->sound_expr[0], '0', SOUND_EXPR_TOTAL_LENGTH);
+    // Decode sound expression data, as used by CODAL, which is a sequence of zero-padded
+    // decimal numbers.  Missing parts of the data are taken to be all '0'.
     size_t len;
     const char *str = mp_obj_str_get_data(str_in, &len);
-    if (len > SOUND_EXPR_TOTAL_LENGTH) {
-        len = SOUND_EXPR_TOTAL_LENGTH;
-    }
-    memcpy(&self->sound_expr[0], str, len);
+    microbit_hal_sound_effect_t *fx = &self->fx;
+    fx->waveform = sound_expr_decode(str, len, 0, 1);
+    fx->vol_start = SOUND_EXPR_DECODE_VOLUME(sound_expr_decode(str, len, 1, 4));
+    fx->freq_start = sound_expr_decode(str, len, 5, 4);
+    fx->duration = sound_expr_decode(str, len, 9, 4);
+    fx->shape = sound_expr_decode(str, len, 13, 2);
+    fx->freq_end = sound_expr_decode(str, len, 18, 4);
+    fx->vol_end = SOUND_EXPR_DECODE_VOLUME(sound_expr_decode(str, len, 26, 4));
+    fx->steps = sound_expr_decode(str, len, 30, 4);
+    fx->fx = sound_expr_decode(str, len, 34, 2);
+    fx->fx_param = sound_expr_decode(str, len, 36, 4);
+    fx->fx_steps = sound_expr_decode(str, len, 40, 4);
 
     return MP_OBJ_FROM_PTR(self);
 }
@@ -327,7 +311,7 @@ STATIC mp_obj_t microbit_soundeffect_copy(mp_obj_t self_in) {
     microbit_soundeffect_obj_t *copy = m_new_obj(microbit_soundeffect_obj_t);
     copy->base.type = self->base.type;
     copy->is_mutable = true;
-    memcpy(&copy->sound_expr[0], &self->sound_expr[0], SOUND_EXPR_TOTAL_LENGTH);
+    copy->fx = self->fx;
 
     return MP_OBJ_FROM_PTR(copy);
 }
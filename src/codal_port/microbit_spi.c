@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "py/runtime.h"
+#include "py/mphal.h"
 #include "microbithal.h"
 #include "modmicrobit.h"
 
@@ -37,8 +38,111 @@ typedef struct _microbit_spi_obj_t {
     const microbit_pin_obj_t *miso;
 } microbit_spi_obj_t;
 
+// Queue of asynchronous transfers.  The transfer at the head is the one in progress; when
+// it completes the SPIM interrupt starts the next, so queued transfers run back-to-back.
+#define SPI_QUEUE_DEPTH (8)
+
+// How long soft reset lets queued transfers run before stopping the SPIM.
+#define SPI_DEINIT_TIMEOUT_MS (100)
+
+typedef struct _microbit_spi_transfer_t {
+    mp_obj_t write_obj;
+    mp_obj_t read_obj;
+    mp_obj_t callback;
+    const uint8_t *write_buf;
+    uint8_t *read_buf;
+    size_t len;
+} microbit_spi_transfer_t;
+
+typedef struct _microbit_spi_queue_t {
+    microbit_spi_transfer_t transfers[SPI_QUEUE_DEPTH];
+    volatile uint8_t head;
+    volatile uint8_t len;
+    volatile int error; // from a queued transfer that the interrupt couldn't start
+} microbit_spi_queue_t;
+
 STATIC bool microbit_spi_initialised = false;
 
+// Remove the transfer at the head of the queue, releasing its objects.
+STATIC void spi_queue_pop(microbit_spi_queue_t *queue) {
+    microbit_spi_transfer_t *t = &queue->transfers[queue->head];
+    t->write_obj = MP_OBJ_NULL;
+    t->read_obj = MP_OBJ_NULL;
+    t->callback = MP_OBJ_NULL;
+    queue->head = (queue->head + 1) % SPI_QUEUE_DEPTH;
+    --queue->len;
+}
+
+// Start the transfer at the head of the queue.  If it can't be started then no done
+// interrupt will come for it, so it's removed from the queue and the error returned.
+STATIC int spi_queue_start_head(microbit_spi_queue_t *queue) {
+    microbit_spi_transfer_t *t = &queue->transfers[queue->head];
+    int ret = microbit_hal_spi_transfer_start(t->len, t->write_buf, t->read_buf);
+    if (ret != 0) {
+        spi_queue_pop(queue);
+    }
+    return ret;
+}
+
+// Called from the SPIM interrupt when the transfer at the head of the queue is done.
+void microbit_hal_spi_transfer_done_callback(void) {
+    microbit_spi_queue_t *queue = MP_STATE_PORT(spi_queue);
+    if (queue == NULL || queue->len == 0) {
+        // The transfer was aborted by microbit_spi_deinit().
+        return;
+    }
+    microbit_spi_transfer_t *t = &queue->transfers[queue->head];
+    if (t->callback != mp_const_none) {
+        mp_sched_schedule(t->callback, t->read_obj != MP_OBJ_NULL ? t->read_obj : t->write_obj);
+    }
+    spi_queue_pop(queue);
+    while (queue->len > 0) {
+        int ret = spi_queue_start_head(queue);
+        if (ret == 0) {
+            break;
+        }
+        // The transfer is dropped without its callback, and the error raised by the next wait.
+        queue->error = ret;
+    }
+}
+
+STATIC size_t spi_queue_pending(void) {
+    microbit_spi_queue_t *queue = MP_STATE_PORT(spi_queue);
+    return queue == NULL ? 0 : queue->len;
+}
+
+// Wait until at most max_pending asynchronous transfers are outstanding.  Raises OSError
+// if a queued transfer failed to start since the last wait.
+STATIC void spi_queue_wait(size_t max_pending) {
+    while (spi_queue_pending() > max_pending) {
+        mp_handle_pending(true);
+        microbit_hal_idle();
+    }
+    microbit_spi_queue_t *queue = MP_STATE_PORT(spi_queue);
+    if (queue != NULL && queue->error != 0) {
+        int ret = queue->error;
+        queue->error = 0;
+        mp_raise_OSError(ret);
+    }
+}
+
+// Give queued transfers a short time to finish, then stop the SPIM so that it doesn't
+// write into heap buffers after they are freed.
+void microbit_spi_deinit(void) {
+    uint32_t start = mp_hal_ticks_ms();
+    while (spi_queue_pending() > 0) {
+        if (mp_hal_ticks_ms() - start >= SPI_DEINIT_TIMEOUT_MS) {
+            uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+            microbit_hal_spi_transfer_abort();
+            MP_STATE_PORT(spi_queue)->len = 0;
+            MICROPY_END_ATOMIC_SECTION(atomic_state);
+            break;
+        }
+        microbit_hal_idle();
+    }
+    MP_STATE_PORT(spi_queue) = NULL;
+}
+
 STATIC void microbit_spi_check_initialised(void) {
     if (!microbit_spi_initialised) {
         mp_raise_ValueError(MP_ERROR_TEXT("SPI not initialised"));
@@ -74,6 +178,9 @@ STATIC mp_obj_t microbit_spi_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp
         miso = microbit_obj_get_pin(args[ARG_miso].u_obj);
     }
 
+    // Let any queued transfers complete with the old settings.
+    spi_queue_wait(0);
+
     // Acquire new pins and free the previous ones.
     microbit_obj_pin_acquire_and_free(&microbit_spi_obj.sclk, sclk, microbit_pin_mode_spi);
     microbit_obj_pin_acquire_and_free(&microbit_spi_obj.mosi, mosi, microbit_pin_mode_spi);
@@ -97,6 +204,7 @@ STATIC mp_obj_t microbit_spi_write(mp_obj_t self_in, mp_obj_t buf_in) {
     microbit_spi_check_initialised();
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    spi_queue_wait(0);
     microbit_hal_spi_transfer(bufinfo.len, bufinfo.buf, NULL);
     return mp_const_none;
 }
@@ -115,6 +223,7 @@ STATIC mp_obj_t microbit_spi_read(size_t n_args, const mp_obj_t *args) {
         byte_out = mp_obj_get_int(args[2]);
     }
     memset(vstr.buf, byte_out, vstr.len);
+    spi_queue_wait(0);
     int ret = microbit_hal_spi_transfer(vstr.len, (uint8_t *)vstr.buf, (uint8_t *)vstr.buf);
     if (ret != 0) {
         mp_raise_OSError(ret);
@@ -132,16 +241,112 @@ STATIC mp_obj_t microbit_spi_write_readinto(mp_obj_t self_in, mp_obj_t write_buf
     if (write_bufinfo.len != read_bufinfo.len) {
         mp_raise_ValueError(MP_ERROR_TEXT("write and read buffers must be the same length"));
     }
+    spi_queue_wait(0);
     microbit_hal_spi_transfer(write_bufinfo.len, write_bufinfo.buf, read_bufinfo.buf);
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_3(microbit_spi_write_readinto_obj, microbit_spi_write_readinto);
 
+// Queue a transfer, waiting for a free slot if the queue is full.  The buffers are kept
+// alive by the queue until the transfer is done, and then the callback (if any) is
+// scheduled with the read buffer, or the write buffer for a write-only transfer.
+STATIC void spi_queue_transfer(mp_obj_t write_obj, mp_obj_t read_obj, mp_obj_t callback) {
+    microbit_spi_check_initialised();
+    if (callback != mp_const_none && !mp_obj_is_callable(callback)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("callback must be callable"));
+    }
+    mp_buffer_info_t write_bufinfo;
+    mp_get_buffer_raise(write_obj, &write_bufinfo, MP_BUFFER_READ);
+    uint8_t *read_buf = NULL;
+    if (read_obj != MP_OBJ_NULL) {
+        mp_buffer_info_t read_bufinfo;
+        mp_get_buffer_raise(read_obj, &read_bufinfo, MP_BUFFER_WRITE);
+        if (write_bufinfo.len != read_bufinfo.len) {
+            mp_raise_ValueError(MP_ERROR_TEXT("write and read buffers must be the same length"));
+        }
+        read_buf = read_bufinfo.buf;
+    }
+    if (write_bufinfo.len == 0) {
+        return;
+    }
+    if (write_bufinfo.len > 0xffff) {
+        // The SPIM's EasyDMA counters are 16 bits.
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too long"));
+    }
+
+    if (MP_STATE_PORT(spi_queue) == NULL) {
+        MP_STATE_PORT(spi_queue) = m_new0(microbit_spi_queue_t, 1);
+    }
+    spi_queue_wait(SPI_QUEUE_DEPTH - 1);
+
+    microbit_spi_queue_t *queue = MP_STATE_PORT(spi_queue);
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    microbit_spi_transfer_t *t = &queue->transfers[(queue->head + queue->len) % SPI_QUEUE_DEPTH];
+    t->write_obj = write_obj;
+    t->read_obj = read_obj;
+    t->callback = callback;
+    t->write_buf = write_bufinfo.buf;
+    t->read_buf = read_buf;
+    t->len = write_bufinfo.len;
+    int ret = 0;
+    if (queue->len++ == 0) {
+        ret = spi_queue_start_head(queue);
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    if (ret != 0) {
+        mp_raise_OSError(ret);
+    }
+}
+
+STATIC mp_obj_t microbit_spi_write_async(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    spi_queue_transfer(args[ARG_buf].u_obj, MP_OBJ_NULL, args[ARG_callback].u_obj);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(microbit_spi_write_async_obj, 1, microbit_spi_write_async);
+
+STATIC mp_obj_t microbit_spi_write_readinto_async(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_write_buf, ARG_read_buf, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_write_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_read_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    spi_queue_transfer(args[ARG_write_buf].u_obj, args[ARG_read_buf].u_obj, args[ARG_callback].u_obj);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(microbit_spi_write_readinto_async_obj, 1, microbit_spi_write_readinto_async);
+
+STATIC mp_obj_t microbit_spi_pending(mp_obj_t self_in) {
+    (void)self_in;
+    return MP_OBJ_NEW_SMALL_INT(spi_queue_pending());
+}
+MP_DEFINE_CONST_FUN_OBJ_1(microbit_spi_pending_obj, microbit_spi_pending);
+
+STATIC mp_obj_t microbit_spi_wait(mp_obj_t self_in) {
+    (void)self_in;
+    spi_queue_wait(0);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(microbit_spi_wait_obj, microbit_spi_wait);
+
 STATIC const mp_rom_map_elem_t microbit_spi_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&microbit_spi_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&microbit_spi_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&microbit_spi_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_write_readinto), MP_ROM_PTR(&microbit_spi_write_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_async), MP_ROM_PTR(&microbit_spi_write_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_readinto_async), MP_ROM_PTR(&microbit_spi_write_readinto_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pending), MP_ROM_PTR(&microbit_spi_pending_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&microbit_spi_wait_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_spi_locals_dict, microbit_spi_locals_dict_table);
 
@@ -158,3 +363,5 @@ microbit_spi_obj_t microbit_spi_obj = {
     .mosi = &microbit_p15_obj,
     .miso = &microbit_p14_obj,
 };
+
+MP_REGISTER_ROOT_POINTER(struct _microbit_spi_queue_t *spi_queue);
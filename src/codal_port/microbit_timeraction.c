@@ -0,0 +1,199 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "drv_radio.h"
+#include "modfilter.h"
+#include "modmicrobit.h"
+
+// A timer action is a fixed piece of I/O that microbit.run_every() can run directly
+// from the soft timer handler, with no Python code and no scheduled callback, so it
+// keeps time however busy the interpreter is.
+
+enum {
+    TIMER_ACTION_TOGGLE,
+    TIMER_ACTION_READ_ANALOG,
+    TIMER_ACTION_RADIO_SEND,
+};
+
+typedef struct _microbit_timer_action_obj_t {
+    mp_obj_base_t base;
+    uint8_t kind;
+    uint8_t pin;
+    uint8_t value; // current output level, for TIMER_ACTION_TOGGLE
+    volatile bool active;
+    volatile uint32_t count;
+    mp_obj_t data; // ring buffer to sample into, or packet to send
+    mp_obj_t filter; // filter object that samples pass through, or MP_OBJ_NULL
+} microbit_timer_action_obj_t;
+
+STATIC microbit_timer_action_obj_t *timer_action_new(uint8_t kind, uint8_t pin, mp_obj_t data) {
+    microbit_timer_action_obj_t *self = m_new_obj(microbit_timer_action_obj_t);
+    self->base.type = &microbit_timer_action_type;
+    self->kind = kind;
+    self->pin = pin;
+    self->value = 0;
+    self->active = true;
+    self->count = 0;
+    self->data = data;
+    self->filter = MP_OBJ_NULL;
+    return self;
+}
+
+// Runs at the priority of the soft timer handler, so must not allocate or raise.
+// Returns false if the action has been stopped, and should not run again.
+bool microbit_timer_action_run(mp_obj_t self_in) {
+    microbit_timer_action_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!self->active) {
+        return false;
+    }
+    switch (self->kind) {
+        case TIMER_ACTION_TOGGLE:
+            self->value ^= 1;
+            microbit_hal_pin_write(self->pin, self->value);
+            break;
+        case TIMER_ACTION_READ_ANALOG: {
+            // Look the buffer up each time because a bytearray may be resized.
+            mp_buffer_info_t bufinfo;
+            if (!mp_get_buffer(self->data, &bufinfo, MP_BUFFER_WRITE) || bufinfo.len == 0) {
+                return true;
+            }
+            int32_t value = microbit_hal_pin_read_analog_u10(self->pin);
+            #if MICROPY_PY_FILTER
+            if (self->filter != MP_OBJ_NULL) {
+                value = MIN(MAX(filter_obj_update(self->filter, value), 0), 1023);
+            }
+            #endif
+            if (bufinfo.typecode == 'H' || bufinfo.typecode == 'h') {
+                size_t n = bufinfo.len / sizeof(uint16_t);
+                ((uint16_t *)bufinfo.buf)[self->count % n] = value;
+            } else {
+                ((uint8_t *)bufinfo.buf)[self->count % bufinfo.len] = value >> 2;
+            }
+            break;
+        }
+        default: {
+            // TIMER_ACTION_RADIO_SEND: a packet is dropped if the radio is off or busy.
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer(self->data, &bufinfo, MP_BUFFER_READ);
+            if (MP_STATE_PORT(radio_buf) == NULL
+                || !microbit_radio_send_async(bufinfo.buf, bufinfo.len, NULL, 0)) {
+                return true;
+            }
+            break;
+        }
+    }
+    ++self->count;
+    return true;
+}
+
+STATIC mp_obj_t microbit_timer_action_toggle(mp_obj_t pin_in) {
+    const microbit_pin_obj_t *pin = microbit_obj_get_pin(pin_in);
+    microbit_obj_pin_acquire(pin, microbit_pin_mode_write_digital);
+    microbit_hal_pin_write(pin->name, 0);
+    return MP_OBJ_FROM_PTR(timer_action_new(TIMER_ACTION_TOGGLE, pin->name, MP_OBJ_NULL));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_timer_action_toggle_obj, microbit_timer_action_toggle);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(microbit_timer_action_toggle_staticmethod_obj, MP_ROM_PTR(&microbit_timer_action_toggle_obj));
+
+// With filter=, each reading is passed through a filter module object before it is
+// stored, so smoothing runs in the soft timer handler too.
+STATIC mp_obj_t microbit_timer_action_read_analog(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_pin, ARG_buf, ARG_filter };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_pin, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_filter, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    const microbit_pin_obj_t *pin = microbit_obj_get_pin(args[ARG_pin].u_obj);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    mp_obj_t filter = args[ARG_filter].u_obj;
+    if (filter != mp_const_none) {
+        #if MICROPY_PY_FILTER
+        if (!filter_obj_is_filter(filter))
+        #endif
+        {
+            mp_raise_TypeError(MP_ERROR_TEXT("expecting a filter"));
+        }
+    }
+    microbit_obj_pin_acquire(pin, microbit_pin_mode_unused);
+    microbit_timer_action_obj_t *self = timer_action_new(TIMER_ACTION_READ_ANALOG, pin->name, args[ARG_buf].u_obj);
+    if (filter != mp_const_none) {
+        self->filter = filter;
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(microbit_timer_action_read_analog_obj, 2, microbit_timer_action_read_analog);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(microbit_timer_action_read_analog_staticmethod_obj, MP_ROM_PTR(&microbit_timer_action_read_analog_obj));
+
+STATIC mp_obj_t microbit_timer_action_radio_send(mp_obj_t data_in) {
+    // Take a copy of the packet, so it can't change while it is being sent.
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+    mp_obj_t data = mp_obj_new_bytes(bufinfo.buf, bufinfo.len);
+    return MP_OBJ_FROM_PTR(timer_action_new(TIMER_ACTION_RADIO_SEND, 0, data));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_timer_action_radio_send_obj, microbit_timer_action_radio_send);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(microbit_timer_action_radio_send_staticmethod_obj, MP_ROM_PTR(&microbit_timer_action_radio_send_obj));
+
+STATIC mp_obj_t microbit_timer_action_stop(mp_obj_t self_in) {
+    microbit_timer_action_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    self->active = false;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_timer_action_stop_obj, microbit_timer_action_stop);
+
+// The number of times the action has run, which for read_analog() is also the number
+// of samples taken.  The next sample goes at index count % len(buf).
+STATIC mp_obj_t microbit_timer_action_count(mp_obj_t self_in) {
+    microbit_timer_action_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_int_from_uint(self->count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_timer_action_count_obj, microbit_timer_action_count);
+
+STATIC const mp_rom_map_elem_t microbit_timer_action_locals_dict_table[] = {
+    // Static methods.
+    { MP_ROM_QSTR(MP_QSTR_toggle), MP_ROM_PTR(&microbit_timer_action_toggle_staticmethod_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_analog), MP_ROM_PTR(&microbit_timer_action_read_analog_staticmethod_obj) },
+    { MP_ROM_QSTR(MP_QSTR_radio_send), MP_ROM_PTR(&microbit_timer_action_radio_send_staticmethod_obj) },
+
+    // Instance methods.
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&microbit_timer_action_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_count), MP_ROM_PTR(&microbit_timer_action_count_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(microbit_timer_action_locals_dict, microbit_timer_action_locals_dict_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    microbit_timer_action_type,
+    MP_QSTR_TimerAction,
+    MP_TYPE_FLAG_NONE,
+    locals_dict, &microbit_timer_action_locals_dict
+    );
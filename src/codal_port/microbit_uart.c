@@ -41,8 +41,16 @@ typedef struct _microbit_uart_obj_t {
 // timeout (in ms) to wait between characters when reading
 STATIC uint16_t microbit_uart_timeout_char = 0;
 
+// Largest receive ring that can be requested with the rxbuf argument.
+#define MICROBIT_UART_RXBUF_MAX (16384)
+
+void microbit_uart_deinit(void) {
+    microbit_hal_serial_set_rx_ring(NULL, 0);
+    MP_STATE_PORT(uart_rx_ring) = NULL;
+}
+
 STATIC mp_obj_t microbit_uart_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_baudrate, ARG_bits, ARG_parity, ARG_stop, ARG_pins, ARG_tx, ARG_rx };
+    enum { ARG_baudrate, ARG_bits, ARG_parity, ARG_stop, ARG_pins, ARG_tx, ARG_rx, ARG_rxbuf };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_baudrate, MP_ARG_INT, {.u_int = 9600} },
         { MP_QSTR_bits,     MP_ARG_INT, {.u_int = 8} },
@@ -51,6 +59,7 @@ STATIC mp_obj_t microbit_uart_init(mp_uint_t n_args, const mp_obj_t *pos_args, m
         { MP_QSTR_pins,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
         { MP_QSTR_tx,       MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
         { MP_QSTR_rx,       MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_rxbuf,    MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
     };
 
     // Parse arguments.
@@ -82,6 +91,19 @@ STATIC mp_obj_t microbit_uart_init(mp_uint_t n_args, const mp_obj_t *pos_args, m
         rx = microbit_obj_get_pin(pins[1])->name;
     }
 
+    mp_int_t rxbuf = args[ARG_rxbuf].u_int;
+    if (rxbuf < 0 || rxbuf > MICROBIT_UART_RXBUF_MAX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid rxbuf"));
+    }
+
+    // Set up the receive ring, or go back to the built-in one if rxbuf is 0.
+    microbit_uart_deinit();
+    if (rxbuf > 0) {
+        MP_STATE_PORT(uart_rx_ring) = m_new(uint8_t, rxbuf);
+        microbit_hal_serial_set_rx_ring(MP_STATE_PORT(uart_rx_ring), rxbuf);
+    }
+    microbit_hal_serial_get_rx_overflow(true);
+
     // Initialise the uart.
     microbit_hal_uart_init(tx, rx, args[ARG_baudrate].u_int,
         args[ARG_bits].u_int, parity, args[ARG_stop].u_int);
@@ -103,9 +125,16 @@ STATIC mp_obj_t microbit_uart_any(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(microbit_uart_any_obj, microbit_uart_any);
 
+STATIC mp_obj_t microbit_uart_overflows(mp_obj_t self_in) {
+    (void)self_in;
+    return mp_obj_new_int_from_uint(microbit_hal_serial_get_rx_overflow(false));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(microbit_uart_overflows_obj, microbit_uart_overflows);
+
 STATIC const mp_rom_map_elem_t microbit_uart_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&microbit_uart_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&microbit_uart_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_overflows), MP_ROM_PTR(&microbit_uart_overflows_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
@@ -148,11 +177,13 @@ STATIC mp_uint_t microbit_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t si
         return MP_STREAM_ERROR;
     }
 
-    // read the data
+    // read the data, copying out everything already received in one go
     byte *orig_buf = buf;
     for (;;) {
-        *buf++ = mp_hal_stdin_rx_chr();
-        if (--size == 0 || !microbit_uart_rx_wait(microbit_uart_timeout_char)) {
+        size_t n = microbit_hal_serial_read(buf, size);
+        buf += n;
+        size -= n;
+        if (size == 0 || !microbit_uart_rx_wait(microbit_uart_timeout_char)) {
             // return number of bytes read
             return buf - orig_buf;
         }
@@ -184,3 +215,5 @@ STATIC MP_DEFINE_CONST_OBJ_TYPE(
 const microbit_uart_obj_t microbit_uart_obj = {
     { &microbit_uart_type },
 };
+
+MP_REGISTER_ROOT_POINTER(uint8_t *uart_rx_ring);
@@ -28,17 +28,31 @@
 // This is a copy of the file micropython:ports/nrf/modules/os/microbitfs.c with:
 // - a call to `microbit_file_opened_for_writing` added in `microbit_file_open`
 // - a fix to `find_chunk_and_erase` to sweep the filesystem if any free chunks are found
-
+// - the microbit_file_reader_t API, for reading files directly from flash outside the heap
+// - an in-RAM index of file names, and seek/tell on files opened for reading
+// - a write-behind buffer so each chunk is programmed with a single write, and os.preallocate
+// - filesystem_sweep split into steps, so it can run a page at a time in the background,
+//   with its progress tagged in flash so that a sweep cut short by a reset is resumed
+// - options for 16-bit chunk numbers and chunks bigger than 256 bytes
+// - append mode, which only has to rewrite the first chunk of the file, and an in-RAM
+//   record of the last chunk of each file and how much of it has been written
+// - an in-RAM map of erased chunks and freed chunks per page, and page erase counts
+
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/stat.h>
 
 #include "modules/os/microbitfs.h"
+#include "microbitfs_ext.h"
+#include "drv_alloc.h"
 #include "drivers/flash.h"
 #include "drivers/rng.h"
 #include "py/obj.h"
 #include "py/stream.h"
 #include "py/runtime.h"
+#include "py/mphal.h"
+#include "shared/readline/readline.h"
 #include "extmod/vfs.h"
 
 #if MICROPY_MBFS
@@ -54,90 +68,205 @@
  * The File System consists of up to MAX_CHUNKS_IN_FILE_SYSTEM chunks of CHUNK_SIZE each,
  * plus one spare page which holds persistent configuration data and is used. for bulk erasing.
  * The spare page is either the first or the last page and will be switched by a bulk erase.
+ * It is found by the persistent data marker, or by the tag left on it by the last sweep.
  * The exact number of chunks will depend on the amount of flash available.
  *
  * Each chunk consists of a one byte marker and a one byte tail
  * The marker shows whether this chunk is the start of a file, the midst of a file
  * (in which case it refers to the previous chunk in the file) or whether it is UNUSED
  * (and erased) or FREED (which means it is unused, but not erased).
- * Chunks are selected in a randomised round-robin fashion to even out wear on the flash
- * memory as much as possible.
+ * Chunks are selected in a round-robin fashion, from a random start, to even out wear on
+ * the flash memory as much as possible.  Erased chunks are found through a bitmap in RAM,
+ * and when a page has to be erased the least worn page that is entirely freed is chosen.
  * A file consists of a linked list of chunks. The first chunk in a file contains its name
  * as well as the end chunk and offset.
- * Files are found by linear search of the chunks, this means that no meta-data needs to be stored
- * outside of the file, which prevents wear hot-spots. Since there are fewer than 250 chunks,
- * the search is fast enough.
+ * No meta-data is stored outside of the file, which prevents wear hot-spots.  Instead the
+ * start chunks of files are found by a scan at startup and indexed in RAM by a hash of their
+ * name, so finding a file does not need a search.
  *
  * Chunks are numbered from 1 as we need to reserve 0 as the FREED marker.
  *
  * Writing to files relies on the persistent API which is high-level wrapper on top of the Nordic SDK.
  */
 
+// Chunks are linked by 8-bit numbers by default, or 16-bit numbers with
+// MICROPY_MBFS_CHUNK_INDEX_16BIT, which allows a much bigger filesystem.  Offsets within
+// a chunk are 8-bit unless MBFS_LOG_CHUNK_SIZE makes chunks bigger than 256 bytes.
+// Changing either of these changes the format of the filesystem in flash.
+#ifndef MICROPY_MBFS_CHUNK_INDEX_16BIT
+#define MICROPY_MBFS_CHUNK_INDEX_16BIT (0)
+#endif
+
+#if MICROPY_MBFS_CHUNK_INDEX_16BIT
+typedef uint16_t chunk_index_t;
+#else
+typedef uint8_t chunk_index_t;
+#endif
+
+#if MBFS_LOG_CHUNK_SIZE > 8
+#if !MICROPY_MBFS_CHUNK_INDEX_16BIT
+// The 16-bit offset in the file header would not be aligned after an 8-bit marker.
+#error "chunks bigger than 256 bytes need MICROPY_MBFS_CHUNK_INDEX_16BIT"
+#endif
+typedef uint16_t chunk_offset_t;
+#else
+typedef uint8_t chunk_offset_t;
+#endif
+
 #define CHUNK_SIZE (1<<MBFS_LOG_CHUNK_SIZE)
-#define DATA_PER_CHUNK (CHUNK_SIZE-2)
+#define DATA_PER_CHUNK (CHUNK_SIZE-2*sizeof(chunk_index_t))
 
-#define UNUSED_CHUNK 255
+#define UNUSED_CHUNK ((chunk_index_t)-1)
 #define FREED_CHUNK  0
-#define FILE_START 254
-#define PERSISTENT_DATA_MARKER 253
+#define FILE_START ((chunk_index_t)-2)
+#define PERSISTENT_DATA_MARKER ((chunk_index_t)-3)
+
+#define UNUSED_OFFSET ((chunk_offset_t)-1)
 
 /** Must be such that sizeof(file_header) < DATA_PER_CHUNK */
 #define MAX_FILENAME_LENGTH 120
 
-#define FILE_NOT_FOUND ((uint8_t)-1)
+#define FILE_NOT_FOUND UNUSED_CHUNK
 
 /** Maximum number of chunks allowed in filesystem. 252 chunks is 31.5kB */
+#ifndef MAX_CHUNKS_IN_FILE_SYSTEM
+#if MICROPY_MBFS_CHUNK_INDEX_16BIT
+#define MAX_CHUNKS_IN_FILE_SYSTEM 2048
+#else
 #define MAX_CHUNKS_IN_FILE_SYSTEM 252
+#endif
+#endif
 
 #define STATIC_ASSERT(e) extern char static_assert_failed[(e) ? 1 : -1]
 
 typedef struct _file_descriptor_obj {
     mp_obj_base_t base;
-    uint8_t start_chunk;
-    uint8_t seek_chunk;
-    uint8_t seek_offset;
+    chunk_index_t start_chunk;
+    chunk_index_t seek_chunk;
+    chunk_offset_t seek_offset;
     bool writable;
     bool open;
     bool binary;
+    chunk_index_t chain_len;
+    chunk_index_t *chain; // all chunks of the file in order, built by the first seek
+    chunk_offset_t write_len;
+    uint8_t *write_buf; // data not yet written to the current chunk, for writable files
 } file_descriptor_obj;
 
 typedef struct _file_header {
-    uint8_t end_offset;
+    chunk_offset_t end_offset;
     uint8_t name_len;
     char filename[MAX_FILENAME_LENGTH];
 } file_header;
 
+// Length of the header before the file name, ie the offset of the name in the first chunk.
+#define FILE_HEADER_LEN (offsetof(file_header, filename))
+
 typedef struct _file_chunk {
-    uint8_t marker;
+    chunk_index_t marker;
     union {
         char data[DATA_PER_CHUNK];
         file_header header;
     };
-    uint8_t next_chunk;
+    chunk_index_t next_chunk;
 } file_chunk;
 
 typedef struct _persistent_config_t {
     // Must start with a marker, so that we can identify it.
-    uint8_t marker; // Should always be PERSISTENT_DATA_MARKER
+    chunk_index_t marker; // Should always be PERSISTENT_DATA_MARKER
 } persistent_config_t;
 
 extern const mp_obj_type_t os_mbfs_fileio_type;
 extern const mp_obj_type_t os_mbfs_textio_type;
 
 // Page indexes count down from the end of ROM.
-STATIC uint8_t first_page_index;
-STATIC uint8_t last_page_index;
+STATIC uint16_t first_page_index;
+STATIC uint16_t last_page_index;
 // The number of usable chunks in the file system.
-STATIC uint8_t chunks_in_file_system;
-// Index of chunk to start searches. This is randomised to even out wear.
-STATIC uint8_t start_index;
+STATIC chunk_index_t chunks_in_file_system;
+// Index of chunk to start searches. This is randomised at startup and then advanced past
+// each chunk taken, to even out wear.
+STATIC chunk_index_t start_index;
 STATIC file_chunk *file_system_chunks;
 
+#define CHUNKS_PER_PAGE (FLASH_PAGESIZE>>MBFS_LOG_CHUNK_SIZE)
+
+// Only start a background sweep when fewer than this many chunks are left erased.
+#define BACKGROUND_SWEEP_UNUSED_CHUNKS (CHUNKS_PER_PAGE)
+
+// State of an incremental sweep.  While a sweep is in progress the pages that have been
+// moved already are found through sweep_chunks, and the rest are still at file_system_chunks.
+// Chunk numbers don't change, so files can be used as normal during the sweep.
+STATIC file_chunk *sweep_chunks;
+STATIC uint8_t sweep_pages_done;
+STATIC bool sweep_upwards;
+// Set when chunks are allocated or freed, to recheck whether a background sweep is needed.
+STATIC bool sweep_check_needed;
+
+// Index of files by hash of their name, so they can be found without searching the
+// chunks.  Each bucket is a linked list of start chunks, through file_index_next.
+// The index only ever points at FILE_START chunks, but a match is always checked against
+// the name in flash, so a stale or colliding entry can't return the wrong file.
+#if MICROPY_MBFS_CHUNK_INDEX_16BIT
+#define FILE_INDEX_NUM_BUCKETS (256)
+#else
+#define FILE_INDEX_NUM_BUCKETS (64)
+#endif
+STATIC chunk_index_t file_index_bucket[FILE_INDEX_NUM_BUCKETS];
+STATIC chunk_index_t file_index_next[MAX_CHUNKS_IN_FILE_SYSTEM + 1];
+
+// The last chunk of each file, and how far into it data has been programmed, indexed by
+// the file's start chunk, so appending doesn't have to walk the file or guess where the
+// data ends.  For a closed file the length is its end offset.  For a file that is still
+// open for writing it's only known in RAM, so it's kept over a soft reset, and is
+// UNUSED_OFFSET for a file that was left open over a hard reset.  A tail of 0 means there
+// is no record for that start chunk.
+STATIC chunk_index_t file_index_tail[MAX_CHUNKS_IN_FILE_SYSTEM + 1];
+STATIC chunk_offset_t file_index_tail_len[MAX_CHUNKS_IN_FILE_SYSTEM + 1];
+
+// Map of UNUSED chunks, one bit per chunk number, and a count of FREED chunks in each page,
+// so finding a chunk to write or a page to erase does not need to look at every chunk.
+// Both are built from the markers in flash by microbit_filesystem_init().  During a sweep
+// some FREED chunks are already erased, which only makes the map pessimistic until the
+// sweep finishes and it is rebuilt.
+#define CHUNK_MAP_WORDS ((MAX_CHUNKS_IN_FILE_SYSTEM + 1 + 31) / 32)
+#define MAX_PAGES_IN_FILE_SYSTEM (MAX_CHUNKS_IN_FILE_SYSTEM / CHUNKS_PER_PAGE + 2)
+STATIC uint32_t chunk_unused_map[CHUNK_MAP_WORDS];
+STATIC chunk_index_t chunks_unused;
+STATIC chunk_index_t chunks_freed;
+STATIC uint8_t page_freed_count[MAX_PAGES_IN_FILE_SYSTEM];
+
+// Number of times each page of the filesystem area, including the spare page, has been
+// erased since power on.  Indexed by physical page, from the lowest address.
+STATIC uint16_t page_erase_count[MAX_PAGES_IN_FILE_SYSTEM];
+
 // Defined by the linker
 extern byte _fs_start[];
 extern byte _fs_end[];
 
 STATIC_ASSERT((sizeof(file_chunk) == CHUNK_SIZE));
+STATIC_ASSERT((sizeof(file_header) < DATA_PER_CHUNK));
+STATIC_ASSERT((MAX_CHUNKS_IN_FILE_SYSTEM < PERSISTENT_DATA_MARKER));
+
+STATIC inline void flash_write_index(uint32_t addr, chunk_index_t value) {
+    #if MICROPY_MBFS_CHUNK_INDEX_16BIT
+    flash_write_bytes(addr, (uint8_t*)&value, sizeof(value));
+    #else
+    flash_write_byte(addr, value);
+    #endif
+}
+
+STATIC inline file_chunk *file_chunk_at(chunk_index_t index) {
+    if (sweep_chunks != NULL) {
+        uint32_t page = (index - 1) / CHUNKS_PER_PAGE;
+        if (sweep_upwards
+            ? page < sweep_pages_done
+            : page >= chunks_in_file_system / CHUNKS_PER_PAGE - sweep_pages_done) {
+            return &sweep_chunks[index];
+        }
+    }
+    return &file_system_chunks[index];
+}
 
 // From micro:bit memory.h
 STATIC inline byte *rounddown(byte *addr, uint32_t align) {
@@ -173,27 +302,242 @@ STATIC void init_limits(void) {
     chunks_in_file_system = (end-start)>>MBFS_LOG_CHUNK_SIZE;
 }
 
+STATIC chunk_index_t *file_index_bucket_for_name(const char *name, size_t name_len) {
+    uint32_t hash = 5381;
+    for (size_t i = 0; i < name_len; ++i) {
+        hash = hash * 33 ^ (uint8_t)name[i];
+    }
+    return &file_index_bucket[hash & (FILE_INDEX_NUM_BUCKETS - 1)];
+}
+
+STATIC void file_index_insert(chunk_index_t index) {
+    const file_chunk *p = file_chunk_at(index);
+    chunk_index_t *bucket = file_index_bucket_for_name(&p->header.filename[0], p->header.name_len);
+    file_index_next[index] = *bucket;
+    *bucket = index;
+}
+
+STATIC void file_index_remove(chunk_index_t index) {
+    file_index_tail[index] = 0;
+    const file_chunk *p = file_chunk_at(index);
+    chunk_index_t *link = file_index_bucket_for_name(&p->header.filename[0], p->header.name_len);
+    while (*link != 0) {
+        if (*link == index) {
+            *link = file_index_next[index];
+            return;
+        }
+        link = &file_index_next[*link];
+    }
+}
+
+STATIC void file_index_set_tail(chunk_index_t start, chunk_index_t tail, chunk_offset_t len) {
+    file_index_tail[start] = tail;
+    file_index_tail_len[start] = len;
+}
+
+// Each chunk is in one file, so finding the tails walks each chunk at most once.
+STATIC void file_index_build(void) {
+    memset(file_index_bucket, 0, sizeof(file_index_bucket));
+    for (chunk_index_t index = 1; index <= chunks_in_file_system; index++) {
+        const file_chunk *p = file_chunk_at(index);
+        if (p->marker != FILE_START) {
+            file_index_tail[index] = 0;
+            continue;
+        }
+        file_index_insert(index);
+        chunk_index_t tail = index;
+        while (file_chunk_at(tail)->next_chunk != UNUSED_CHUNK) {
+            tail = file_chunk_at(tail)->next_chunk;
+        }
+        if (p->header.end_offset != UNUSED_OFFSET) {
+            file_index_set_tail(index, tail, p->header.end_offset);
+        } else if (file_index_tail[index] != tail) {
+            file_index_set_tail(index, tail, UNUSED_OFFSET);
+        }
+    }
+}
+
 STATIC void randomise_start_index(void) {
     start_index = rng_generate_random_word() % chunks_in_file_system + 1;
 }
 
-void microbit_filesystem_init(void) {
-    init_limits();
-    randomise_start_index();
+STATIC void filesystem_sweep(void);
+
+STATIC inline void chunk_map_set(chunk_index_t index) {
+    chunk_unused_map[index / 32] |= 1u << (index % 32);
+}
+
+STATIC inline void chunk_map_clear(chunk_index_t index) {
+    chunk_unused_map[index / 32] &= ~(1u << (index % 32));
+}
+
+STATIC void chunk_map_build(void) {
+    memset(chunk_unused_map, 0, sizeof(chunk_unused_map));
+    memset(page_freed_count, 0, sizeof(page_freed_count));
+    chunks_unused = 0;
+    chunks_freed = 0;
+    for (chunk_index_t index = 1; index <= chunks_in_file_system; index++) {
+        chunk_index_t marker = file_chunk_at(index)->marker;
+        if (marker == UNUSED_CHUNK) {
+            chunk_map_set(index);
+            chunks_unused++;
+        } else if (marker == FREED_CHUNK) {
+            page_freed_count[(index - 1) / CHUNKS_PER_PAGE]++;
+            chunks_freed++;
+        }
+    }
+}
+
+// Find the first UNUSED chunk at or after start, wrapping around, a word of the map at a time.
+STATIC chunk_index_t chunk_map_find_unused(chunk_index_t start) {
+    if (chunks_unused == 0) {
+        return FILE_NOT_FOUND;
+    }
+    uint32_t num_words = chunks_in_file_system / 32 + 1;
+    uint32_t w = start / 32;
+    uint32_t bits = chunk_unused_map[w] & (~0u << (start % 32));
+    for (uint32_t i = 0; i <= num_words; i++) {
+        if (bits != 0) {
+            return w * 32 + __builtin_ctz(bits);
+        }
+        w = w + 1 == num_words ? 0 : w + 1;
+        bits = chunk_unused_map[w];
+    }
+    return FILE_NOT_FOUND;
+}
+
+// Record that a chunk has been marked FREED.
+STATIC void chunk_map_freed(chunk_index_t index) {
+    page_freed_count[(index - 1) / CHUNKS_PER_PAGE]++;
+    chunks_freed++;
+}
+
+STATIC inline uint32_t page_physical_index(uint32_t page) {
+    return ((uint32_t)file_chunk_at(page * CHUNKS_PER_PAGE + 1) - (uint32_t)first_page()) / FLASH_PAGESIZE;
+}
+
+STATIC void erase_page(void *addr) {
+    flash_page_erase((uint32_t)addr);
+    uint16_t *count = &page_erase_count[((uint32_t)addr - (uint32_t)first_page()) / FLASH_PAGESIZE];
+    if (*count < UINT16_MAX) {
+        ++*count;
+    }
+}
+
+// Erase a page of the filesystem made up entirely of FREED chunks.
+STATIC void erase_freed_page(uint32_t page) {
+    chunk_index_t first = page * CHUNKS_PER_PAGE + 1;
+    erase_page(file_chunk_at(first));
+    for (chunk_index_t index = first; index < first + CHUNKS_PER_PAGE; index++) {
+        chunk_map_set(index);
+    }
+    page_freed_count[page] = 0;
+    chunks_freed -= CHUNKS_PER_PAGE;
+    chunks_unused += CHUNKS_PER_PAGE;
+}
+
+// Each step of a sweep tags the page it has just copied from, which is then the spare page,
+// by zeroing the marker and next_chunk of the page's first chunk when sweeping upwards or
+// its last chunk when sweeping downwards.  No chunk in use ever has a next_chunk of 0, so
+// a tag can't be mistaken for file data, and the tag shows how far the sweep has got.
+STATIC file_chunk *sweep_tag_chunk(void *page, bool upwards) {
+    return &((file_chunk *)page)[upwards ? 0 : CHUNKS_PER_PAGE - 1];
+}
+
+STATIC bool page_has_sweep_tag(void *page, bool upwards) {
+    const file_chunk *p = sweep_tag_chunk(page, upwards);
+    return p->marker == FREED_CHUNK && p->next_chunk == FREED_CHUNK;
+}
+
+STATIC void page_set_sweep_tag(void *page, bool upwards) {
+    file_chunk *p = sweep_tag_chunk(page, upwards);
+    flash_write_index((uint32_t)&p->marker, FREED_CHUNK);
+    flash_write_index((uint32_t)&p->next_chunk, FREED_CHUNK);
+}
+
+// Set up the state of a sweep in the given direction, with pages_done pages already moved.
+STATIC void filesystem_sweep_setup(bool upwards, uint8_t pages_done) {
     file_chunk *base = first_page();
-    if (base->marker == PERSISTENT_DATA_MARKER) {
-        file_system_chunks = &base[(FLASH_PAGESIZE>>MBFS_LOG_CHUNK_SIZE)-1];
-    } else if (((file_chunk *)last_page())->marker == PERSISTENT_DATA_MARKER) {
-        file_system_chunks = &base[-1];
+    sweep_upwards = upwards;
+    sweep_pages_done = pages_done;
+    if (upwards) {
+        file_system_chunks = &base[CHUNKS_PER_PAGE-1];
+        sweep_chunks = &base[-1];
     } else {
-        flash_write_byte((uint32_t)&((file_chunk *)last_page())->marker, PERSISTENT_DATA_MARKER);
         file_system_chunks = &base[-1];
+        sweep_chunks = &base[CHUNKS_PER_PAGE-1];
     }
 }
 
+// Find the spare page, from the persistent data marker or a sweep's tag, and point
+// file_system_chunks at the pages either side of it.  Returns false if the tag shows that
+// a sweep was cut short by a hard reset, in which case the sweep is set up to carry on.
+STATIC bool filesystem_find_spare_page(void) {
+    file_chunk *base = first_page();
+    uint32_t num_pages = chunks_in_file_system / CHUNKS_PER_PAGE;
+    if (base->marker == PERSISTENT_DATA_MARKER) {
+        file_system_chunks = &base[CHUNKS_PER_PAGE-1];
+        return true;
+    }
+    if (((file_chunk *)last_page())->marker == PERSISTENT_DATA_MARKER) {
+        file_system_chunks = &base[-1];
+        return true;
+    }
+    for (uint32_t page = 0; page <= num_pages; page++) {
+        uint8_t *addr = (uint8_t *)first_page() + page * FLASH_PAGESIZE;
+        bool upwards = page_has_sweep_tag(addr, true);
+        bool downwards = page_has_sweep_tag(addr, false);
+        if (!upwards && !downwards) {
+            continue;
+        }
+        // A sweep ends with its tag on the page at the end it was moving towards, and the
+        // next sweep adds the other tag to that page as it starts, so only a tag for the
+        // direction away from an end page means a sweep is under way.
+        if (page == 0 && !upwards) {
+            file_system_chunks = &base[CHUNKS_PER_PAGE-1];
+            return true;
+        }
+        if (page == num_pages && !downwards) {
+            file_system_chunks = &base[-1];
+            return true;
+        }
+        upwards = page == 0 || !downwards;
+        filesystem_sweep_setup(upwards, upwards ? page : num_pages - page);
+        return false;
+    }
+    // A new filesystem.  This also happens if a reset comes while a sweep is erasing or
+    // copying into a page, before the page it copied from is tagged, and then the data in
+    // one page is lost.
+    if (((file_chunk *)last_page())->marker != UNUSED_CHUNK) {
+        erase_page(last_page());
+    }
+    flash_write_index((uint32_t)&((file_chunk *)last_page())->marker, PERSISTENT_DATA_MARKER);
+    file_system_chunks = &base[-1];
+    return true;
+}
+
+void microbit_filesystem_init(void) {
+    if (sweep_chunks != NULL) {
+        // Finish a background sweep that was interrupted by a soft reset.
+        filesystem_sweep();
+        return;
+    }
+    init_limits();
+    randomise_start_index();
+    if (!filesystem_find_spare_page()) {
+        // Finish a sweep that was interrupted by a hard reset.  The last step of the sweep
+        // initialises the filesystem again.
+        filesystem_sweep();
+        return;
+    }
+    file_index_build();
+    chunk_map_build();
+    sweep_check_needed = true;
+}
+
 STATIC void copy_page(void *dest, void *src) {
     DEBUG(("FILE DEBUG: Copying page from %lx to %lx.\r\n", (uint32_t)src, (uint32_t)dest));
-    flash_page_erase((uint32_t)dest);
+    erase_page(dest);
     file_chunk *src_chunk = src;
     file_chunk *dest_chunk = dest;
     uint32_t chunks = FLASH_PAGESIZE>>MBFS_LOG_CHUNK_SIZE;
@@ -209,48 +553,61 @@ STATIC void copy_page(void *dest, void *src) {
 // There should be no erased chunks before the sweep (or it would be unnecessary)
 // but if there are this should work correctly.
 //
-// The direction of the sweep depends on whether the persistent data is in the first or last page
-// The persistent data is copied to RAM, leaving its page unused.
-// Then all the pages are copied, one by one, into the adjacent newly unused page.
-// Finally, the persistent data is saved back to the opposite end of the filesystem from whence it came.
+// The direction of the sweep depends on whether the spare page is the first or last page.
+// The spare page is tagged for the sweep, then all the pages are copied, one by one, into
+// the adjacent newly unused page, which leaves the spare page at the opposite end.
 //
-STATIC void filesystem_sweep(void) {
-    persistent_config_t config;
-    uint8_t *page;
-    uint8_t *end_page;
-    int step;
-    uint32_t page_size = FLASH_PAGESIZE;
+// Each page is copied by a separate call to filesystem_sweep_step, so the sweep can be spread
+// out over time.  After each step the page copied from is tagged, so if a reset comes part
+// way through, microbit_filesystem_init finds the tag and finishes the sweep.  Only a reset
+// during a step, while a page is being erased and copied, loses data.
+//
+STATIC void filesystem_sweep_begin(void) {
     DEBUG(("FILE DEBUG: Sweeping file system\r\n"));
-    if (((file_chunk *)first_page())->marker == PERSISTENT_DATA_MARKER) {
-        config = *(persistent_config_t *)first_page();
-        page = first_page();
-        end_page = last_page();
-        step = page_size;
-    } else {
-        config = *(persistent_config_t *)last_page();
-        page = last_page();
-        end_page = first_page();
-        step = -page_size;
-    }
-    while (page != end_page) {
-        uint8_t *next_page = page+step;
-        flash_page_erase((uint32_t)page);
-        copy_page(page, next_page);
-        page = next_page;
-    }
-    flash_page_erase((uint32_t)end_page);
-    flash_write_bytes((uint32_t)end_page, (uint8_t*)&config, sizeof(config));
+    file_chunk *base = first_page();
+    bool upwards = file_system_chunks != &base[-1];
+    page_set_sweep_tag(upwards ? first_page() : last_page(), upwards);
+    filesystem_sweep_setup(upwards, 0);
+}
+
+// Move one page of the filesystem, or finish once all pages are moved.
+// Returns true when the sweep is complete.
+STATIC bool filesystem_sweep_step(void) {
+    uint32_t num_pages = chunks_in_file_system / CHUNKS_PER_PAGE;
+    int step = sweep_upwards ? FLASH_PAGESIZE : -FLASH_PAGESIZE;
+    uint8_t *start = sweep_upwards ? first_page() : last_page();
+    if (sweep_pages_done < num_pages) {
+        uint8_t *page = start + step * sweep_pages_done;
+        copy_page(page, page + step);
+        // Only now do the chunks of this page move to their new location.
+        sweep_pages_done++;
+        page_set_sweep_tag(page + step, sweep_upwards);
+        return false;
+    }
+    // The last page copied from, already tagged, is the new spare page.
+    file_system_chunks = sweep_chunks;
+    sweep_chunks = NULL;
     microbit_filesystem_init();
+    return true;
+}
+
+STATIC void filesystem_sweep(void) {
+    if (sweep_chunks == NULL) {
+        filesystem_sweep_begin();
+    }
+    while (!filesystem_sweep_step()) {
+    }
 }
 
 
 STATIC inline byte *seek_address(file_descriptor_obj *self) {
-    return (byte*)&(file_system_chunks[self->seek_chunk].data[self->seek_offset]);
+    return (byte*)&(file_chunk_at(self->seek_chunk)->data[self->seek_offset]);
 }
 
-STATIC uint8_t microbit_find_file(const char *name, int name_len) {
-    for (uint8_t index = 1; index <= chunks_in_file_system; index++) {
-        const file_chunk *p = &file_system_chunks[index];
+STATIC chunk_index_t microbit_find_file(const char *name, int name_len) {
+    chunk_index_t *bucket = file_index_bucket_for_name(name, name_len);
+    for (chunk_index_t index = *bucket; index != 0; index = file_index_next[index]) {
+        const file_chunk *p = file_chunk_at(index);
         if (p->marker != FILE_START)
             continue;
         if (p->header.name_len != name_len)
@@ -264,73 +621,78 @@ STATIC uint8_t microbit_find_file(const char *name, int name_len) {
     return FILE_NOT_FOUND;
 }
 
-// Return a free, erased chunk.
-// Search the chunks:
-// 1  If an UNUSED chunk is found, then return that.
-// 2. If an entire page of FREED chunks is found, then erase the page and return the first chunk
+// Make sure at least n chunks are erased, so that writing n chunks of data will not need
+// to erase or sweep.  Pages made up entirely of FREED chunks are erased first, and if that
+// is not enough the filesystem is swept, once.  Returns false if there is not enough space.
+STATIC bool ensure_unused_chunks(uint32_t n) {
+    for (uint32_t page = 0; page < chunks_in_file_system / CHUNKS_PER_PAGE && chunks_unused < n; page++) {
+        if (page_freed_count[page] == CHUNKS_PER_PAGE) {
+            erase_freed_page(page);
+        }
+    }
+    if (chunks_unused < n && chunks_freed > 0) {
+        filesystem_sweep();
+    }
+    return chunks_unused >= n;
+}
+
+// Return a free, erased chunk, and take it out of the map of erased chunks.
+// 1. If an UNUSED chunk is found in the map, then return that.
+// 2. If an entire page of FREED chunks is found, then erase the least worn one and return its first chunk.
 // 3. If the number of FREED chunks is > 0, then
 // 3a. Sweep the filesystem and restart.
 // 3b. Otherwise, fail and return FILE_NOT_FOUND.
 //
-STATIC uint8_t find_chunk_and_erase(void) {
-    // Start search at a random chunk to spread the wear more evenly.
-    // Search for unused chunk
-    uint8_t index = start_index;
-    do {
-        const file_chunk *p = &file_system_chunks[index];
-        if (p->marker == UNUSED_CHUNK) {
-            DEBUG(("FILE DEBUG: Unused chunk found: %d\r\n", index));
-            return index;
-        }
-        index++;
-        if (index == chunks_in_file_system+1) index = 1;
-    } while (index != start_index);
-
-    // Search for FREED page, and total up FREED chunks
-    uint32_t freed_chunks = 0;
-    index = start_index;
-    uint32_t chunks_per_page = FLASH_PAGESIZE>>MBFS_LOG_CHUNK_SIZE;
-    do {
-        const file_chunk *p = &file_system_chunks[index];
-        if (p->marker == FREED_CHUNK) {
-            freed_chunks++;
-        }
-        if (FLASH_IS_PAGE_ALIGNED(p)) {
-            uint32_t i;
-            for (i = 0; i < chunks_per_page; i++) {
-                if (p[i].marker != FREED_CHUNK)
-                    break;
+STATIC chunk_index_t find_chunk_and_erase(void) {
+    sweep_check_needed = true;
+    chunk_index_t index = chunk_map_find_unused(start_index);
+    if (index == FILE_NOT_FOUND) {
+        int best = -1;
+        for (uint32_t page = 0; page < chunks_in_file_system / CHUNKS_PER_PAGE; page++) {
+            if (page_freed_count[page] == CHUNKS_PER_PAGE
+                && (best < 0 || page_erase_count[page_physical_index(page)] < page_erase_count[page_physical_index(best)])) {
+                best = page;
             }
-            if (i == chunks_per_page) {
-                DEBUG(("FILE DEBUG: Found freed page of chunks: %d\r\n", index));
-                flash_page_erase((uint32_t)&file_system_chunks[index]);
-                return index;
+        }
+        if (best >= 0) {
+            DEBUG(("FILE DEBUG: Found freed page of chunks: %d\r\n", best));
+            erase_freed_page(best);
+            index = best * CHUNKS_PER_PAGE + 1;
+        } else {
+            DEBUG(("FILE DEBUG: %u free chunks\r\n", chunks_freed));
+            if (chunks_freed == 0) {
+                return FILE_NOT_FOUND;
             }
+            // No freed pages, so sweep file system.
+            filesystem_sweep();
+            // This is guaranteed to succeed.
+            return find_chunk_and_erase();
         }
-        index++;
-        if (index == chunks_in_file_system+1) index = 1;
-    } while (index != start_index);
-    DEBUG(("FILE DEBUG: %lu free chunks\r\n", freed_chunks));
-    if (freed_chunks == 0) {
-        return FILE_NOT_FOUND;
     }
-    // No freed pages, so sweep file system.
-    filesystem_sweep();
-    // This is guaranteed to succeed.
-    return find_chunk_and_erase();
+    DEBUG(("FILE DEBUG: Unused chunk found: %d\r\n", index));
+    chunk_map_clear(index);
+    --chunks_unused;
+    // Carry on from the next chunk, so allocation cycles through the whole filesystem.
+    start_index = index % chunks_in_file_system + 1;
+    return index;
 }
 
 STATIC mp_obj_t microbit_file_name(file_descriptor_obj *fd) {
-    return mp_obj_new_str(&(file_system_chunks[fd->start_chunk].header.filename[0]), file_system_chunks[fd->start_chunk].header.name_len);
+    return mp_obj_new_str(&(file_chunk_at(fd->start_chunk)->header.filename[0]), file_chunk_at(fd->start_chunk)->header.name_len);
 }
 
-STATIC file_descriptor_obj *microbit_file_descriptor_new(uint8_t start_chunk, bool write, bool binary);
+STATIC file_descriptor_obj *microbit_file_descriptor_new(chunk_index_t start_chunk, bool write, bool binary);
+STATIC int advance(file_descriptor_obj *self, uint32_t n, bool write);
+STATIC mp_uint_t microbit_file_write(mp_obj_t obj, const void *buf, mp_uint_t size, int *errcode);
 
-STATIC void clear_file(uint8_t chunk) {
+STATIC void clear_file(chunk_index_t chunk) {
+    file_index_remove(chunk);
+    sweep_check_needed = true;
     do {
-        flash_write_byte((uint32_t)&(file_system_chunks[chunk].marker), FREED_CHUNK);
+        flash_write_index((uint32_t)&(file_chunk_at(chunk)->marker), FREED_CHUNK);
+        chunk_map_freed(chunk);
         DEBUG(("FILE DEBUG: Freeing chunk %d.\n", chunk));
-        chunk = file_system_chunks[chunk].next_chunk;
+        chunk = file_chunk_at(chunk)->next_chunk;
     } while (chunk <= chunks_in_file_system);
 }
 
@@ -338,7 +700,7 @@ STATIC file_descriptor_obj *microbit_file_open(const char *name, size_t name_len
     if (name_len > MAX_FILENAME_LENGTH) {
         return NULL;
     }
-    uint8_t index = microbit_find_file(name, name_len);
+    chunk_index_t index = microbit_find_file(name, name_len);
     if (write) {
         if (index != FILE_NOT_FOUND) {
             // Free old file
@@ -348,9 +710,11 @@ STATIC file_descriptor_obj *microbit_file_open(const char *name, size_t name_len
         if (index == FILE_NOT_FOUND) {
             mp_raise_OSError(MP_ENOSPC);
         }
-        flash_write_byte((uint32_t)&(file_system_chunks[index].marker), FILE_START);
-        flash_write_byte((uint32_t)&(file_system_chunks[index].header.name_len), name_len);
-        flash_write_bytes((uint32_t)&(file_system_chunks[index].header.filename[0]), (uint8_t*)name, name_len);
+        flash_write_index((uint32_t)&(file_chunk_at(index)->marker), FILE_START);
+        flash_write_byte((uint32_t)&(file_chunk_at(index)->header.name_len), name_len);
+        flash_write_bytes((uint32_t)&(file_chunk_at(index)->header.filename[0]), (uint8_t*)name, name_len);
+        file_index_insert(index);
+        file_index_set_tail(index, index, FILE_HEADER_LEN + name_len);
         microbit_file_opened_for_writing(name, name_len);
     } else {
         if (index == FILE_NOT_FOUND) {
@@ -360,14 +724,114 @@ STATIC file_descriptor_obj *microbit_file_open(const char *name, size_t name_len
     return microbit_file_descriptor_new(index, write, binary);
 }
 
-STATIC file_descriptor_obj *microbit_file_descriptor_new(uint8_t start_chunk, bool write, bool binary) {
+// Copy what can be read of a file that was left open for writing over a hard reset into a
+// new file of the same name, and return the new file open for writing at its end.  How
+// much of the old file's last chunk was written is not recorded in flash, so readers skip
+// that chunk, and so does the copy.  The old file is only removed once the copy is made.
+STATIC file_descriptor_obj *microbit_file_copy_readable(chunk_index_t old_start, const char *name, size_t name_len, bool binary) {
+    chunk_index_t index = find_chunk_and_erase();
+    if (index == FILE_NOT_FOUND) {
+        mp_raise_OSError(MP_ENOSPC);
+    }
+    flash_write_index((uint32_t)&(file_chunk_at(index)->marker), FILE_START);
+    flash_write_byte((uint32_t)&(file_chunk_at(index)->header.name_len), name_len);
+    flash_write_bytes((uint32_t)&(file_chunk_at(index)->header.filename[0]), (uint8_t*)name, name_len);
+    file_index_set_tail(index, index, FILE_HEADER_LEN + name_len);
+    file_descriptor_obj *fd = microbit_file_descriptor_new(index, true, binary);
+    microbit_file_reader_t reader = {
+        .start_chunk = old_start,
+        .seek_chunk = old_start,
+        .seek_offset = name_len + FILE_HEADER_LEN,
+    };
+    uint8_t buf[32];
+    size_t n;
+    // The data is copied out of flash first, because writing may sweep the filesystem.
+    while ((n = microbit_file_reader_read(&reader, buf, sizeof(buf))) != 0) {
+        int err;
+        if (microbit_file_write(fd, buf, n, &err) == MP_STREAM_ERROR) {
+            mp_raise_OSError(err);
+        }
+    }
+    clear_file(old_start);
+    // A sweep while copying rebuilds the index, which would have found the new file already.
+    file_index_remove(index);
+    file_index_insert(index);
+    return fd;
+}
+
+// Open a file for appending, or create it if it doesn't exist.  Writing carries on in the
+// erased bytes after the data in the last chunk, which is found from the file index.  The
+// end offset in the header can only be programmed once, so the first chunk is moved to a
+// fresh one with the offset left erased; this is the only chunk that is rewritten, however
+// long the file is.
+STATIC file_descriptor_obj *microbit_file_open_append(const char *name, size_t name_len, bool binary) {
+    if (name_len > MAX_FILENAME_LENGTH) {
+        return NULL;
+    }
+    chunk_index_t start = microbit_find_file(name, name_len);
+    if (start == FILE_NOT_FOUND) {
+        return microbit_file_open(name, name_len, true, binary);
+    }
+    chunk_index_t last = file_index_tail[start];
+    uint32_t end_offset = file_chunk_at(start)->header.end_offset;
+    if (end_offset == UNUSED_OFFSET) {
+        // The file was not closed after writing, so its header can be used as it is, and
+        // the end of the data is only known from what was programmed since power on.
+        end_offset = file_index_tail_len[start];
+        if (end_offset == UNUSED_OFFSET) {
+            microbit_file_opened_for_writing(name, name_len);
+            return microbit_file_copy_readable(start, name, name_len, binary);
+        }
+    } else {
+        chunk_index_t index = find_chunk_and_erase();
+        if (index == FILE_NOT_FOUND) {
+            mp_raise_OSError(MP_ENOSPC);
+        }
+        const file_chunk *old_chunk = file_chunk_at(start);
+        file_chunk *new_chunk = file_chunk_at(index);
+        // Copy everything after the end offset: the name and the data in this chunk.
+        uint32_t copy_from = offsetof(file_header, name_len);
+        uint32_t copy_to = last == start ? end_offset : DATA_PER_CHUNK;
+        flash_write_bytes((uint32_t)&new_chunk->data[copy_from], (uint8_t*)&old_chunk->data[copy_from], copy_to - copy_from);
+        if (last != start) {
+            flash_write_index((uint32_t)&new_chunk->next_chunk, old_chunk->next_chunk);
+        }
+        // Mark the new chunk before freeing the old one, so a reset in between can't lose the file.
+        flash_write_index((uint32_t)&new_chunk->marker, FILE_START);
+        file_index_remove(start);
+        flash_write_index((uint32_t)&old_chunk->marker, FREED_CHUNK);
+        chunk_map_freed(start);
+        file_index_insert(index);
+        if (last == start) {
+            last = index;
+        }
+        file_index_set_tail(index, last, end_offset);
+        start = index;
+    }
+    microbit_file_opened_for_writing(name, name_len);
+    file_descriptor_obj *fd = microbit_file_descriptor_new(start, true, binary);
+    fd->seek_chunk = last;
+    fd->seek_offset = 0;
+    int err = advance(fd, end_offset, true);
+    if (err) {
+        mp_raise_OSError(err);
+    }
+    return fd;
+}
+
+STATIC file_descriptor_obj *microbit_file_descriptor_new(chunk_index_t start_chunk, bool write, bool binary) {
     file_descriptor_obj *res = mp_obj_malloc(file_descriptor_obj, binary ? &os_mbfs_fileio_type : &os_mbfs_textio_type);
     res->start_chunk = start_chunk;
     res->seek_chunk = start_chunk;
-    res->seek_offset = file_system_chunks[start_chunk].header.name_len+2;
+    res->seek_offset = file_chunk_at(start_chunk)->header.name_len+FILE_HEADER_LEN;
     res->writable = write;
     res->open = true;
     res->binary = binary;
+    res->chain_len = 0;
+    res->chain = NULL;
+    res->write_len = 0;
+    res->write_buf = write ? m_new(uint8_t, DATA_PER_CHUNK) : NULL;
+    MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_FILE, sizeof(*res) + (write ? DATA_PER_CHUNK : 0));
     return res;
 }
 
@@ -375,10 +839,14 @@ STATIC mp_obj_t microbit_remove(mp_obj_t filename) {
     size_t name_len;
     const char *name = mp_obj_str_get_data(filename, &name_len);
     mp_uint_t index = microbit_find_file(name, name_len);
-    if (index == 255) {
+    if (index == FILE_NOT_FOUND) {
         mp_raise_OSError(MP_ENOENT);
     }
     clear_file(index);
+    #if MICROPY_MBFS_MPY_CACHE
+    // The cache is hidden from listdir, so nothing else would ever remove it.
+    microbit_mpy_cache_invalidate(name, name_len);
+    #endif
     return mp_const_none;
 }
 
@@ -394,17 +862,18 @@ STATIC int advance(file_descriptor_obj *self, uint32_t n, bool write) {
     if (self->seek_offset == DATA_PER_CHUNK) {
         self->seek_offset = 0;
         if (write) {
-            uint8_t next_chunk = find_chunk_and_erase();
+            chunk_index_t next_chunk = find_chunk_and_erase();
             if (next_chunk == FILE_NOT_FOUND) {
                 clear_file(self->start_chunk);
                 self->open = false;
                 return MP_ENOSPC;
             }
             // Link next chunk to this one
-            flash_write_byte((uint32_t)&(file_system_chunks[self->seek_chunk].next_chunk), next_chunk);
-            flash_write_byte((uint32_t)&(file_system_chunks[next_chunk].marker), self->seek_chunk);
+            flash_write_index((uint32_t)&(file_chunk_at(self->seek_chunk)->next_chunk), next_chunk);
+            flash_write_index((uint32_t)&(file_chunk_at(next_chunk)->marker), self->seek_chunk);
+            file_index_set_tail(self->start_chunk, next_chunk, 0);
         }
-        self->seek_chunk = file_system_chunks[self->seek_chunk].next_chunk;
+        self->seek_chunk = file_chunk_at(self->seek_chunk)->next_chunk;
     }
     DEBUG(("FILE DEBUG: Advanced to chunk %d, offset %d.\r\n", self->seek_chunk, self->seek_offset));
     return 0;
@@ -413,7 +882,7 @@ STATIC int advance(file_descriptor_obj *self, uint32_t n, bool write) {
 STATIC mp_uint_t microbit_file_read(mp_obj_t obj, void *buf, mp_uint_t size, int *errcode) {
     file_descriptor_obj *self = (file_descriptor_obj *)obj;
     check_file_open(self);
-    if (self->writable || file_system_chunks[self->start_chunk].marker == FREED_CHUNK) {
+    if (self->writable || file_chunk_at(self->start_chunk)->marker == FREED_CHUNK) {
         *errcode = MP_EBADF;
         return MP_STREAM_ERROR;
     }
@@ -421,9 +890,9 @@ STATIC mp_uint_t microbit_file_read(mp_obj_t obj, void *buf, mp_uint_t size, int
     uint8_t *data = buf;
     while (1) {
         mp_uint_t to_read = DATA_PER_CHUNK - self->seek_offset;
-        if (file_system_chunks[self->seek_chunk].next_chunk == UNUSED_CHUNK) {
-            uint8_t end_offset = file_system_chunks[self->start_chunk].header.end_offset;
-            if (end_offset == UNUSED_CHUNK) {
+        if (file_chunk_at(self->seek_chunk)->next_chunk == UNUSED_CHUNK) {
+            chunk_offset_t end_offset = file_chunk_at(self->start_chunk)->header.end_offset;
+            if (end_offset == UNUSED_OFFSET) {
                 to_read = 0;
             } else {
                 to_read = MIN(to_read, (mp_uint_t)end_offset-self->seek_offset);
@@ -440,22 +909,38 @@ STATIC mp_uint_t microbit_file_read(mp_obj_t obj, void *buf, mp_uint_t size, int
     return bytes_read;
 }
 
+// Program any buffered data into the current chunk.
+STATIC int file_write_flush(file_descriptor_obj *self) {
+    if (self->write_len == 0) {
+        return 0;
+    }
+    chunk_offset_t len = self->write_len;
+    self->write_len = 0;
+    flash_write_bytes((uint32_t)seek_address(self), self->write_buf, len);
+    file_index_tail_len[self->start_chunk] = self->seek_offset + len;
+    return advance(self, len, true);
+}
+
 STATIC mp_uint_t microbit_file_write(mp_obj_t obj, const void *buf, mp_uint_t size, int *errcode) {
     file_descriptor_obj *self = (file_descriptor_obj *)obj;
     check_file_open(self);
-    if (!self->writable || file_system_chunks[self->start_chunk].marker == FREED_CHUNK) {
+    if (!self->writable || file_chunk_at(self->start_chunk)->marker == FREED_CHUNK) {
         *errcode = MP_EBADF;
         return MP_STREAM_ERROR;
     }
     uint32_t len = size;
     const uint8_t *data = buf;
     while (len) {
-        uint32_t to_write = MIN(((uint32_t)(DATA_PER_CHUNK - self->seek_offset)), len);
-        flash_write_bytes((uint32_t)seek_address(self), data, to_write);
-        int err = advance(self, to_write, true);
-        if (err) {
-            *errcode = err;
-            return MP_STREAM_ERROR;
+        // Collect data until the current chunk is full, then program it in one go.
+        uint32_t to_write = MIN(((uint32_t)(DATA_PER_CHUNK - self->seek_offset - self->write_len)), len);
+        memcpy(self->write_buf + self->write_len, data, to_write);
+        self->write_len += to_write;
+        if (self->seek_offset + self->write_len == DATA_PER_CHUNK) {
+            int err = file_write_flush(self);
+            if (err) {
+                *errcode = err;
+                return MP_STREAM_ERROR;
+            }
         }
         data += to_write;
         len -= to_write;
@@ -464,17 +949,36 @@ STATIC mp_uint_t microbit_file_write(mp_obj_t obj, const void *buf, mp_uint_t si
 }
 
 STATIC void microbit_file_close(file_descriptor_obj *fd) {
-    if (fd->writable) {
-        flash_write_byte((uint32_t)&(file_system_chunks[fd->start_chunk].header.end_offset), fd->seek_offset);
+    if (fd->writable && fd->open) {
+        if (file_write_flush(fd) != 0) {
+            // Out of space, and the file has already been removed.
+            return;
+        }
+        flash_write_bytes((uint32_t)&(file_chunk_at(fd->start_chunk)->header.end_offset), (uint8_t*)&fd->seek_offset, sizeof(fd->seek_offset));
     }
     fd->open = false;
 }
 
+// Whether a file is listed: the compiled code cached for a script, .foo.mpy, is not.
+STATIC bool microbit_file_is_listed(chunk_index_t index) {
+    if (file_chunk_at(index)->marker != FILE_START) {
+        return false;
+    }
+    #if MICROPY_MBFS_MPY_CACHE
+    const file_header *header = &file_chunk_at(index)->header;
+    if (header->name_len > 4 && header->filename[0] == '.'
+        && memcmp(&header->filename[header->name_len - 4], ".mpy", 4) == 0) {
+        return false;
+    }
+    #endif
+    return true;
+}
+
 STATIC mp_obj_t microbit_file_list(void) {
     mp_obj_t res = mp_obj_new_list(0, NULL);
-    for (uint8_t index = 1; index <= chunks_in_file_system; index++) {
-        if (file_system_chunks[index].marker == FILE_START) {
-            mp_obj_t name = mp_obj_new_str(&file_system_chunks[index].header.filename[0], file_system_chunks[index].header.name_len);
+    for (chunk_index_t index = 1; index <= chunks_in_file_system; index++) {
+        if (microbit_file_is_listed(index)) {
+            mp_obj_t name = mp_obj_new_str(&file_chunk_at(index)->header.filename[0], file_chunk_at(index)->header.name_len);
             mp_obj_list_append(res, name);
         }
     }
@@ -484,16 +988,16 @@ STATIC mp_obj_t microbit_file_list(void) {
 STATIC mp_obj_t microbit_file_size(mp_obj_t filename) {
     size_t name_len;
     const char *name = mp_obj_str_get_data(filename, &name_len);
-    uint8_t chunk = microbit_find_file(name, name_len);
-    if (chunk == 255) {
+    chunk_index_t chunk = microbit_find_file(name, name_len);
+    if (chunk == FILE_NOT_FOUND) {
         mp_raise_OSError(MP_ENOENT);
     }
     mp_uint_t len = 0;
-    uint8_t end_offset = file_system_chunks[chunk].header.end_offset;
-    uint8_t offset = file_system_chunks[chunk].header.name_len+2;
-    while (file_system_chunks[chunk].next_chunk != UNUSED_CHUNK) {
+    chunk_offset_t end_offset = file_chunk_at(chunk)->header.end_offset;
+    chunk_offset_t offset = file_chunk_at(chunk)->header.name_len+FILE_HEADER_LEN;
+    while (file_chunk_at(chunk)->next_chunk != UNUSED_CHUNK) {
         len += DATA_PER_CHUNK - offset;
-        chunk = file_system_chunks[chunk].next_chunk;
+        chunk = file_chunk_at(chunk)->next_chunk;
         offset = 0;
     }
     len += end_offset - offset;
@@ -501,17 +1005,186 @@ STATIC mp_obj_t microbit_file_size(mp_obj_t filename) {
 }
 
 STATIC mp_uint_t file_read_byte(file_descriptor_obj *fd) {
-    if (file_system_chunks[fd->seek_chunk].next_chunk == UNUSED_CHUNK) {
-        uint8_t end_offset = file_system_chunks[fd->start_chunk].header.end_offset;
-        if (end_offset == UNUSED_CHUNK || fd->seek_offset == end_offset) {
+    if (file_chunk_at(fd->seek_chunk)->next_chunk == UNUSED_CHUNK) {
+        chunk_offset_t end_offset = file_chunk_at(fd->start_chunk)->header.end_offset;
+        if (end_offset == UNUSED_OFFSET || fd->seek_offset == end_offset) {
             return (mp_uint_t)-1;
         }
     }
-    mp_uint_t res = file_system_chunks[fd->seek_chunk].data[fd->seek_offset];
+    mp_uint_t res = file_chunk_at(fd->seek_chunk)->data[fd->seek_offset];
     advance(fd, 1, false);
     return res;
 }
 
+// Record all the chunks of a file, so any position in it can be found in constant time.
+STATIC void file_build_chain(file_descriptor_obj *fd) {
+    chunk_index_t len = 1;
+    for (chunk_index_t chunk = fd->start_chunk; file_chunk_at(chunk)->next_chunk != UNUSED_CHUNK; chunk = file_chunk_at(chunk)->next_chunk) {
+        len++;
+    }
+    fd->chain = m_new(chunk_index_t, len);
+    MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_FILE, len * sizeof(chunk_index_t));
+    fd->chain_len = len;
+    chunk_index_t chunk = fd->start_chunk;
+    for (chunk_index_t i = 0; i < len; i++) {
+        fd->chain[i] = chunk;
+        chunk = file_chunk_at(chunk)->next_chunk;
+    }
+}
+
+// Convert a position in the chain of chunks to a byte offset in the file.
+STATIC mp_uint_t file_chain_to_pos(file_descriptor_obj *fd, chunk_index_t i, chunk_offset_t offset) {
+    mp_uint_t header_len = file_chunk_at(fd->start_chunk)->header.name_len+FILE_HEADER_LEN;
+    return i * DATA_PER_CHUNK + offset - header_len;
+}
+
+STATIC mp_uint_t microbit_file_ioctl(mp_obj_t obj, mp_uint_t request, uintptr_t arg, int *errcode) {
+    file_descriptor_obj *self = (file_descriptor_obj *)obj;
+    if (request == MP_STREAM_FLUSH) {
+        check_file_open(self);
+        if (self->writable) {
+            int err = file_write_flush(self);
+            if (err) {
+                *errcode = err;
+                return MP_STREAM_ERROR;
+            }
+        }
+        return 0;
+    }
+    if (request != MP_STREAM_SEEK) {
+        *errcode = MP_EINVAL;
+        return MP_STREAM_ERROR;
+    }
+    check_file_open(self);
+    if (self->writable || file_chunk_at(self->start_chunk)->marker == FREED_CHUNK) {
+        *errcode = MP_EOPNOTSUPP;
+        return MP_STREAM_ERROR;
+    }
+    if (self->chain == NULL) {
+        file_build_chain(self);
+    }
+
+    // Find the current position and the size of the file.
+    chunk_index_t cur = 0;
+    while (self->chain[cur] != self->seek_chunk) {
+        cur++;
+    }
+    chunk_offset_t end_offset = file_chunk_at(self->start_chunk)->header.end_offset;
+    if (end_offset == UNUSED_OFFSET) {
+        // File was not closed after writing, so the data in its last chunk is not readable.
+        end_offset = self->chain_len == 1 ? file_chunk_at(self->start_chunk)->header.name_len+FILE_HEADER_LEN : 0;
+    }
+    mp_off_t pos = file_chain_to_pos(self, cur, self->seek_offset);
+    mp_off_t size = file_chain_to_pos(self, self->chain_len - 1, end_offset);
+
+    struct mp_stream_seek_t *s = (struct mp_stream_seek_t *)arg;
+    if (s->whence == 1) {
+        pos += s->offset;
+    } else if (s->whence == 2) {
+        pos = size + s->offset;
+    } else {
+        pos = s->offset;
+    }
+    if (pos < 0) {
+        pos = 0;
+    } else if (pos > size) {
+        pos = size;
+    }
+
+    // Move to the new position.
+    mp_uint_t data_pos = pos + file_chunk_at(self->start_chunk)->header.name_len+FILE_HEADER_LEN;
+    self->seek_chunk = self->chain[data_pos / DATA_PER_CHUNK];
+    self->seek_offset = data_pos % DATA_PER_CHUNK;
+    s->offset = pos;
+    return 0;
+}
+
+// Returns false if the file does not exist.
+bool microbit_file_reader_open(microbit_file_reader_t *reader, const char *name, size_t name_len) {
+    chunk_index_t index = microbit_find_file(name, name_len);
+    if (index == FILE_NOT_FOUND) {
+        return false;
+    }
+    reader->start_chunk = index;
+    reader->seek_chunk = index;
+    reader->seek_offset = file_chunk_at(index)->header.name_len+FILE_HEADER_LEN;
+    return true;
+}
+
+// Get the next contiguous run of data of the file, up to max_len bytes, as a pointer into
+// flash, and advance past it.  Returns the length of the run, or 0 at the end of the file
+// or if the file has been removed since it was opened.
+size_t microbit_file_reader_next(microbit_file_reader_t *reader, const uint8_t **data, size_t max_len) {
+    if (file_chunk_at(reader->start_chunk)->marker != FILE_START) {
+        return 0;
+    }
+    file_descriptor_obj fd = {
+        .start_chunk = reader->start_chunk,
+        .seek_chunk = reader->seek_chunk,
+        .seek_offset = reader->seek_offset,
+    };
+    size_t to_read = DATA_PER_CHUNK - fd.seek_offset;
+    if (file_chunk_at(fd.seek_chunk)->next_chunk == UNUSED_CHUNK) {
+        chunk_offset_t end_offset = file_chunk_at(fd.start_chunk)->header.end_offset;
+        if (end_offset == UNUSED_OFFSET) {
+            to_read = 0;
+        } else {
+            to_read = MIN(to_read, (size_t)end_offset-fd.seek_offset);
+        }
+    }
+    to_read = MIN(to_read, max_len);
+    if (to_read == 0) {
+        return 0;
+    }
+    *data = seek_address(&fd);
+    advance(&fd, to_read, false);
+    reader->seek_chunk = fd.seek_chunk;
+    reader->seek_offset = fd.seek_offset;
+    return to_read;
+}
+
+// Copy up to len bytes of the file into buf.  Returns the number of bytes copied.
+size_t microbit_file_reader_read(microbit_file_reader_t *reader, uint8_t *buf, size_t len) {
+    size_t total = 0;
+    while (total < len) {
+        const uint8_t *data;
+        size_t n = microbit_file_reader_next(reader, &data, len - total);
+        if (n == 0) {
+            break;
+        }
+        memcpy(buf + total, data, n);
+        total += n;
+    }
+    return total;
+}
+
+// Do a little filesystem maintenance while there is nothing else to do: one step of a
+// sweep, if one is in progress or the filesystem is running out of erased chunks.
+// A step takes up to about MICROBIT_FILESYSTEM_SWEEP_STEP_MS.  Returns true if it did anything.
+bool microbit_filesystem_background(void) {
+    if (sweep_chunks == NULL) {
+        if (!sweep_check_needed) {
+            return false;
+        }
+        sweep_check_needed = false;
+        // Sweeping wears the flash, so only do it when needed and when it gains at least a page.
+        if (chunks_unused >= BACKGROUND_SWEEP_UNUSED_CHUNKS || chunks_freed < CHUNKS_PER_PAGE) {
+            return false;
+        }
+        filesystem_sweep_begin();
+        return true;
+    }
+    filesystem_sweep_step();
+    return true;
+}
+
+// Finish a sweep in progress, before a reset or power down.
+void microbit_filesystem_finish_sweep(void) {
+    if (sweep_chunks != NULL) {
+        filesystem_sweep();
+    }
+}
+
 // Now follows the code to integrate this filesystem into the os module.
 
 mp_lexer_t *os_mbfs_new_reader(const char *filename) {
@@ -527,7 +1200,7 @@ mp_lexer_t *os_mbfs_new_reader(const char *filename) {
 }
 
 mp_import_stat_t os_mbfs_import_stat(const char *path) {
-    uint8_t chunk = microbit_find_file(path, strlen(path));
+    chunk_index_t chunk = microbit_find_file(path, strlen(path));
     if (chunk == FILE_NOT_FOUND) {
         return MP_IMPORT_STAT_NO_EXIST;
     } else {
@@ -562,20 +1235,20 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(os_mbfs_file___exit___obj, 4, 4, os_m
 typedef struct {
     mp_obj_base_t base;
     mp_fun_1_t iternext;
-    uint8_t index;
+    chunk_index_t index;
 } os_mbfs_ilistdir_it_t;
 
 STATIC mp_obj_t os_mbfs_ilistdir_it_iternext(mp_obj_t self_in) {
     os_mbfs_ilistdir_it_t *self = MP_OBJ_TO_PTR(self_in);
 
-    // Read until the next FILE_START chunk.
+    // Read until the next FILE_START chunk of a listed file.
     for (; self->index <= chunks_in_file_system; self->index++) {
-        if (file_system_chunks[self->index].marker != FILE_START) {
+        if (!microbit_file_is_listed(self->index)) {
             continue;
         }
 
         // Get the file name as str object.
-        mp_obj_t name = mp_obj_new_str(&file_system_chunks[self->index].header.filename[0], file_system_chunks[self->index].header.name_len);
+        mp_obj_t name = mp_obj_new_str(&file_chunk_at(self->index)->header.filename[0], file_chunk_at(self->index)->header.name_len);
 
         // make 3-tuple with info about this entry
         mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(3, NULL));
@@ -617,6 +1290,9 @@ STATIC const mp_map_elem_t os_mbfs_file_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&mp_stream_readinto_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_readline), (mp_obj_t)&mp_stream_unbuffered_readline_obj},
     { MP_OBJ_NEW_QSTR(MP_QSTR_write), (mp_obj_t)&mp_stream_write_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_flush), (mp_obj_t)&mp_stream_flush_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_seek), (mp_obj_t)&mp_stream_seek_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_tell), (mp_obj_t)&mp_stream_tell_obj},
 };
 STATIC MP_DEFINE_CONST_DICT(os_mbfs_file_locals_dict, os_mbfs_file_locals_dict_table);
 
@@ -624,6 +1300,7 @@ STATIC MP_DEFINE_CONST_DICT(os_mbfs_file_locals_dict, os_mbfs_file_locals_dict_t
 STATIC const mp_stream_p_t textio_stream_p = {
     .read = microbit_file_read,
     .write = microbit_file_write,
+    .ioctl = microbit_file_ioctl,
     .is_text = true,
 };
 
@@ -639,6 +1316,7 @@ MP_DEFINE_CONST_OBJ_TYPE(
 STATIC const mp_stream_p_t fileio_stream_p = {
     .read = microbit_file_read,
     .write = microbit_file_write,
+    .ioctl = microbit_file_ioctl,
 };
 
 MP_DEFINE_CONST_OBJ_TYPE(
@@ -654,15 +1332,17 @@ mp_obj_t os_mbfs_open(size_t n_args, const mp_obj_t *args) {
     /// -1 means default; 0 explicitly false; 1 explicitly true.
     int read = -1;
     int text = -1;
+    bool append = false;
     if (n_args == 2) {
         size_t len;
         const char *mode = mp_obj_str_get_data(args[1], &len);
         for (mp_uint_t i = 0; i < len; i++) {
-            if (mode[i] == 'r' || mode[i] == 'w') {
+            if (mode[i] == 'r' || mode[i] == 'w' || mode[i] == 'a') {
                 if (read >= 0) {
                     goto mode_error;
                 }
                 read = (mode[i] == 'r');
+                append = (mode[i] == 'a');
             } else if (mode[i] == 'b' || mode[i] == 't') {
                 if (text >= 0) {
                     goto mode_error;
@@ -675,7 +1355,12 @@ mp_obj_t os_mbfs_open(size_t n_args, const mp_obj_t *args) {
     }
     size_t name_len;
     const char *filename = mp_obj_str_get_data(args[0], &name_len);
-    file_descriptor_obj *res = microbit_file_open(filename, name_len, read == 0, text == 0);
+    file_descriptor_obj *res;
+    if (append) {
+        res = microbit_file_open_append(filename, name_len, text == 0);
+    } else {
+        res = microbit_file_open(filename, name_len, read == 0, text == 0);
+    }
     if (res == NULL) {
         mp_raise_OSError(MP_ENOENT);
     }
@@ -702,4 +1387,126 @@ STATIC mp_obj_t os_mbfs_stat(mp_obj_t filename) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(os_mbfs_stat_obj, os_mbfs_stat);
 
+// Create an empty file and erase enough chunks to then write size bytes to it, so that
+// writing the data does not have to stop to erase pages or sweep the filesystem.
+// The erased chunks are not reserved, so writing other files in the meantime uses them up.
+STATIC mp_obj_t os_mbfs_preallocate(mp_obj_t filename, mp_obj_t size_in) {
+    size_t name_len;
+    const char *name = mp_obj_str_get_data(filename, &name_len);
+    mp_int_t size = mp_obj_get_int(size_in);
+    if (name_len > MAX_FILENAME_LENGTH || size < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    chunk_index_t index = microbit_find_file(name, name_len);
+    if (index != FILE_NOT_FOUND) {
+        clear_file(index);
+    }
+    // One more chunk than the data fills, because advance() takes the next chunk as soon
+    // as the current one is full.
+    uint32_t chunks = 1 + (size + name_len + FILE_HEADER_LEN) / DATA_PER_CHUNK;
+    if (!ensure_unused_chunks(chunks)) {
+        mp_raise_OSError(MP_ENOSPC);
+    }
+    file_descriptor_obj *fd = microbit_file_open(name, name_len, true, true);
+    microbit_file_close(fd);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(os_mbfs_preallocate_obj, os_mbfs_preallocate);
+
+// Fast path for tools copying a file over the raw REPL: read size bytes from stdin and
+// write them straight into a new file, without the data being parsed as Python.  The space
+// is erased first, so programming a chunk is never held up by an erase.  For flow control
+// the board sends an ACK (0x06) whenever it is ready for the next block, which is the rest
+// of the current chunk, or of the file if that is less.  Ctrl-C is not an interrupt while
+// the data is arriving, since it may be part of the file.
+STATIC mp_obj_t os_mbfs_receive_file(mp_obj_t filename, mp_obj_t size_in) {
+    size_t name_len;
+    const char *name = mp_obj_str_get_data(filename, &name_len);
+    mp_int_t size = mp_obj_get_int(size_in);
+    if (name_len > MAX_FILENAME_LENGTH || size < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    chunk_index_t index = microbit_find_file(name, name_len);
+    if (index != FILE_NOT_FOUND) {
+        clear_file(index);
+    }
+    if (!ensure_unused_chunks(1 + (size + name_len + FILE_HEADER_LEN) / DATA_PER_CHUNK)) {
+        mp_raise_OSError(MP_ENOSPC);
+    }
+    file_descriptor_obj *fd = microbit_file_open(name, name_len, true, true);
+    mp_hal_set_interrupt_char(-1);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        while (size > 0) {
+            size_t n = MIN((size_t)size, DATA_PER_CHUNK - fd->seek_offset);
+            mp_hal_stdout_tx_strn("\x06", 1);
+            for (size_t i = 0; i < n; i++) {
+                fd->write_buf[i] = mp_hal_stdin_rx_chr();
+            }
+            fd->write_len = n;
+            int err = file_write_flush(fd);
+            if (err) {
+                mp_raise_OSError(err);
+            }
+            size -= n;
+        }
+        nlr_pop();
+    } else {
+        mp_hal_set_interrupt_char(CHAR_CTRL_C);
+        if (fd->open) {
+            fd->open = false;
+            clear_file(fd->start_chunk);
+        }
+        nlr_jump(nlr.ret_val);
+    }
+    mp_hal_set_interrupt_char(CHAR_CTRL_C);
+    microbit_file_close(fd);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(os_mbfs_receive_file_obj, os_mbfs_receive_file);
+
+// Return (chunk_size, total_chunks, unused_chunks, freed_chunks, page_erases).  Freed
+// chunks must be reclaimed by a sweep before they can be written again.  page_erases is a
+// tuple of the number of times each flash page of the filesystem has been erased since
+// power on, from the lowest address, including the spare page.
+STATIC mp_obj_t os_mbfs_fsinfo(void) {
+    size_t num_pages = first_page_index - last_page_index + 1;
+    mp_obj_tuple_t *erases = MP_OBJ_TO_PTR(mp_obj_new_tuple(num_pages, NULL));
+    for (size_t i = 0; i < num_pages; i++) {
+        erases->items[i] = MP_OBJ_NEW_SMALL_INT(page_erase_count[i]);
+    }
+    mp_obj_t t[5] = {
+        MP_OBJ_NEW_SMALL_INT(CHUNK_SIZE),
+        MP_OBJ_NEW_SMALL_INT(chunks_in_file_system),
+        MP_OBJ_NEW_SMALL_INT(chunks_unused),
+        MP_OBJ_NEW_SMALL_INT(chunks_freed),
+        MP_OBJ_FROM_PTR(erases),
+    };
+    return mp_obj_new_tuple(5, t);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(os_mbfs_fsinfo_obj, os_mbfs_fsinfo);
+
+// Reclaim all freed chunks.  With wait=False the sweep is started and then continues a page
+// at a time whenever the program sleeps.
+STATIC mp_obj_t os_mbfs_compact(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_wait };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_wait, MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (sweep_chunks == NULL) {
+        if (chunks_freed == 0) {
+            return mp_const_none;
+        }
+        filesystem_sweep_begin();
+    }
+    if (args[ARG_wait].u_bool) {
+        filesystem_sweep();
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(os_mbfs_compact_obj, 0, os_mbfs_compact);
+
 #endif // MICROPY_MBFS
@@ -0,0 +1,386 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// A cache of compiled scripts in the filesystem.  An import of foo.py goes through its
+// cache, .foo.mpy: mp_import_stat hides foo.py and reports foo.mpy instead, and
+// mp_reader_new_file reads the cached code.  If the cache is missing or out of date, the
+// reader compiles the source and saves it first, so each import compiles at most once.
+//
+// Opening a .py for writing removes its cache, so import_stat only compares the length of
+// the source with the header, which walks its chunks without reading the data.  The hash
+// catches a source changed some other way, and is checked once when the code is loaded.
+
+#include <string.h>
+
+#include "py/compile.h"
+#include "py/mperrno.h"
+#include "py/persistentcode.h"
+#include "py/reader.h"
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "modules/os/microbitfs.h"
+#include "microbitfs_ext.h"
+
+#if MICROPY_MBFS && MICROPY_MBFS_MPY_CACHE
+
+typedef struct _mpy_cache_header_t {
+    uint32_t source_hash;
+    uint32_t source_len;
+    uint32_t flags;
+} mpy_cache_header_t;
+
+// The source has native code, which can't be cached.  The header is kept on its own so the
+// source is imported as a .py, and not compiled for the cache again, until it changes.
+#define MPY_CACHE_NO_CODE (1)
+
+// Longest "foo.py" that has a cache; the cache name is 2 characters longer.
+#define MPY_CACHE_MAX_SOURCE_NAME (120 - 2)
+
+STATIC bool name_has_suffix(const char *name, size_t len, const char *suffix) {
+    size_t suffix_len = strlen(suffix);
+    return len > suffix_len && memcmp(name + len - suffix_len, suffix, suffix_len) == 0;
+}
+
+// Write the name of the cache of the source file name, which ends in ".py", to buf.
+STATIC size_t mpy_cache_name(char *buf, const char *name, size_t len) {
+    buf[0] = '.';
+    memcpy(buf + 1, name, len - 3);
+    memcpy(buf + 1 + len - 3, ".mpy", 4);
+    return len + 2;
+}
+
+STATIC bool mbfs_file_exists(const char *name, size_t len) {
+    microbit_file_reader_t reader;
+    return microbit_file_reader_open(&reader, name, len);
+}
+
+// Get the length of a file by following its chunks, without touching the data.
+STATIC bool mpy_cache_source_len(const char *name, size_t len, uint32_t *source_len) {
+    microbit_file_reader_t reader;
+    if (!microbit_file_reader_open(&reader, name, len)) {
+        return false;
+    }
+    uint32_t total = 0;
+    const uint8_t *data;
+    size_t n;
+    while ((n = microbit_file_reader_next(&reader, &data, SIZE_MAX)) != 0) {
+        total += n;
+    }
+    *source_len = total;
+    return true;
+}
+
+STATIC bool mpy_cache_hash_source(const char *name, size_t len, mpy_cache_header_t *header) {
+    microbit_file_reader_t reader;
+    if (!microbit_file_reader_open(&reader, name, len)) {
+        return false;
+    }
+    uint32_t hash = 5381;
+    uint32_t total = 0;
+    const uint8_t *data;
+    size_t n;
+    while ((n = microbit_file_reader_next(&reader, &data, SIZE_MAX)) != 0) {
+        for (size_t i = 0; i < n; ++i) {
+            hash = hash * 33 ^ data[i];
+        }
+        total += n;
+    }
+    header->source_hash = hash;
+    header->source_len = total;
+    header->flags = 0;
+    return true;
+}
+
+// Read the header of the cache of the given source file, and check it against the length
+// of the source.  Returns false if there is no cache, or it is out of date.
+STATIC bool mpy_cache_find(const char *name, size_t len, mpy_cache_header_t *header) {
+    uint32_t source_len;
+    if (!mpy_cache_source_len(name, len, &source_len)) {
+        return false;
+    }
+    char cache_name[MPY_CACHE_MAX_SOURCE_NAME + 2];
+    size_t cache_len = mpy_cache_name(cache_name, name, len);
+    microbit_file_reader_t reader;
+    return microbit_file_reader_open(&reader, cache_name, cache_len)
+        && microbit_file_reader_read(&reader, (uint8_t *)header, sizeof(*header)) == sizeof(*header)
+        && header->source_len == source_len;
+}
+
+// Whether a source file is imported through its cache.  This only looks at the filesystem,
+// so it is cheap enough for import_stat: the cache is made when the source is loaded.
+STATIC bool mpy_cache_is_used(const char *name, size_t len) {
+    if (len > MPY_CACHE_MAX_SOURCE_NAME || !name_has_suffix(name, len, ".py")
+        || !mbfs_file_exists(name, len)) {
+        return false;
+    }
+    mpy_cache_header_t header;
+    return !mpy_cache_find(name, len, &header) || !(header.flags & MPY_CACHE_NO_CODE);
+}
+
+// Returns true if the cache holds code made from the current source, checked by its hash.
+STATIC bool mpy_cache_is_valid(const char *name, size_t len, const mpy_cache_header_t *source) {
+    mpy_cache_header_t header;
+    return mpy_cache_find(name, len, &header)
+        && header.source_hash == source->source_hash
+        && !(header.flags & MPY_CACHE_NO_CODE);
+}
+
+STATIC void mpy_cache_print_strn(void *data, const char *str, size_t len) {
+    int errcode;
+    const mp_stream_p_t *stream = mp_get_stream(MP_OBJ_FROM_PTR(data));
+    if (stream->write(MP_OBJ_FROM_PTR(data), str, len, &errcode) == MP_STREAM_ERROR) {
+        mp_raise_OSError(errcode);
+    }
+}
+
+#if MICROPY_EMIT_NATIVE
+// Machine code compiled at runtime refers to this session's qstrs, so it can't be cached.
+STATIC bool mpy_cache_has_native(const mp_raw_code_t *rc) {
+    if (rc->kind != MP_CODE_BYTECODE) {
+        return true;
+    }
+    for (size_t i = 0; i < rc->n_children; ++i) {
+        if (mpy_cache_has_native(rc->children[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+// Compile a source file.  Errors, including in the source itself, are raised as usual.
+STATIC void mpy_cache_compile(const char *name, size_t len, mp_obj_dict_t *globals, mp_compiled_module_t *cm) {
+    mp_lexer_t *lex = os_mbfs_new_reader(qstr_str(qstr_from_strn(name, len)));
+    qstr source_name = lex->source_name;
+    mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+    cm->context = m_new_obj(mp_module_context_t);
+    cm->context->module.globals = globals;
+    mp_compile_to_raw_code(&parse_tree, source_name, false, cm);
+}
+
+// Save compiled code to the cache of a source file, with the given header.  Code that can't
+// be cached leaves a header on its own.  Returns false if there is no cached code, which
+// includes when the filesystem is full.
+STATIC bool mpy_cache_save(const char *name, size_t len, const mpy_cache_header_t *header, mp_compiled_module_t *cm) {
+    char cache_name[MPY_CACHE_MAX_SOURCE_NAME + 2];
+    size_t cache_len = mpy_cache_name(cache_name, name, len);
+    mp_obj_t cache_name_obj = mp_obj_new_str(cache_name, cache_len);
+    mpy_cache_header_t saved = *header;
+    #if MICROPY_EMIT_NATIVE
+    if (mpy_cache_has_native(cm->rc)) {
+        saved.flags = MPY_CACHE_NO_CODE;
+    }
+    #endif
+    mp_obj_t file = MP_OBJ_NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t args[2] = { cache_name_obj, MP_OBJ_NEW_QSTR(MP_QSTR_wb) };
+        file = os_mbfs_open(2, args);
+        mp_print_t print = { MP_OBJ_TO_PTR(file), mpy_cache_print_strn };
+        print.print_strn(print.data, (const char *)&saved, sizeof(saved));
+        if (!(saved.flags & MPY_CACHE_NO_CODE)) {
+            mp_raw_code_save(cm, &print);
+        }
+        mp_stream_close(file);
+        nlr_pop();
+        return !(saved.flags & MPY_CACHE_NO_CODE);
+    } else {
+        if (file != MP_OBJ_NULL) {
+            mp_stream_close(file);
+            os_mbfs_remove_obj.fun._1(cache_name_obj);
+        }
+        return false;
+    }
+}
+
+// Read compiled bytecode from an .mpy made in RAM.
+STATIC void mpy_cache_mem_reader(mp_reader_t *reader, mp_compiled_module_t *cm) {
+    vstr_t vstr;
+    mp_print_t print;
+    vstr_init_print(&vstr, 64, &print);
+    mp_raw_code_save(cm, &print);
+    mp_reader_new_mem(reader, (const byte *)vstr.buf, vstr.len, vstr.alloc);
+}
+
+// Read a module that just runs its source file, so the source is compiled as usual, with
+// any native code it has.
+STATIC void mpy_cache_source_stub(mp_reader_t *reader, const char *name, size_t len) {
+    vstr_t vstr;
+    mp_print_t print;
+    vstr_init_print(&vstr, 32 + len, &print);
+    mp_print_str(&print, "exec(open(");
+    mp_obj_print_helper(&print, mp_obj_new_str(name, len), PRINT_REPR);
+    mp_print_str(&print, ").read())");
+    qstr source_name = qstr_from_strn(name, len);
+    mp_lexer_t *lex = mp_lexer_new_from_str_len(source_name, vstr.buf, vstr.len, 0);
+    mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+    mp_compiled_module_t cm;
+    cm.context = m_new_obj(mp_module_context_t);
+    cm.context->module.globals = NULL;
+    mp_compile_to_raw_code(&parse_tree, source_name, false, &cm);
+    vstr_clear(&vstr);
+    mpy_cache_mem_reader(reader, &cm);
+}
+
+// Reads .mpy files out of flash a chunk at a time, so each byte is just a load.  This only
+// speeds up reading: the loader still copies the bytecode and constants into the heap, as
+// this MicroPython can't run code from ROM, so a module must fit in the heap once loaded.
+typedef struct _mpy_reader_t {
+    microbit_file_reader_t file;
+    const uint8_t *cur;
+    const uint8_t *end;
+} mpy_reader_t;
+
+STATIC mp_uint_t mpy_reader_readbyte(void *data) {
+    mpy_reader_t *r = data;
+    if (r->cur == r->end) {
+        size_t n = microbit_file_reader_next(&r->file, &r->cur, SIZE_MAX);
+        if (n == 0) {
+            r->end = r->cur;
+            return MP_READER_EOF;
+        }
+        r->end = r->cur + n;
+    }
+    return *r->cur++;
+}
+
+STATIC void mpy_reader_close(void *data) {
+    m_del_obj(mpy_reader_t, data);
+}
+
+STATIC void mpy_reader_new(mp_reader_t *reader, const char *name, size_t len, bool is_cache) {
+    mpy_reader_t *file = m_new_obj(mpy_reader_t);
+    if (!microbit_file_reader_open(&file->file, name, len)) {
+        m_del_obj(mpy_reader_t, file);
+        mp_raise_OSError(MP_ENOENT);
+    }
+    if (is_cache) {
+        mpy_cache_header_t header;
+        microbit_file_reader_read(&file->file, (uint8_t *)&header, sizeof(header));
+    }
+    file->cur = NULL;
+    file->end = NULL;
+    reader->data = file;
+    reader->readbyte = mpy_reader_readbyte;
+    reader->close = mpy_reader_close;
+}
+
+// The source file with the same module name as the given .mpy file.
+STATIC size_t mpy_source_name(char *buf, const char *name, size_t len) {
+    memcpy(buf, name, len - 4);
+    memcpy(buf + len - 4, ".py", 3);
+    return len - 1;
+}
+
+mp_import_stat_t microbit_mpy_cache_import_stat(const char *path) {
+    size_t len = strlen(path);
+    if (name_has_suffix(path, len, ".py")) {
+        // Hide a source file that goes through its cache, so the import loads that instead.
+        if (mpy_cache_is_used(path, len)) {
+            return MP_IMPORT_STAT_NO_EXIST;
+        }
+    } else if (name_has_suffix(path, len, ".mpy") && len <= MPY_CACHE_MAX_SOURCE_NAME + 1) {
+        char source_name[MPY_CACHE_MAX_SOURCE_NAME];
+        size_t source_len = mpy_source_name(source_name, path, len);
+        if (mpy_cache_is_used(source_name, source_len)) {
+            return MP_IMPORT_STAT_FILE;
+        }
+    }
+    return os_mbfs_import_stat(path);
+}
+
+// Open an .mpy file for the import machinery.  For a source file this reads its cached code,
+// compiling the source into the cache first if needed.
+void microbit_mpy_cache_reader_new(mp_reader_t *reader, const char *path) {
+    size_t len = strlen(path);
+    if (name_has_suffix(path, len, ".mpy") && len <= MPY_CACHE_MAX_SOURCE_NAME + 1) {
+        char source_name[MPY_CACHE_MAX_SOURCE_NAME];
+        size_t source_len = mpy_source_name(source_name, path, len);
+        mpy_cache_header_t header;
+        if (mpy_cache_is_used(source_name, source_len)
+            && mpy_cache_hash_source(source_name, source_len, &header)) {
+            if (!mpy_cache_is_valid(source_name, source_len, &header)) {
+                mp_compiled_module_t cm;
+                mpy_cache_compile(source_name, source_len, NULL, &cm);
+                if (!mpy_cache_save(source_name, source_len, &header, &cm)) {
+                    #if MICROPY_EMIT_NATIVE
+                    if (mpy_cache_has_native(cm.rc)) {
+                        // Only the next import will see the source; this one runs it.
+                        mpy_cache_source_stub(reader, source_name, source_len);
+                        return;
+                    }
+                    #endif
+                    // The filesystem is full, so hand over the compiled code directly.
+                    mpy_cache_mem_reader(reader, &cm);
+                    return;
+                }
+            }
+            char cache_name[MPY_CACHE_MAX_SOURCE_NAME + 2];
+            size_t cache_len = mpy_cache_name(cache_name, source_name, source_len);
+            mpy_reader_new(reader, cache_name, cache_len, true);
+            return;
+        }
+    }
+    mpy_reader_new(reader, path, len, false);
+}
+
+// Compile a script to run as the main module, using and making the cache where possible.
+mp_obj_t microbit_mpy_cache_compile_file(const char *filename) {
+    size_t len = strlen(filename);
+    mpy_cache_header_t header;
+    mp_compiled_module_t cm;
+    bool used = mpy_cache_is_used(filename, len) && mpy_cache_hash_source(filename, len, &header);
+    if (used && mpy_cache_is_valid(filename, len, &header)) {
+        char cache_name[MPY_CACHE_MAX_SOURCE_NAME + 2];
+        size_t cache_len = mpy_cache_name(cache_name, filename, len);
+        mp_reader_t reader;
+        cm.context = m_new_obj(mp_module_context_t);
+        cm.context->module.globals = mp_globals_get();
+        mpy_reader_new(&reader, cache_name, cache_len, true);
+        mp_raw_code_load(&reader, &cm);
+    } else {
+        // Run the code just compiled, whether or not it could be saved.
+        mpy_cache_compile(filename, len, mp_globals_get(), &cm);
+        if (used) {
+            mpy_cache_save(filename, len, &header, &cm);
+        }
+    }
+    return mp_make_function_from_raw_code(cm.rc, cm.context, NULL);
+}
+
+// Remove the cache of a source file that is being rewritten or removed.
+void microbit_mpy_cache_invalidate(const char *name, size_t len) {
+    if (len > MPY_CACHE_MAX_SOURCE_NAME || !name_has_suffix(name, len, ".py")) {
+        return;
+    }
+    char cache_name[MPY_CACHE_MAX_SOURCE_NAME + 2];
+    size_t cache_len = mpy_cache_name(cache_name, name, len);
+    if (mbfs_file_exists(cache_name, cache_len)) {
+        os_mbfs_remove_obj.fun._1(mp_obj_new_str(cache_name, cache_len));
+    }
+}
+
+#endif // MICROPY_MBFS && MICROPY_MBFS_MPY_CACHE
@@ -0,0 +1,63 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_MICROBITFS_EXT_H
+#define MICROPY_INCLUDED_CODAL_PORT_MICROBITFS_EXT_H
+
+// Extensions to microbitfs.c beyond the version in the nrf port.
+
+#include "py/obj.h"
+#include "py/lexer.h"
+#include "py/reader.h"
+
+// The longest a call to microbit_filesystem_background can take: a page erase and copy.
+#define MICROBIT_FILESYSTEM_SWEEP_STEP_MS (150)
+
+// A read cursor into a file in the filesystem, which lives outside the Python heap so it
+// can be used by drivers.  Data is returned as pointers directly into flash.
+typedef struct _microbit_file_reader_t {
+    uint16_t start_chunk;
+    uint16_t seek_chunk;
+    uint16_t seek_offset;
+} microbit_file_reader_t;
+
+bool microbit_file_reader_open(microbit_file_reader_t *reader, const char *name, size_t name_len);
+size_t microbit_file_reader_next(microbit_file_reader_t *reader, const uint8_t **data, size_t max_len);
+size_t microbit_file_reader_read(microbit_file_reader_t *reader, uint8_t *buf, size_t len);
+
+bool microbit_filesystem_background(void);
+void microbit_filesystem_finish_sweep(void);
+
+mp_import_stat_t microbit_mpy_cache_import_stat(const char *path);
+void microbit_mpy_cache_reader_new(mp_reader_t *reader, const char *path);
+mp_obj_t microbit_mpy_cache_compile_file(const char *filename);
+void microbit_mpy_cache_invalidate(const char *name, size_t len);
+
+MP_DECLARE_CONST_FUN_OBJ_2(os_mbfs_preallocate_obj);
+MP_DECLARE_CONST_FUN_OBJ_2(os_mbfs_receive_file_obj);
+MP_DECLARE_CONST_FUN_OBJ_0(os_mbfs_fsinfo_obj);
+MP_DECLARE_CONST_FUN_OBJ_KW(os_mbfs_compact_obj);
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_MICROBITFS_EXT_H
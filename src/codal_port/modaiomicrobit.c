@@ -0,0 +1,114 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "drv_display.h"
+#include "drv_radio.h"
+#include "modaudio.h"
+#include "modmusic.h"
+
+// Helpers for the frozen aiomicrobit module.  A Ready object polls as readable once its
+// driver has finished (or, for the radio, has a packet waiting), so asyncio can wait for
+// it in select.poll together with everything else instead of spinning.
+
+#define AIOMICROBIT_DISPLAY (0)
+#define AIOMICROBIT_MUSIC (1)
+#define AIOMICROBIT_SPEECH (2)
+#define AIOMICROBIT_RADIO (3)
+
+typedef struct _aiomicrobit_ready_obj_t {
+    mp_obj_base_t base;
+    uint8_t source;
+} aiomicrobit_ready_obj_t;
+
+STATIC bool aiomicrobit_is_ready(uint8_t source) {
+    switch (source) {
+        case AIOMICROBIT_DISPLAY:
+            return !microbit_display_is_animating();
+        case AIOMICROBIT_MUSIC:
+            return !microbit_music_is_playing();
+        case AIOMICROBIT_SPEECH:
+            return !microbit_speech_is_speaking();
+        default:
+            return microbit_radio_peek() != NULL;
+    }
+}
+
+STATIC mp_obj_t aiomicrobit_ready_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t source = mp_obj_get_int(args[0]);
+    if (source < AIOMICROBIT_DISPLAY || source > AIOMICROBIT_RADIO) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid source"));
+    }
+    aiomicrobit_ready_obj_t *self = mp_obj_malloc(aiomicrobit_ready_obj_t, type);
+    self->source = source;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_uint_t aiomicrobit_ready_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    aiomicrobit_ready_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_POLL) {
+        if (aiomicrobit_is_ready(self->source)) {
+            return arg & MP_STREAM_POLL_RD;
+        }
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC const mp_stream_p_t aiomicrobit_ready_stream_p = {
+    .ioctl = aiomicrobit_ready_ioctl,
+};
+
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    aiomicrobit_ready_type,
+    MP_QSTR_Ready,
+    MP_TYPE_FLAG_NONE,
+    make_new, aiomicrobit_ready_make_new,
+    protocol, &aiomicrobit_ready_stream_p
+    );
+
+STATIC const mp_rom_map_elem_t aiomicrobit_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR__aiomicrobit) },
+
+    { MP_ROM_QSTR(MP_QSTR_Ready), MP_ROM_PTR(&aiomicrobit_ready_type) },
+
+    { MP_ROM_QSTR(MP_QSTR_DISPLAY), MP_ROM_INT(AIOMICROBIT_DISPLAY) },
+    { MP_ROM_QSTR(MP_QSTR_MUSIC), MP_ROM_INT(AIOMICROBIT_MUSIC) },
+    { MP_ROM_QSTR(MP_QSTR_SPEECH), MP_ROM_INT(AIOMICROBIT_SPEECH) },
+    { MP_ROM_QSTR(MP_QSTR_RADIO), MP_ROM_INT(AIOMICROBIT_RADIO) },
+};
+STATIC MP_DEFINE_CONST_DICT(aiomicrobit_module_globals, aiomicrobit_module_globals_table);
+
+const mp_obj_module_t aiomicrobit_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&aiomicrobit_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR__aiomicrobit, aiomicrobit_module);
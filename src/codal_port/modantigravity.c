@@ -27,9 +27,10 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "drv_display.h"
 
 #define GET_PIXEL(x, y) microbit_hal_display_get_pixel(x, y)
-#define SET_PIXEL(x, y, v) microbit_hal_display_set_pixel(x, y, v)
+#define SET_PIXEL(x, y, v) microbit_display_write_pixel(x, y, v)
 
 STATIC void antigravity_output_char(char c) {
     MP_PLAT_PRINT_STRN((char *)&c, 1);
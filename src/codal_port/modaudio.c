@@ -25,57 +25,215 @@
  * THE SOFTWARE.
  */
 
+#include "py/mperrno.h"
 #include "py/mphal.h"
+#include "drv_alloc.h"
+#include "drv_stats.h"
 #include "drv_system.h"
 #include "modaudio.h"
 #include "modmicrobit.h"
+#include "microbitfs_ext.h"
+#include "microbithal.h"
 
-#define audio_source_iter MP_STATE_PORT(audio_source)
+#define audio_source_iter(channel) MP_STATE_PORT(audio_source)[channel]
 
 #define DEFAULT_SAMPLE_RATE (7812)
-#define BUFFER_EXPANSION (4) // smooth out the samples via linear interpolation
-#define OUT_CHUNK_SIZE (BUFFER_EXPANSION * AUDIO_CHUNK_SIZE)
+#define DEFAULT_OUTPUT_BUFFERS (2)
 
-typedef enum {
-    AUDIO_OUTPUT_STATE_IDLE,
-    AUDIO_OUTPUT_STATE_DATA_READY,
-    AUDIO_OUTPUT_STATE_DATA_WRITTEN,
-} audio_output_state_t;
+// Channel gains are 8.8 fixed point, up to just under 4.0.
+#define AUDIO_GAIN_SHIFT (8)
+#define AUDIO_GAIN_ONE (1 << AUDIO_GAIN_SHIFT)
+#define AUDIO_GAIN_MAX (4 * AUDIO_GAIN_ONE - 1)
 
-static uint8_t audio_output_buffer[OUT_CHUNK_SIZE];
-static volatile audio_output_state_t audio_output_state;
+// Samples are smoothed out via linear interpolation, expanding each one by a power of 2
+// so that the output rate is at most MAX_EXPANDED_SAMPLE_RATE.
+#define MAX_BUFFER_EXPANSION_SHIFT (3)
+#define MAX_EXPANDED_SAMPLE_RATE (32000)
+
+// Output chunks vary in length, up to what fits in MICROBIT_HAL_AUDIO_MAX_CHUNK once
+// expanded, and a default-sized AudioFrame must fit in one chunk at any rate.
+#if (AUDIO_CHUNK_SIZE << MAX_BUFFER_EXPANSION_SHIFT) > MICROBIT_HAL_AUDIO_MAX_CHUNK
+#error "expanded audio chunks are too long for the output ring"
+#endif
+
+// The output chunks form a ring of buffers which live in the HAL, so they can be handed
+// to the audio pipeline without copying.  audio_data_fetcher() is the only writer of
+// audio_output_head and microbit_hal_audio_ready_callback() is the only writer of
+// audio_output_tail; both are free-running counters.  The chunk most recently handed to
+// the pipeline is still being read by it, so at most num_buffers - 1 chunks are waiting.
+static size_t audio_output_num_buffers_config = DEFAULT_OUTPUT_BUFFERS;
+static size_t audio_output_num_buffers;
+static volatile uint32_t audio_output_head;
+static volatile uint32_t audio_output_tail;
+static volatile bool audio_output_idle; // pipeline needs to be told when a chunk is ready
+static volatile uint32_t audio_output_underruns;
+static uint8_t audio_output_last_sample;
+static uint8_t audio_expansion_shift;
 static volatile bool audio_fetcher_scheduled;
+static volatile bool audio_direct_ready_scheduled;
+#if MICROPY_HW_LATENCY_STATS
+static uint32_t audio_fetcher_scheduled_us;
+#endif
+
+// All channels that are playing at once share the same sample rate.  A channel playing
+// AudioFrames at their own rate can change it when nothing else is playing, which is held
+// pending until the chunks already mixed at the old rate have gone to the pipeline.
+static uint32_t audio_sample_rate;
+static uint32_t audio_sample_rate_pending;
+static uint16_t audio_channel_gain[MICROPY_HW_AUDIO_MIXER_CHANNELS];
+
+// A channel playing a bytes-like object of 8-bit unsigned samples has that object as its
+// source (which keeps it alive), and this records how far through it playback has got.
+static size_t audio_channel_buffer_pos[MICROPY_HW_AUDIO_MIXER_CHANNELS];
+
+// A channel playing an iterator of AudioFrames holds the frame it is part way through, so
+// the iterator is only stepped once per frame.  Output chunks end where the current frame
+// does, so a frame that fits in one chunk is mixed and handed over in one go.
+#define audio_channel_frame(channel) MP_STATE_PORT(audio_channel_frame)[channel]
+static size_t audio_channel_frame_pos[MICROPY_HW_AUDIO_MIXER_CHANNELS];
+static bool audio_channel_frame_rate[MICROPY_HW_AUDIO_MIXER_CHANNELS]; // play at each frame's rate
+
+// Holds the final partial frame of a buffer or file source, padded with silence.
+static uint8_t audio_partial_frame[MICROBIT_HAL_AUDIO_MAX_CHUNK];
+
+// The sum of the channels for one chunk, before it is scaled and saturated.  It's too big
+// for the stack of the scheduler callback that mixes it.
+static int32_t audio_mix[MICROBIT_HAL_AUDIO_MAX_CHUNK];
+
+#if MICROPY_MBFS
+// A channel playing a file has this as its source, and reads 8-bit unsigned samples
+// straight out of flash.  A frame only has to be copied (into audio_partial_frame) when it
+// straddles two chunks of the file, or is the final partial frame.
+#define AUDIO_SOURCE_FILE (MP_OBJ_SENTINEL)
+static microbit_file_reader_t audio_channel_file[MICROPY_HW_AUDIO_MIXER_CHANNELS];
+static size_t audio_channel_file_remaining[MICROPY_HW_AUDIO_MIXER_CHANNELS];
+#endif
 
 microbit_audio_frame_obj_t *microbit_audio_frame_make_new(void);
 
 static inline bool audio_is_running(void) {
-    return audio_source_iter != NULL;
+    for (size_t i = 0; i < MICROPY_HW_AUDIO_MIXER_CHANNELS; ++i) {
+        if (audio_source_iter(i) != NULL) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void microbit_audio_stop(void) {
-    audio_source_iter = NULL;
+    for (size_t i = 0; i < MICROPY_HW_AUDIO_MIXER_CHANNELS; ++i) {
+        audio_source_iter(i) = NULL;
+        audio_channel_frame(i) = NULL;
+    }
+    audio_sample_rate_pending = 0;
+    // Drop any chunks that are waiting to be played.
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    audio_output_head = audio_output_tail;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
     microbit_hal_audio_stop_expression();
 }
 
 STATIC void audio_buffer_ready(void) {
     uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
-    audio_output_state_t old_state = audio_output_state;
-    audio_output_state = AUDIO_OUTPUT_STATE_DATA_READY;
+    ++audio_output_head;
+    bool was_idle = audio_output_idle;
+    audio_output_idle = false;
     MICROPY_END_ATOMIC_SECTION(atomic_state);
-    if (old_state == AUDIO_OUTPUT_STATE_IDLE) {
+    if (was_idle) {
         microbit_hal_audio_ready_callback();
     }
 }
 
-STATIC void audio_data_fetcher(void) {
-    audio_fetcher_scheduled = false;
-    if (audio_source_iter == NULL) {
-        return;
+// Expand a chunk of samples into dest with linear interpolation from the previous sample.
+// The interpolation is done incrementally in fixed point, adding the difference between
+// consecutive samples at each step, so there is no multiply or divide per output sample.
+STATIC void audio_expand_chunk(uint8_t *dest, const uint8_t *src, size_t len) {
+    unsigned int shift = audio_expansion_shift;
+    if (shift == 0) {
+        memcpy(dest, src, len);
+    } else {
+        int32_t last = audio_output_last_sample;
+        for (size_t i = 0; i < len; ++i) {
+            int32_t cur = src[i];
+            int32_t delta = cur - last;
+            int32_t acc = last << shift;
+            for (size_t j = 1 << shift; j > 0; --j) {
+                acc += delta;
+                *dest++ = acc >> shift;
+            }
+            last = cur;
+        }
+    }
+    audio_output_last_sample = src[len - 1];
+}
+
+#if MICROPY_MBFS
+STATIC const uint8_t *audio_channel_next_file_frame(size_t channel, size_t chunk_len) {
+    microbit_file_reader_t *reader = &audio_channel_file[channel];
+    size_t max_len = MIN(chunk_len, audio_channel_file_remaining[channel]);
+    const uint8_t *data;
+    size_t len = microbit_file_reader_next(reader, &data, max_len);
+    if (len == 0) {
+        // End of file
+        audio_source_iter(channel) = NULL;
+        return NULL;
+    }
+    if (len < chunk_len) {
+        memcpy(audio_partial_frame, data, len);
+        len += microbit_file_reader_read(reader, audio_partial_frame + len, max_len - len);
+        memset(audio_partial_frame + len, 128, chunk_len - len);
+        data = audio_partial_frame;
+    }
+    audio_channel_file_remaining[channel] -= len;
+    return data;
+}
+#endif
+
+// An AudioFrame on its own is played the same way as a bytes-like object.
+STATIC bool audio_source_is_buffer(mp_obj_t src) {
+    return mp_obj_is_type(src, &mp_type_bytes)
+        || mp_obj_is_type(src, &mp_type_bytearray)
+        || mp_obj_is_type(src, &mp_type_memoryview)
+        || mp_obj_is_type(src, &microbit_audio_frame_type);
+}
+
+// A tuple/list is a sequence of sound effects if its first item is one.
+STATIC bool audio_source_is_effect_list(mp_obj_t src) {
+    if (!mp_obj_is_type(src, &mp_type_tuple) && !mp_obj_is_type(src, &mp_type_list)) {
+        return false;
     }
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(src, &len, &items);
+    return len > 0 && mp_obj_is_type(items[0], &microbit_soundeffect_type);
+}
+
+STATIC const uint8_t *audio_channel_next_buffer_frame(size_t channel, size_t chunk_len) {
+    // Look the buffer up each time because a bytearray may be resized while it plays.
+    mp_buffer_info_t bufinfo;
+    size_t pos = audio_channel_buffer_pos[channel];
+    if (!mp_get_buffer(audio_source_iter(channel), &bufinfo, MP_BUFFER_READ) || pos >= bufinfo.len) {
+        audio_source_iter(channel) = NULL;
+        return NULL;
+    }
+    const uint8_t *data = (const uint8_t *)bufinfo.buf + pos;
+    size_t len = MIN(chunk_len, bufinfo.len - pos);
+    if (len < chunk_len) {
+        memcpy(audio_partial_frame, data, len);
+        memset(audio_partial_frame + len, 128, chunk_len - len);
+        data = audio_partial_frame;
+    }
+    audio_channel_buffer_pos[channel] = pos + len;
+    return data;
+}
+
+// Get the next AudioFrame from a channel's iterator.  If the iterator has finished, or
+// did not return an AudioFrame, then the channel is stopped and NULL is returned.
+STATIC microbit_audio_frame_obj_t *audio_channel_next_iter_frame(size_t channel) {
     mp_obj_t buffer_obj;
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
-        buffer_obj = mp_iternext_allow_raise(audio_source_iter);
+        buffer_obj = mp_iternext_allow_raise(audio_source_iter(channel));
         nlr_pop();
     } else {
         if (!mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(((mp_obj_base_t*)nlr.ret_val)->type),
@@ -86,27 +244,182 @@ STATIC void audio_data_fetcher(void) {
     }
     if (buffer_obj == MP_OBJ_STOP_ITERATION) {
         // End of audio iterator
-        microbit_audio_stop();
+        audio_source_iter(channel) = NULL;
+        return NULL;
     } else if (mp_obj_get_type(buffer_obj) != &microbit_audio_frame_type) {
         // Audio iterator did not return an AudioFrame
-        microbit_audio_stop();
+        audio_source_iter(channel) = NULL;
         mp_sched_exception(mp_obj_new_exception_msg(&mp_type_TypeError, MP_ERROR_TEXT("not an AudioFrame")));
+        return NULL;
     } else {
-        microbit_audio_frame_obj_t *buffer = (microbit_audio_frame_obj_t *)buffer_obj;
-        uint8_t *dest = &audio_output_buffer[0];
-        uint32_t last = dest[BUFFER_EXPANSION * AUDIO_CHUNK_SIZE - 1];
-        for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i) {
-            uint32_t cur = buffer->data[i];
-            for (int j = 0; j < BUFFER_EXPANSION; ++j) {
-                // Get next sample with linear interpolation.
-                uint32_t sample = ((BUFFER_EXPANSION - 1 - j) * last + (j + 1) * cur) / BUFFER_EXPANSION;
-                // Write sample to the buffer.
-                *dest++ = sample;
+        return (microbit_audio_frame_obj_t *)buffer_obj;
+    }
+}
+
+// Check the rate of a channel's new AudioFrame against the output rate.  Returns false if
+// the frame can't be played yet, either because the rate has to change first or because
+// the channel was stopped for not matching the other channels.
+STATIC bool audio_channel_frame_rate_ok(size_t channel, microbit_audio_frame_obj_t *frame) {
+    if (!audio_channel_frame_rate[channel] || frame->rate == audio_sample_rate) {
+        return true;
+    }
+    for (size_t i = 0; i < MICROPY_HW_AUDIO_MIXER_CHANNELS; ++i) {
+        if (i != channel && audio_source_iter(i) != NULL) {
+            audio_source_iter(channel) = NULL;
+            audio_channel_frame(channel) = NULL;
+            mp_sched_exception(mp_obj_new_exception_msg(&mp_type_ValueError, MP_ERROR_TEXT("sample_rate differs from playing audio")));
+            return false;
+        }
+    }
+    audio_sample_rate_pending = frame->rate;
+    return false;
+}
+
+STATIC bool audio_source_is_iter(mp_obj_t src) {
+    #if MICROPY_MBFS
+    if (src == AUDIO_SOURCE_FILE) {
+        return false;
+    }
+    #endif
+    return src != NULL && !audio_source_is_buffer(src);
+}
+
+// Make sure a channel playing AudioFrames has a frame to play from, stepping its iterator
+// if the current one is used up.  Returns the number of samples left in the frame, or 0
+// if there are none to play for now.
+STATIC size_t audio_channel_iter_frame_remaining(size_t channel) {
+    microbit_audio_frame_obj_t *frame = audio_channel_frame(channel);
+    while (frame == NULL || audio_channel_frame_pos[channel] >= frame->len) {
+        frame = audio_channel_next_iter_frame(channel);
+        audio_channel_frame(channel) = frame;
+        if (frame == NULL) {
+            return 0;
+        }
+        audio_channel_frame_pos[channel] = 0;
+        if (!audio_channel_frame_rate_ok(channel, frame)) {
+            // Played once the rate has changed, which happens before any more mixing.
+            return 0;
+        }
+    }
+    return frame->len - audio_channel_frame_pos[channel];
+}
+
+// Get the next chunk of samples from a channel's current AudioFrame, which the chunk
+// length has been chosen to fit in, so it is always used in place.
+STATIC const uint8_t *audio_channel_next_iter_chunk(size_t channel, size_t chunk_len) {
+    microbit_audio_frame_obj_t *frame = audio_channel_frame(channel);
+    if (frame == NULL || audio_sample_rate_pending != 0) {
+        return NULL;
+    }
+    size_t pos = audio_channel_frame_pos[channel];
+    audio_channel_frame_pos[channel] = pos + chunk_len;
+    return frame->data + pos;
+}
+
+STATIC const uint8_t *audio_channel_next_frame(size_t channel, size_t chunk_len) {
+    #if MICROPY_MBFS
+    if (audio_source_iter(channel) == AUDIO_SOURCE_FILE) {
+        return audio_channel_next_file_frame(channel, chunk_len);
+    }
+    #endif
+    if (audio_source_is_buffer(audio_source_iter(channel))) {
+        return audio_channel_next_buffer_frame(channel, chunk_len);
+    }
+    return audio_channel_next_iter_chunk(channel, chunk_len);
+}
+
+// Set the output rate, with samples expanded as far as MAX_EXPANDED_SAMPLE_RATE allows.
+STATIC void audio_set_sample_rate(uint32_t sample_rate) {
+    audio_sample_rate = sample_rate;
+    audio_expansion_shift = 0;
+    while (audio_expansion_shift < MAX_BUFFER_EXPANSION_SHIFT
+        && (sample_rate << (audio_expansion_shift + 1)) <= MAX_EXPANDED_SAMPLE_RATE) {
+        ++audio_expansion_shift;
+    }
+    microbit_hal_audio_init(sample_rate << audio_expansion_shift);
+}
+
+// Mix the next frame of every playing channel into one output chunk, scaling each by its
+// gain and saturating the sum.  The chunk ends where the first of the channels' current
+// AudioFrames does, so that each frame costs one chunk, and one scheduled fetch, rather
+// than one per AUDIO_CHUNK_SIZE samples.  Returns false if there is nothing more to mix
+// for now.
+STATIC bool audio_data_fetch_chunk(void) {
+    if (audio_sample_rate_pending != 0) {
+        if (audio_output_head != audio_output_tail) {
+            // Called again from microbit_hal_audio_ready_callback() as these drain.
+            return false;
+        }
+        audio_set_sample_rate(audio_sample_rate_pending);
+        audio_sample_rate_pending = 0;
+        // Changing the rate halts direct output, so the next chunk must restart it.
+        audio_output_idle = true;
+    }
+    size_t len = MICROBIT_HAL_AUDIO_MAX_CHUNK >> audio_expansion_shift;
+    for (size_t c = 0; c < MICROPY_HW_AUDIO_MIXER_CHANNELS; ++c) {
+        if (audio_source_is_iter(audio_source_iter(c))) {
+            size_t remaining = audio_channel_iter_frame_remaining(c);
+            if (remaining != 0) {
+                len = MIN(len, remaining);
             }
-            last = cur;
         }
-        audio_buffer_ready();
     }
+
+    int32_t *mix = audio_mix;
+    memset(mix, 0, len * sizeof(int32_t));
+    bool have_data = false;
+    for (size_t c = 0; c < MICROPY_HW_AUDIO_MIXER_CHANNELS; ++c) {
+        if (audio_source_iter(c) == NULL) {
+            continue;
+        }
+        const uint8_t *data = audio_channel_next_frame(c, len);
+        if (data == NULL) {
+            continue;
+        }
+        have_data = true;
+        int32_t gain = audio_channel_gain[c];
+        for (size_t i = 0; i < len; ++i) {
+            mix[i] += ((int32_t)data[i] - 128) * gain;
+        }
+    }
+    if (!have_data) {
+        // A channel may be waiting at a frame for the rate to change.
+        return audio_sample_rate_pending != 0 && audio_output_head == audio_output_tail;
+    }
+
+    // The samples are written over the start of the mix, behind the values being read.
+    uint8_t *chunk = (uint8_t *)mix;
+    for (size_t i = 0; i < len; ++i) {
+        int32_t sample = (mix[i] >> AUDIO_GAIN_SHIFT) + 128;
+        if (sample < 0) {
+            sample = 0;
+        } else if (sample > 255) {
+            sample = 255;
+        }
+        chunk[i] = sample;
+    }
+
+    size_t out_len = len << audio_expansion_shift;
+    uint8_t *dest = microbit_hal_audio_get_buffer(audio_output_head % audio_output_num_buffers, out_len);
+    audio_expand_chunk(dest, chunk, len);
+    audio_buffer_ready();
+    return true;
+}
+
+// Fill all the free chunks of the output ring from the audio iterator.
+STATIC void audio_data_fetcher(void) {
+    #if MICROPY_HW_LATENCY_STATS
+    uint32_t stats_start = mp_hal_ticks_us();
+    microbit_stats_record(MICROBIT_STATS_AUDIO_SCHED_DELAY, stats_start - audio_fetcher_scheduled_us);
+    #endif
+    audio_fetcher_scheduled = false;
+    while (audio_is_running()
+        && audio_output_head - audio_output_tail < audio_output_num_buffers - 1) {
+        if (!audio_data_fetch_chunk()) {
+            break;
+        }
+    }
+    MICROBIT_STATS_END(MICROBIT_STATS_AUDIO_FETCH, stats_start);
 }
 
 STATIC mp_obj_t audio_data_fetcher_wrapper(mp_obj_t arg) {
@@ -116,61 +429,179 @@ STATIC mp_obj_t audio_data_fetcher_wrapper(mp_obj_t arg) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(audio_data_fetcher_wrapper_obj, audio_data_fetcher_wrapper);
 
 void microbit_hal_audio_ready_callback(void) {
-    if (audio_output_state == AUDIO_OUTPUT_STATE_DATA_READY) {
-        // there is data ready to send out to the audio pipeline, so send it
-        microbit_hal_audio_write_data(&audio_output_buffer[0], OUT_CHUNK_SIZE);
-        audio_output_state = AUDIO_OUTPUT_STATE_DATA_WRITTEN;
+    if (audio_output_head != audio_output_tail) {
+        // there is a chunk ready to send out to the audio pipeline, so send it
+        if (!microbit_hal_audio_write_buffer(audio_output_tail % audio_output_num_buffers)) {
+            // Dropped, which leaves a gap just like running out does.
+            ++audio_output_underruns;
+        }
+        ++audio_output_tail;
     } else {
         // no data ready, need to call this function later when data is ready
-        audio_output_state = AUDIO_OUTPUT_STATE_IDLE;
+        if (audio_is_running()) {
+            ++audio_output_underruns;
+        }
+        audio_output_idle = true;
     }
     if (!audio_fetcher_scheduled) {
         // schedule audio_data_fetcher to be executed to prepare the next buffer
+        #if MICROPY_HW_LATENCY_STATS
+        audio_fetcher_scheduled_us = mp_hal_ticks_us();
+        #endif
         audio_fetcher_scheduled = mp_sched_schedule(MP_OBJ_FROM_PTR(&audio_data_fetcher_wrapper_obj), mp_const_none);
     }
 }
 
+// Direct output keeps a short queue of chunks in the HAL.  Its interrupt asks for the queue
+// to be topped up, which is done from here rather than in the interrupt, and the queue
+// covers any delay in getting here.
+STATIC mp_obj_t audio_direct_ready(mp_obj_t arg) {
+    audio_direct_ready_scheduled = false;
+    if (!microbit_hal_audio_direct_is_active()) {
+        // Back on the mixer, which pulls each chunk itself.
+        return mp_const_none;
+    }
+    while (audio_output_head != audio_output_tail && !microbit_hal_audio_direct_queue_full()) {
+        microbit_hal_audio_ready_callback();
+    }
+    if (!microbit_hal_audio_direct_queue_full()) {
+        // There is room, so the next chunk should be handed over as soon as it's ready.
+        audio_output_idle = true;
+    }
+    audio_data_fetcher();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(audio_direct_ready_obj, audio_direct_ready);
+
+void microbit_hal_audio_direct_ready_callback(bool underrun) {
+    if (underrun && audio_is_running()) {
+        ++audio_output_underruns;
+    }
+    if (!audio_direct_ready_scheduled) {
+        audio_direct_ready_scheduled = mp_sched_schedule(MP_OBJ_FROM_PTR(&audio_direct_ready_obj), mp_const_none);
+    }
+}
+
 static void audio_init(uint32_t sample_rate) {
     audio_fetcher_scheduled = false;
-    audio_output_state = AUDIO_OUTPUT_STATE_IDLE;
-    microbit_hal_audio_init(BUFFER_EXPANSION * sample_rate);
+    audio_direct_ready_scheduled = false;
+    audio_sample_rate_pending = 0;
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    audio_output_num_buffers = audio_output_num_buffers_config;
+    audio_output_head = 0;
+    audio_output_tail = 0;
+    audio_output_idle = true;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    audio_output_underruns = 0;
+    audio_output_last_sample = 128;
+    audio_set_sample_rate(sample_rate);
 }
 
 void microbit_audio_play_source(mp_obj_t src, mp_obj_t pin_select, bool wait, uint32_t sample_rate) {
     if (audio_is_running()) {
         microbit_audio_stop();
     }
-    audio_init(sample_rate);
-    microbit_pin_audio_select(pin_select, microbit_pin_mode_audio_play);
+    microbit_audio_play_source_on_channel(src, pin_select, wait, sample_rate, 0, AUDIO_GAIN_ONE, false);
+}
 
-    const char *sound_expr_data = NULL;
+// Stop the given channel and get the audio output ready for it to start playing.  With
+// direct set, the output (of all channels) is streamed straight to the pin instead of
+// going through the mixer.  A sample_rate of 0 leaves the rate to the channel's frames.
+STATIC void audio_channel_prepare(size_t channel, mp_obj_t pin_select, uint32_t sample_rate, bool direct) {
+    bool mixing = false;
+    for (size_t i = 0; i < MICROPY_HW_AUDIO_MIXER_CHANNELS; ++i) {
+        if (i != channel && audio_source_iter(i) != NULL) {
+            mixing = true;
+        }
+    }
+    uint32_t playing_rate = audio_sample_rate_pending != 0 ? audio_sample_rate_pending : audio_sample_rate;
+    if (sample_rate == 0) {
+        sample_rate = mixing ? playing_rate : DEFAULT_SAMPLE_RATE;
+    }
+    if (mixing && sample_rate != playing_rate) {
+        mp_raise_ValueError(MP_ERROR_TEXT("sample_rate differs from playing audio"));
+    }
+    audio_source_iter(channel) = NULL;
+    if (!mixing) {
+        audio_init(sample_rate);
+    }
+    if (direct) {
+        microbit_pin_audio_select_direct(pin_select, microbit_pin_mode_audio_play);
+    } else {
+        microbit_pin_audio_select(pin_select, microbit_pin_mode_audio_play);
+    }
+}
+
+// Start the given channel playing, once its source has been set.
+STATIC void audio_channel_start(size_t channel, bool wait) {
+    // The scheduler must be locked because audio_data_fetcher() can also be called from the scheduler.
+    mp_sched_lock();
+    audio_data_fetcher();
+    mp_sched_unlock();
+
+    if (wait) {
+        // Wait the audio to exhaust the source.
+        while (audio_source_iter(channel) != NULL) {
+            mp_handle_pending(true);
+            microbit_hal_idle();
+        }
+    }
+}
+
+STATIC bool audio_source_is_expression(mp_obj_t src) {
+    return mp_obj_is_type(src, &microbit_sound_type)
+        || mp_obj_is_type(src, &microbit_soundeffect_type)
+        || audio_source_is_effect_list(src);
+}
+
+// Play a source on one channel of the mixer, replacing anything already playing on that
+// channel.  Other channels keep playing, as long as they use the same sample rate.  A
+// sample_rate of 0 means use the rate of the source's (first) AudioFrame.
+void microbit_audio_play_source_on_channel(mp_obj_t src, mp_obj_t pin_select, bool wait, uint32_t sample_rate, size_t channel, uint16_t gain, bool direct) {
+    if (direct && audio_source_is_expression(src)) {
+        // Sound expressions are synthesised by the mixer.
+        mp_raise_ValueError(MP_ERROR_TEXT("direct output needs sample data"));
+    }
+    // The rate of an iterator's frames is applied as each one starts playing.
+    bool frame_rate = false;
+    if (sample_rate == 0) {
+        if (mp_obj_is_type(src, &microbit_audio_frame_type)) {
+            sample_rate = ((microbit_audio_frame_obj_t *)MP_OBJ_TO_PTR(src))->rate;
+        } else if (audio_source_is_expression(src) || audio_source_is_buffer(src)) {
+            sample_rate = DEFAULT_SAMPLE_RATE;
+        } else {
+            frame_rate = true;
+        }
+    }
+
+    audio_channel_prepare(channel, pin_select, sample_rate, direct);
+
+    bool is_expression = true;
     if (mp_obj_is_type(src, &microbit_sound_type)) {
         const microbit_sound_obj_t *sound = (const microbit_sound_obj_t *)MP_OBJ_TO_PTR(src);
-        sound_expr_data = sound->name;
+        microbit_hal_audio_play_expression(sound->name);
     } else if (mp_obj_is_type(src, &microbit_soundeffect_type)) {
-        sound_expr_data = microbit_soundeffect_get_sound_expr_data(src);
-    } else if (mp_obj_is_type(src, &mp_type_tuple) || mp_obj_is_type(src, &mp_type_list)) {
-        // A tuple/list passed in.  Need to check if it contains SoundEffect instances.
+        microbit_hal_audio_play_effects(microbit_soundeffect_get_effect(src), 1);
+    } else if (audio_source_is_effect_list(src)) {
+        // A tuple/list of SoundEffect instances, which are played as one batch.
         size_t len;
         mp_obj_t *items;
         mp_obj_get_array(src, &len, &items);
-        if (len > 0 && mp_obj_is_type(items[0], &microbit_soundeffect_type)) {
-            // A tuple/list of SoundEffect instances.  Convert it to a long string of
-            // sound expression data, each effect separated by a ",".
-            char *data = m_new(char, len * (SOUND_EXPR_TOTAL_LENGTH + 1));
-            sound_expr_data = data;
-            for (size_t i = 0; i < len; ++i) {
-                memcpy(data, microbit_soundeffect_get_sound_expr_data(items[i]), SOUND_EXPR_TOTAL_LENGTH);
-                data += SOUND_EXPR_TOTAL_LENGTH;
-                *data++ = ',';
+        microbit_hal_sound_effect_t *effects = m_new(microbit_hal_sound_effect_t, len);
+        for (size_t i = 0; i < len; ++i) {
+            if (!mp_obj_is_type(items[i], &microbit_soundeffect_type)) {
+                m_del(microbit_hal_sound_effect_t, effects, len);
+                mp_raise_TypeError(MP_ERROR_TEXT("expecting a SoundEffect"));
             }
-            // Replace last "," with a string null terminator.
-            data[-1] = '\0';
+            effects[i] = *microbit_soundeffect_get_effect(items[i]);
         }
+        microbit_hal_audio_play_effects(effects, len);
+        m_del(microbit_hal_sound_effect_t, effects, len);
+    } else {
+        is_expression = false;
     }
 
-    if (sound_expr_data != NULL) {
-        microbit_hal_audio_play_expression(sound_expr_data);
+    if (is_expression) {
         if (wait) {
             nlr_buf_t nlr;
             if (nlr_push(&nlr) == 0) {
@@ -189,27 +620,61 @@ void microbit_audio_play_source(mp_obj_t src, mp_obj_t pin_select, bool wait, ui
         return;
     }
 
-    // Get the iterator and start the audio running.
-    // The scheduler must be locked because audio_data_fetcher() can also be called from the scheduler.
-    audio_source_iter = mp_getiter(src, NULL);
-    mp_sched_lock();
-    audio_data_fetcher();
-    mp_sched_unlock();
+    // Get the iterator and start the audio running.  A bytes-like object is played
+    // directly as 8-bit unsigned samples, without going through AudioFrame objects.
+    audio_channel_gain[channel] = gain;
+    if (audio_source_is_buffer(src)) {
+        audio_channel_buffer_pos[channel] = 0;
+        audio_source_iter(channel) = src;
+    } else {
+        mp_obj_t iter = mp_getiter(src, NULL);
+        audio_channel_frame(channel) = NULL;
+        audio_channel_frame_pos[channel] = 0;
+        audio_channel_frame_rate[channel] = frame_rate;
+        audio_source_iter(channel) = iter;
+    }
+    audio_channel_start(channel, wait);
+}
 
-    if (wait) {
-        // Wait the audio to exhaust the iterator.
-        while (audio_is_running()) {
-            mp_handle_pending(true);
-            microbit_hal_idle();
+STATIC mp_obj_t stop(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0 || args[0] == mp_const_none) {
+        microbit_audio_stop();
+    } else {
+        mp_int_t channel = mp_obj_get_int(args[0]);
+        if (channel < 0 || channel >= MICROPY_HW_AUDIO_MIXER_CHANNELS) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid channel"));
         }
+        // Any chunks already mixed are left to play out.
+        audio_source_iter(channel) = NULL;
     }
+    return mp_const_none;
 }
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(microbit_audio_stop_obj, 0, 1, stop);
 
-STATIC mp_obj_t stop(void) {
-    microbit_audio_stop();
-    return mp_const_none;
+STATIC uint32_t audio_get_sample_rate(mp_int_t sample_rate) {
+    if (sample_rate <= 0 || sample_rate > 100000) {
+        mp_raise_ValueError(MP_ERROR_TEXT("sample_rate out of range"));
+    }
+    return sample_rate;
+}
+
+STATIC size_t audio_get_channel(mp_int_t channel) {
+    if (channel < 0 || channel >= MICROPY_HW_AUDIO_MIXER_CHANNELS) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid channel"));
+    }
+    return channel;
+}
+
+STATIC uint16_t audio_get_gain(mp_obj_t gain_in) {
+    if (gain_in == mp_const_none) {
+        return AUDIO_GAIN_ONE;
+    }
+    mp_int_t gain = (mp_int_t)(mp_obj_get_float(gain_in) * AUDIO_GAIN_ONE + 0.5f);
+    if (gain < 0 || gain > AUDIO_GAIN_MAX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("gain out of range"));
+    }
+    return gain;
 }
-MP_DEFINE_CONST_FUN_OBJ_0(microbit_audio_stop_obj, stop);
 
 STATIC mp_obj_t play(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     // Note: the return_pin argument is for compatibility with micro:bit v1 and is ignored on v2.
@@ -218,17 +683,150 @@ STATIC mp_obj_t play(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_ar
         { MP_QSTR_wait,  MP_ARG_BOOL, {.u_bool = true} },
         { MP_QSTR_pin,   MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&microbit_pin_default_audio_obj)} },
         { MP_QSTR_return_pin,   MP_ARG_OBJ, {.u_obj = mp_const_none } },
+        { MP_QSTR_sample_rate, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_channel, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_gain, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_direct, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
     };
     // parse args
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
+    // Without a sample_rate, AudioFrames are played at their own rate.
+    uint32_t sample_rate = 0;
+    if (args[4].u_obj != mp_const_none) {
+        sample_rate = audio_get_sample_rate(mp_obj_get_int(args[4].u_obj));
+    }
+    size_t channel = audio_get_channel(args[5].u_int);
+    uint16_t gain = audio_get_gain(args[6].u_obj);
+
     mp_obj_t src = args[0].u_obj;
-    microbit_audio_play_source(src, args[2].u_obj, args[1].u_bool, DEFAULT_SAMPLE_RATE);
+    microbit_audio_play_source_on_channel(src, args[2].u_obj, args[1].u_bool, sample_rate, channel, gain, args[7].u_bool);
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(microbit_audio_play_obj, 0, play);
 
+#if MICROPY_MBFS
+
+STATIC void audio_file_skip(microbit_file_reader_t *reader, size_t len) {
+    const uint8_t *data;
+    size_t n;
+    while (len > 0 && (n = microbit_file_reader_next(reader, &data, len)) > 0) {
+        len -= n;
+    }
+}
+
+STATIC uint32_t audio_get_le32(const uint8_t *buf) {
+    return buf[0] | buf[1] << 8 | buf[2] << 16 | buf[3] << 24;
+}
+
+// If the file is a WAV file then parse its header, leaving the reader at the start of the
+// sample data.  Only 8-bit unsigned mono PCM is supported.  Returns false for a raw file,
+// leaving the reader at the start of the file.
+STATIC bool audio_file_parse_wav(microbit_file_reader_t *reader, uint32_t *sample_rate, size_t *data_len) {
+    microbit_file_reader_t start = *reader;
+    uint8_t buf[16];
+    if (microbit_file_reader_read(reader, buf, 12) != 12
+        || memcmp(buf, "RIFF", 4) != 0 || memcmp(buf + 8, "WAVE", 4) != 0) {
+        *reader = start;
+        return false;
+    }
+    bool have_fmt = false;
+    for (;;) {
+        if (microbit_file_reader_read(reader, buf, 8) != 8) {
+            break;
+        }
+        size_t chunk_len = audio_get_le32(buf + 4);
+        if (memcmp(buf, "fmt ", 4) == 0 && chunk_len >= 16) {
+            if (microbit_file_reader_read(reader, buf, 16) != 16
+                || (buf[0] | buf[1] << 8) != 1 // PCM
+                || (buf[2] | buf[3] << 8) != 1 // mono
+                || (buf[14] | buf[15] << 8) != 8) { // 8 bits per sample
+                break;
+            }
+            *sample_rate = audio_get_le32(buf + 4);
+            have_fmt = true;
+            chunk_len -= 16;
+        } else if (memcmp(buf, "data", 4) == 0 && have_fmt) {
+            *data_len = chunk_len;
+            return true;
+        }
+        // Chunks are padded to an even length.
+        audio_file_skip(reader, chunk_len + (chunk_len & 1));
+    }
+    mp_raise_ValueError(MP_ERROR_TEXT("unsupported WAV file"));
+}
+
+// Play a raw 8-bit unsigned PCM file, or a WAV file in that format, streaming it straight
+// from the filesystem without using the Python heap.
+STATIC mp_obj_t play_file(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_filename, ARG_rate, ARG_wait, ARG_pin, ARG_channel, ARG_gain, ARG_direct };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_filename, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_rate, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+        { MP_QSTR_pin, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&microbit_pin_default_audio_obj)} },
+        { MP_QSTR_channel, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_gain, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_direct, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    size_t channel = audio_get_channel(args[ARG_channel].u_int);
+    uint16_t gain = audio_get_gain(args[ARG_gain].u_obj);
+
+    size_t name_len;
+    const char *name = mp_obj_str_get_data(args[ARG_filename].u_obj, &name_len);
+    microbit_file_reader_t reader;
+    if (!microbit_file_reader_open(&reader, name, name_len)) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    uint32_t sample_rate = DEFAULT_SAMPLE_RATE;
+    size_t data_len = SIZE_MAX;
+    audio_file_parse_wav(&reader, &sample_rate, &data_len);
+    if (args[ARG_rate].u_obj != mp_const_none) {
+        sample_rate = mp_obj_get_int(args[ARG_rate].u_obj);
+    }
+    sample_rate = audio_get_sample_rate(sample_rate);
+
+    audio_channel_prepare(channel, args[ARG_pin].u_obj, sample_rate, args[ARG_direct].u_bool);
+    audio_channel_file[channel] = reader;
+    audio_channel_file_remaining[channel] = data_len;
+    audio_channel_gain[channel] = gain;
+    audio_source_iter(channel) = AUDIO_SOURCE_FILE;
+    audio_channel_start(channel, args[ARG_wait].u_bool);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(microbit_audio_play_file_obj, 1, play_file);
+
+#endif
+
+STATIC mp_obj_t config(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buffers };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buffers, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_buffers].u_int != -1) {
+        // Takes effect from the next call to play().
+        if (!(2 <= args[ARG_buffers].u_int && args[ARG_buffers].u_int <= MICROBIT_HAL_AUDIO_MAX_BUFFERS)) {
+            mp_raise_ValueError(MP_ERROR_TEXT("value out of range for argument 'buffers'"));
+        }
+        audio_output_num_buffers_config = args[ARG_buffers].u_int;
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(microbit_audio_config_obj, 0, config);
+
+// Returns the number of times the audio pipeline ran out of data since play() was called.
+STATIC mp_obj_t underruns(void) {
+    return mp_obj_new_int_from_uint(audio_output_underruns);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(microbit_audio_underruns_obj, underruns);
+
 bool microbit_audio_is_playing(void) {
     return audio_is_running() || microbit_hal_audio_is_expression_active();
 }
@@ -242,7 +840,12 @@ STATIC const mp_rom_map_elem_t audio_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_audio) },
     { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&microbit_audio_stop_obj) },
     { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&microbit_audio_play_obj) },
+    #if MICROPY_MBFS
+    { MP_ROM_QSTR(MP_QSTR_play_file), MP_ROM_PTR(&microbit_audio_play_file_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_is_playing), MP_ROM_PTR(&microbit_audio_is_playing_obj) },
+    { MP_ROM_QSTR(MP_QSTR_config), MP_ROM_PTR(&microbit_audio_config_obj) },
+    { MP_ROM_QSTR(MP_QSTR_underruns), MP_ROM_PTR(&microbit_audio_underruns_obj) },
     { MP_ROM_QSTR(MP_QSTR_AudioFrame), MP_ROM_PTR(&microbit_audio_frame_type) },
     { MP_ROM_QSTR(MP_QSTR_SoundEffect), MP_ROM_PTR(&microbit_soundeffect_type) },
 };
@@ -258,17 +861,55 @@ MP_REGISTER_MODULE(MP_QSTR_audio, audio_module);
 /******************************************************************************/
 // AudioFrame class
 
-STATIC mp_obj_t microbit_audio_frame_new(const mp_obj_type_t *type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+// A fixed pool of frames outside the GC heap.  Frames come from here while there are free
+// ones, and only go back when recycle() is called on them, so a dropped frame just stays
+// out of the pool until the next soft reset.
+STATIC microbit_audio_frame_obj_t audio_frame_pool[MICROPY_HW_AUDIO_FRAME_POOL_SIZE];
+STATIC uint32_t audio_frame_pool_free; // bitmask of free entries in audio_frame_pool
+
+void microbit_audio_frame_pool_init(void) {
+    audio_frame_pool_free = (uint32_t)-1 >> (32 - MICROPY_HW_AUDIO_FRAME_POOL_SIZE);
+}
+
+// Frames of the default length come from the pool if possible.  Others are always
+// allocated on the heap, with a separate sample buffer if they are longer than a chunk.
+STATIC microbit_audio_frame_obj_t *audio_frame_make_new_len(size_t len, uint32_t rate) {
+    microbit_audio_frame_obj_t *res;
+    if (len == AUDIO_CHUNK_SIZE) {
+        res = microbit_audio_frame_make_new();
+    } else {
+        res = m_new_obj(microbit_audio_frame_obj_t);
+        res->base.type = &microbit_audio_frame_type;
+        res->data = len <= AUDIO_CHUNK_SIZE ? res->chunk : m_new(uint8_t, len);
+        MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_AUDIO_FRAME, sizeof(*res) + (len <= AUDIO_CHUNK_SIZE ? 0 : len));
+        res->len = len;
+        memset(res->data, 128, len);
+    }
+    res->rate = rate;
+    return res;
+}
+
+STATIC mp_obj_t microbit_audio_frame_new(const mp_obj_type_t *type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
     (void)type_in;
-    (void)args;
-    mp_arg_check_num(n_args, n_kw, 0, 0, false);
-    return microbit_audio_frame_make_new();
+    enum { ARG_length, ARG_rate };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_length, MP_ARG_INT, {.u_int = AUDIO_CHUNK_SIZE} },
+        { MP_QSTR_rate, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = DEFAULT_SAMPLE_RATE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t len = args[ARG_length].u_int;
+    if (len <= 0 || len > AUDIO_FRAME_MAX_LENGTH) {
+        mp_raise_ValueError(MP_ERROR_TEXT("length out of range"));
+    }
+    return MP_OBJ_FROM_PTR(audio_frame_make_new_len(len, audio_get_sample_rate(args[ARG_rate].u_int)));
 }
 
 STATIC mp_obj_t audio_frame_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t value_in) {
     microbit_audio_frame_obj_t *self = (microbit_audio_frame_obj_t *)self_in;
     mp_int_t index = mp_obj_get_int(index_in);
-    if (index < 0 || index >= AUDIO_CHUNK_SIZE) {
+    if (index < 0 || index >= (mp_int_t)self->len) {
          mp_raise_ValueError(MP_ERROR_TEXT("index out of bounds"));
     }
     if (value_in == MP_OBJ_NULL) {
@@ -288,10 +929,10 @@ STATIC mp_obj_t audio_frame_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t
 }
 
 static mp_obj_t audio_frame_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
-    (void)self_in;
+    microbit_audio_frame_obj_t *self = (microbit_audio_frame_obj_t *)self_in;
     switch (op) {
         case MP_UNARY_OP_LEN:
-            return MP_OBJ_NEW_SMALL_INT(32);
+            return MP_OBJ_NEW_SMALL_INT(self->len);
         default:
             return MP_OBJ_NULL; // op not supported
     }
@@ -301,14 +942,15 @@ static mp_int_t audio_frame_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufin
     (void)flags;
     microbit_audio_frame_obj_t *self = (microbit_audio_frame_obj_t *)self_in;
     bufinfo->buf = self->data;
-    bufinfo->len = AUDIO_CHUNK_SIZE;
+    bufinfo->len = self->len;
     bufinfo->typecode = 'b';
     return 0;
 }
 
 static void add_into(microbit_audio_frame_obj_t *self, microbit_audio_frame_obj_t *other, bool add) {
     int mult = add ? 1 : -1;
-    for (int i = 0; i < AUDIO_CHUNK_SIZE; i++) {
+    size_t len = MIN(self->len, other->len);
+    for (size_t i = 0; i < len; i++) {
         unsigned val = (int)self->data[i] + mult*(other->data[i]-128);
         // Clamp to 0-255
         if (val > 255) {
@@ -319,10 +961,8 @@ static void add_into(microbit_audio_frame_obj_t *self, microbit_audio_frame_obj_
 }
 
 static microbit_audio_frame_obj_t *copy(microbit_audio_frame_obj_t *self) {
-    microbit_audio_frame_obj_t *result = microbit_audio_frame_make_new();
-    for (int i = 0; i < AUDIO_CHUNK_SIZE; i++) {
-        result->data[i] = self->data[i];
-    }
+    microbit_audio_frame_obj_t *result = audio_frame_make_new_len(self->len, self->rate);
+    memcpy(result->data, self->data, self->len);
     return result;
 }
 
@@ -330,7 +970,7 @@ mp_obj_t copyfrom(mp_obj_t self_in, mp_obj_t other) {
     microbit_audio_frame_obj_t *self = (microbit_audio_frame_obj_t *)self_in;
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(other, &bufinfo, MP_BUFFER_READ);
-    uint32_t len = bufinfo.len > AUDIO_CHUNK_SIZE ? AUDIO_CHUNK_SIZE : bufinfo.len;
+    uint32_t len = MIN(bufinfo.len, self->len);
     for (uint32_t i = 0; i < len; i++) {
         self->data[i] = ((uint8_t *)bufinfo.buf)[i];
     }
@@ -367,7 +1007,7 @@ int32_t float_to_fixed(float f, uint32_t scale) {
 
 static void mult(microbit_audio_frame_obj_t *self, float f) {
     int scaled = float_to_fixed(f, 15);
-    for (int i = 0; i < AUDIO_CHUNK_SIZE; i++) {
+    for (size_t i = 0; i < self->len; i++) {
         unsigned val = ((((int)self->data[i]-128) * scaled) >> 15)+128;
         if (val > 255) {
             val = (1-(val>>31))*255;
@@ -402,8 +1042,36 @@ STATIC mp_obj_t audio_frame_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj
     }
 }
 
+// Give a frame back to the pool once it is finished with, so generating audio doesn't
+// need to allocate.  The frame must not be used again after this.  Frames that were
+// allocated on the heap, because the pool was empty, are left to the GC.
+STATIC mp_obj_t audio_frame_recycle(mp_obj_t self_in) {
+    microbit_audio_frame_obj_t *self = (microbit_audio_frame_obj_t *)self_in;
+    if (self >= &audio_frame_pool[0] && self < &audio_frame_pool[MICROPY_HW_AUDIO_FRAME_POOL_SIZE]) {
+        audio_frame_pool_free |= 1 << (self - &audio_frame_pool[0]);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(audio_frame_recycle_obj, audio_frame_recycle);
+
+STATIC mp_obj_t audio_frame_set_rate(mp_obj_t self_in, mp_obj_t rate_in) {
+    microbit_audio_frame_obj_t *self = (microbit_audio_frame_obj_t *)self_in;
+    self->rate = audio_get_sample_rate(mp_obj_get_int(rate_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(audio_frame_set_rate_obj, audio_frame_set_rate);
+
+STATIC mp_obj_t audio_frame_get_rate(mp_obj_t self_in) {
+    microbit_audio_frame_obj_t *self = (microbit_audio_frame_obj_t *)self_in;
+    return mp_obj_new_int_from_uint(self->rate);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(audio_frame_get_rate_obj, audio_frame_get_rate);
+
 STATIC const mp_map_elem_t microbit_audio_frame_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_copyfrom), (mp_obj_t)&copyfrom_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recycle), (mp_obj_t)&audio_frame_recycle_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_set_rate), (mp_obj_t)&audio_frame_set_rate_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_get_rate), (mp_obj_t)&audio_frame_get_rate_obj },
 };
 STATIC MP_DEFINE_CONST_DICT(microbit_audio_frame_locals_dict, microbit_audio_frame_locals_dict_table);
 
@@ -420,10 +1088,22 @@ MP_DEFINE_CONST_OBJ_TYPE(
     );
 
 microbit_audio_frame_obj_t *microbit_audio_frame_make_new(void) {
-    microbit_audio_frame_obj_t *res = m_new_obj(microbit_audio_frame_obj_t);
+    microbit_audio_frame_obj_t *res;
+    if (audio_frame_pool_free != 0) {
+        size_t i = __builtin_ctz(audio_frame_pool_free);
+        audio_frame_pool_free &= ~(1 << i);
+        res = &audio_frame_pool[i];
+    } else {
+        res = m_new_obj(microbit_audio_frame_obj_t);
+        MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_AUDIO_FRAME, sizeof(*res));
+    }
     res->base.type = &microbit_audio_frame_type;
+    res->data = res->chunk;
+    res->len = AUDIO_CHUNK_SIZE;
+    res->rate = DEFAULT_SAMPLE_RATE;
     memset(res->data, 128, AUDIO_CHUNK_SIZE);
     return res;
 }
 
-MP_REGISTER_ROOT_POINTER(void *audio_source);
+MP_REGISTER_ROOT_POINTER(mp_obj_t audio_source[MICROPY_HW_AUDIO_MIXER_CHANNELS]);
+MP_REGISTER_ROOT_POINTER(struct _microbit_audio_frame_obj_t *audio_channel_frame[MICROPY_HW_AUDIO_MIXER_CHANNELS]);
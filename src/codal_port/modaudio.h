@@ -32,21 +32,32 @@
 #define LOG_AUDIO_CHUNK_SIZE (5)
 #define AUDIO_CHUNK_SIZE (1 << LOG_AUDIO_CHUNK_SIZE)
 
-#define SOUND_EXPR_TOTAL_LENGTH (72)
+// Longest AudioFrame that can be created, in samples.
+#define AUDIO_FRAME_MAX_LENGTH (8192)
 
+// An AudioFrame holds any number of samples, along with the rate to play them at.  Frames
+// of up to AUDIO_CHUNK_SIZE samples keep them in chunk, longer ones in a separate buffer.
 typedef struct _microbit_audio_frame_obj_t {
     mp_obj_base_t base;
-    uint8_t data[AUDIO_CHUNK_SIZE];
+    uint8_t *data;
+    size_t len;
+    uint32_t rate;
+    uint8_t chunk[AUDIO_CHUNK_SIZE];
 } microbit_audio_frame_obj_t;
 
 extern const mp_obj_type_t microbit_audio_frame_type;
 extern const mp_obj_module_t audio_module;
 
 void microbit_audio_play_source(mp_obj_t src, mp_obj_t pin_select, bool wait, uint32_t sample_rate);
+void microbit_audio_play_source_on_channel(mp_obj_t src, mp_obj_t pin_select, bool wait, uint32_t sample_rate, size_t channel, uint16_t gain, bool direct);
 void microbit_audio_stop(void);
+void microbit_speech_stop(void);
+void microbit_speech_deinit(void);
+bool microbit_speech_is_speaking(void);
 bool microbit_audio_is_playing(void);
 microbit_audio_frame_obj_t *microbit_audio_frame_make_new(void);
+void microbit_audio_frame_pool_init(void);
 
-const char *microbit_soundeffect_get_sound_expr_data(mp_obj_t self_in);
+const struct _microbit_hal_sound_effect_t *microbit_soundeffect_get_effect(mp_obj_t self_in);
 
 #endif // MICROPY_INCLUDED_MICROBIT_MODAUDIO_H
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+
+#if MICROPY_HW_BENCH
+
+// Hooks for the benchmark suite frozen into "make bench" builds, see modules/bench.py.
+
+bool microbit_bench_vm_hook_enabled = true;
+
+// Set in lib/sam/render.c.
+extern int sam_bench_old_renderer;
+
+// Turns the background work done by MICROPY_VM_HOOK_POLL on or off, so the bytecode
+// benchmarks can measure what it costs.  Returns the previous setting.
+STATIC mp_obj_t bench_vm_hook(size_t n_args, const mp_obj_t *args) {
+    bool enabled = microbit_bench_vm_hook_enabled;
+    if (n_args > 0) {
+        microbit_bench_vm_hook_enabled = mp_obj_is_true(args[0]);
+    }
+    return mp_obj_new_bool(enabled);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bench_vm_hook_obj, 0, 1, bench_vm_hook);
+
+// Selects the SAM renderer used by speech, so the current one can be timed against the
+// one it replaced.  Returns the previous setting, true for the old renderer.
+STATIC mp_obj_t bench_speech_renderer(size_t n_args, const mp_obj_t *args) {
+    bool old = sam_bench_old_renderer;
+    if (n_args > 0) {
+        sam_bench_old_renderer = mp_obj_is_true(args[0]);
+    }
+    return mp_obj_new_bool(old);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bench_speech_renderer_obj, 0, 1, bench_speech_renderer);
+
+STATIC const mp_rom_map_elem_t bench_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR__bench) },
+    { MP_ROM_QSTR(MP_QSTR_vm_hook), MP_ROM_PTR(&bench_vm_hook_obj) },
+    { MP_ROM_QSTR(MP_QSTR_speech_renderer), MP_ROM_PTR(&bench_speech_renderer_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(bench_module_globals, bench_module_globals_table);
+
+const mp_obj_module_t bench_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&bench_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR__bench, bench_module);
+
+#endif // MICROPY_HW_BENCH
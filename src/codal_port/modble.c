@@ -0,0 +1,82 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+
+#if MICROPY_PY_BLE
+
+// Streams telemetry to a phone or PC over BLE, as notifications of a single characteristic.
+// The SoftDevice owns the RADIO while BLE runs, so the radio module can't be used with it.
+
+STATIC mp_obj_t ble___init__(void) {
+    if (microbit_hal_ble_stream_init() != MICROBIT_HAL_DEVICE_OK) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ble___init___obj, ble___init__);
+
+STATIC mp_obj_t ble_connected(void) {
+    return mp_obj_new_bool(microbit_hal_ble_connected());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ble_connected_obj, ble_connected);
+
+// Queue as much of buf as fits and return the number of bytes taken.  Nothing is queued
+// while no central is connected, so old data isn't sent when one connects.
+STATIC mp_obj_t ble_stream_write(mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (!microbit_hal_ble_connected()) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+    return MP_OBJ_NEW_SMALL_INT(microbit_hal_ble_stream_write(bufinfo.buf, bufinfo.len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ble_stream_write_obj, ble_stream_write);
+
+STATIC mp_obj_t ble_stream_space(void) {
+    return MP_OBJ_NEW_SMALL_INT(microbit_hal_ble_stream_space());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ble_stream_space_obj, ble_stream_space);
+
+STATIC const mp_rom_map_elem_t ble_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ble) },
+    { MP_ROM_QSTR(MP_QSTR___init__), MP_ROM_PTR(&ble___init___obj) },
+    { MP_ROM_QSTR(MP_QSTR_connected), MP_ROM_PTR(&ble_connected_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stream_write), MP_ROM_PTR(&ble_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stream_space), MP_ROM_PTR(&ble_stream_space_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(ble_module_globals, ble_module_globals_table);
+
+const mp_obj_module_t ble_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&ble_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR_ble, ble_module);
+
+#endif // MICROPY_PY_BLE
@@ -0,0 +1,377 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "py/runtime.h"
+#include "modaudio.h"
+
+#if MICROPY_PY_FFT
+
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+// Spectral analysis of sample buffers, such as those filled by pin.sample_into(),
+// microphone.record_into() and accelerometer.read_fifo().
+//
+// A real input of N samples is packed into N/2 complex points, transformed with a
+// radix-2 Q15 FFT that halves the data at each stage so it cannot overflow, then split
+// into N/2 bins of the single-sided amplitude spectrum.  A sine of amplitude A in the
+// input reads as about A in its bin (A/2 with the Hann window).
+
+#define FFT_LOG_TABLE_SIZE (10)
+#define FFT_TABLE_SIZE (1 << FFT_LOG_TABLE_SIZE)
+#define FFT_MIN_SAMPLES (8)
+#define FFT_MAX_SAMPLES (FFT_TABLE_SIZE)
+
+#define FFT_WINDOW_RECT (0)
+#define FFT_WINDOW_HANN (1)
+#define FFT_WINDOW_HAMMING (2)
+
+typedef struct _fft_complex_t {
+    int16_t re;
+    int16_t im;
+} fft_complex_t;
+
+// A quarter of a sine wave, round(32767 * sin(2 * pi * i / FFT_TABLE_SIZE)).
+STATIC const int16_t fft_sine_table[FFT_TABLE_SIZE / 4 + 1] = {
+    0, 201, 402, 603, 804, 1005, 1206, 1407, 1608, 1809, 2009, 2210,
+    2410, 2611, 2811, 3012, 3212, 3412, 3612, 3811, 4011, 4210, 4410, 4609,
+    4808, 5007, 5205, 5404, 5602, 5800, 5998, 6195, 6393, 6590, 6786, 6983,
+    7179, 7375, 7571, 7767, 7962, 8157, 8351, 8545, 8739, 8933, 9126, 9319,
+    9512, 9704, 9896, 10087, 10278, 10469, 10659, 10849, 11039, 11228, 11417, 11605,
+    11793, 11980, 12167, 12353, 12539, 12725, 12910, 13094, 13279, 13462, 13645, 13828,
+    14010, 14191, 14372, 14553, 14732, 14912, 15090, 15269, 15446, 15623, 15800, 15976,
+    16151, 16325, 16499, 16673, 16846, 17018, 17189, 17360, 17530, 17700, 17869, 18037,
+    18204, 18371, 18537, 18703, 18868, 19032, 19195, 19357, 19519, 19680, 19841, 20000,
+    20159, 20317, 20475, 20631, 20787, 20942, 21096, 21250, 21403, 21554, 21705, 21856,
+    22005, 22154, 22301, 22448, 22594, 22739, 22884, 23027, 23170, 23311, 23452, 23592,
+    23731, 23870, 24007, 24143, 24279, 24413, 24547, 24680, 24811, 24942, 25072, 25201,
+    25329, 25456, 25582, 25708, 25832, 25955, 26077, 26198, 26319, 26438, 26556, 26674,
+    26790, 26905, 27019, 27133, 27245, 27356, 27466, 27575, 27683, 27790, 27896, 28001,
+    28105, 28208, 28310, 28411, 28510, 28609, 28706, 28803, 28898, 28992, 29085, 29177,
+    29268, 29358, 29447, 29534, 29621, 29706, 29791, 29874, 29956, 30037, 30117, 30195,
+    30273, 30349, 30424, 30498, 30571, 30643, 30714, 30783, 30852, 30919, 30985, 31050,
+    31113, 31176, 31237, 31297, 31356, 31414, 31470, 31526, 31580, 31633, 31685, 31736,
+    31785, 31833, 31880, 31926, 31971, 32014, 32057, 32098, 32137, 32176, 32213, 32250,
+    32285, 32318, 32351, 32382, 32412, 32441, 32469, 32495, 32521, 32545, 32567, 32589,
+    32609, 32628, 32646, 32663, 32678, 32692, 32705, 32717, 32728, 32737, 32745, 32752,
+    32757, 32761, 32765, 32766, 32767,
+};
+
+// Returns sin(2 * pi * i / FFT_TABLE_SIZE) in Q15.
+STATIC int32_t fft_sin(size_t i) {
+    i &= FFT_TABLE_SIZE - 1;
+    if (i <= FFT_TABLE_SIZE / 4) {
+        return fft_sine_table[i];
+    } else if (i <= FFT_TABLE_SIZE / 2) {
+        return fft_sine_table[FFT_TABLE_SIZE / 2 - i];
+    } else if (i <= 3 * FFT_TABLE_SIZE / 4) {
+        return -fft_sine_table[i - FFT_TABLE_SIZE / 2];
+    } else {
+        return -fft_sine_table[FFT_TABLE_SIZE - i];
+    }
+}
+
+STATIC int32_t fft_cos(size_t i) {
+    return fft_sin(i + FFT_TABLE_SIZE / 4);
+}
+
+STATIC uint32_t fft_isqrt(uint32_t x) {
+    uint32_t result = 0;
+    uint32_t bit = 1 << 30;
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (x >= result + bit) {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+// Multiplies a by the twiddle factor (c - js) in Q15, then sets a to (a + b) / 2 and b to
+// (a - b) / 2.  On the M4 the pairs of 16-bit halves are processed with SIMD instructions.
+static inline void fft_butterfly(fft_complex_t *a, fft_complex_t *b, int32_t c, int32_t s) {
+    #if defined(__ARM_FEATURE_SIMD32)
+    int16x2_t w = (int16x2_t)((uint16_t)c | ((uint32_t)s << 16));
+    int16x2_t bv, av;
+    memcpy(&bv, b, sizeof(bv));
+    memcpy(&av, a, sizeof(av));
+    int32_t t_re = __smuad(bv, w) >> 15;
+    int32_t t_im = -__smusdx(bv, w) >> 15;
+    int16x2_t t = (int16x2_t)((uint16_t)t_re | ((uint32_t)t_im << 16));
+    int16x2_t sum = __shadd16(av, t);
+    int16x2_t diff = __shsub16(av, t);
+    memcpy(a, &sum, sizeof(sum));
+    memcpy(b, &diff, sizeof(diff));
+    #else
+    int32_t t_re = (b->re * c + b->im * s) >> 15;
+    int32_t t_im = (b->im * c - b->re * s) >> 15;
+    int32_t a_re = a->re;
+    int32_t a_im = a->im;
+    a->re = (a_re + t_re) >> 1;
+    a->im = (a_im + t_im) >> 1;
+    b->re = (a_re - t_re) >> 1;
+    b->im = (a_im - t_im) >> 1;
+    #endif
+}
+
+// In-place decimation-in-time FFT of m points, scaled by 1/m.
+STATIC void fft_complex(fft_complex_t *z, size_t m) {
+    // Reorder the input into bit-reversed order.
+    for (size_t i = 1, j = 0; i < m; ++i) {
+        size_t bit = m >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j |= bit;
+        if (i < j) {
+            fft_complex_t tmp = z[i];
+            z[i] = z[j];
+            z[j] = tmp;
+        }
+    }
+
+    for (size_t size = 2; size <= m; size <<= 1) {
+        size_t half = size >> 1;
+        size_t step = FFT_TABLE_SIZE / size;
+        for (size_t k = 0; k < half; ++k) {
+            int32_t c = fft_cos(k * step);
+            int32_t s = fft_sin(k * step);
+            for (size_t start = 0; start < m; start += size) {
+                fft_butterfly(&z[start + k], &z[start + k + half], c, s);
+            }
+        }
+    }
+}
+
+// Converts the transform of the packed real input into the amplitudes of n / 2 bins.
+STATIC void fft_real_spectrum(const fft_complex_t *z, size_t n, uint16_t *out) {
+    size_t m = n / 2;
+    for (size_t k = 0; k < m; ++k) {
+        const fft_complex_t *zk = &z[k];
+        const fft_complex_t *zmk = &z[(m - k) & (m - 1)];
+        // Even part (Zk + conj(Zm-k)) and odd part -j(Zk - conj(Zm-k)), each doubled
+        // to undo the pre-scaling of the input.
+        int32_t fe_re = zk->re + zmk->re;
+        int32_t fe_im = zk->im - zmk->im;
+        int32_t fo_re = zk->im + zmk->im;
+        int32_t fo_im = zmk->re - zk->re;
+        int32_t c = fft_cos(k * (FFT_TABLE_SIZE / n));
+        int32_t s = fft_sin(k * (FFT_TABLE_SIZE / n));
+        int32_t re = fe_re + ((c * fo_re + s * fo_im) >> 15);
+        int32_t im = fe_im + ((c * fo_im - s * fo_re) >> 15);
+        uint64_t sq = (int64_t)re * re + (int64_t)im * im;
+        out[k] = sq >= (uint64_t)0xffff * 0xffff ? 0xffff : fft_isqrt(sq);
+    }
+}
+
+// Returns the window weight of sample i of n in Q15.
+STATIC int32_t fft_window_weight(int window, size_t i, size_t n) {
+    int32_t c = fft_cos(i * (FFT_TABLE_SIZE / n));
+    if (window == FFT_WINDOW_HANN) {
+        return (32767 - c) >> 1;
+    } else if (window == FFT_WINDOW_HAMMING) {
+        return 17695 - ((15073 * c) >> 15);
+    } else {
+        return 32767;
+    }
+}
+
+// Returns sample j of a buffer, with 8-bit samples scaled up to 16 bits.
+STATIC int32_t fft_get_sample(const void *src, char typecode, size_t j) {
+    switch (typecode) {
+        case 'b':
+            return ((const int8_t *)src)[j] << 7;
+        case 'B':
+            return ((const uint8_t *)src)[j] << 7;
+        case 'h':
+            return ((const int16_t *)src)[j];
+        default:
+            return ((const uint16_t *)src)[j];
+    }
+}
+
+// Loads n samples, stride apart, removes their mean, applies the window and stores them
+// halved, so that pairs packed as complex points have a magnitude that fits in Q15.
+STATIC void fft_load_samples(int16_t *dest, const void *src, char typecode, size_t n, size_t stride, int window) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += fft_get_sample(src, typecode, i * stride);
+    }
+    int32_t mean = sum / (int32_t)n;
+    for (size_t i = 0; i < n; ++i) {
+        int32_t value = fft_get_sample(src, typecode, i * stride) - mean;
+        if (value > 32767) {
+            value = 32767;
+        } else if (value < -32768) {
+            value = -32768;
+        }
+        dest[i] = (value * fft_window_weight(window, i, n)) >> 16;
+    }
+}
+
+STATIC mp_obj_t fft_spectrum(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_samples, ARG_out, ARG_window, ARG_stride };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_samples, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_out, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_window, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = FFT_WINDOW_HANN} },
+        { MP_QSTR_stride, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    // Work out the sample format.  AudioFrames hold unsigned samples centred on 128.
+    mp_obj_t samples = args[ARG_samples].u_obj;
+    mp_buffer_info_t src;
+    mp_get_buffer_raise(samples, &src, MP_BUFFER_READ);
+    char typecode = src.typecode;
+    if (mp_obj_is_type(samples, &microbit_audio_frame_type)) {
+        typecode = 'B';
+    }
+    size_t sample_size = 1;
+    if (typecode == 'h' || typecode == 'H') {
+        sample_size = 2;
+    } else if (typecode != 'b' && typecode != 'B') {
+        mp_raise_ValueError(MP_ERROR_TEXT("unsupported sample type"));
+    }
+
+    mp_int_t stride = args[ARG_stride].u_int;
+    mp_int_t window = args[ARG_window].u_int;
+    if (stride < 1) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid stride"));
+    }
+    if (window < FFT_WINDOW_RECT || window > FFT_WINDOW_HAMMING) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid window"));
+    }
+
+    // Use the largest power of two number of samples that the buffer holds.
+    size_t available = (src.len / sample_size + stride - 1) / stride;
+    if (available < FFT_MIN_SAMPLES) {
+        mp_raise_ValueError(MP_ERROR_TEXT("too few samples"));
+    }
+    size_t n = FFT_MAX_SAMPLES;
+    while (n > available) {
+        n >>= 1;
+    }
+
+    mp_buffer_info_t dest;
+    mp_get_buffer_raise(args[ARG_out].u_obj, &dest, MP_BUFFER_WRITE);
+    if (dest.typecode != 'H' || dest.len < n / 2 * sizeof(uint16_t)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("out must be an 'H' array of at least n/2 bins"));
+    }
+
+    int16_t *work = m_new(int16_t, n);
+    fft_load_samples(work, src.buf, typecode, n, stride, window);
+    fft_complex((fft_complex_t *)work, n / 2);
+    fft_real_spectrum((fft_complex_t *)work, n, dest.buf);
+    m_del(int16_t, work, n);
+
+    return MP_OBJ_NEW_SMALL_INT(n / 2);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(fft_spectrum_obj, 2, fft_spectrum);
+
+STATIC mp_obj_t fft_band_energy(mp_obj_t spectrum_in, mp_obj_t edges_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(spectrum_in, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.typecode != 'H') {
+        mp_raise_ValueError(MP_ERROR_TEXT("spectrum must be an 'H' array"));
+    }
+    const uint16_t *bins = bufinfo.buf;
+    size_t num_bins = bufinfo.len / sizeof(uint16_t);
+
+    size_t num_edges;
+    mp_obj_t *edges;
+    mp_obj_get_array(edges_in, &num_edges, &edges);
+    if (num_edges < 2) {
+        mp_raise_ValueError(MP_ERROR_TEXT("need at least 2 edges"));
+    }
+
+    // Sum the squared amplitudes of the bins from each edge up to (not including) the next.
+    mp_obj_t result = mp_obj_new_list(num_edges - 1, NULL);
+    mp_int_t lo = mp_obj_get_int(edges[0]);
+    for (size_t i = 1; i < num_edges; ++i) {
+        mp_int_t hi = mp_obj_get_int(edges[i]);
+        if (lo < 0 || hi < lo || (size_t)hi > num_bins) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid edges"));
+        }
+        uint64_t energy = 0;
+        for (mp_int_t k = lo; k < hi; ++k) {
+            energy += (uint32_t)bins[k] * bins[k];
+        }
+        mp_obj_list_store(result, MP_OBJ_NEW_SMALL_INT(i - 1), mp_obj_new_int_from_ull(energy));
+        lo = hi;
+    }
+    return result;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(fft_band_energy_obj, fft_band_energy);
+
+STATIC mp_obj_t fft_peak(mp_obj_t spectrum_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(spectrum_in, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.typecode != 'H') {
+        mp_raise_ValueError(MP_ERROR_TEXT("spectrum must be an 'H' array"));
+    }
+    const uint16_t *bins = bufinfo.buf;
+    size_t num_bins = bufinfo.len / sizeof(uint16_t);
+
+    // Skip the DC bin, which only holds what is left after removing the mean.
+    size_t peak = 0;
+    for (size_t k = 1; k < num_bins; ++k) {
+        if (peak == 0 || bins[k] > bins[peak]) {
+            peak = k;
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(peak);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(fft_peak_obj, fft_peak);
+
+STATIC const mp_rom_map_elem_t fft_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_fft) },
+    { MP_ROM_QSTR(MP_QSTR_spectrum), MP_ROM_PTR(&fft_spectrum_obj) },
+    { MP_ROM_QSTR(MP_QSTR_band_energy), MP_ROM_PTR(&fft_band_energy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_peak), MP_ROM_PTR(&fft_peak_obj) },
+    { MP_ROM_QSTR(MP_QSTR_RECT), MP_ROM_INT(FFT_WINDOW_RECT) },
+    { MP_ROM_QSTR(MP_QSTR_HANN), MP_ROM_INT(FFT_WINDOW_HANN) },
+    { MP_ROM_QSTR(MP_QSTR_HAMMING), MP_ROM_INT(FFT_WINDOW_HAMMING) },
+};
+STATIC MP_DEFINE_CONST_DICT(fft_module_globals, fft_module_globals_table);
+
+const mp_obj_module_t fft_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&fft_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR_fft, fft_module);
+
+#endif // MICROPY_PY_FFT
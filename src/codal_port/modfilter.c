@@ -0,0 +1,600 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <math.h>
+#include "py/runtime.h"
+#include "modaudio.h"
+#include "modfilter.h"
+
+#if MICROPY_PY_FILTER
+
+// Stateful filters for smoothing sensor readings one sample at a time, or a whole buffer
+// at once as filled by pin.sample_into(), microphone.record_into() and
+// accelerometer.read_fifo().  Samples are integers and all arithmetic is fixed point:
+// smoothed values are kept with 8 fractional bits and IIR coefficients in Q14.
+
+#define FILTER_FRAC_BITS (8)
+#define FILTER_COEF_BITS (14)
+#define FILTER_MAX_WINDOW (255)
+
+typedef struct _filter_mean_obj_t {
+    filter_obj_t base;
+    uint8_t size;
+    uint8_t filled;
+    uint8_t index;
+    int32_t sum;
+    int32_t window[];
+} filter_mean_obj_t;
+
+typedef struct _filter_ema_obj_t {
+    filter_obj_t base;
+    bool primed;
+    uint32_t k; // weight of each new sample, Q16
+    int32_t y; // FILTER_FRAC_BITS fractional bits
+} filter_ema_obj_t;
+
+typedef struct _filter_biquad_obj_t {
+    filter_obj_t base;
+    int32_t b[3]; // Q14
+    int32_t a[2]; // Q14, with a0 normalised to 1
+    int32_t x1, x2;
+    int32_t y1, y2; // FILTER_FRAC_BITS fractional bits
+} filter_biquad_obj_t;
+
+typedef struct _filter_median_obj_t {
+    filter_obj_t base;
+    uint8_t size;
+    uint8_t filled;
+    uint8_t index;
+    // The first size entries are the samples in arrival order, the next size are the
+    // same samples kept sorted.
+    int32_t data[];
+} filter_median_obj_t;
+
+typedef struct _filter_peak_obj_t {
+    filter_obj_t base;
+    bool in_peak;
+    int32_t threshold;
+    int32_t release; // level that ends a peak, threshold - hysteresis
+    int32_t max;
+    uint32_t count;
+} filter_peak_obj_t;
+
+extern const mp_obj_type_t filter_mean_type;
+extern const mp_obj_type_t filter_ema_type;
+extern const mp_obj_type_t filter_biquad_type;
+extern const mp_obj_type_t filter_median_type;
+extern const mp_obj_type_t filter_peak_type;
+
+bool filter_obj_is_filter(mp_const_obj_t o) {
+    return mp_obj_is_type(o, &filter_mean_type)
+           || mp_obj_is_type(o, &filter_ema_type)
+           || mp_obj_is_type(o, &filter_biquad_type)
+           || mp_obj_is_type(o, &filter_median_type)
+           || mp_obj_is_type(o, &filter_peak_type);
+}
+
+STATIC mp_int_t filter_get_window_size(mp_obj_t size_in) {
+    mp_int_t size = mp_obj_get_int(size_in);
+    if (size < 1 || size > FILTER_MAX_WINDOW) {
+        mp_raise_ValueError(MP_ERROR_TEXT("window size must be 1-255"));
+    }
+    return size;
+}
+
+/******************************************************************************/
+// Filter cores, which must not allocate or raise.
+
+STATIC int32_t filter_mean_update(filter_obj_t *self_in, int32_t x) {
+    filter_mean_obj_t *self = (filter_mean_obj_t *)self_in;
+    if (self->filled < self->size) {
+        ++self->filled;
+    } else {
+        self->sum -= self->window[self->index];
+    }
+    self->window[self->index] = x;
+    self->sum += x;
+    if (++self->index == self->size) {
+        self->index = 0;
+    }
+    int32_t half = self->filled / 2;
+    int32_t sum = self->sum >= 0 ? self->sum + half : self->sum - half;
+    self->base.value = sum / self->filled;
+    return self->base.value;
+}
+
+STATIC int32_t filter_ema_update(filter_obj_t *self_in, int32_t x) {
+    filter_ema_obj_t *self = (filter_ema_obj_t *)self_in;
+    int32_t xf = x * (1 << FILTER_FRAC_BITS);
+    if (!self->primed) {
+        self->primed = true;
+        self->y = xf;
+    } else {
+        self->y += ((int64_t)(xf - self->y) * self->k) >> 16;
+    }
+    self->base.value = (self->y + (1 << (FILTER_FRAC_BITS - 1))) >> FILTER_FRAC_BITS;
+    return self->base.value;
+}
+
+// Direct form I, so that the state is just the last inputs and outputs.
+STATIC int32_t filter_biquad_update(filter_obj_t *self_in, int32_t x) {
+    filter_biquad_obj_t *self = (filter_biquad_obj_t *)self_in;
+    int64_t acc = ((int64_t)self->b[0] * x + (int64_t)self->b[1] * self->x1 + (int64_t)self->b[2] * self->x2)
+        * (1 << FILTER_FRAC_BITS);
+    acc -= (int64_t)self->a[0] * self->y1 + (int64_t)self->a[1] * self->y2;
+    acc = (acc + (1 << (FILTER_COEF_BITS - 1))) >> FILTER_COEF_BITS;
+    if (acc > INT32_MAX) {
+        acc = INT32_MAX;
+    } else if (acc < INT32_MIN) {
+        acc = INT32_MIN;
+    }
+    self->x2 = self->x1;
+    self->x1 = x;
+    self->y2 = self->y1;
+    self->y1 = acc;
+    self->base.value = (self->y1 + (1 << (FILTER_FRAC_BITS - 1))) >> FILTER_FRAC_BITS;
+    return self->base.value;
+}
+
+// Keeps the window sorted with one insertion per sample, rather than sorting it each time.
+STATIC int32_t filter_median_update(filter_obj_t *self_in, int32_t x) {
+    filter_median_obj_t *self = (filter_median_obj_t *)self_in;
+    int32_t *ring = self->data;
+    int32_t *sorted = self->data + self->size;
+    size_t n = self->filled;
+    if (n == self->size) {
+        // Remove the oldest sample from the sorted half.
+        int32_t old = ring[self->index];
+        size_t i = 0;
+        while (sorted[i] != old) {
+            ++i;
+        }
+        for (--n; i < n; ++i) {
+            sorted[i] = sorted[i + 1];
+        }
+    } else {
+        ++self->filled;
+    }
+    size_t i = n;
+    for (; i > 0 && sorted[i - 1] > x; --i) {
+        sorted[i] = sorted[i - 1];
+    }
+    sorted[i] = x;
+    ring[self->index] = x;
+    if (++self->index == self->size) {
+        self->index = 0;
+    }
+    self->base.value = sorted[self->filled / 2];
+    return self->base.value;
+}
+
+// A peak starts when the input reaches the threshold and ends when it falls below the
+// release level, at which point the largest input seen in between is recorded.
+STATIC int32_t filter_peak_update(filter_obj_t *self_in, int32_t x) {
+    filter_peak_obj_t *self = (filter_peak_obj_t *)self_in;
+    if (!self->in_peak) {
+        if (x >= self->threshold) {
+            self->in_peak = true;
+            self->max = x;
+        }
+    } else if (x < self->release) {
+        self->in_peak = false;
+        self->base.value = self->max;
+        ++self->count;
+    } else if (x > self->max) {
+        self->max = x;
+    }
+    return x;
+}
+
+/******************************************************************************/
+// Buffers of samples.
+
+STATIC char filter_get_typecode(mp_obj_t buf_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    mp_get_buffer_raise(buf_in, bufinfo, flags);
+    // AudioFrames hold unsigned samples centred on 128.
+    if (mp_obj_is_type(buf_in, &microbit_audio_frame_type)) {
+        return 'B';
+    }
+    char typecode = bufinfo->typecode;
+    if (typecode != 'b' && typecode != 'B' && typecode != 'h' && typecode != 'H' && typecode != 'i') {
+        mp_raise_ValueError(MP_ERROR_TEXT("unsupported sample type"));
+    }
+    return typecode;
+}
+
+STATIC size_t filter_sample_size(char typecode) {
+    if (typecode == 'b' || typecode == 'B') {
+        return 1;
+    } else if (typecode == 'h' || typecode == 'H') {
+        return 2;
+    } else {
+        return 4;
+    }
+}
+
+STATIC int32_t filter_get_sample(const void *buf, char typecode, size_t i) {
+    switch (typecode) {
+        case 'b':
+            return ((const int8_t *)buf)[i];
+        case 'B':
+            return ((const uint8_t *)buf)[i];
+        case 'h':
+            return ((const int16_t *)buf)[i];
+        case 'H':
+            return ((const uint16_t *)buf)[i];
+        default:
+            return ((const int32_t *)buf)[i];
+    }
+}
+
+// Stores a sample, saturating it to the range of the buffer's type.
+STATIC void filter_put_sample(void *buf, char typecode, size_t i, int32_t value) {
+    switch (typecode) {
+        case 'b':
+            ((int8_t *)buf)[i] = MIN(MAX(value, INT8_MIN), INT8_MAX);
+            break;
+        case 'B':
+            ((uint8_t *)buf)[i] = MIN(MAX(value, 0), UINT8_MAX);
+            break;
+        case 'h':
+            ((int16_t *)buf)[i] = MIN(MAX(value, INT16_MIN), INT16_MAX);
+            break;
+        case 'H':
+            ((uint16_t *)buf)[i] = MIN(MAX(value, 0), UINT16_MAX);
+            break;
+        default:
+            ((int32_t *)buf)[i] = value;
+            break;
+    }
+}
+
+/******************************************************************************/
+// Methods shared by all filters.
+
+STATIC mp_obj_t filter_update(mp_obj_t self_in, mp_obj_t x_in) {
+    return MP_OBJ_NEW_SMALL_INT(filter_obj_update(self_in, mp_obj_get_int(x_in)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(filter_update_obj, filter_update);
+
+// Filters src into dest, or in place if dest is not given.  The two may have different
+// sample types, and dest may be shorter than src.  Returns the number of samples written.
+STATIC mp_obj_t filter_process(size_t n_args, const mp_obj_t *args) {
+    filter_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_buffer_info_t src;
+    char src_typecode = filter_get_typecode(args[1], &src, MP_BUFFER_READ);
+    mp_buffer_info_t dest = src;
+    char dest_typecode = src_typecode;
+    if (n_args > 2) {
+        dest_typecode = filter_get_typecode(args[2], &dest, MP_BUFFER_WRITE);
+    }
+    size_t n = MIN(src.len / filter_sample_size(src_typecode), dest.len / filter_sample_size(dest_typecode));
+    for (size_t i = 0; i < n; ++i) {
+        int32_t value = self->update(self, filter_get_sample(src.buf, src_typecode, i));
+        filter_put_sample(dest.buf, dest_typecode, i, value);
+    }
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(filter_process_obj, 2, 3, filter_process);
+
+STATIC mp_obj_t filter_value(mp_obj_t self_in) {
+    filter_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return MP_OBJ_NEW_SMALL_INT(self->value);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(filter_value_obj, filter_value);
+
+// Forgets all past samples, keeping the parameters the filter was made with.
+STATIC mp_obj_t filter_reset(mp_obj_t self_in) {
+    filter_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    self->value = 0;
+    if (mp_obj_is_type(self_in, &filter_mean_type)) {
+        filter_mean_obj_t *mean = MP_OBJ_TO_PTR(self_in);
+        mean->filled = 0;
+        mean->index = 0;
+        mean->sum = 0;
+    } else if (mp_obj_is_type(self_in, &filter_ema_type)) {
+        filter_ema_obj_t *ema = MP_OBJ_TO_PTR(self_in);
+        ema->primed = false;
+    } else if (mp_obj_is_type(self_in, &filter_biquad_type)) {
+        filter_biquad_obj_t *biquad = MP_OBJ_TO_PTR(self_in);
+        biquad->x1 = biquad->x2 = 0;
+        biquad->y1 = biquad->y2 = 0;
+    } else if (mp_obj_is_type(self_in, &filter_median_type)) {
+        filter_median_obj_t *median = MP_OBJ_TO_PTR(self_in);
+        median->filled = 0;
+        median->index = 0;
+    } else {
+        filter_peak_obj_t *peak = MP_OBJ_TO_PTR(self_in);
+        peak->in_peak = false;
+        peak->count = 0;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(filter_reset_obj, filter_reset);
+
+STATIC const mp_rom_map_elem_t filter_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&filter_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_process), MP_ROM_PTR(&filter_process_obj) },
+    { MP_ROM_QSTR(MP_QSTR_value), MP_ROM_PTR(&filter_value_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&filter_reset_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(filter_locals_dict, filter_locals_dict_table);
+
+/******************************************************************************/
+// filter.Mean(size): the average of the last size samples.
+
+STATIC mp_obj_t filter_mean_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t size = filter_get_window_size(args[0]);
+    filter_mean_obj_t *self = m_new_obj_var(filter_mean_obj_t, window, int32_t, size);
+    self->base.base.type = type;
+    self->base.update = filter_mean_update;
+    self->size = size;
+    filter_reset(MP_OBJ_FROM_PTR(self));
+    return MP_OBJ_FROM_PTR(self);
+}
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    filter_mean_type,
+    MP_QSTR_Mean,
+    MP_TYPE_FLAG_NONE,
+    make_new, filter_mean_make_new,
+    locals_dict, &filter_locals_dict
+    );
+
+/******************************************************************************/
+// filter.EMA(alpha): an exponential moving average, where each new sample has weight alpha.
+
+STATIC mp_obj_t filter_ema_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_float_t alpha = mp_obj_get_float(args[0]);
+    if (!(alpha > 0 && alpha <= 1)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("alpha must be in (0, 1]"));
+    }
+    filter_ema_obj_t *self = m_new_obj(filter_ema_obj_t);
+    self->base.base.type = type;
+    self->base.update = filter_ema_update;
+    self->k = MAX(1, (uint32_t)(alpha * 65536 + MICROPY_FLOAT_CONST(0.5)));
+    filter_reset(MP_OBJ_FROM_PTR(self));
+    return MP_OBJ_FROM_PTR(self);
+}
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    filter_ema_type,
+    MP_QSTR_EMA,
+    MP_TYPE_FLAG_NONE,
+    make_new, filter_ema_make_new,
+    locals_dict, &filter_locals_dict
+    );
+
+/******************************************************************************/
+// filter.Biquad(b0, b1, b2, a1, a2): a second order IIR section, with a0 taken as 1.
+
+// Coefficients must fit in Q14 with enough headroom that the sums can't overflow.
+#define FILTER_COEF_MAX (8)
+
+STATIC mp_obj_t filter_biquad_new(const mp_obj_type_t *type, const mp_float_t *coefs) {
+    filter_biquad_obj_t *self = m_new_obj(filter_biquad_obj_t);
+    self->base.base.type = type;
+    self->base.update = filter_biquad_update;
+    for (size_t i = 0; i < 5; ++i) {
+        if (!(coefs[i] > -FILTER_COEF_MAX && coefs[i] < FILTER_COEF_MAX)) {
+            mp_raise_ValueError(MP_ERROR_TEXT("coefficient out of range"));
+        }
+        mp_float_t scaled = coefs[i] * (1 << FILTER_COEF_BITS);
+        int32_t c = (int32_t)(scaled < 0 ? scaled - MICROPY_FLOAT_CONST(0.5) : scaled + MICROPY_FLOAT_CONST(0.5));
+        if (i < 3) {
+            self->b[i] = c;
+        } else {
+            self->a[i - 3] = c;
+        }
+    }
+    filter_reset(MP_OBJ_FROM_PTR(self));
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t filter_biquad_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 5, 5, false);
+    mp_float_t coefs[5];
+    for (size_t i = 0; i < 5; ++i) {
+        coefs[i] = mp_obj_get_float(args[i]);
+    }
+    return filter_biquad_new(type, coefs);
+}
+
+// Designs a low or high pass section from the Audio EQ Cookbook formulas.
+STATIC mp_obj_t filter_biquad_design(size_t n_args, const mp_obj_t *args, bool high) {
+    mp_float_t cutoff = mp_obj_get_float(args[0]);
+    mp_float_t rate = mp_obj_get_float(args[1]);
+    mp_float_t q = n_args > 2 ? mp_obj_get_float(args[2]) : MICROPY_FLOAT_CONST(0.70710678);
+    if (!(cutoff > 0 && cutoff < rate / 2) || !(q > 0)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("cutoff must be below half the rate"));
+    }
+    mp_float_t w0 = 2 * MP_PI * cutoff / rate;
+    mp_float_t cos_w0 = MICROPY_FLOAT_C_FUN(cos)(w0);
+    mp_float_t alpha = MICROPY_FLOAT_C_FUN(sin)(w0) / (2 * q);
+    mp_float_t a0 = 1 + alpha;
+    mp_float_t b1 = high ? -(1 + cos_w0) : 1 - cos_w0;
+    mp_float_t b0 = (high ? -b1 : b1) / 2;
+    mp_float_t coefs[5] = {
+        b0 / a0, b1 / a0, b0 / a0, -2 * cos_w0 / a0, (1 - alpha) / a0,
+    };
+    return filter_biquad_new(&filter_biquad_type, coefs);
+}
+
+STATIC mp_obj_t filter_biquad_lowpass(size_t n_args, const mp_obj_t *args) {
+    return filter_biquad_design(n_args, args, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(filter_biquad_lowpass_obj, 2, 3, filter_biquad_lowpass);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(filter_biquad_lowpass_staticmethod_obj, MP_ROM_PTR(&filter_biquad_lowpass_obj));
+
+STATIC mp_obj_t filter_biquad_highpass(size_t n_args, const mp_obj_t *args) {
+    return filter_biquad_design(n_args, args, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(filter_biquad_highpass_obj, 2, 3, filter_biquad_highpass);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(filter_biquad_highpass_staticmethod_obj, MP_ROM_PTR(&filter_biquad_highpass_obj));
+
+STATIC const mp_rom_map_elem_t filter_biquad_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_lowpass), MP_ROM_PTR(&filter_biquad_lowpass_staticmethod_obj) },
+    { MP_ROM_QSTR(MP_QSTR_highpass), MP_ROM_PTR(&filter_biquad_highpass_staticmethod_obj) },
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&filter_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_process), MP_ROM_PTR(&filter_process_obj) },
+    { MP_ROM_QSTR(MP_QSTR_value), MP_ROM_PTR(&filter_value_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&filter_reset_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(filter_biquad_locals_dict, filter_biquad_locals_dict_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    filter_biquad_type,
+    MP_QSTR_Biquad,
+    MP_TYPE_FLAG_NONE,
+    make_new, filter_biquad_make_new,
+    locals_dict, &filter_biquad_locals_dict
+    );
+
+/******************************************************************************/
+// filter.Median(size): the median of the last size samples, for removing spikes.
+
+STATIC mp_obj_t filter_median_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t size = filter_get_window_size(args[0]);
+    filter_median_obj_t *self = m_new_obj_var(filter_median_obj_t, data, int32_t, 2 * size);
+    self->base.base.type = type;
+    self->base.update = filter_median_update;
+    self->size = size;
+    filter_reset(MP_OBJ_FROM_PTR(self));
+    return MP_OBJ_FROM_PTR(self);
+}
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    filter_median_type,
+    MP_QSTR_Median,
+    MP_TYPE_FLAG_NONE,
+    make_new, filter_median_make_new,
+    locals_dict, &filter_locals_dict
+    );
+
+/******************************************************************************/
+// filter.Peak(threshold, hysteresis=0): detects peaks that rise to the threshold.
+
+STATIC mp_obj_t filter_peak_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    mp_int_t threshold = mp_obj_get_int(args[0]);
+    mp_int_t hysteresis = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
+    if (hysteresis < 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("hysteresis must not be negative"));
+    }
+    filter_peak_obj_t *self = m_new_obj(filter_peak_obj_t);
+    self->base.base.type = type;
+    self->base.update = filter_peak_update;
+    self->threshold = threshold;
+    self->release = threshold - hysteresis;
+    filter_reset(MP_OBJ_FROM_PTR(self));
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Returns the height of the peak that this sample ended, or None.
+STATIC mp_obj_t filter_peak_update_obj_fun(mp_obj_t self_in, mp_obj_t x_in) {
+    filter_peak_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t count = self->count;
+    filter_peak_update(&self->base, mp_obj_get_int(x_in));
+    if (self->count == count) {
+        return mp_const_none;
+    }
+    return MP_OBJ_NEW_SMALL_INT(self->base.value);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(filter_peak_update_obj, filter_peak_update_obj_fun);
+
+// Scans src for peaks, storing the height of each into out if given, and returns how
+// many peaks ended within src.  A peak can start in one buffer and end in the next.
+STATIC mp_obj_t filter_peak_process(size_t n_args, const mp_obj_t *args) {
+    filter_peak_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_buffer_info_t src;
+    char src_typecode = filter_get_typecode(args[1], &src, MP_BUFFER_READ);
+    mp_buffer_info_t out = { .len = 0 };
+    char out_typecode = 'B';
+    if (n_args > 2) {
+        out_typecode = filter_get_typecode(args[2], &out, MP_BUFFER_WRITE);
+    }
+    size_t n = src.len / filter_sample_size(src_typecode);
+    size_t out_len = out.len / filter_sample_size(out_typecode);
+    uint32_t start = self->count;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t count = self->count;
+        filter_peak_update(&self->base, filter_get_sample(src.buf, src_typecode, i));
+        if (self->count != count && count - start < out_len) {
+            filter_put_sample(out.buf, out_typecode, count - start, self->base.value);
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(self->count - start);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(filter_peak_process_obj, 2, 3, filter_peak_process);
+
+// The number of peaks seen since the filter was made or reset.
+STATIC mp_obj_t filter_peak_count(mp_obj_t self_in) {
+    filter_peak_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_int_from_uint(self->count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(filter_peak_count_obj, filter_peak_count);
+
+STATIC const mp_rom_map_elem_t filter_peak_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&filter_peak_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_process), MP_ROM_PTR(&filter_peak_process_obj) },
+    { MP_ROM_QSTR(MP_QSTR_value), MP_ROM_PTR(&filter_value_obj) },
+    { MP_ROM_QSTR(MP_QSTR_count), MP_ROM_PTR(&filter_peak_count_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&filter_reset_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(filter_peak_locals_dict, filter_peak_locals_dict_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    filter_peak_type,
+    MP_QSTR_Peak,
+    MP_TYPE_FLAG_NONE,
+    make_new, filter_peak_make_new,
+    locals_dict, &filter_peak_locals_dict
+    );
+
+/******************************************************************************/
+// filter module
+
+STATIC const mp_rom_map_elem_t filter_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_filter) },
+    { MP_ROM_QSTR(MP_QSTR_Mean), MP_ROM_PTR(&filter_mean_type) },
+    { MP_ROM_QSTR(MP_QSTR_EMA), MP_ROM_PTR(&filter_ema_type) },
+    { MP_ROM_QSTR(MP_QSTR_Biquad), MP_ROM_PTR(&filter_biquad_type) },
+    { MP_ROM_QSTR(MP_QSTR_Median), MP_ROM_PTR(&filter_median_type) },
+    { MP_ROM_QSTR(MP_QSTR_Peak), MP_ROM_PTR(&filter_peak_type) },
+};
+STATIC MP_DEFINE_CONST_DICT(filter_module_globals, filter_module_globals_table);
+
+const mp_obj_module_t filter_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&filter_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR_filter, filter_module);
+
+#endif // MICROPY_PY_FILTER
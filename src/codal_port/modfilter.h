@@ -0,0 +1,53 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_MODFILTER_H
+#define MICROPY_INCLUDED_CODAL_PORT_MODFILTER_H
+
+#include "py/obj.h"
+
+#if MICROPY_PY_FILTER
+
+// Every filter object starts with this header, so that C code can feed samples to
+// any of them without knowing which kind it is.
+typedef struct _filter_obj_t {
+    mp_obj_base_t base;
+    int32_t (*update)(struct _filter_obj_t *self, int32_t x);
+    int32_t value; // latest output, or latest peak for filter.Peak
+} filter_obj_t;
+
+bool filter_obj_is_filter(mp_const_obj_t o);
+
+// Passes one sample through a filter and returns its output.  It does not allocate
+// or raise, so may be called from the soft timer handler.  A filter.Peak returns its
+// input unchanged, and only records the peaks it sees.
+static inline int32_t filter_obj_update(mp_obj_t self_in, int32_t x) {
+    filter_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return self->update(self, x);
+}
+
+#endif // MICROPY_PY_FILTER
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_MODFILTER_H
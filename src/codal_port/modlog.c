@@ -24,12 +24,19 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
 #include "py/runtime.h"
+#include "py/binary.h"
+#include "py/formatfloat.h"
 #include "py/objstr.h"
 #include "py/mperrno.h"
 #include "py/mphal.h"
 
 #define TIMESTAMP_DEFAULT_FORMAT (MICROBIT_HAL_LOG_TIMESTAMP_SECONDS)
+#define BUFFERED_DEFAULT_MAX_DELAY_MS (1000)
+
+// Large enough for any integer, or a float printed with 7 significant digits.
+#define LOG_VALUE_BUF_SIZE (24)
 
 STATIC void log_check_error(int result) {
     if (result == MICROBIT_HAL_DEVICE_NO_RESOURCES) {
@@ -40,7 +47,9 @@ STATIC void log_check_error(int result) {
 }
 
 STATIC mp_obj_t log___init__(void) {
+    microbit_hal_log_set_policy(MICROBIT_HAL_LOG_POLICY_IMMEDIATE, 0);
     microbit_hal_log_set_timestamp(TIMESTAMP_DEFAULT_FORMAT);
+    MP_STATE_PORT(log_labels) = mp_const_none;
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_0(log___init___obj, log___init__);
@@ -69,6 +78,9 @@ STATIC mp_obj_t log_set_labels(size_t n_args, const mp_obj_t *pos_args, mp_map_t
             log_check_error(microbit_hal_log_data(key, ""));
         }
         log_check_error(microbit_hal_log_end_row());
+
+        // Remember the labels so add_rows() knows the column order.
+        MP_STATE_PORT(log_labels) = mp_obj_new_tuple(n_args, pos_args);
     }
 
     return mp_const_none;
@@ -81,6 +93,37 @@ STATIC mp_obj_t log_set_mirroring(mp_obj_t serial) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(log_set_mirroring_obj, log_set_mirroring);
 
+// With log.BUFFERED rows are kept in RAM and written to flash in batches when the
+// micro:bit is idle, at the cost of losing up to max_delay ms of rows on power loss.
+STATIC mp_obj_t log_set_policy(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_policy, ARG_max_delay };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_policy, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_max_delay, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = BUFFERED_DEFAULT_MAX_DELAY_MS} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t policy = args[ARG_policy].u_int;
+    if (policy != MICROBIT_HAL_LOG_POLICY_IMMEDIATE && policy != MICROBIT_HAL_LOG_POLICY_BUFFERED) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid policy"));
+    }
+    if (args[ARG_max_delay].u_int < 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid max_delay"));
+    }
+    microbit_hal_log_set_policy(policy, args[ARG_max_delay].u_int);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(log_set_policy_obj, 1, log_set_policy);
+
+STATIC mp_obj_t log_flush(void) {
+    log_check_error(microbit_hal_log_flush());
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(log_flush_obj, log_flush);
+
 STATIC mp_obj_t log_delete(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     enum { ARG_full };
     static const mp_arg_t allowed_args[] = {
@@ -134,20 +177,116 @@ STATIC mp_obj_t log_add(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_ar
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(log_add_obj, 0, log_add);
 
+STATIC const char *log_format_int(char *buf, mp_int_t value) {
+    char *s = buf + LOG_VALUE_BUF_SIZE;
+    *--s = '\0';
+    mp_uint_t u = value < 0 ? -(mp_uint_t)value : (mp_uint_t)value;
+    do {
+        *--s = '0' + u % 10;
+        u /= 10;
+    } while (u != 0);
+    if (value < 0) {
+        *--s = '-';
+    }
+    return s;
+}
+
+// Format the same way as str() of a float.
+STATIC const char *log_format_float(char *buf, mp_float_t value) {
+    mp_format_float(value, buf, LOG_VALUE_BUF_SIZE - 2, 'g', 7, '\0');
+    if (strchr(buf, '.') == NULL && strchr(buf, 'e') == NULL && strchr(buf, 'n') == NULL) {
+        strcat(buf, ".0");
+    }
+    return buf;
+}
+
+// Convert a value to text without allocating, except for types other than int and float.
+STATIC const char *log_format_value(char *buf, mp_obj_t value) {
+    if (mp_obj_is_small_int(value)) {
+        return log_format_int(buf, MP_OBJ_SMALL_INT_VALUE(value));
+    } else if (mp_obj_is_float(value)) {
+        return log_format_float(buf, mp_obj_get_float(value));
+    } else if (mp_obj_is_integer(value)) {
+        value = mp_obj_str_make_new(&mp_type_str, 1, 0, &value);
+    }
+    return mp_obj_str_get_str(value);
+}
+
+// Add many rows in one call, with columns in the order given to set_labels().  The
+// rows are either a buffer such as an array packed with one value per column, row after
+// row, or an iterable of sequences with one value per column.
+STATIC mp_obj_t log_add_rows(mp_obj_t rows_in) {
+    if (MP_STATE_PORT(log_labels) == mp_const_none) {
+        mp_raise_ValueError(MP_ERROR_TEXT("labels not set"));
+    }
+    size_t num_cols;
+    mp_obj_t *labels;
+    mp_obj_tuple_get(MP_STATE_PORT(log_labels), &num_cols, &labels);
+
+    char value_buf[LOG_VALUE_BUF_SIZE];
+    mp_buffer_info_t bufinfo;
+    if (!mp_obj_is_str(rows_in) && mp_get_buffer(rows_in, &bufinfo, MP_BUFFER_READ)) {
+        size_t num_values = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL);
+        if (num_values % num_cols != 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("incomplete row"));
+        }
+        for (size_t i = 0; i < num_values; i += num_cols) {
+            log_check_error(microbit_hal_log_begin_row());
+            for (size_t c = 0; c < num_cols; ++c) {
+                const char *value_str;
+                if (bufinfo.typecode == 'f') {
+                    value_str = log_format_float(value_buf, ((const float *)bufinfo.buf)[i + c]);
+                } else {
+                    value_str = log_format_value(value_buf, mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, i + c));
+                }
+                log_check_error(microbit_hal_log_data(mp_obj_str_get_str(labels[c]), value_str));
+            }
+            log_check_error(microbit_hal_log_end_row());
+        }
+    } else {
+        mp_obj_iter_buf_t iter_buf;
+        mp_obj_t iterable = mp_getiter(rows_in, &iter_buf);
+        mp_obj_t row;
+        while ((row = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+            size_t len;
+            mp_obj_t *items;
+            mp_obj_get_array(row, &len, &items);
+            if (len != num_cols) {
+                mp_raise_ValueError(MP_ERROR_TEXT("incomplete row"));
+            }
+            log_check_error(microbit_hal_log_begin_row());
+            for (size_t c = 0; c < num_cols; ++c) {
+                const char *value_str = log_format_value(value_buf, items[c]);
+                log_check_error(microbit_hal_log_data(mp_obj_str_get_str(labels[c]), value_str));
+            }
+            log_check_error(microbit_hal_log_end_row());
+        }
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(log_add_rows_obj, log_add_rows);
+
 STATIC const mp_rom_map_elem_t log_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_log) },
     { MP_ROM_QSTR(MP_QSTR___init__), MP_ROM_PTR(&log___init___obj) },
 
     { MP_ROM_QSTR(MP_QSTR_set_labels), MP_ROM_PTR(&log_set_labels_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_mirroring), MP_ROM_PTR(&log_set_mirroring_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_policy), MP_ROM_PTR(&log_set_policy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&log_flush_obj) },
     { MP_ROM_QSTR(MP_QSTR_delete), MP_ROM_PTR(&log_delete_obj) },
     { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&log_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_add_rows), MP_ROM_PTR(&log_add_rows_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_MILLISECONDS), MP_ROM_INT(MICROBIT_HAL_LOG_TIMESTAMP_MILLISECONDS) },
     { MP_ROM_QSTR(MP_QSTR_SECONDS), MP_ROM_INT(MICROBIT_HAL_LOG_TIMESTAMP_SECONDS) },
     { MP_ROM_QSTR(MP_QSTR_MINUTES), MP_ROM_INT(MICROBIT_HAL_LOG_TIMESTAMP_MINUTES) },
     { MP_ROM_QSTR(MP_QSTR_HOURS), MP_ROM_INT(MICROBIT_HAL_LOG_TIMESTAMP_HOURS) },
     { MP_ROM_QSTR(MP_QSTR_DAYS), MP_ROM_INT(MICROBIT_HAL_LOG_TIMESTAMP_DAYS) },
+
+    { MP_ROM_QSTR(MP_QSTR_IMMEDIATE), MP_ROM_INT(MICROBIT_HAL_LOG_POLICY_IMMEDIATE) },
+    { MP_ROM_QSTR(MP_QSTR_BUFFERED), MP_ROM_INT(MICROBIT_HAL_LOG_POLICY_BUFFERED) },
 };
 STATIC MP_DEFINE_CONST_DICT(log_module_globals, log_module_globals_table);
 
@@ -157,3 +296,5 @@ const mp_obj_module_t log_module = {
 };
 
 MP_REGISTER_MODULE(MP_QSTR_log, log_module);
+
+MP_REGISTER_ROOT_POINTER(mp_obj_t log_labels);
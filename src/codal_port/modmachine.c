@@ -25,6 +25,7 @@
  */
 
 #include "py/runtime.h"
+#include "py/mphal.h"
 #include "modmicrobit.h"
 
 #undef MICROPY_PY_MACHINE
@@ -46,6 +47,16 @@ STATIC mp_obj_t machine_freq(void) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(microbit_freq_obj, machine_freq);
 
+// Microseconds from startup until CODAL was initialised, and until main.py started
+STATIC mp_obj_t machine_boot_time(void) {
+    mp_obj_t items[2] = {
+        mp_obj_new_int_from_uint(microbit_hal_boot_time_us()),
+        mp_obj_new_int_from_uint(microbit_main_start_us),
+    };
+    return mp_obj_new_tuple(2, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_boot_time_obj, machine_boot_time);
+
 // Disable interrupt requests
 STATIC mp_obj_t machine_disable_irq(void) {
     return mp_obj_new_int(mp_hal_disable_irq());
@@ -65,6 +76,7 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_unique_id), MP_ROM_PTR(&microbit_unique_id_obj) },
     { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&microbit_reset_obj) },
     { MP_ROM_QSTR(MP_QSTR_freq), MP_ROM_PTR(&microbit_freq_obj) },
+    { MP_ROM_QSTR(MP_QSTR_boot_time), MP_ROM_PTR(&machine_boot_time_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_disable_irq), MP_ROM_PTR(&machine_disable_irq_obj) },
     { MP_ROM_QSTR(MP_QSTR_enable_irq), MP_ROM_PTR(&machine_enable_irq_obj) },
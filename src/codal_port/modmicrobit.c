@@ -25,16 +25,25 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include "py/obj.h"
 #include "py/mphal.h"
+#include "drv_alloc.h"
+#include "drv_event.h"
+#include "drv_gc.h"
 #include "drv_softtimer.h"
+#include "drv_stats.h"
 #include "drv_system.h"
+#include "microbitfs_ext.h"
 #include "modaudio.h"
 #include "modmicrobit.h"
 
-STATIC mp_obj_t microbit_run_every_new(uint32_t period_ms);
+STATIC mp_obj_t microbit_run_every_new(uint64_t period_us);
 
 STATIC mp_obj_t microbit_reset_(void) {
+    #if MICROPY_MBFS
+    microbit_filesystem_finish_sweep();
+    #endif
     microbit_hal_reset();
     return mp_const_none;
 }
@@ -97,7 +106,7 @@ STATIC mp_obj_t microbit_ws2812_write(mp_obj_t pin_in, mp_obj_t buf_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(microbit_ws2812_write_obj, microbit_ws2812_write);
 
 STATIC mp_obj_t microbit_run_every(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_callback, ARG_days, ARG_h, ARG_min, ARG_s, ARG_ms };
+    enum { ARG_callback, ARG_days, ARG_h, ARG_min, ARG_s, ARG_ms, ARG_us };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_callback, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
         { MP_QSTR_days, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
@@ -105,18 +114,20 @@ STATIC mp_obj_t microbit_run_every(size_t n_args, const mp_obj_t *pos_args, mp_m
         { MP_QSTR_min, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_s, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_ms, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_us, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
     };
 
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
-    uint32_t period_ms = args[ARG_days].u_int * 24 * 60 * 60 * 1000
-        + args[ARG_h].u_int * 60 * 60 * 1000
+    uint64_t period_ms = (uint64_t)args[ARG_days].u_int * 24 * 60 * 60 * 1000
+        + (uint64_t)args[ARG_h].u_int * 60 * 60 * 1000
         + args[ARG_min].u_int * 60 * 1000
         + args[ARG_s].u_int * 1000
         + args[ARG_ms].u_int;
+    uint64_t period_us = period_ms * 1000 + args[ARG_us].u_int;
 
-    mp_obj_t run_every = microbit_run_every_new(period_ms);
+    mp_obj_t run_every = microbit_run_every_new(MAX(period_us, MICROBIT_SYSTEM_TIMER_MIN_US));
 
     if (args[ARG_callback].u_obj == mp_const_none) {
         // Return decorator-compatible object.
@@ -163,6 +174,198 @@ STATIC mp_obj_t microbit_scale(size_t n_args, const mp_obj_t *pos_args, mp_map_t
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(microbit_scale_obj, 0, microbit_scale);
 
+STATIC mp_obj_t microbit_event_source_obj(const microbit_event_t *event) {
+    switch (event->source) {
+        case MICROBIT_EVENT_SOURCE_GESTURE:
+            return MP_OBJ_FROM_PTR(&microbit_accelerometer_obj);
+        case MICROBIT_EVENT_SOURCE_SOUND:
+            return MP_OBJ_FROM_PTR(&microbit_microphone_obj);
+        case MICROBIT_EVENT_SOURCE_BUTTON:
+            return MP_OBJ_FROM_PTR(event->id == 0 ? &microbit_button_a_obj : &microbit_button_b_obj);
+        default:
+            switch (event->id) {
+                case MICROBIT_HAL_PIN_P0:
+                    return MP_OBJ_FROM_PTR(&microbit_p0_obj);
+                case MICROBIT_HAL_PIN_P1:
+                    return MP_OBJ_FROM_PTR(&microbit_p1_obj);
+                case MICROBIT_HAL_PIN_P2:
+                    return MP_OBJ_FROM_PTR(&microbit_p2_obj);
+                default:
+                    return MP_OBJ_FROM_PTR(&microbit_pin_logo_obj);
+            }
+    }
+}
+
+STATIC mp_obj_t microbit_event_value_obj(const microbit_event_t *event) {
+    switch (event->source) {
+        case MICROBIT_EVENT_SOURCE_GESTURE:
+            return microbit_accelerometer_gesture_obj(event->value);
+        case MICROBIT_EVENT_SOURCE_SOUND:
+            return microbit_microphone_sound_event_obj(event->value);
+        default:
+            return MP_OBJ_NEW_QSTR(event->value == MICROBIT_HAL_BUTTON_EVT_DOWN ? MP_QSTR_down : MP_QSTR_up);
+    }
+}
+
+// Drain the event queue, returning a list of (time, source, value) tuples, oldest first.
+// The time is in the same units as time.ticks_ms().
+STATIC mp_obj_t microbit_events(void) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    microbit_event_t event;
+    while (microbit_event_pop(&event)) {
+        mp_obj_t items[3] = {
+            MP_OBJ_NEW_SMALL_INT(event.time_ms & (MICROPY_PY_TIME_TICKS_PERIOD - 1)),
+            microbit_event_source_obj(&event),
+            microbit_event_value_obj(&event),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(3, items));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(microbit_events_obj, microbit_events);
+
+STATIC mp_obj_t microbit_events_dropped(void) {
+    return mp_obj_new_int_from_uint(microbit_event_take_dropped());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(microbit_events_dropped_obj, microbit_events_dropped);
+
+STATIC mp_obj_t microbit_set_idle_gc(mp_obj_t threshold_in) {
+    mp_int_t threshold = mp_obj_get_int(threshold_in);
+    if (threshold < 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid threshold"));
+    }
+    microbit_gc_set_idle_threshold(threshold);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_set_idle_gc_obj, microbit_set_idle_gc);
+
+STATIC mp_obj_t microbit_get_idle_gc(void) {
+    return mp_obj_new_int_from_uint(microbit_gc_get_idle_threshold());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(microbit_get_idle_gc_obj, microbit_get_idle_gc);
+
+// Returns (count, last_us, max_us) for the collections since the last reset.
+STATIC mp_obj_t microbit_gc_pauses(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_reset };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset, MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    microbit_gc_pauses_t pauses;
+    microbit_gc_get_pauses(&pauses, args[ARG_reset].u_bool);
+    mp_obj_t items[3] = {
+        mp_obj_new_int_from_uint(pauses.count),
+        mp_obj_new_int_from_uint(pauses.last_us),
+        mp_obj_new_int_from_uint(pauses.max_us),
+    };
+    return mp_obj_new_tuple(3, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(microbit_gc_pauses_obj, 0, microbit_gc_pauses);
+
+#if MICROPY_HW_LATENCY_STATS
+STATIC const qstr microbit_stats_hook_names[MICROBIT_STATS_NUM_HOOKS] = {
+    [MICROBIT_STATS_TIMER_CALLBACK] = MP_QSTR_timer,
+    [MICROBIT_STATS_RADIO_IRQ] = MP_QSTR_radio_irq,
+    [MICROBIT_STATS_AUDIO_FETCH] = MP_QSTR_audio_fetch,
+    [MICROBIT_STATS_AUDIO_SCHED_DELAY] = MP_QSTR_audio_sched_delay,
+    [MICROBIT_STATS_GC_COLLECT] = MP_QSTR_gc_collect,
+};
+
+STATIC mp_obj_t microbit_stats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_reset };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset, MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    // Take a consistent snapshot before allocating, the hooks may fire at any time.
+    microbit_stats_hook_t hooks[MICROBIT_STATS_NUM_HOOKS];
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    memcpy(hooks, microbit_stats_hooks, sizeof(hooks));
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    if (args[ARG_reset].u_bool) {
+        microbit_stats_reset();
+    }
+
+    mp_obj_t result = mp_obj_new_dict(MICROBIT_STATS_NUM_HOOKS);
+    for (size_t i = 0; i < MICROBIT_STATS_NUM_HOOKS; ++i) {
+        mp_obj_t histogram[MICROBIT_STATS_NUM_BUCKETS];
+        for (size_t j = 0; j < MICROBIT_STATS_NUM_BUCKETS; ++j) {
+            histogram[j] = mp_obj_new_int_from_uint(hooks[i].buckets[j]);
+        }
+        mp_obj_t entry = mp_obj_new_dict(4);
+        mp_obj_dict_store(entry, MP_OBJ_NEW_QSTR(MP_QSTR_count), mp_obj_new_int_from_uint(hooks[i].count));
+        mp_obj_dict_store(entry, MP_OBJ_NEW_QSTR(MP_QSTR_min), mp_obj_new_int_from_uint(hooks[i].min_us));
+        mp_obj_dict_store(entry, MP_OBJ_NEW_QSTR(MP_QSTR_max), mp_obj_new_int_from_uint(hooks[i].max_us));
+        mp_obj_dict_store(entry, MP_OBJ_NEW_QSTR(MP_QSTR_histogram), mp_obj_new_tuple(MICROBIT_STATS_NUM_BUCKETS, histogram));
+        mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(microbit_stats_hook_names[i]), entry);
+    }
+    return result;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(microbit_stats_obj, 0, microbit_stats);
+#endif
+
+#if MICROPY_HW_ALLOC_TRACE
+STATIC const qstr microbit_alloc_site_names[MICROBIT_ALLOC_NUM_SITES] = {
+    [MICROBIT_ALLOC_SITE_IMAGE] = MP_QSTR_image,
+    [MICROBIT_ALLOC_SITE_AUDIO_FRAME] = MP_QSTR_audio_frame,
+    [MICROBIT_ALLOC_SITE_RADIO_RECEIVE] = MP_QSTR_radio_receive,
+    [MICROBIT_ALLOC_SITE_ARENA_OVERFLOW] = MP_QSTR_arena_overflow,
+    [MICROBIT_ALLOC_SITE_NEOPIXEL] = MP_QSTR_neopixel,
+    [MICROBIT_ALLOC_SITE_SPEECH] = MP_QSTR_speech,
+    [MICROBIT_ALLOC_SITE_FILE] = MP_QSTR_file,
+};
+
+// Returns a dict of (count, bytes) allocated by each driver call site.
+STATIC mp_obj_t microbit_alloc_stats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_reset };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset, MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    // Take a snapshot first, because building the result allocates.
+    microbit_alloc_site_t sites[MICROBIT_ALLOC_NUM_SITES];
+    memcpy(sites, microbit_alloc_sites, sizeof(sites));
+    if (args[ARG_reset].u_bool) {
+        microbit_alloc_reset();
+    }
+
+    mp_obj_t result = mp_obj_new_dict(MICROBIT_ALLOC_NUM_SITES);
+    for (size_t i = 0; i < MICROBIT_ALLOC_NUM_SITES; ++i) {
+        mp_obj_t entry[2] = {
+            mp_obj_new_int_from_uint(sites[i].count),
+            mp_obj_new_int_from_uint(sites[i].bytes),
+        };
+        mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(microbit_alloc_site_names[i]), mp_obj_new_tuple(2, entry));
+    }
+    return result;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(microbit_alloc_stats_obj, 0, microbit_alloc_stats);
+
+// Returns (free_runs, used_objects), histograms of the heap by size in GC blocks.
+STATIC mp_obj_t microbit_heap_map(void) {
+    microbit_heap_histogram_t hist;
+    microbit_heap_histogram(&hist);
+    mp_obj_t free_runs[MICROBIT_ALLOC_NUM_BUCKETS];
+    mp_obj_t used_objects[MICROBIT_ALLOC_NUM_BUCKETS];
+    for (size_t i = 0; i < MICROBIT_ALLOC_NUM_BUCKETS; ++i) {
+        free_runs[i] = mp_obj_new_int_from_uint(hist.free_runs[i]);
+        used_objects[i] = mp_obj_new_int_from_uint(hist.used_objects[i]);
+    }
+    mp_obj_t items[2] = {
+        mp_obj_new_tuple(MICROBIT_ALLOC_NUM_BUCKETS, free_runs),
+        mp_obj_new_tuple(MICROBIT_ALLOC_NUM_BUCKETS, used_objects),
+    };
+    return mp_obj_new_tuple(2, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(microbit_heap_map_obj, microbit_heap_map);
+#endif
+
 STATIC const mp_rom_map_elem_t microbit_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_microbit) },
 
@@ -192,7 +395,20 @@ STATIC const mp_rom_map_elem_t microbit_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_ws2812_write), MP_ROM_PTR(&microbit_ws2812_write_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_run_every), MP_ROM_PTR(&microbit_run_every_obj) },
+    { MP_ROM_QSTR(MP_QSTR_TimerAction), MP_ROM_PTR(&microbit_timer_action_type) },
     { MP_ROM_QSTR(MP_QSTR_scale), MP_ROM_PTR(&microbit_scale_obj) },
+    { MP_ROM_QSTR(MP_QSTR_events), MP_ROM_PTR(&microbit_events_obj) },
+    { MP_ROM_QSTR(MP_QSTR_events_dropped), MP_ROM_PTR(&microbit_events_dropped_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_idle_gc), MP_ROM_PTR(&microbit_set_idle_gc_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_idle_gc), MP_ROM_PTR(&microbit_get_idle_gc_obj) },
+    { MP_ROM_QSTR(MP_QSTR_gc_pauses), MP_ROM_PTR(&microbit_gc_pauses_obj) },
+    #if MICROPY_HW_LATENCY_STATS
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&microbit_stats_obj) },
+    #endif
+    #if MICROPY_HW_ALLOC_TRACE
+    { MP_ROM_QSTR(MP_QSTR_alloc_stats), MP_ROM_PTR(&microbit_alloc_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_heap_map), MP_ROM_PTR(&microbit_heap_map_obj) },
+    #endif
 
     { MP_ROM_QSTR(MP_QSTR_pin0), MP_ROM_PTR(&microbit_p0_obj) },
     { MP_ROM_QSTR(MP_QSTR_pin1), MP_ROM_PTR(&microbit_p1_obj) },
@@ -266,12 +482,27 @@ STATIC mp_obj_t microbit_run_every_callback(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(microbit_run_every_callback_obj, microbit_run_every_callback);
 
+// Runs a TimerAction straight from the soft timer handler.
+STATIC void microbit_run_every_action_callback(microbit_soft_timer_entry_t *entry) {
+    microbit_run_every_obj_t *self = (microbit_run_every_obj_t *)entry;
+    if (!microbit_timer_action_run(self->user_callback)) {
+        // The action was stopped, so don't put the timer back on the heap.
+        self->timer.mode = MICROBIT_SOFT_TIMER_MODE_ONE_SHOT;
+    }
+}
+
 STATIC mp_obj_t microbit_run_every_obj_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     microbit_run_every_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_arg_check_num(n_args, n_kw, 1, 1, false);
-    self->timer.py_callback = MP_OBJ_FROM_PTR(&microbit_run_every_callback_obj);
+    if (mp_obj_is_type(args[0], &microbit_timer_action_type)) {
+        self->timer.flags &= ~MICROBIT_SOFT_TIMER_FLAG_PY_CALLBACK;
+        self->timer.c_callback = microbit_run_every_action_callback;
+    } else {
+        self->timer.flags |= MICROBIT_SOFT_TIMER_FLAG_PY_CALLBACK;
+        self->timer.py_callback = MP_OBJ_FROM_PTR(&microbit_run_every_callback_obj);
+    }
     self->user_callback = args[0];
-    microbit_soft_timer_insert(&self->timer, self->timer.delta_ms);
+    microbit_soft_timer_insert(&self->timer, self->timer.delta_us);
     return self_in;
 }
 
@@ -282,12 +513,12 @@ STATIC MP_DEFINE_CONST_OBJ_TYPE(
     call, microbit_run_every_obj_call
     );
 
-STATIC mp_obj_t microbit_run_every_new(uint32_t period_ms) {
+STATIC mp_obj_t microbit_run_every_new(uint64_t period_us) {
     microbit_run_every_obj_t *self = m_new_obj(microbit_run_every_obj_t);
     self->timer.pairheap.base.type = &microbit_run_every_obj_type;
     self->timer.flags = MICROBIT_SOFT_TIMER_FLAG_PY_CALLBACK | MICROBIT_SOFT_TIMER_FLAG_GC_ALLOCATED;
     self->timer.mode = MICROBIT_SOFT_TIMER_MODE_PERIODIC;
-    self->timer.delta_ms = period_ms;
+    self->timer.delta_us = period_us;
     self->user_callback = MP_OBJ_NULL;
     return MP_OBJ_FROM_PTR(self);
 }
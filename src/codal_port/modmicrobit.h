@@ -88,6 +88,7 @@ extern const mp_obj_type_t microbit_touch_only_pin_type;
 extern const mp_obj_type_t microbit_sound_type;
 extern const mp_obj_type_t microbit_soundeffect_type;
 extern const mp_obj_type_t microbit_soundevent_type;
+extern const mp_obj_type_t microbit_timer_action_type;
 
 extern const struct _microbit_pin_obj_t microbit_p0_obj;
 extern const struct _microbit_pin_obj_t microbit_p1_obj;
@@ -208,6 +209,8 @@ uint8_t microbit_obj_get_button_id(mp_obj_t button);
 const microbit_pin_obj_t *microbit_obj_get_pin(mp_const_obj_t o);
 uint8_t microbit_obj_get_pin_name(mp_obj_t o);
 
+bool microbit_timer_action_run(mp_obj_t self_in);
+
 // Release pin for use by other modes. Safe to call in an interrupt.
 // If pin is NULL or pin already unused, then this is a no-op
 void microbit_obj_pin_free(const microbit_pin_obj_t *pin);
@@ -233,8 +236,22 @@ void pinmode_error(const microbit_pin_obj_t *pin);
 
 void microbit_pin_audio_speaker_enable(bool enable);
 void microbit_pin_audio_select(mp_const_obj_t select, const microbit_pinmode_t *pinmode);
+void microbit_pin_audio_select_direct(mp_const_obj_t select, const microbit_pinmode_t *pinmode);
 void microbit_pin_audio_free(void);
+void microbit_pin_sample_stop(void);
+void microbit_pin_irq_deinit(void);
+void microbit_spi_deinit(void);
+void microbit_uart_deinit(void);
+void microbit_neopixel_deinit(void);
+void microbit_microphone_stop_recording(void);
+mp_obj_t microbit_microphone_sound_event_obj(uint8_t sound);
+mp_obj_t microbit_accelerometer_gesture_obj(uint8_t gesture);
+
+extern uint32_t microbit_main_start_us;
 
 MP_DECLARE_CONST_FUN_OBJ_0(microbit_reset_obj);
+MP_DECLARE_CONST_FUN_OBJ_KW(microbit_pin_irq_obj);
+MP_DECLARE_CONST_FUN_OBJ_1(microbit_pin_edges_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(microbit_pin_edge_count_obj);
 
 #endif // MICROPY_INCLUDED_MICROBIT_MODMICROBIT_H
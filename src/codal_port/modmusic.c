@@ -24,6 +24,7 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
 #include "py/runtime.h"
 #include "py/objstr.h"
 #include "py/mphal.h"
@@ -43,30 +44,94 @@
 #define MUSIC_OUTPUT_AMPLITUDE_OFF (0)
 #define MUSIC_OUTPUT_AMPLITUDE_ON (128)
 
+#if MICROPY_HW_MUSIC_SYNTH
+// Music is synthesised as a square wave on its own audio mixer channel, and the times
+// between its events are counted in samples of that channel.
+#define MUSIC_SYNTH_SAMPLE_RATE (31250)
+#define MUSIC_SYNTH_LEVEL (16) // matches MUSIC_OUTPUT_AMPLITUDE_ON on the 10-bit mixer pin
+#define MUSIC_UNITS_PER_SECOND (MUSIC_SYNTH_SAMPLE_RATE)
+#else
+// Music changes the PWM period of the mixer pin, from the system timer, and the times
+// between its events are counted in milliseconds.
+#define MUSIC_UNITS_PER_SECOND (1000)
+#endif
+#define MUSIC_UNITS_FROM_MS(ms) ((uint64_t)(ms) * MUSIC_UNITS_PER_SECOND / 1000)
+#define ARTICULATION_UNITS ((mp_int_t)MUSIC_UNITS_FROM_MS(ARTICULATION_MS))
+
 enum {
     ASYNC_MUSIC_STATE_IDLE,
     ASYNC_MUSIC_STATE_NEXT_NOTE,
     ASYNC_MUSIC_STATE_ARTICULATE,
 };
 
+// A note of a compiled tune.  The duration is kept in ticks, rather than milliseconds,
+// so that the tempo can still be changed while a compiled tune plays.
+typedef struct _music_event_t {
+    uint32_t period_us : 24; // 0 for a rest
+    uint32_t duration : 8;
+} music_event_t;
+
+// The result of music.compile(), which play() can use without parsing any strings.
+typedef struct _music_tune_obj_t {
+    mp_obj_base_t base;
+    size_t len;
+    music_event_t events[];
+} music_tune_obj_t;
+
 typedef struct _music_data_t {
     uint16_t bpm;
     uint16_t ticks;
 
-    // store these to simplify the writing process
-    uint8_t last_octave;
-    uint8_t last_duration;
-
     // Asynchronous parts.
     volatile uint8_t async_state;
     bool async_loop;
+    #if MICROPY_HW_MUSIC_SYNTH
+    volatile uint32_t async_wait_samples;
+    #else
     uint32_t async_wait_ticks;
-    uint16_t async_notes_len;
+    #endif
     uint16_t async_notes_index;
-    mp_obj_t async_note;
+    music_tune_obj_t *async_tune;
+
+    // The last tuple of notes that was played, and its compiled form.  Tuples of
+    // strings can't change, so playing the same one again (eg a built-in tune)
+    // doesn't need to compile it again.
+    mp_obj_t compiled_src;
+    music_tune_obj_t *compiled_tune;
+
+    #if MICROPY_HW_MUSIC_SYNTH
+    // Square wave generator, with the phase as a 32-bit fraction of a period.
+    volatile bool synth_on;
+    volatile uint32_t synth_phase_inc;
+    uint32_t synth_phase;
+    #endif
 } music_data_t;
 
-STATIC uint32_t start_note(const char *note_str, size_t note_len);
+STATIC const mp_obj_type_t microbit_music_tune_type;
+
+STATIC uint32_t start_note(const music_event_t *event);
+
+#if MICROPY_HW_MUSIC_SYNTH
+
+STATIC void music_output_amplitude(uint32_t amplitude) {
+    music_data->synth_on = amplitude != MUSIC_OUTPUT_AMPLITUDE_OFF;
+}
+
+STATIC int music_output_period_us(uint32_t period) {
+    // The tone must be below the Nyquist frequency of the channel.
+    if ((uint64_t)period * MUSIC_SYNTH_SAMPLE_RATE < 2000000) {
+        return -1;
+    }
+    music_data->synth_phase_inc = ((uint64_t)1000000 << 32) / ((uint64_t)period * MUSIC_SYNTH_SAMPLE_RATE);
+    return 0;
+}
+
+// Make sure the music channel is pulling samples, after starting something to play.
+STATIC void music_output_start(void) {
+    microbit_hal_audio_music_init(MUSIC_SYNTH_SAMPLE_RATE);
+}
+
+#else
 
 STATIC void music_output_amplitude(uint32_t amplitude) {
     microbit_hal_pin_write_analog_u10(MICROBIT_HAL_PIN_MIXER, amplitude);
@@ -76,10 +141,108 @@ STATIC int music_output_period_us(uint32_t period) {
     return microbit_hal_pin_set_analog_period_us(MICROBIT_HAL_PIN_MIXER, period);
 }
 
+STATIC void music_output_start(void) {
+    microbit_system_timer_update();
+}
+
+#endif
+
 bool microbit_music_is_playing(void) {
     return music_data != NULL && music_data->async_state != ASYNC_MUSIC_STATE_IDLE;
 }
 
+// Move the background music on to its next state, returning how long that state lasts
+// in units of MUSIC_UNITS_PER_SECOND.  The music is idle if it has finished.
+STATIC uint32_t music_next_state(void) {
+    if (music_data->async_state == ASYNC_MUSIC_STATE_ARTICULATE) {
+        // turn off output and rest
+        music_output_amplitude(MUSIC_OUTPUT_AMPLITUDE_OFF);
+        music_data->async_state = ASYNC_MUSIC_STATE_NEXT_NOTE;
+        return ARTICULATION_UNITS;
+    } else {
+        // play next note
+        music_tune_obj_t *tune = music_data->async_tune;
+        if (tune == NULL || music_data->async_notes_index >= tune->len) {
+            if (tune != NULL && tune->len > 0 && music_data->async_loop) {
+                music_data->async_notes_index = 0;
+            } else {
+                music_data->async_state = ASYNC_MUSIC_STATE_IDLE;
+                return 0;
+            }
+        }
+        uint32_t delay_on = start_note(&tune->events[music_data->async_notes_index]);
+        music_data->async_notes_index += 1;
+        music_data->async_state = ASYNC_MUSIC_STATE_ARTICULATE;
+        return delay_on;
+    }
+}
+
+#if MICROPY_HW_MUSIC_SYNTH
+
+uint32_t microbit_music_get_ms_to_next_event(void) {
+    // The music channel keeps its own time.
+    return UINT32_MAX;
+}
+
+void microbit_music_tick(void) {
+}
+
+// Called by the music channel of the audio mixer when it needs more samples.  Returns
+// the number of samples written, which is 0 if there is nothing to play.
+size_t microbit_hal_audio_music_ready_callback(uint8_t *buf, size_t num_samples) {
+    if (music_data == NULL
+        || (music_data->async_state == ASYNC_MUSIC_STATE_IDLE && !music_data->synth_on)) {
+        return 0;
+    }
+
+    size_t i = 0;
+    while (i < num_samples) {
+        // Run the events that are due at this sample.
+        size_t n = num_samples - i;
+        if (music_data->async_state != ASYNC_MUSIC_STATE_IDLE) {
+            while (music_data->async_wait_samples == 0) {
+                music_data->async_wait_samples = music_next_state();
+                if (music_data->async_state == ASYNC_MUSIC_STATE_IDLE) {
+                    break;
+                }
+            }
+            if (music_data->async_state != ASYNC_MUSIC_STATE_IDLE) {
+                n = MIN(n, music_data->async_wait_samples);
+                music_data->async_wait_samples -= n;
+            }
+        }
+
+        // Synthesise the output up to the next event.
+        if (music_data->synth_on) {
+            uint32_t phase = music_data->synth_phase;
+            uint32_t phase_inc = music_data->synth_phase_inc;
+            for (size_t j = 0; j < n; ++j) {
+                buf[i + j] = (phase & 0x80000000) ? 128 + MUSIC_SYNTH_LEVEL : 128 - MUSIC_SYNTH_LEVEL;
+                phase += phase_inc;
+            }
+            music_data->synth_phase = phase;
+        } else {
+            memset(buf + i, 128, n);
+        }
+        i += n;
+    }
+
+    return num_samples;
+}
+
+#else
+
+uint32_t microbit_music_get_ms_to_next_event(void) {
+    if (!microbit_music_is_playing()) {
+        return UINT32_MAX;
+    }
+    int32_t dt = music_data->async_wait_ticks - mp_hal_ticks_ms();
+    if (dt <= 0) {
+        return 0;
+    }
+    return dt;
+}
+
 // This runs on a hardware interrupt.
 void microbit_music_tick(void) {
     if (music_data == NULL) {
@@ -97,41 +260,11 @@ void microbit_music_tick(void) {
         return;
     }
 
-    if (music_data->async_state == ASYNC_MUSIC_STATE_ARTICULATE) {
-        // turn off output and rest
-        music_output_amplitude(MUSIC_OUTPUT_AMPLITUDE_OFF);
-        music_data->async_wait_ticks = mp_hal_ticks_ms() + ARTICULATION_MS;
-        music_data->async_state = ASYNC_MUSIC_STATE_NEXT_NOTE;
-    } else if (music_data->async_state == ASYNC_MUSIC_STATE_NEXT_NOTE) {
-        // play next note
-        if (music_data->async_notes_index >= music_data->async_notes_len) {
-            if (music_data->async_loop) {
-                music_data->async_notes_index = 0;
-            } else {
-                music_data->async_state = ASYNC_MUSIC_STATE_IDLE;
-                return;
-            }
-        }
-        mp_obj_t note;
-        if (music_data->async_notes_len == 1) {
-            note = music_data->async_note;
-        } else {
-            note = ((mp_obj_t *)music_data->async_note)[music_data->async_notes_index];
-        }
-        if (!mp_obj_is_str_or_bytes(note)) {
-            mp_printf(&mp_plat_print, "TypeError: expecting a str for note\n");
-            music_data->async_state = ASYNC_MUSIC_STATE_IDLE;
-            return;
-        }
-        mp_uint_t note_len;
-        const char *note_str = mp_obj_str_get_data(note, &note_len);
-        uint32_t delay_on = start_note(note_str, note_len);
-        music_data->async_wait_ticks = mp_hal_ticks_ms() + delay_on;
-        music_data->async_notes_index += 1;
-        music_data->async_state = ASYNC_MUSIC_STATE_ARTICULATE;
-    }
+    music_data->async_wait_ticks = mp_hal_ticks_ms() + music_next_state();
 }
 
+#endif
+
 STATIC void wait_async_music_idle(void) {
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
@@ -149,26 +282,26 @@ STATIC void wait_async_music_idle(void) {
     }
 }
 
-STATIC uint32_t start_note(const char *note_str, size_t note_len) {
-    music_output_amplitude(MUSIC_OUTPUT_AMPLITUDE_ON);
-
+// Parse a note string into an event.  The octave and duration carry on from the
+// previous note, so they are updated in place.
+STATIC void compile_note(const char *note_str, size_t note_len, music_event_t *event, uint8_t *last_octave, uint8_t *last_duration) {
     // [NOTE](#|b)(octave)(:length)
     // technically, c4 is middle c, so we'll go with that...
     // if we define A as 0 and G as 7, then we can use the following
     // array of us periods
 
     // these are the periods of note4 (the octave ascending from middle c) from A->B then C->G
-    STATIC uint16_t periods_us[] = {2273, 2025, 3822, 3405, 3034, 2863, 2551};
+    STATIC const uint16_t periods_us[] = {2273, 2025, 3822, 3405, 3034, 2863, 2551};
     // A#, -, C#, D#, -, F#, G#
-    STATIC uint16_t periods_sharps_us[] = {2145, 0, 3608, 3214, 0, 2703, 2408};
+    STATIC const uint16_t periods_sharps_us[] = {2145, 0, 3608, 3214, 0, 2703, 2408};
+
+    if (note_len == 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid note"));
+    }
 
     // we'll represent the note as an integer (A=0, G=6)
-    // TODO: validate the note
     uint8_t note_index = (note_str[0] & 0x1f) - 1;
 
-    // TODO: the duration and bpm should be persistent between notes
-    uint32_t ms_per_tick = (60000 / music_data->bpm) / music_data->ticks;
-
     int8_t octave = 0;
     bool sharp = false;
 
@@ -198,11 +331,11 @@ STATIC uint32_t start_note(const char *note_str, size_t note_len) {
     if (current_position < note_len && note_str[current_position] != ':') {
         // currently this will only work with a one digit number
         // use +=, since the sharp/flat code changes octave to compensate.
-        music_data->last_octave = (note_str[current_position] & 0xf);
+        *last_octave = (note_str[current_position] & 0xf);
         current_position++;
     }
 
-    octave += music_data->last_octave;
+    octave += *last_octave;
 
     // parse the duration
     if (current_position < note_len && note_str[current_position] == ':') {
@@ -210,12 +343,12 @@ STATIC uint32_t start_note(const char *note_str, size_t note_len) {
         current_position++;
 
         if (current_position < note_len) {
-            music_data->last_duration = note_str[current_position] & 0xf;
+            *last_duration = note_str[current_position] & 0xf;
 
             current_position++;
             if (current_position < note_len) {
-                music_data->last_duration *= 10;
-                music_data->last_duration += note_str[current_position] & 0xf;
+                *last_duration *= 10;
+                *last_duration += note_str[current_position] & 0xf;
             }
         } else {
             // technically, this should be a syntax error, since this means
@@ -223,51 +356,128 @@ STATIC uint32_t start_note(const char *note_str, size_t note_len) {
             // we'll let you off :D
         }
     }
-    // play the note!
 
     // make the octave relative to octave 4
     octave -= 4;
 
-    // 18 is 'r' or 'R'
-    if (note_index < 10) {
-        uint32_t period;
+    // anything other than A-G (eg 'r' or 'R') is a rest
+    uint32_t period = 0;
+    if (note_index < MP_ARRAY_SIZE(periods_us)) {
         if (sharp) {
-            if (octave >= 0) {
-                period = periods_sharps_us[note_index] >> octave;
-            }
-            else {
-                period = periods_sharps_us[note_index] << -octave;
-            }
+            period = periods_sharps_us[note_index];
         } else {
-            if (octave >= 0) {
-                period = periods_us[note_index] >> octave;
-            }
-            else {
-                period = periods_us[note_index] << -octave;
-            }
+            period = periods_us[note_index];
+        }
+        if (octave >= 0) {
+            period >>= octave;
+        } else {
+            period <<= -octave;
+        }
+    }
+    event->period_us = period;
+    event->duration = *last_duration;
+}
+
+// Convert a note string, or a sequence of them, to a compiled tune.
+STATIC music_tune_obj_t *music_compile_tune(mp_obj_t tune_in) {
+    if (mp_obj_is_type(tune_in, &microbit_music_tune_type)) {
+        return MP_OBJ_TO_PTR(tune_in);
+    }
+
+    // Playing the same tuple again can reuse its compiled form.
+    bool is_tuple = mp_obj_is_type(tune_in, &mp_type_tuple);
+    if (is_tuple && tune_in == music_data->compiled_src) {
+        return music_data->compiled_tune;
+    }
+
+    // get either a single note or a list of notes
+    size_t len;
+    mp_obj_t *items;
+    if (mp_obj_is_str_or_bytes(tune_in)) {
+        len = 1;
+        items = &tune_in;
+    } else {
+        mp_obj_get_array(tune_in, &len, &items);
+    }
+
+    // The octave and duration start from the defaults so tunes always play the same.
+    uint8_t last_octave = DEFAULT_OCTAVE;
+    uint8_t last_duration = DEFAULT_DURATION;
+    music_tune_obj_t *tune = m_new_obj_var(music_tune_obj_t, events, music_event_t, len);
+    tune->base.type = &microbit_music_tune_type;
+    tune->len = len;
+    for (size_t i = 0; i < len; ++i) {
+        if (!mp_obj_is_str_or_bytes(items[i])) {
+            mp_raise_TypeError(MP_ERROR_TEXT("expecting a str for note"));
         }
-        music_output_period_us(period);
+        size_t note_len;
+        const char *note_str = mp_obj_str_get_data(items[i], &note_len);
+        compile_note(note_str, note_len, &tune->events[i], &last_octave, &last_duration);
+    }
+
+    if (is_tuple) {
+        music_data->compiled_src = tune_in;
+        music_data->compiled_tune = tune;
+    }
+    return tune;
+}
+
+// This runs on a hardware interrupt, so only works from the compiled event.  Returns
+// the time until the articulation, in units of MUSIC_UNITS_PER_SECOND.
+STATIC uint32_t start_note(const music_event_t *event) {
+    uint32_t units_per_tick = (60 * MUSIC_UNITS_PER_SECOND / music_data->bpm) / music_data->ticks;
+
+    // play the note!
+    if (event->period_us != 0) {
+        music_output_amplitude(MUSIC_OUTPUT_AMPLITUDE_ON);
+        music_output_period_us(event->period_us);
     } else {
         music_output_amplitude(MUSIC_OUTPUT_AMPLITUDE_OFF);
     }
 
     // Cut off a short time from end of note so we hear articulation.
-    mp_int_t gap_ms = (ms_per_tick * music_data->last_duration) - ARTICULATION_MS;
-    if (gap_ms < ARTICULATION_MS) {
-        gap_ms = ARTICULATION_MS;
+    mp_int_t gap = (units_per_tick * event->duration) - ARTICULATION_UNITS;
+    if (gap < ARTICULATION_UNITS) {
+        gap = ARTICULATION_UNITS;
     }
-    return gap_ms;
+    return gap;
 }
 
 STATIC mp_obj_t microbit_music_reset(void) {
     music_data->bpm = DEFAULT_BPM;
     music_data->ticks = DEFAULT_TICKS;
-    music_data->last_octave = DEFAULT_OCTAVE;
-    music_data->last_duration = DEFAULT_DURATION;
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_0(microbit_music_reset_obj, microbit_music_reset);
 
+STATIC mp_obj_t microbit_music_compile(mp_obj_t tune_in) {
+    return MP_OBJ_FROM_PTR(music_compile_tune(tune_in));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(microbit_music_compile_obj, microbit_music_compile);
+
+STATIC mp_int_t microbit_music_tune_get_len(mp_obj_t self_in) {
+    music_tune_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return self->len;
+}
+
+STATIC mp_obj_t microbit_music_tune_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    switch (op) {
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(microbit_music_tune_get_len(self_in));
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(microbit_music_tune_get_len(self_in) != 0);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    microbit_music_tune_type,
+    MP_QSTR_MicroBitTune,
+    MP_TYPE_FLAG_NONE,
+    unary_op, microbit_music_tune_unary_op
+    );
+
 STATIC mp_obj_t microbit_music_get_tempo(void) {
     mp_obj_t tempo_tuple[2];
     tempo_tuple[0] = mp_obj_new_int(music_data->bpm);
@@ -308,19 +518,8 @@ STATIC mp_obj_t microbit_music_play(mp_uint_t n_args, const mp_obj_t *pos_args,
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
-    // reset octave and duration so tunes always play the same
-    music_data->last_octave = DEFAULT_OCTAVE;
-    music_data->last_duration = DEFAULT_DURATION;
-
-    // get either a single note or a list of notes
-    mp_uint_t len;
-    mp_obj_t *items;
-    if (MP_OBJ_IS_STR_OR_BYTES(args[0].u_obj)) {
-        len = 1;
-        items = &args[0].u_obj;
-    } else {
-        mp_obj_get_array(args[0].u_obj, &len, &items);
-    }
+    // Parse the notes now, so the interrupt handler only has to play them.
+    music_tune_obj_t *tune = music_compile_tune(args[0].u_obj);
 
     // Stop any ongoing background music
     music_data->async_state = ASYNC_MUSIC_STATE_IDLE;
@@ -329,19 +528,16 @@ STATIC mp_obj_t microbit_music_play(mp_uint_t n_args, const mp_obj_t *pos_args,
     microbit_pin_audio_select(args[1].u_obj, microbit_pin_mode_music);
 
     // start the tune running in the background
+    #if MICROPY_HW_MUSIC_SYNTH
+    music_data->async_wait_samples = 0;
+    #else
     music_data->async_wait_ticks = mp_hal_ticks_ms();
+    #endif
     music_data->async_loop = args[3].u_bool;
-    music_data->async_notes_len = len;
     music_data->async_notes_index = 0;
-    if (len == 1) {
-        // If a string was passed as a single note then we can't store a pointer
-        // to args[0].u_obj, so instead store the single string directly (also
-        // works if a tuple/list of one element was passed).
-        music_data->async_note = items[0];
-    } else {
-        music_data->async_note = items;
-    }
+    music_data->async_tune = tune;
     music_data->async_state = ASYNC_MUSIC_STATE_NEXT_NOTE;
+    music_output_start();
 
     if (args[2].u_bool) {
         // wait for tune to finish
@@ -381,12 +577,16 @@ STATIC mp_obj_t microbit_music_pitch(mp_uint_t n_args, const mp_obj_t *pos_args,
     }
     if (duration >= 0) {
         // use async machinery to stop the pitch after the duration
+        #if MICROPY_HW_MUSIC_SYNTH
+        music_data->async_wait_samples = MUSIC_UNITS_FROM_MS(duration);
+        #else
         music_data->async_wait_ticks = mp_hal_ticks_ms() + duration;
+        #endif
         music_data->async_loop = false;
-        music_data->async_notes_len = 0;
         music_data->async_notes_index = 0;
-        music_data->async_note = NULL;
+        music_data->async_tune = NULL;
         music_data->async_state = ASYNC_MUSIC_STATE_ARTICULATE;
+        music_output_start();
 
         if (wait) {
             // wait for the pitch to finish
@@ -394,6 +594,9 @@ STATIC mp_obj_t microbit_music_pitch(mp_uint_t n_args, const mp_obj_t *pos_args,
         }
     } else {
         // don't block here, since there's no reason to leave a pitch forever in a blocking C function
+        #if MICROPY_HW_MUSIC_SYNTH
+        music_output_start();
+        #endif
     }
 
     return mp_const_none;
@@ -426,10 +629,15 @@ static mp_obj_t music_init(void) {
     music_data = m_new_obj(music_data_t);
     music_data->bpm = DEFAULT_BPM;
     music_data->ticks = DEFAULT_TICKS;
-    music_data->last_octave = DEFAULT_OCTAVE;
-    music_data->last_duration = DEFAULT_DURATION;
     music_data->async_state = ASYNC_MUSIC_STATE_IDLE;
-    music_data->async_note = NULL;
+    music_data->async_tune = NULL;
+    music_data->compiled_src = MP_OBJ_NULL;
+    music_data->compiled_tune = NULL;
+    #if MICROPY_HW_MUSIC_SYNTH
+    music_data->synth_on = false;
+    music_data->synth_phase_inc = 0;
+    music_data->synth_phase = 0;
+    #endif
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_0(music___init___obj, music_init);
@@ -444,6 +652,7 @@ STATIC const mp_rom_map_elem_t microbit_music_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&microbit_music_play_obj) },
     { MP_ROM_QSTR(MP_QSTR_pitch), MP_ROM_PTR(&microbit_music_pitch_obj) },
     { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&microbit_music_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_compile), MP_ROM_PTR(&microbit_music_compile_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_DADADADUM), MP_ROM_PTR(&microbit_music_tune_dadadadum_obj) },
     { MP_ROM_QSTR(MP_QSTR_ENTERTAINER), MP_ROM_PTR(&microbit_music_tune_entertainer_obj) },
@@ -53,5 +53,6 @@ extern const struct _mp_obj_tuple_t microbit_music_tune_power_down_obj;
 void microbit_music_volume_changed(void);
 bool microbit_music_is_playing(void);
 void microbit_music_tick(void);
+uint32_t microbit_music_get_ms_to_next_event(void);
 
 #endif // MICROPY_INCLUDED_MICROBIT_MUSIC_H
@@ -0,0 +1,512 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/objtype.h"
+#include "drv_alloc.h"
+#include "modmicrobit.h"
+
+// A strip of ws2812 pixels.  Colours are kept in a byte buffer in wire order, and on
+// write() the buffer is scaled by the brightness and encoded into a PWM sequence that the
+// HAL streams out by DMA.  Once encoded the buffer can be changed again, so write(wait=False)
+// returns straight away.  Sequences are allocated on the first write and reused; a second
+// one is only allocated if a frame is written while the previous one is still going out.
+
+typedef struct _neopixel_frames_t {
+    uint16_t *seq[2];
+    size_t alloc[2];
+    uint8_t index;
+} neopixel_frames_t;
+
+typedef struct _neopixel_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t pin;
+    mp_obj_t buf;
+    uint8_t *data;
+    neopixel_frames_t frames;
+    uint16_t n;
+    uint8_t bpp;
+    uint8_t brightness;
+} neopixel_obj_t;
+
+STATIC const mp_obj_type_t neopixel_type;
+
+// Offset within a pixel of the red, green, blue and white components.
+STATIC const uint8_t neopixel_order[4] = { 1, 0, 2, 3 };
+
+STATIC const mp_rom_obj_tuple_t neopixel_order_obj = {
+    {&mp_type_tuple}, 4, {MP_ROM_INT(1), MP_ROM_INT(0), MP_ROM_INT(2), MP_ROM_INT(3)}
+};
+
+STATIC void neopixel_get_color(neopixel_obj_t *self, mp_obj_t color_in, uint8_t *pixel) {
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(color_in, &len, &items);
+    if (len < self->bpp) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid colour"));
+    }
+    for (size_t i = 0; i < self->bpp; ++i) {
+        pixel[neopixel_order[i]] = mp_obj_get_int(items[i]);
+    }
+}
+
+STATIC mp_obj_t neopixel_get_pixel(neopixel_obj_t *self, size_t index) {
+    const uint8_t *pixel = self->data + index * self->bpp;
+    mp_obj_t items[4];
+    for (size_t i = 0; i < self->bpp; ++i) {
+        items[i] = MP_OBJ_NEW_SMALL_INT(pixel[neopixel_order[i]]);
+    }
+    return mp_obj_new_tuple(self->bpp, items);
+}
+
+// Fill pixels start to stop-1 with the given colour, replicating the first one.
+STATIC void neopixel_fill_range(neopixel_obj_t *self, size_t start, size_t stop, const uint8_t *pixel) {
+    if (start >= stop) {
+        return;
+    }
+    uint8_t *dest = self->data + start * self->bpp;
+    memcpy(dest, pixel, self->bpp);
+    size_t done = self->bpp;
+    size_t total = (stop - start) * self->bpp;
+    while (done < total) {
+        size_t chunk = MIN(done, total - done);
+        memcpy(dest + done, dest, chunk);
+        done += chunk;
+    }
+}
+
+STATIC void neopixel_reverse(neopixel_obj_t *self, size_t lo, size_t hi) {
+    uint8_t tmp[4];
+    while (lo + 1 < hi) {
+        --hi;
+        uint8_t *a = self->data + lo * self->bpp;
+        uint8_t *b = self->data + hi * self->bpp;
+        memcpy(tmp, a, self->bpp);
+        memcpy(a, b, self->bpp);
+        memcpy(b, tmp, self->bpp);
+        ++lo;
+    }
+}
+
+STATIC mp_obj_t neopixel_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_pin, ARG_n, ARG_bpp, ARG_brightness };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_pin, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_n, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_bpp, MP_ARG_INT, {.u_int = 3} },
+        { MP_QSTR_brightness, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 255} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    // Check the pin is valid.
+    microbit_obj_get_pin(args[ARG_pin].u_obj);
+
+    mp_int_t n = args[ARG_n].u_int;
+    mp_int_t bpp = args[ARG_bpp].u_int;
+    if (bpp != 3 && bpp != 4) {
+        mp_raise_ValueError(MP_ERROR_TEXT("bpp must be 3 or 4"));
+    }
+    if (n < 0 || MICROBIT_HAL_WS2812_SEQ_LEN(n * bpp) > MICROBIT_HAL_WS2812_MAX_SEQ_LEN) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid number of pixels"));
+    }
+    mp_int_t brightness = args[ARG_brightness].u_int;
+    if (brightness < 0 || brightness > 255) {
+        mp_raise_ValueError(MP_ERROR_TEXT("brightness out of range"));
+    }
+
+    neopixel_obj_t *self = m_new_obj(neopixel_obj_t);
+    self->base.type = type;
+    self->pin = args[ARG_pin].u_obj;
+    self->data = m_new0(uint8_t, n * bpp);
+    MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_NEOPIXEL, sizeof(*self) + n * bpp);
+    self->buf = mp_obj_new_bytearray_by_ref(n * bpp, self->data);
+    self->frames = (neopixel_frames_t){ { NULL, NULL }, { 0, 0 }, 0 };
+    self->n = n;
+    self->bpp = bpp;
+    self->brightness = brightness;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC void neopixel_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (dest[0] != MP_OBJ_NULL) {
+        // Attributes are read-only.
+        return;
+    }
+    if (attr == MP_QSTR_pin) {
+        dest[0] = self->pin;
+    } else if (attr == MP_QSTR_n) {
+        dest[0] = MP_OBJ_NEW_SMALL_INT(self->n);
+    } else if (attr == MP_QSTR_bpp) {
+        dest[0] = MP_OBJ_NEW_SMALL_INT(self->bpp);
+    } else if (attr == MP_QSTR_buf) {
+        dest[0] = self->buf;
+    } else {
+        // Continue lookup in locals dict.
+        dest[1] = MP_OBJ_SENTINEL;
+    }
+}
+
+STATIC mp_obj_t neopixel_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t value) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (value == MP_OBJ_NULL) {
+        // delete
+        return MP_OBJ_NULL; // op not supported
+    }
+
+    if (mp_obj_is_type(index_in, &mp_type_slice)) {
+        mp_bound_slice_t slice;
+        if (!mp_seq_get_fast_slice_indexes(self->n, index_in, &slice)) {
+            mp_raise_NotImplementedError(MP_ERROR_TEXT("only slices with step=1 (aka None) are supported"));
+        }
+        size_t start = slice.start;
+        size_t stop = MAX(slice.start, slice.stop);
+        if (value == MP_OBJ_SENTINEL) {
+            // load
+            mp_obj_list_t *list = MP_OBJ_TO_PTR(mp_obj_new_list(stop - start, NULL));
+            for (size_t i = start; i < stop; ++i) {
+                list->items[i - start] = neopixel_get_pixel(self, i);
+            }
+            return MP_OBJ_FROM_PTR(list);
+        }
+
+        // store, either a single colour for the whole slice or one colour per pixel
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(value, &len, &items);
+        if (len > 0 && mp_obj_is_int(items[0])) {
+            uint8_t pixel[4];
+            neopixel_get_color(self, value, pixel);
+            neopixel_fill_range(self, start, stop, pixel);
+        } else {
+            if (len != stop - start) {
+                mp_raise_ValueError(MP_ERROR_TEXT("slice size mismatch"));
+            }
+            for (size_t i = 0; i < len; ++i) {
+                neopixel_get_color(self, items[i], self->data + (start + i) * self->bpp);
+            }
+        }
+        return mp_const_none;
+    }
+
+    size_t index = mp_get_index(self->base.type, self->n, index_in, false);
+    if (value == MP_OBJ_SENTINEL) {
+        // load
+        return neopixel_get_pixel(self, index);
+    } else {
+        // store
+        neopixel_get_color(self, value, self->data + index * self->bpp);
+        return mp_const_none;
+    }
+}
+
+STATIC mp_obj_t neopixel_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(self->n);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC void neopixel_wait_done(void) {
+    while (microbit_hal_ws2812_busy()) {
+        microbit_hal_idle();
+    }
+    MP_STATE_PORT(neopixel_seq_in_flight) = NULL;
+}
+
+// Return a sequence of at least seq_len words that is not being sent.
+STATIC uint16_t *neopixel_frames_get(neopixel_frames_t *frames, size_t seq_len) {
+    if (microbit_hal_ws2812_busy() && MP_STATE_PORT(neopixel_seq_in_flight) == frames->seq[frames->index]) {
+        frames->index ^= 1;
+    }
+    if (frames->alloc[frames->index] < seq_len) {
+        frames->seq[frames->index] = m_new(uint16_t, seq_len);
+        MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_NEOPIXEL, seq_len * sizeof(uint16_t));
+        frames->alloc[frames->index] = seq_len;
+    }
+    return frames->seq[frames->index];
+}
+
+STATIC void neopixel_send(const int *pins, size_t num_pins, uint16_t *seq, size_t seq_len, bool wait) {
+    // The previous frame may still be going out while this one was encoded.
+    neopixel_wait_done();
+    // Keep the sequence alive while it's being sent, even if its strip isn't.
+    MP_STATE_PORT(neopixel_seq_in_flight) = seq;
+    int ret = microbit_hal_ws2812_start(pins, num_pins, seq, seq_len);
+    if (ret != MICROBIT_HAL_DEVICE_OK) {
+        MP_STATE_PORT(neopixel_seq_in_flight) = NULL;
+        // The PWM instance is in use by direct audio output.
+        mp_raise_OSError(ret == MICROBIT_HAL_DEVICE_NO_RESOURCES ? MP_EBUSY : MP_EIO);
+    }
+    if (wait) {
+        neopixel_wait_done();
+    }
+}
+
+STATIC void neopixel_write_helper(neopixel_obj_t *self, bool wait) {
+    size_t len = self->n * self->bpp;
+    size_t seq_len = MICROBIT_HAL_WS2812_SEQ_LEN(len);
+    uint16_t *seq = neopixel_frames_get(&self->frames, seq_len);
+    microbit_hal_ws2812_encode(seq, 1, self->data, len, len, self->brightness);
+    int pin = microbit_obj_get_pin(self->pin)->name;
+    neopixel_send(&pin, 1, seq, seq_len, wait);
+}
+
+STATIC mp_obj_t neopixel_write(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_wait };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_wait, MP_ARG_BOOL, {.u_bool = true} },
+    };
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    neopixel_write_helper(self, args[ARG_wait].u_bool);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(neopixel_write_obj, 1, neopixel_write);
+
+// Wait until the last frame written, to any strip, has been sent.
+STATIC mp_obj_t neopixel_wait(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    (void)args;
+    neopixel_wait_done();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neopixel_wait_obj, 0, 1, neopixel_wait);
+
+STATIC mp_obj_t neopixel_fill(mp_obj_t self_in, mp_obj_t color_in) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint8_t pixel[4];
+    neopixel_get_color(self, color_in, pixel);
+    neopixel_fill_range(self, 0, self->n, pixel);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(neopixel_fill_obj, neopixel_fill);
+
+STATIC mp_obj_t neopixel_clear(mp_obj_t self_in) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    memset(self->data, 0, self->n * self->bpp);
+    neopixel_write_helper(self, true);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(neopixel_clear_obj, neopixel_clear);
+
+STATIC mp_obj_t neopixel_set_brightness(mp_obj_t self_in, mp_obj_t brightness_in) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_int_t brightness = mp_obj_get_int(brightness_in);
+    if (brightness < 0 || brightness > 255) {
+        mp_raise_ValueError(MP_ERROR_TEXT("brightness out of range"));
+    }
+    self->brightness = brightness;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(neopixel_set_brightness_obj, neopixel_set_brightness);
+
+STATIC mp_obj_t neopixel_get_brightness(mp_obj_t self_in) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return MP_OBJ_NEW_SMALL_INT(self->brightness);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(neopixel_get_brightness_obj, neopixel_get_brightness);
+
+// Move every pixel n places towards the end of the strip, wrapping round to the start.
+STATIC mp_obj_t neopixel_rotate(size_t n_args, const mp_obj_t *args) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (self->n == 0) {
+        return mp_const_none;
+    }
+    mp_int_t shift = 1;
+    if (n_args > 1) {
+        shift = mp_obj_get_int(args[1]);
+    }
+    shift %= (mp_int_t)self->n;
+    if (shift < 0) {
+        shift += self->n;
+    }
+    neopixel_reverse(self, 0, self->n);
+    neopixel_reverse(self, 0, shift);
+    neopixel_reverse(self, shift, self->n);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neopixel_rotate_obj, 1, 2, neopixel_rotate);
+
+// Fill pixels start to stop-1 with colours fading linearly from color1 to color2.
+STATIC mp_obj_t neopixel_gradient(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_color1, ARG_color2, ARG_start, ARG_stop };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_color1, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_color2, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_start, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_stop, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    uint8_t c1[4];
+    uint8_t c2[4];
+    neopixel_get_color(self, args[ARG_color1].u_obj, c1);
+    neopixel_get_color(self, args[ARG_color2].u_obj, c2);
+
+    mp_int_t start = args[ARG_start].u_int;
+    mp_int_t stop = self->n;
+    if (args[ARG_stop].u_obj != mp_const_none) {
+        stop = mp_obj_get_int(args[ARG_stop].u_obj);
+    }
+    if (start < 0 || stop > self->n || start > stop) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid range"));
+    }
+
+    mp_int_t span = MAX(stop - start - 1, 1);
+    for (mp_int_t i = start; i < stop; ++i) {
+        uint8_t *pixel = self->data + i * self->bpp;
+        mp_int_t t = i - start;
+        for (size_t j = 0; j < self->bpp; ++j) {
+            pixel[j] = c1[j] + ((mp_int_t)c2[j] - c1[j]) * t / span;
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(neopixel_gradient_obj, 3, neopixel_gradient);
+
+STATIC const mp_rom_map_elem_t neopixel_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&neopixel_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&neopixel_wait_obj) },
+    { MP_ROM_QSTR(MP_QSTR_fill), MP_ROM_PTR(&neopixel_fill_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_brightness), MP_ROM_PTR(&neopixel_set_brightness_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_brightness), MP_ROM_PTR(&neopixel_get_brightness_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rotate), MP_ROM_PTR(&neopixel_rotate_obj) },
+    { MP_ROM_QSTR(MP_QSTR_gradient), MP_ROM_PTR(&neopixel_gradient_obj) },
+
+    // microbit v1 methods
+    { MP_ROM_QSTR(MP_QSTR_clear), MP_ROM_PTR(&neopixel_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_show), MP_ROM_PTR(&neopixel_write_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_ORDER), MP_ROM_PTR(&neopixel_order_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(neopixel_locals_dict, neopixel_locals_dict_table);
+
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    neopixel_type,
+    MP_QSTR_NeoPixel,
+    MP_TYPE_FLAG_NONE,
+    make_new, neopixel_make_new,
+    attr, neopixel_attr,
+    subscr, neopixel_subscr,
+    unary_op, neopixel_unary_op,
+    locals_dict, &neopixel_locals_dict
+    );
+
+// Send several strips on different pins at the same time, one per PWM channel, with
+// their frames interleaved in a shared sequence.
+STATIC mp_obj_t neopixel_write_all(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_strips, ARG_wait };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_strips, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    size_t num_strips;
+    mp_obj_t *items;
+    mp_obj_get_array(args[ARG_strips].u_obj, &num_strips, &items);
+    if (num_strips == 0 || num_strips > MICROBIT_HAL_WS2812_MAX_STRIPS) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid number of strips"));
+    }
+
+    neopixel_obj_t *strips[MICROBIT_HAL_WS2812_MAX_STRIPS];
+    int pins[MICROBIT_HAL_WS2812_MAX_STRIPS];
+    size_t max_len = 0;
+    for (size_t i = 0; i < num_strips; ++i) {
+        mp_obj_t strip = mp_obj_cast_to_native_base(items[i], &neopixel_type);
+        if (strip == MP_OBJ_NULL) {
+            mp_raise_TypeError(MP_ERROR_TEXT("expecting a NeoPixel"));
+        }
+        strips[i] = MP_OBJ_TO_PTR(strip);
+        pins[i] = microbit_obj_get_pin(strips[i]->pin)->name;
+        for (size_t j = 0; j < i; ++j) {
+            if (pins[j] == pins[i]) {
+                mp_raise_ValueError(MP_ERROR_TEXT("strips must use different pins"));
+            }
+        }
+        max_len = MAX(max_len, strips[i]->n * strips[i]->bpp);
+    }
+
+    if (num_strips == 1) {
+        neopixel_write_helper(strips[0], args[ARG_wait].u_bool);
+        return mp_const_none;
+    }
+
+    size_t seq_len = MICROBIT_HAL_WS2812_SEQ_LEN(max_len) * MICROBIT_HAL_WS2812_MAX_STRIPS;
+    if (seq_len > MICROBIT_HAL_WS2812_MAX_SEQ_LEN) {
+        mp_raise_ValueError(MP_ERROR_TEXT("strips too long"));
+    }
+    if (MP_STATE_PORT(neopixel_multi_frames) == NULL) {
+        MP_STATE_PORT(neopixel_multi_frames) = m_new0(neopixel_frames_t, 1);
+    }
+    uint16_t *seq = neopixel_frames_get(MP_STATE_PORT(neopixel_multi_frames), seq_len);
+    for (size_t i = 0; i < MICROBIT_HAL_WS2812_MAX_STRIPS; ++i) {
+        if (i < num_strips) {
+            size_t len = strips[i]->n * strips[i]->bpp;
+            microbit_hal_ws2812_encode(seq + i, MICROBIT_HAL_WS2812_MAX_STRIPS, strips[i]->data, len, max_len, strips[i]->brightness);
+        } else {
+            // Unused channels are not connected to a pin, but still need their words.
+            microbit_hal_ws2812_encode(seq + i, MICROBIT_HAL_WS2812_MAX_STRIPS, NULL, 0, max_len, 255);
+        }
+    }
+    neopixel_send(pins, num_strips, seq, seq_len, args[ARG_wait].u_bool);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(neopixel_write_all_obj, 1, neopixel_write_all);
+
+void microbit_neopixel_deinit(void) {
+    neopixel_wait_done();
+    MP_STATE_PORT(neopixel_multi_frames) = NULL;
+}
+
+STATIC const mp_rom_map_elem_t neopixel_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_neopixel) },
+    { MP_ROM_QSTR(MP_QSTR_NeoPixel), MP_ROM_PTR(&neopixel_type) },
+    { MP_ROM_QSTR(MP_QSTR_write_all), MP_ROM_PTR(&neopixel_write_all_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&neopixel_wait_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(neopixel_module_globals, neopixel_module_globals_table);
+
+const mp_obj_module_t neopixel_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&neopixel_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR_neopixel, neopixel_module);
+
+MP_REGISTER_ROOT_POINTER(uint16_t *neopixel_seq_in_flight);
+MP_REGISTER_ROOT_POINTER(struct _neopixel_frames_t *neopixel_multi_frames);
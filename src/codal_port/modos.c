@@ -28,6 +28,7 @@
 #include "py/objtuple.h"
 #include "py/objstr.h"
 #include "ports/nrf/modules/os/microbitfs.h"
+#include "microbitfs_ext.h"
 
 // Include MicroPython and micro:bit version information.
 #include "genhdr/mpversion.h"
@@ -84,6 +85,10 @@ STATIC const mp_rom_map_elem_t os_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_ilistdir), MP_ROM_PTR(&os_mbfs_ilistdir_obj) },
     { MP_ROM_QSTR(MP_QSTR_remove), MP_ROM_PTR(&os_mbfs_remove_obj) },
     { MP_ROM_QSTR(MP_QSTR_stat), MP_ROM_PTR(&os_mbfs_stat_obj) },
+    { MP_ROM_QSTR(MP_QSTR_preallocate), MP_ROM_PTR(&os_mbfs_preallocate_obj) },
+    { MP_ROM_QSTR(MP_QSTR_receive_file), MP_ROM_PTR(&os_mbfs_receive_file_obj) },
+    { MP_ROM_QSTR(MP_QSTR_fsinfo), MP_ROM_PTR(&os_mbfs_fsinfo_obj) },
+    { MP_ROM_QSTR(MP_QSTR_compact), MP_ROM_PTR(&os_mbfs_compact_obj) },
 
     // micro:bit v1 specific
     { MP_ROM_QSTR(MP_QSTR_size), MP_ROM_PTR(&os_size_obj) },
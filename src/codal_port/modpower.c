@@ -27,6 +27,11 @@
 #include "py/runtime.h"
 #include "py/mphal.h"
 #include "drv_softtimer.h"
+#include "drv_system.h"
+#include "microbitfs_ext.h"
+
+// How often the wake sources are checked during a light sleep.
+#define LIGHT_SLEEP_POLL_MS (20)
 
 STATIC size_t get_array(mp_obj_t *src, mp_obj_t **items) {
     if (*src == mp_const_none) {
@@ -45,7 +50,27 @@ STATIC size_t get_array(mp_obj_t *src, mp_obj_t **items) {
     }
 }
 
+STATIC void set_wake_sources(mp_obj_t *src) {
+    microbit_hal_power_clear_wake_sources();
+
+    mp_obj_t *items;
+    size_t len = get_array(src, &items);
+    for (size_t i = 0; i < len; ++i) {
+        const mp_obj_type_t *type = mp_obj_get_type(items[i]);
+        if (microbit_obj_type_is_button(type)) {
+            microbit_hal_power_wake_on_button(microbit_obj_get_button_id(items[i]), true);
+        } else if (microbit_obj_type_is_pin(type)) {
+            microbit_hal_power_wake_on_pin(microbit_obj_get_pin_name(items[i]), true);
+        } else {
+            mp_raise_ValueError(MP_ERROR_TEXT("expecting a pin or button"));
+        }
+    }
+}
+
 STATIC mp_obj_t power_off(void) {
+    #if MICROPY_MBFS
+    microbit_filesystem_finish_sweep();
+    #endif
     microbit_hal_power_off();
     return mp_const_none;
 }
@@ -62,8 +87,6 @@ STATIC mp_obj_t power_deep_sleep(size_t n_args, const mp_obj_t *pos_args, mp_map
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
-    microbit_hal_power_clear_wake_sources();
-
     // Configure wake-up time, if given.
     bool wake_on_ms = false;
     uint32_t wake_ms = UINT32_MAX;
@@ -73,18 +96,12 @@ STATIC mp_obj_t power_deep_sleep(size_t n_args, const mp_obj_t *pos_args, mp_map
     }
 
     // Configure wake-up sources.
-    mp_obj_t *items;
-    size_t len = get_array(&args[ARG_wake_on].u_obj, &items);
-    for (size_t i = 0; i < len; ++i) {
-        const mp_obj_type_t *type = mp_obj_get_type(items[i]);
-        if (microbit_obj_type_is_button(type)) {
-            microbit_hal_power_wake_on_button(microbit_obj_get_button_id(items[i]), true);
-        } else if (microbit_obj_type_is_pin(type)) {
-            microbit_hal_power_wake_on_pin(microbit_obj_get_pin_name(items[i]), true);
-        } else {
-            mp_raise_ValueError(MP_ERROR_TEXT("expecting a pin or button"));
-        }
-    }
+    set_wake_sources(&args[ARG_wake_on].u_obj);
+
+    #if MICROPY_MBFS
+    // Deep sleep may end in a reset, so don't leave a sweep part done.
+    microbit_filesystem_finish_sweep();
+    #endif
 
     uint32_t start_ms = mp_hal_ticks_ms();
     uint32_t remain_ms = wake_ms;
@@ -98,10 +115,11 @@ STATIC mp_obj_t power_deep_sleep(size_t n_args, const mp_obj_t *pos_args, mp_map
 
         // If run_every is true then check if any soft timers will expire and need to wake the device.
         if (args[ARG_run_every].u_bool) {
-            uint32_t soft_timer_ms = microbit_soft_timer_get_ms_to_next_expiry();
-            if (soft_timer_ms != UINT32_MAX) {
-                // A soft timer will expire in "ms" milliseconds.
+            uint64_t soft_timer_us = microbit_soft_timer_get_us_to_next_expiry();
+            if (soft_timer_us != UINT64_MAX) {
+                // A soft timer will expire in "ms" milliseconds (rounded up).
                 wake = true;
+                uint64_t soft_timer_ms = (soft_timer_us + 999) / 1000;
                 if (soft_timer_ms < ms) {
                     ms = soft_timer_ms;
                 }
@@ -138,11 +156,59 @@ STATIC mp_obj_t power_deep_sleep(size_t n_args, const mp_obj_t *pos_args, mp_map
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(power_deep_sleep_obj, 0, power_deep_sleep);
 
+// Unlike deep_sleep(), nothing is suspended: the CPU idles in System ON with the heap,
+// the VM state and all peripherals retained, so it resumes within microseconds of a
+// wake source becoming active.  Soft timers and scheduled functions keep running.
+STATIC mp_obj_t power_light_sleep(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_ms, ARG_wake_on };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_ms, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_wake_on, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    bool wake_on_ms = false;
+    uint32_t wake_ms = 0;
+    if (args[ARG_ms].u_obj != mp_const_none) {
+        wake_on_ms = true;
+        wake_ms = mp_obj_get_int(args[ARG_ms].u_obj);
+    }
+
+    set_wake_sources(&args[ARG_wake_on].u_obj);
+    microbit_hal_power_light_sleep_begin();
+
+    uint32_t start_ms = mp_hal_ticks_ms();
+    for (;;) {
+        mp_handle_pending(true);
+        if (microbit_hal_power_wake_source_active()) {
+            break;
+        }
+        uint32_t ms = LIGHT_SLEEP_POLL_MS;
+        if (wake_on_ms) {
+            uint32_t dt = mp_hal_ticks_ms() - start_ms;
+            if (dt >= wake_ms) {
+                break;
+            }
+            ms = MIN(ms, wake_ms - dt);
+        }
+        microbit_system_timer_wake_within(ms);
+        microbit_hal_idle();
+    }
+
+    microbit_hal_power_clear_wake_sources();
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(power_light_sleep_obj, 0, power_light_sleep);
+
 STATIC const mp_rom_map_elem_t power_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_power) },
 
     { MP_ROM_QSTR(MP_QSTR_off), MP_ROM_PTR(&power_off_obj) },
     { MP_ROM_QSTR(MP_QSTR_deep_sleep), MP_ROM_PTR(&power_deep_sleep_obj) },
+    { MP_ROM_QSTR(MP_QSTR_light_sleep), MP_ROM_PTR(&power_light_sleep_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(power_module_globals, power_module_globals_table);
 
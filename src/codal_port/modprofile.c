@@ -0,0 +1,205 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "drv_system.h"
+#include "modprofile.h"
+
+#if MICROPY_PY_PROFILE
+
+// Number of different functions that samples are counted for.
+#define PROFILE_MAX_FUNCTIONS (32)
+
+typedef struct _profile_function_t {
+    qstr name;
+    uint32_t hits;
+} profile_function_t;
+
+bool microbit_profile_active;
+
+// Set by the 6ms timer, and cleared when the VM hook takes the sample.
+STATIC volatile bool profile_sample_pending;
+
+STATIC profile_function_t profile_functions[PROFILE_MAX_FUNCTIONS];
+STATIC uint32_t profile_num_functions;
+STATIC uint32_t profile_other_hits; // samples of functions that did not fit in the table
+STATIC uint32_t profile_subsystem_us[MICROBIT_PROFILE_NUM_SUBSYSTEMS];
+
+STATIC const qstr profile_subsystem_names[MICROBIT_PROFILE_NUM_SUBSYSTEMS] = {
+    MP_QSTR_display,
+    MP_QSTR_music,
+    MP_QSTR_soft_timer,
+    MP_QSTR_background,
+};
+
+// Called at the start of the 6ms timer interrupt.
+void microbit_profile_tick(void) {
+    if (microbit_profile_active) {
+        profile_sample_pending = true;
+    }
+}
+
+// Returns the time to pass to microbit_profile_end.
+uint32_t microbit_profile_begin(void) {
+    return microbit_profile_active ? mp_hal_ticks_us() : 0;
+}
+
+// Charge the time since start_us to the given subsystem, and return the current time so
+// calls can be chained to time consecutive pieces of work.
+uint32_t microbit_profile_end(unsigned int subsystem, uint32_t start_us) {
+    if (!microbit_profile_active) {
+        return 0;
+    }
+    uint32_t now = mp_hal_ticks_us();
+    profile_subsystem_us[subsystem] += now - start_us;
+    return now;
+}
+
+// Called from the VM hook in place of microbit_hal_background_processing_poll while profiling.
+void microbit_profile_vm_hook(const void *fun) {
+    if (profile_sample_pending) {
+        profile_sample_pending = false;
+        qstr name = mp_obj_fun_get_name(fun);
+        size_t i;
+        for (i = 0; i < profile_num_functions; ++i) {
+            if (profile_functions[i].name == name) {
+                break;
+            }
+        }
+        if (i < profile_num_functions) {
+            ++profile_functions[i].hits;
+        } else if (profile_num_functions < PROFILE_MAX_FUNCTIONS) {
+            profile_functions[i].name = name;
+            profile_functions[i].hits = 1;
+            ++profile_num_functions;
+        } else {
+            ++profile_other_hits;
+        }
+    }
+    uint32_t start = mp_hal_ticks_us();
+    extern void microbit_hal_background_processing_poll(void);
+    microbit_hal_background_processing_poll();
+    microbit_profile_end(MICROBIT_PROFILE_BACKGROUND, start);
+}
+
+STATIC mp_obj_t profile_start(void) {
+    microbit_profile_active = true;
+    microbit_system_timer_update();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(profile_start_obj, profile_start);
+
+STATIC mp_obj_t profile_stop(void) {
+    microbit_profile_active = false;
+    profile_sample_pending = false;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(profile_stop_obj, profile_stop);
+
+STATIC mp_obj_t profile_reset(void) {
+    uint32_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    profile_num_functions = 0;
+    profile_other_hits = 0;
+    memset(profile_subsystem_us, 0, sizeof(profile_subsystem_us));
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(profile_reset_obj, profile_reset);
+
+// Return a list of (name, samples) for each function seen, most sampled first.
+STATIC mp_obj_t profile_functions_list(void) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    bool done[PROFILE_MAX_FUNCTIONS] = { false };
+    for (size_t n = 0; n < profile_num_functions; ++n) {
+        size_t best = 0;
+        for (size_t i = 0; i < profile_num_functions; ++i) {
+            if (!done[i] && (done[best] || profile_functions[i].hits > profile_functions[best].hits)) {
+                best = i;
+            }
+        }
+        done[best] = true;
+        mp_obj_t t[2] = {
+            MP_OBJ_NEW_QSTR(profile_functions[best].name),
+            mp_obj_new_int_from_uint(profile_functions[best].hits),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(2, t));
+    }
+    if (profile_other_hits != 0) {
+        mp_obj_t t[2] = { MP_OBJ_NEW_QSTR(MP_QSTR__lt_other_gt_), mp_obj_new_int_from_uint(profile_other_hits) };
+        mp_obj_list_append(list, mp_obj_new_tuple(2, t));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(profile_functions_obj, profile_functions_list);
+
+// Return a dict of the time in microseconds spent in each subsystem.
+STATIC mp_obj_t profile_subsystems(void) {
+    mp_obj_t dict = mp_obj_new_dict(MICROBIT_PROFILE_NUM_SUBSYSTEMS);
+    for (size_t i = 0; i < MICROBIT_PROFILE_NUM_SUBSYSTEMS; ++i) {
+        mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(profile_subsystem_names[i]), mp_obj_new_int_from_uint(profile_subsystem_us[i]));
+    }
+    return dict;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(profile_subsystems_obj, profile_subsystems);
+
+// Print all the results to the serial console.
+STATIC mp_obj_t profile_dump(void) {
+    mp_obj_list_t *list = MP_OBJ_TO_PTR(profile_functions_list());
+    mp_printf(&mp_plat_print, "samples  function\n");
+    for (size_t i = 0; i < list->len; ++i) {
+        mp_obj_tuple_t *t = MP_OBJ_TO_PTR(list->items[i]);
+        mp_printf(&mp_plat_print, "%7u  %q\n", (unsigned int)mp_obj_get_int_truncated(t->items[1]), MP_OBJ_QSTR_VALUE(t->items[0]));
+    }
+    mp_printf(&mp_plat_print, "     us  subsystem\n");
+    for (size_t i = 0; i < MICROBIT_PROFILE_NUM_SUBSYSTEMS; ++i) {
+        mp_printf(&mp_plat_print, "%7u  %q\n", (unsigned int)profile_subsystem_us[i], profile_subsystem_names[i]);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(profile_dump_obj, profile_dump);
+
+STATIC const mp_rom_map_elem_t profile_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_profile) },
+    { MP_ROM_QSTR(MP_QSTR_start), MP_ROM_PTR(&profile_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&profile_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&profile_reset_obj) },
+    { MP_ROM_QSTR(MP_QSTR_functions), MP_ROM_PTR(&profile_functions_obj) },
+    { MP_ROM_QSTR(MP_QSTR_subsystems), MP_ROM_PTR(&profile_subsystems_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dump), MP_ROM_PTR(&profile_dump_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(profile_module_globals, profile_module_globals_table);
+
+const mp_obj_module_t profile_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&profile_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR_profile, profile_module);
+
+#endif // MICROPY_PY_PROFILE
@@ -0,0 +1,47 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_CODAL_PORT_MODPROFILE_H
+#define MICROPY_INCLUDED_CODAL_PORT_MODPROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    MICROBIT_PROFILE_DISPLAY,
+    MICROBIT_PROFILE_MUSIC,
+    MICROBIT_PROFILE_SOFT_TIMER,
+    MICROBIT_PROFILE_BACKGROUND,
+    MICROBIT_PROFILE_NUM_SUBSYSTEMS,
+};
+
+extern bool microbit_profile_active;
+
+void microbit_profile_tick(void);
+uint32_t microbit_profile_begin(void);
+uint32_t microbit_profile_end(unsigned int subsystem, uint32_t start_us);
+void microbit_profile_vm_hook(const void *fun);
+
+#endif // MICROPY_INCLUDED_CODAL_PORT_MODPROFILE_H
@@ -29,12 +29,27 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/mperrno.h"
 #include "py/smallint.h"
+#include "py/objarray.h"
+#include "py/objtuple.h"
+#include "py/binary.h"
+#include "drv_alloc.h"
 #include "drv_radio.h"
+#include "drv_radiostream.h"
+#include "drv_radiosync.h"
+
+// Size of a packet as stored in the RX queue: len, data, RSSI, time, group and channel bytes.
+#define RADIO_PACKET_RECORD_LEN(len) (1 + (len) + 1 + 4 + 1 + 1)
 
 STATIC microbit_radio_config_t radio_config;
 
+// Set while a call to the on_receive() handler is waiting to run.
+STATIC volatile bool radio_rx_scheduled;
+
 STATIC mp_obj_t mod_radio_reset(void);
+STATIC void radio_view_release(bool pop);
+STATIC const mp_obj_type_t radio_view_type;
 
 STATIC void ensure_enabled(void) {
     if (MP_STATE_PORT(radio_buf) == NULL) {
@@ -42,7 +57,18 @@ STATIC void ensure_enabled(void) {
     }
 }
 
+// Get the next waiting packet for one of the copying receive functions.  Any packet
+// still lent out by receive_view() is consumed first, so it can't be popped twice.
+STATIC const uint8_t *radio_peek(void) {
+    radio_view_release(true);
+    return microbit_radio_peek();
+}
+
 STATIC mp_obj_t mod_radio___init__(void) {
+    MP_STATE_PORT(radio_rx_handler) = MP_OBJ_NULL;
+    radio_rx_scheduled = false;
+    radio_view_release(false);
+    microbit_radio_sync_reset();
     mod_radio_reset();
     microbit_radio_enable(&radio_config);
     return mp_const_none;
@@ -52,15 +78,39 @@ MP_DEFINE_CONST_FUN_OBJ_0(mod_radio___init___obj, mod_radio___init__);
 STATIC mp_obj_t mod_radio_reset(void) {
     radio_config.max_payload = MICROBIT_RADIO_DEFAULT_MAX_PAYLOAD;
     radio_config.queue_len = MICROBIT_RADIO_DEFAULT_QUEUE_LEN;
+    radio_config.tx_queue_len = MICROBIT_RADIO_DEFAULT_TX_QUEUE_LEN;
     radio_config.channel = MICROBIT_RADIO_DEFAULT_CHANNEL;
     radio_config.power_dbm = MICROBIT_RADIO_DEFAULT_POWER_DBM;
     radio_config.base0 = MICROBIT_RADIO_DEFAULT_BASE0;
     radio_config.prefix0 = MICROBIT_RADIO_DEFAULT_PREFIX0;
     radio_config.data_rate = MICROBIT_RADIO_DEFAULT_DATA_RATE;
+    radio_config.num_rx_groups = 0;
+    radio_config.num_hop_channels = 0;
+    radio_config.hop_interval_ms = MICROBIT_RADIO_DEFAULT_HOP_INTERVAL_MS;
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_reset_obj, mod_radio_reset);
 
+// Get a sequence of up to max_len integers, each between 0 and max_value inclusive.
+// Returns false if the sequence is too long or a value is out of range.
+STATIC bool radio_config_get_list(mp_obj_t list_in, uint8_t *dest, uint8_t *dest_len, size_t max_len, mp_int_t max_value) {
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(list_in, &len, &items);
+    if (len > max_len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        mp_int_t value = mp_obj_get_int(items[i]);
+        if (!(0 <= value && value <= max_value)) {
+            return false;
+        }
+        dest[i] = value;
+    }
+    *dest_len = len;
+    return true;
+}
+
 STATIC mp_obj_t mod_radio_config(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     (void)pos_args; // unused
 
@@ -74,8 +124,22 @@ STATIC mp_obj_t mod_radio_config(size_t n_args, const mp_obj_t *pos_args, mp_map
     qstr arg_name = MP_QSTR_;
     for (size_t i = 0; i < kw_args->alloc; ++i) {
         if (MP_MAP_SLOT_IS_FILLED(kw_args, i)) {
-            mp_int_t value = mp_obj_get_int_truncated(kw_args->table[i].value);
             arg_name = mp_obj_str_get_qstr(kw_args->table[i].key);
+
+            // these arguments take a sequence of values
+            if (arg_name == MP_QSTR_rx_groups) {
+                if (!radio_config_get_list(kw_args->table[i].value, new_config.rx_groups, &new_config.num_rx_groups, MICROBIT_RADIO_MAX_RX_GROUPS, 255)) {
+                    goto value_error;
+                }
+                continue;
+            } else if (arg_name == MP_QSTR_hop) {
+                if (!radio_config_get_list(kw_args->table[i].value, new_config.hop_channels, &new_config.num_hop_channels, MICROBIT_RADIO_MAX_HOP_CHANNELS, MICROBIT_RADIO_MAX_CHANNEL)) {
+                    goto value_error;
+                }
+                continue;
+            }
+
+            mp_int_t value = mp_obj_get_int_truncated(kw_args->table[i].value);
             switch (arg_name) {
                 case MP_QSTR_length:
                     if (!(1 <= value && value <= 251)) {
@@ -91,6 +155,13 @@ STATIC mp_obj_t mod_radio_config(size_t n_args, const mp_obj_t *pos_args, mp_map
                     new_config.queue_len = value;
                     break;
 
+                case MP_QSTR_tx_queue:
+                    if (!(1 <= value && value <= 254)) {
+                        goto value_error;
+                    }
+                    new_config.tx_queue_len = value;
+                    break;
+
                 case MP_QSTR_channel:
                     if (!(0 <= value && value <= MICROBIT_RADIO_MAX_CHANNEL)) {
                         goto value_error;
@@ -98,6 +169,13 @@ STATIC mp_obj_t mod_radio_config(size_t n_args, const mp_obj_t *pos_args, mp_map
                     new_config.channel = value;
                     break;
 
+                case MP_QSTR_hop_interval:
+                    if (!(1 <= value && value <= 65535)) {
+                        goto value_error;
+                    }
+                    new_config.hop_interval_ms = value;
+                    break;
+
                 case MP_QSTR_power: {
                     if (!(0 <= value && value <= 7)) {
                         goto value_error;
@@ -141,8 +219,11 @@ STATIC mp_obj_t mod_radio_config(size_t n_args, const mp_obj_t *pos_args, mp_map
         radio_config = new_config;
     } else {
         // radio eabled
-        if (new_config.max_payload != radio_config.max_payload || new_config.queue_len != radio_config.queue_len) {
+        if (new_config.max_payload != radio_config.max_payload
+            || new_config.queue_len != radio_config.queue_len
+            || new_config.tx_queue_len != radio_config.tx_queue_len) {
             // tx/rx buffer size changed which requires reallocating the buffers
+            radio_view_release(false);
             microbit_radio_disable();
             radio_config = new_config;
             microbit_radio_enable(&radio_config);
@@ -161,51 +242,108 @@ value_error:
 MP_DEFINE_CONST_FUN_OBJ_KW(mod_radio_config_obj, 0, mod_radio_config);
 
 STATIC mp_obj_t mod_radio_on(void) {
+    radio_view_release(false);
     microbit_radio_enable(&radio_config);
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_on_obj, mod_radio_on);
 
 STATIC mp_obj_t mod_radio_off(void) {
+    radio_view_release(false);
     microbit_radio_disable();
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_off_obj, mod_radio_off);
 
-STATIC mp_obj_t mod_radio_send_bytes(mp_obj_t buf_in) {
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+STATIC mp_obj_t radio_rx_dispatch(mp_obj_t arg) {
+    (void)arg;
+    radio_rx_scheduled = false;
+    mp_obj_t handler = MP_STATE_PORT(radio_rx_handler);
+    if (handler != MP_OBJ_NULL) {
+        mp_call_function_0(handler);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(radio_rx_dispatch_obj, radio_rx_dispatch);
+
+// The handler is scheduled once for a burst of packets, and should drain the queue.
+// Packets that arrive while it runs schedule it again.
+void microbit_radio_rx_callback(void) {
+    if (MP_STATE_PORT(radio_rx_handler) != MP_OBJ_NULL && !radio_rx_scheduled) {
+        radio_rx_scheduled = mp_sched_schedule(MP_OBJ_FROM_PTR(&radio_rx_dispatch_obj), mp_const_none);
+    }
+}
+
+STATIC mp_obj_t mod_radio_on_receive(mp_obj_t handler) {
+    if (handler == mp_const_none) {
+        MP_STATE_PORT(radio_rx_handler) = MP_OBJ_NULL;
+        return mp_const_none;
+    }
+    if (!mp_obj_is_callable(handler)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("handler must be callable"));
+    }
+    MP_STATE_PORT(radio_rx_handler) = handler;
+    // Packets that are already waiting won't raise the callback.
+    if (MP_STATE_PORT(radio_buf) != NULL && microbit_radio_peek() != NULL) {
+        microbit_radio_rx_callback();
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mod_radio_on_receive_obj, mod_radio_on_receive);
+
+// Arguments for the send functions.  If block is false then the packet is put on the
+// TX queue and the call returns without waiting for it to be sent.
+STATIC const mp_arg_t radio_send_allowed_args[] = {
+    { MP_QSTR_message, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_block, MP_ARG_BOOL, {.u_bool = true} },
+};
+
+STATIC void radio_send(const void *buf, size_t len, const void *buf2, size_t len2, bool block) {
     ensure_enabled();
-    microbit_radio_send(bufinfo.buf, bufinfo.len, NULL, 0);
+    if (block) {
+        microbit_radio_send(buf, len, buf2, len2);
+    } else if (!microbit_radio_send_async(buf, len, buf2, len2)) {
+        mp_raise_OSError(MP_EAGAIN);
+    }
+}
+
+STATIC mp_obj_t mod_radio_send_bytes(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(radio_send_allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(radio_send_allowed_args), radio_send_allowed_args, args);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_READ);
+    radio_send(bufinfo.buf, bufinfo.len, NULL, 0, args[1].u_bool);
     return mp_const_none;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(mod_radio_send_bytes_obj, mod_radio_send_bytes);
+MP_DEFINE_CONST_FUN_OBJ_KW(mod_radio_send_bytes_obj, 1, mod_radio_send_bytes);
 
 STATIC mp_obj_t mod_radio_receive_bytes(void) {
     ensure_enabled();
-    const uint8_t *buf = microbit_radio_peek();
+    const uint8_t *buf = radio_peek();
     if (buf == NULL) {
         return mp_const_none;
     } else {
         mp_obj_t ret = mp_obj_new_bytes(buf + 1, buf[0]);
+        MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_RADIO_RECEIVE, buf[0]);
         microbit_radio_pop();
         return ret;
     }
 }
 MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_receive_bytes_obj, mod_radio_receive_bytes);
 
-STATIC mp_obj_t mod_radio_send(mp_obj_t buf_in) {
+STATIC mp_obj_t mod_radio_send(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(radio_send_allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(radio_send_allowed_args), radio_send_allowed_args, args);
     mp_uint_t len;
-    const char *data = mp_obj_str_get_data(buf_in, &len);
-    ensure_enabled();
-    microbit_radio_send("\x01\x00\x01", 3, data, len);
+    const char *data = mp_obj_str_get_data(args[0].u_obj, &len);
+    radio_send("\x01\x00\x01", 3, data, len, args[1].u_bool);
     return mp_const_none;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(mod_radio_send_obj, mod_radio_send);
+MP_DEFINE_CONST_FUN_OBJ_KW(mod_radio_send_obj, 1, mod_radio_send);
 
 STATIC mp_obj_t mod_radio_receive(void) {
     ensure_enabled();
-    const uint8_t *buf = microbit_radio_peek();
+    const uint8_t *buf = radio_peek();
     if (buf == NULL) {
         return mp_const_none;
     } else {
@@ -215,6 +353,7 @@ STATIC mp_obj_t mod_radio_receive(void) {
             mp_raise_ValueError(MP_ERROR_TEXT("received packet is not a string"));
         }
         mp_obj_t ret = mp_obj_new_str((const char *)buf + 4, buf[0] - 3);
+        MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_RADIO_RECEIVE, buf[0] - 3);
         microbit_radio_pop();
         return ret;
     }
@@ -225,7 +364,7 @@ STATIC mp_obj_t mod_radio_receive_bytes_into(mp_obj_t buf_in) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
     ensure_enabled();
-    const uint8_t *buf = microbit_radio_peek();
+    const uint8_t *buf = radio_peek();
     if (buf == NULL) {
         return mp_const_none;
     } else {
@@ -239,7 +378,7 @@ MP_DEFINE_CONST_FUN_OBJ_1(mod_radio_receive_bytes_into_obj, mod_radio_receive_by
 
 STATIC mp_obj_t mod_radio_receive_full(void) {
     ensure_enabled();
-    const uint8_t *buf = microbit_radio_peek();
+    const uint8_t *buf = radio_peek();
     if (buf == NULL) {
         return mp_const_none;
     } else {
@@ -254,12 +393,650 @@ STATIC mp_obj_t mod_radio_receive_full(void) {
             MP_OBJ_NEW_SMALL_INT(rssi),
             MP_OBJ_NEW_SMALL_INT(timestamp_us & (MICROPY_PY_TIME_TICKS_PERIOD - 1))
         };
+        MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_RADIO_RECEIVE, len);
         microbit_radio_pop();
         return mp_obj_new_tuple(3, tuple);
     }
 }
 MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_receive_full_obj, mod_radio_receive_full);
 
+// Like receive_full() but also returns the group and channel the packet arrived on.
+STATIC mp_obj_t mod_radio_receive_tagged(void) {
+    ensure_enabled();
+    const uint8_t *buf = radio_peek();
+    if (buf == NULL) {
+        return mp_const_none;
+    } else {
+        size_t len = buf[0];
+        int rssi = -buf[1 + len];
+        uint32_t timestamp_us = buf[1 + len + 1]
+            | buf[1 + len + 2] << 8
+            | buf[1 + len + 3] << 16
+            | buf[1 + len + 4] << 24;
+        mp_obj_t tuple[5] = {
+            mp_obj_new_bytes(buf + 1, len),
+            MP_OBJ_NEW_SMALL_INT(rssi),
+            MP_OBJ_NEW_SMALL_INT(timestamp_us & (MICROPY_PY_TIME_TICKS_PERIOD - 1)),
+            MP_OBJ_NEW_SMALL_INT(buf[1 + len + 5]),
+            MP_OBJ_NEW_SMALL_INT(buf[1 + len + 6]),
+        };
+        MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_RADIO_RECEIVE, len);
+        microbit_radio_pop();
+        return mp_obj_new_tuple(5, tuple);
+    }
+}
+MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_receive_tagged_obj, mod_radio_receive_tagged);
+
+// Copy as many waiting packets as possible into buf, using the same record format as
+// the RX queue (see drv_radio.h).  The start offset of each record within buf can be
+// written to the optional offsets buffer, which may be any integer array type.
+STATIC mp_obj_t mod_radio_receive_many(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_offsets, ARG_max_packets };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_offsets, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_max_packets, MP_ARG_INT, {.u_int = -1} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_WRITE);
+
+    size_t max_packets = args[ARG_max_packets].u_int < 0 ? SIZE_MAX : (size_t)args[ARG_max_packets].u_int;
+    mp_buffer_info_t offsets_info = { .buf = NULL };
+    if (args[ARG_offsets].u_obj != mp_const_none) {
+        mp_get_buffer_raise(args[ARG_offsets].u_obj, &offsets_info, MP_BUFFER_WRITE);
+        size_t offsets_len = offsets_info.len / mp_binary_get_size('@', offsets_info.typecode, NULL);
+        max_packets = MIN(max_packets, offsets_len);
+    }
+
+    ensure_enabled();
+    uint8_t *dest = bufinfo.buf;
+    size_t num_packets = 0;
+    size_t offset = 0;
+    while (num_packets < max_packets) {
+        const uint8_t *buf = radio_peek();
+        if (buf == NULL) {
+            break;
+        }
+        size_t record_len = RADIO_PACKET_RECORD_LEN(buf[0]);
+        if (offset + record_len > bufinfo.len) {
+            // Leave the packet on the queue for the next call.
+            break;
+        }
+        memcpy(dest + offset, buf, record_len);
+        microbit_radio_pop();
+        if (offsets_info.buf != NULL) {
+            mp_binary_set_val_array_from_int(offsets_info.typecode, offsets_info.buf, num_packets, offset);
+        }
+        offset += record_len;
+        ++num_packets;
+    }
+
+    return MP_OBJ_NEW_SMALL_INT(num_packets);
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mod_radio_receive_many_obj, 1, mod_radio_receive_many);
+
+STATIC mp_obj_t mod_radio_stats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_reset };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset, MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    microbit_radio_stats_t stats;
+    microbit_radio_get_stats(&stats, args[ARG_reset].u_bool);
+
+    mp_obj_t result = mp_obj_new_dict(7);
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_received), mp_obj_new_int_from_uint(stats.rx_packets));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_sent), mp_obj_new_int_from_uint(stats.tx_packets));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_crc_errors), mp_obj_new_int_from_uint(stats.crc_errors));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_queue_full), mp_obj_new_int_from_uint(stats.rx_queue_full));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_queue_depth), mp_obj_new_int_from_uint(stats.rx_queue_depth));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_queue_peak), mp_obj_new_int_from_uint(stats.rx_queue_peak));
+    mp_obj_dict_store(result, MP_OBJ_NEW_QSTR(MP_QSTR_tx_busy_us), mp_obj_new_int_from_uint(stats.tx_busy_us));
+    return result;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mod_radio_stats_obj, 0, mod_radio_stats);
+
+/******************************************************************************/
+// Reliable streams, reassembled by the RADIO IRQ straight into the caller's buffer
+
+// Stream acks have to fit in a packet too, on both ends.
+STATIC size_t radio_stream_fragment_size(void) {
+    ensure_enabled();
+    if (radio_config.max_payload < MICROBIT_RADIO_STREAM_ACK_LEN) {
+        mp_raise_ValueError(MP_ERROR_TEXT("length too short for streams"));
+    }
+    return radio_config.max_payload - MICROBIT_RADIO_STREAM_DATA_OVERHEAD;
+}
+
+// Returns the number of fragments that had to be sent again.
+STATIC mp_obj_t mod_radio_send_stream(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_message, ARG_timeout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_message, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1000} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_message].u_obj, &bufinfo, MP_BUFFER_READ);
+    size_t fragment_size = radio_stream_fragment_size();
+    if (bufinfo.len > MICROBIT_RADIO_STREAM_MAX_FRAGMENTS * fragment_size) {
+        mp_raise_ValueError(MP_ERROR_TEXT("message too long"));
+    }
+    if (args[ARG_timeout].u_int < 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid timeout"));
+    }
+
+    size_t resent;
+    if (!microbit_radio_stream_send(bufinfo.buf, bufinfo.len, fragment_size, args[ARG_timeout].u_int, &resent)) {
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+    return MP_OBJ_NEW_SMALL_INT(resent);
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mod_radio_send_stream_obj, 1, mod_radio_send_stream);
+
+// Returns the length of the message received into buf, or None on timeout.
+STATIC mp_obj_t mod_radio_receive_stream(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_timeout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    uint32_t timeout_ms = UINT32_MAX;
+    if (args[ARG_timeout].u_obj != mp_const_none) {
+        mp_int_t timeout = mp_obj_get_int(args[ARG_timeout].u_obj);
+        if (timeout < 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("invalid timeout"));
+        }
+        timeout_ms = MIN((mp_uint_t)timeout, UINT32_MAX - 1);
+    }
+    radio_stream_fragment_size();
+
+    size_t len;
+    if (!microbit_radio_stream_receive(bufinfo.buf, bufinfo.len, timeout_ms, &len)) {
+        return mp_const_none;
+    }
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mod_radio_receive_stream_obj, 1, mod_radio_receive_stream);
+
+/******************************************************************************/
+// Zero-copy receive view
+
+// There is only ever one packet lent out, so the view object and the memoryview that
+// it hands out are statically allocated.  This means receiving a packet this way does
+// not touch the heap at all.  When the packet is released the memoryview is shrunk to
+// zero length, so any reference that escapes the "with" block can't see stale data.
+
+typedef struct _radio_view_obj_t {
+    mp_obj_base_t base;
+    bool lent;
+} radio_view_obj_t;
+
+STATIC radio_view_obj_t radio_view_obj = { { &radio_view_type }, false };
+STATIC mp_obj_array_t radio_view_memoryview;
+
+// If pop is false then the packet buffer is about to be freed, so just forget about it.
+STATIC void radio_view_release(bool pop) {
+    if (radio_view_obj.lent) {
+        radio_view_obj.lent = false;
+        radio_view_memoryview.len = 0;
+        if (pop) {
+            microbit_radio_pop();
+        }
+    }
+}
+
+STATIC mp_obj_t radio_view___enter__(mp_obj_t self_in) {
+    (void)self_in;
+    ensure_enabled();
+    if (!radio_view_obj.lent) {
+        const uint8_t *buf = microbit_radio_peek();
+        if (buf == NULL) {
+            return mp_const_none;
+        }
+        mp_obj_memoryview_init(&radio_view_memoryview, 'B', 0, buf[0], (void *)(buf + 1));
+        radio_view_obj.lent = true;
+    }
+    return MP_OBJ_FROM_PTR(&radio_view_memoryview);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(radio_view___enter___obj, radio_view___enter__);
+
+STATIC mp_obj_t radio_view_release_(mp_obj_t self_in) {
+    (void)self_in;
+    radio_view_release(true);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(radio_view_release_obj, radio_view_release_);
+
+STATIC mp_obj_t radio_view___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return radio_view_release_(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(radio_view___exit___obj, 4, 4, radio_view___exit__);
+
+STATIC const mp_rom_map_elem_t radio_view_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&radio_view___enter___obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&radio_view___exit___obj) },
+    { MP_ROM_QSTR(MP_QSTR_release), MP_ROM_PTR(&radio_view_release_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(radio_view_locals_dict, radio_view_locals_dict_table);
+
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    radio_view_type,
+    MP_QSTR_RadioView,
+    MP_TYPE_FLAG_NONE,
+    locals_dict, &radio_view_locals_dict
+    );
+
+STATIC mp_obj_t mod_radio_receive_view(void) {
+    ensure_enabled();
+    return MP_OBJ_FROM_PTR(&radio_view_obj);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_receive_view_obj, mod_radio_receive_view);
+
+/******************************************************************************/
+// Record schemas
+
+// A Schema is a fixed packet layout, parsed once from a struct-like format string, so
+// packing and unpacking a record doesn't parse anything or allocate per field.  Fields
+// are little endian and unaligned: b B ? (1 byte), h H (2), i I l L f (4), with x for a
+// pad byte and an optional repeat count before each code.  An optional tag is sent
+// before the fields, so that a receiver can tell record types apart.
+
+#define RADIO_SCHEMA_MAX_SIZE (251)
+#define RADIO_SCHEMA_MAX_TAG (4)
+
+typedef struct _radio_schema_obj_t {
+    mp_obj_base_t base;
+    uint8_t size;
+    uint8_t num_fields;
+    uint8_t num_codes;
+    uint8_t tag_len;
+    uint8_t tag[RADIO_SCHEMA_MAX_TAG];
+    char codes[]; // format with repeat counts expanded
+} radio_schema_obj_t;
+
+STATIC size_t radio_schema_code_size(char code) {
+    switch (code) {
+        case 'b':
+        case 'B':
+        case '?':
+        case 'x':
+            return 1;
+        case 'h':
+        case 'H':
+            return 2;
+        case 'i':
+        case 'I':
+        case 'l':
+        case 'L':
+        case 'f':
+            return 4;
+        default:
+            mp_raise_ValueError(MP_ERROR_TEXT("bad format code"));
+    }
+}
+
+// Expand fmt into codes, if it isn't NULL, and return the number of codes.
+STATIC size_t radio_schema_parse(const char *fmt, size_t fmt_len, size_t max_size, char *codes, size_t *size) {
+    size_t num_codes = 0;
+    *size = 0;
+    size_t i = 0;
+    if (fmt_len > 0 && fmt[0] == '<') {
+        ++i;
+    }
+    while (i < fmt_len) {
+        size_t count = 1;
+        if (unichar_isdigit(fmt[i])) {
+            count = 0;
+            while (i < fmt_len && unichar_isdigit(fmt[i])) {
+                count = MIN(count * 10 + fmt[i++] - '0', max_size + 1);
+            }
+            if (i == fmt_len) {
+                mp_raise_ValueError(MP_ERROR_TEXT("bad format code"));
+            }
+        }
+        char code = fmt[i++];
+        *size += count * radio_schema_code_size(code);
+        if (*size > max_size) {
+            mp_raise_ValueError(MP_ERROR_TEXT("record too long"));
+        }
+        if (codes != NULL) {
+            memset(codes + num_codes, code, count);
+        }
+        num_codes += count;
+    }
+    return num_codes;
+}
+
+STATIC mp_obj_t radio_schema_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_format, ARG_tag };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_format, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_tag, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t tag = { .buf = NULL, .len = 0 };
+    if (args[ARG_tag].u_obj != mp_const_none) {
+        mp_get_buffer_raise(args[ARG_tag].u_obj, &tag, MP_BUFFER_READ);
+        if (tag.len > RADIO_SCHEMA_MAX_TAG) {
+            mp_raise_ValueError(MP_ERROR_TEXT("tag too long"));
+        }
+    }
+
+    size_t fmt_len;
+    const char *fmt = mp_obj_str_get_data(args[ARG_format].u_obj, &fmt_len);
+    size_t size;
+    size_t num_codes = radio_schema_parse(fmt, fmt_len, RADIO_SCHEMA_MAX_SIZE - tag.len, NULL, &size);
+    radio_schema_obj_t *self = m_new_obj_var(radio_schema_obj_t, codes, char, num_codes);
+    self->base.type = type;
+    radio_schema_parse(fmt, fmt_len, RADIO_SCHEMA_MAX_SIZE - tag.len, self->codes, &size);
+    self->size = size;
+    self->num_codes = num_codes;
+    self->num_fields = 0;
+    for (size_t i = 0; i < num_codes; ++i) {
+        self->num_fields += self->codes[i] != 'x';
+    }
+    self->tag_len = tag.len;
+    memcpy(self->tag, tag.buf, tag.len);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC void radio_schema_pack(radio_schema_obj_t *self, uint8_t *dest, size_t n_values, const mp_obj_t *values) {
+    if (n_values != self->num_fields) {
+        mp_raise_ValueError(MP_ERROR_TEXT("wrong number of values"));
+    }
+    for (size_t i = 0; i < self->num_codes; ++i) {
+        char code = self->codes[i];
+        size_t n = radio_schema_code_size(code);
+        uint32_t val;
+        if (code == 'x') {
+            val = 0;
+        } else if (code == 'f') {
+            float f = mp_obj_get_float(*values++);
+            memcpy(&val, &f, 4);
+        } else if (code == '?') {
+            val = mp_obj_is_true(*values++);
+        } else {
+            val = mp_obj_get_int_truncated(*values++);
+        }
+        // The CPU is little endian, so the low bytes are the value.
+        memcpy(dest, &val, n);
+        dest += n;
+    }
+}
+
+STATIC mp_obj_t radio_schema_unpack(radio_schema_obj_t *self, const uint8_t *src) {
+    mp_obj_tuple_t *tuple = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->num_fields, NULL));
+    mp_obj_t *item = tuple->items;
+    for (size_t i = 0; i < self->num_codes; ++i) {
+        char code = self->codes[i];
+        size_t n = radio_schema_code_size(code);
+        uint32_t val = 0;
+        memcpy(&val, src, n);
+        src += n;
+        switch (code) {
+            case 'x':
+                continue;
+            case 'b':
+                *item++ = MP_OBJ_NEW_SMALL_INT((int8_t)val);
+                break;
+            case 'h':
+                *item++ = MP_OBJ_NEW_SMALL_INT((int16_t)val);
+                break;
+            case 'i':
+            case 'l':
+                *item++ = mp_obj_new_int((int32_t)val);
+                break;
+            case 'I':
+            case 'L':
+                *item++ = mp_obj_new_int_from_uint(val);
+                break;
+            case '?':
+                *item++ = mp_obj_new_bool(val);
+                break;
+            case 'f': {
+                float f;
+                memcpy(&f, &val, 4);
+                *item++ = mp_obj_new_float(f);
+                break;
+            }
+            default:
+                *item++ = MP_OBJ_NEW_SMALL_INT(val);
+                break;
+        }
+    }
+    return MP_OBJ_FROM_PTR(tuple);
+}
+
+// Schema.pack_into(buf, offset, *values) packs the fields, without the tag, into buf.
+STATIC mp_obj_t radio_schema_pack_into(size_t n_args, const mp_obj_t *args) {
+    radio_schema_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    mp_int_t offset = mp_obj_get_int(args[2]);
+    if (offset < 0) {
+        offset += bufinfo.len;
+    }
+    if (offset < 0 || (size_t)offset + self->size > bufinfo.len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+    }
+    radio_schema_pack(self, (uint8_t *)bufinfo.buf + offset, n_args - 3, args + 3);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(radio_schema_pack_into_obj, 3, radio_schema_pack_into);
+
+// Schema.unpack_from(buf, offset=0) returns a tuple of the fields at offset in buf.
+STATIC mp_obj_t radio_schema_unpack_from(size_t n_args, const mp_obj_t *args) {
+    radio_schema_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    mp_int_t offset = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+    if (offset < 0) {
+        offset += bufinfo.len;
+    }
+    if (offset < 0 || (size_t)offset + self->size > bufinfo.len) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+    }
+    return radio_schema_unpack(self, (const uint8_t *)bufinfo.buf + offset);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(radio_schema_unpack_from_obj, 2, 3, radio_schema_unpack_from);
+
+// Schema.send(*values, block=True) packs a record on the stack and sends it after the tag.
+STATIC mp_obj_t radio_schema_send(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    radio_schema_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    bool block = true;
+    mp_map_elem_t *elem = mp_map_lookup(kw_args, MP_OBJ_NEW_QSTR(MP_QSTR_block), MP_MAP_LOOKUP);
+    if (elem != NULL) {
+        block = mp_obj_is_true(elem->value);
+    }
+    if (kw_args->used > (elem != NULL)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("unexpected keyword argument"));
+    }
+    uint8_t record[RADIO_SCHEMA_MAX_SIZE];
+    radio_schema_pack(self, record, n_args - 1, args + 1);
+    radio_send(self->tag, self->tag_len, record, self->size, block);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(radio_schema_send_obj, 1, radio_schema_send);
+
+// Schema.receive() decodes the next packet straight from the RX queue, or returns None if
+// there isn't one.  A packet that doesn't match the schema is dropped with ValueError.
+STATIC mp_obj_t radio_schema_receive(mp_obj_t self_in) {
+    radio_schema_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    ensure_enabled();
+    const uint8_t *buf = radio_peek();
+    if (buf == NULL) {
+        return mp_const_none;
+    }
+    if (MICROBIT_RADIO_PACKET_LEN(buf) != self->tag_len + self->size
+        || memcmp(MICROBIT_RADIO_PACKET_PAYLOAD(buf), self->tag, self->tag_len) != 0) {
+        microbit_radio_pop();
+        mp_raise_ValueError(MP_ERROR_TEXT("received packet does not match schema"));
+    }
+    mp_obj_t ret;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        ret = radio_schema_unpack(self, MICROBIT_RADIO_PACKET_PAYLOAD(buf) + self->tag_len);
+        nlr_pop();
+    } else {
+        // Out of memory for the tuple, so don't leave the packet to be decoded again.
+        microbit_radio_pop();
+        nlr_jump(nlr.ret_val);
+    }
+    microbit_radio_pop();
+    return ret;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(radio_schema_receive_obj, radio_schema_receive);
+
+STATIC mp_obj_t radio_schema_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    radio_schema_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(self->size);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC const mp_rom_map_elem_t radio_schema_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&radio_schema_pack_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&radio_schema_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&radio_schema_send_obj) },
+    { MP_ROM_QSTR(MP_QSTR_receive), MP_ROM_PTR(&radio_schema_receive_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(radio_schema_locals_dict, radio_schema_locals_dict_table);
+
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    radio_schema_type,
+    MP_QSTR_Schema,
+    MP_TYPE_FLAG_NONE,
+    make_new, radio_schema_make_new,
+    unary_op, radio_schema_unary_op,
+    locals_dict, &radio_schema_locals_dict
+    );
+
+/******************************************************************************/
+// radio.sync submodule
+
+// Times seen by Python are ticks_us() values, which wrap at MICROPY_PY_TIME_TICKS_PERIOD.
+#define SYNC_TICKS_MASK(t) ((t) & (MICROPY_PY_TIME_TICKS_PERIOD - 1))
+#define SYNC_TICKS_DIFF(t1, t0) ((mp_int_t)SYNC_TICKS_MASK((t1) - (t0) + MICROPY_PY_TIME_TICKS_PERIOD / 2) - MICROPY_PY_TIME_TICKS_PERIOD / 2)
+
+STATIC bool radio_sync_get_estimate(microbit_radio_sync_estimate_t *estimate) {
+    if (!microbit_radio_sync_get_estimate(estimate)) {
+        return false;
+    }
+    estimate->remote_us = SYNC_TICKS_MASK(estimate->remote_us);
+    estimate->local_us = SYNC_TICKS_MASK(estimate->local_us);
+    return true;
+}
+
+STATIC mp_obj_t mod_radio_sync_follow(size_t n_args, const mp_obj_t *args) {
+    microbit_radio_sync_set_follow(n_args == 0 || mp_obj_is_true(args[0]));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_radio_sync_follow_obj, 0, 1, mod_radio_sync_follow);
+
+STATIC mp_obj_t mod_radio_sync_beacon(void) {
+    ensure_enabled();
+    uint8_t buf[MICROBIT_RADIO_SYNC_BEACON_LEN];
+    size_t len = microbit_radio_sync_make_beacon(buf);
+    microbit_radio_sync_beacon_sent(microbit_radio_send_timed(buf, len, NULL, 0));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_sync_beacon_obj, mod_radio_sync_beacon);
+
+STATIC mp_obj_t mod_radio_sync_reset(void) {
+    microbit_radio_sync_reset();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_sync_reset_obj, mod_radio_sync_reset);
+
+STATIC mp_obj_t mod_radio_sync_samples(void) {
+    microbit_radio_sync_estimate_t estimate;
+    if (!radio_sync_get_estimate(&estimate)) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+    return MP_OBJ_NEW_SMALL_INT(estimate.num_samples);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_sync_samples_obj, mod_radio_sync_samples);
+
+// Returns local time minus remote time, in microseconds.
+STATIC mp_obj_t mod_radio_sync_offset(void) {
+    microbit_radio_sync_estimate_t estimate;
+    if (!radio_sync_get_estimate(&estimate)) {
+        return mp_const_none;
+    }
+    return MP_OBJ_NEW_SMALL_INT(SYNC_TICKS_DIFF(estimate.local_us, estimate.remote_us));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_sync_offset_obj, mod_radio_sync_offset);
+
+// Returns how fast the local clock runs relative to the remote one, in parts per million.
+STATIC mp_obj_t mod_radio_sync_drift(void) {
+    microbit_radio_sync_estimate_t estimate;
+    if (!radio_sync_get_estimate(&estimate)) {
+        return mp_const_none;
+    }
+    return mp_obj_new_float((estimate.rate - 1) * 1000000);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_radio_sync_drift_obj, mod_radio_sync_drift);
+
+STATIC mp_obj_t mod_radio_sync_to_local(mp_obj_t remote_in) {
+    microbit_radio_sync_estimate_t estimate;
+    if (!radio_sync_get_estimate(&estimate)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("not synchronised"));
+    }
+    mp_int_t dt = SYNC_TICKS_DIFF((mp_uint_t)mp_obj_get_int(remote_in), estimate.remote_us);
+    return MP_OBJ_NEW_SMALL_INT(SYNC_TICKS_MASK(estimate.local_us + (mp_int_t)(dt * estimate.rate)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_radio_sync_to_local_obj, mod_radio_sync_to_local);
+
+STATIC mp_obj_t mod_radio_sync_to_remote(mp_obj_t local_in) {
+    microbit_radio_sync_estimate_t estimate;
+    if (!radio_sync_get_estimate(&estimate)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("not synchronised"));
+    }
+    mp_int_t dt = SYNC_TICKS_DIFF((mp_uint_t)mp_obj_get_int(local_in), estimate.local_us);
+    return MP_OBJ_NEW_SMALL_INT(SYNC_TICKS_MASK(estimate.remote_us + (mp_int_t)(dt / estimate.rate)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_radio_sync_to_remote_obj, mod_radio_sync_to_remote);
+
+STATIC const mp_rom_map_elem_t radio_sync_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_sync) },
+    { MP_ROM_QSTR(MP_QSTR_follow), MP_ROM_PTR(&mod_radio_sync_follow_obj) },
+    { MP_ROM_QSTR(MP_QSTR_beacon), MP_ROM_PTR(&mod_radio_sync_beacon_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&mod_radio_sync_reset_obj) },
+    { MP_ROM_QSTR(MP_QSTR_samples), MP_ROM_PTR(&mod_radio_sync_samples_obj) },
+    { MP_ROM_QSTR(MP_QSTR_offset), MP_ROM_PTR(&mod_radio_sync_offset_obj) },
+    { MP_ROM_QSTR(MP_QSTR_drift), MP_ROM_PTR(&mod_radio_sync_drift_obj) },
+    { MP_ROM_QSTR(MP_QSTR_to_local), MP_ROM_PTR(&mod_radio_sync_to_local_obj) },
+    { MP_ROM_QSTR(MP_QSTR_to_remote), MP_ROM_PTR(&mod_radio_sync_to_remote_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(radio_sync_module_globals, radio_sync_module_globals_table);
+
+STATIC const mp_obj_module_t radio_sync_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&radio_sync_module_globals,
+};
+
+/******************************************************************************/
+// radio module
+
 STATIC const mp_map_elem_t radio_module_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_radio) },
     { MP_OBJ_NEW_QSTR(MP_QSTR___init__), (mp_obj_t)&mod_radio___init___obj },
@@ -274,6 +1051,15 @@ STATIC const mp_map_elem_t radio_module_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_receive), (mp_obj_t)&mod_radio_receive_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_receive_bytes_into), (mp_obj_t)&mod_radio_receive_bytes_into_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_receive_full), (mp_obj_t)&mod_radio_receive_full_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_receive_tagged), (mp_obj_t)&mod_radio_receive_tagged_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_receive_many), (mp_obj_t)&mod_radio_receive_many_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_receive_view), (mp_obj_t)&mod_radio_receive_view_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_on_receive), (mp_obj_t)&mod_radio_on_receive_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stats), (mp_obj_t)&mod_radio_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_send_stream), (mp_obj_t)&mod_radio_send_stream_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_receive_stream), (mp_obj_t)&mod_radio_receive_stream_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sync), (mp_obj_t)&radio_sync_module },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Schema), (mp_obj_t)&radio_schema_type },
 
     // A rate of 250Kbit is physically supported by the nRF52 but it is deprecated,
     // so don't provide the constant to the Python user.  They can still select this
@@ -292,3 +1078,5 @@ const mp_obj_module_t radio_module = {
 };
 
 MP_REGISTER_MODULE(MP_QSTR_radio, radio_module);
+
+MP_REGISTER_ROOT_POINTER(mp_obj_t radio_rx_handler);
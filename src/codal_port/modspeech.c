@@ -32,6 +32,7 @@
 #include "py/obj.h"
 #include "py/objtuple.h"
 #include "py/objstr.h"
+#include "drv_alloc.h"
 #include "microbithal.h"
 #include "modmicrobit.h"
 #include "modaudio.h"
@@ -53,8 +54,14 @@
 // If enabled, use a dedicated audio mixer channer with a double buffer.
 #define USE_DEDICATED_AUDIO_CHANNEL (1)
 
+// Number of recent translate() results to keep, so repeated text skips the reciter.
+#define TRANSLATE_CACHE_SIZE (4)
+
 #if USE_DEDICATED_AUDIO_CHANNEL
 #define OUT_CHUNK_SIZE (128)
+// SAM outputs at most this many samples at once, so when speaking in the background
+// rendering pauses this close to the end of a chunk if that chunk can't be queued yet.
+#define OUT_CHUNK_SLACK (16)
 #else
 #define OUT_CHUNK_SIZE (32) // must match audio frame size
 #endif
@@ -71,6 +78,8 @@ extern int debug;
 
 static int synth_mode = 0;
 static int synth_volume = 0;
+// Output value for each SAM value `b>>4`, for the current synth_volume.
+static uint8_t synth_volume_map[16];
 static microbit_audio_frame_obj_t *sam_output_frame;
 static volatile unsigned int buf_start_pos = 0;
 static volatile unsigned int last_pos = 0;
@@ -86,6 +95,14 @@ static uint8_t speech_output_buffer[2 * OUT_CHUNK_SIZE];
 static unsigned int speech_output_buffer_idx;
 static volatile int speech_output_write;
 static volatile int speech_output_read;
+// When non-NULL, samples are appended to this buffer instead of being played.
+static vstr_t *speech_render_vstr;
+// MP_STATE_PORT(speech_background_data) is non-NULL while speech renders in the background,
+// driven by the speech channel requesting data.
+#define speech_background (MP_STATE_PORT(speech_background_data) != NULL)
+static volatile bool speech_render_scheduled;
+static bool speech_render_finishing;
+STATIC void speech_schedule_render(void);
 #else
 static volatile bool audio_output_ready = false;
 #endif
@@ -99,6 +116,9 @@ void microbit_hal_audio_speech_ready_callback(void) {
         // missed
         speech_output_read = -2;
     }
+    if (speech_background) {
+        speech_schedule_render();
+    }
     #else
     audio_output_ready = true;
     #endif
@@ -148,12 +168,106 @@ STATIC void speech_wait_output_drained(void) {
 
 #if USE_DEDICATED_AUDIO_CHANNEL
 STATIC void speech_output_sample(uint8_t b) {
+    if (speech_render_vstr != NULL) {
+        if (speech_render_vstr->len == speech_render_vstr->alloc) {
+            // Double the allocation so the total amount of copying stays linear.
+            vstr_hint_size(speech_render_vstr, speech_render_vstr->alloc);
+        }
+        vstr_add_byte(speech_render_vstr, b);
+        return;
+    }
     speech_output_buffer[OUT_CHUNK_SIZE * speech_output_write + speech_output_buffer_idx++] = b;
     if (speech_output_buffer_idx >= OUT_CHUNK_SIZE) {
         speech_wait_output_drained();
         speech_output_buffer_idx = 0;
     }
 }
+
+// Output the same sample n times, filling whole runs of the buffer at once.
+STATIC void speech_output_run(uint8_t b, unsigned int n) {
+    if (speech_render_vstr != NULL) {
+        if (speech_render_vstr->len + n > speech_render_vstr->alloc) {
+            vstr_hint_size(speech_render_vstr, MAX(speech_render_vstr->alloc, n));
+        }
+        memset(vstr_add_len(speech_render_vstr, n), b, n);
+        return;
+    }
+    while (n > 0) {
+        unsigned int len = MIN(n, OUT_CHUNK_SIZE - speech_output_buffer_idx);
+        memset(&speech_output_buffer[OUT_CHUNK_SIZE * speech_output_write + speech_output_buffer_idx], b, len);
+        speech_output_buffer_idx += len;
+        n -= len;
+        if (speech_output_buffer_idx >= OUT_CHUNK_SIZE) {
+            speech_wait_output_drained();
+            speech_output_buffer_idx = 0;
+        }
+    }
+}
+
+// Called by SAM between outputs, to see if it should stop rendering for now.
+int SamOutputFull(void) {
+    return speech_background
+        && speech_output_read >= 0
+        && speech_output_buffer_idx + OUT_CHUNK_SLACK >= OUT_CHUNK_SIZE;
+}
+
+void microbit_speech_stop(void) {
+    MP_STATE_PORT(speech_background_data) = NULL;
+}
+
+bool microbit_speech_is_speaking(void) {
+    return speech_background;
+}
+
+// Render the next part of background speech, until the output buffer is full.
+STATIC mp_obj_t speech_render_task(mp_obj_t arg) {
+    (void)arg;
+    speech_render_scheduled = false;
+    if (!speech_background) {
+        return mp_const_none;
+    }
+    if (!speech_render_finishing) {
+        if (SAMRender(MP_STATE_PORT(speech_background_data))) {
+            // Output is full, continue when the speech channel next takes a chunk.
+            return mp_const_none;
+        }
+        speech_render_finishing = true;
+    }
+    if (speech_output_read >= 0) {
+        // Wait for the chunk that is ready to be taken.
+        return mp_const_none;
+    }
+    if (speech_output_buffer_idx != 0) {
+        // Pad out and queue the final chunk.
+        while (speech_output_buffer_idx != 0) {
+            speech_output_sample(128);
+        }
+        return mp_const_none;
+    }
+    microbit_speech_stop();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(speech_render_task_obj, speech_render_task);
+
+STATIC void speech_schedule_render(void) {
+    if (!speech_render_scheduled) {
+        speech_render_scheduled = mp_sched_schedule(MP_OBJ_FROM_PTR(&speech_render_task_obj), mp_const_none);
+    }
+}
+
+#else
+
+int SamOutputFull(void) {
+    return false;
+}
+
+void microbit_speech_stop(void) {
+}
+
+bool microbit_speech_is_speaking(void) {
+    return false;
+}
+
 #endif
 
 // Table to map SAM value `b>>4` to an output value for the PWM.
@@ -198,23 +312,32 @@ static const uint8_t sam_sample_remap[16] = {
 // 13    254
 // 14    82
 // 15    1
+// Work out synth_volume_map for the synth_volume setting, which adjusts b to increase volume.
+STATIC void sam_volume_map_init(void) {
+    for (unsigned int i = 0; i < 16; ++i) {
+        uint32_t b = i << 4;
+        if (synth_volume == 0) {
+            // pass
+        } else if (synth_volume == 1) {
+            b |= b >> 4;
+        } else if (synth_volume == 2) {
+            if (b < (2 << 4)) b = 2 << 4;
+            if (b > (14 << 4)) b = 14 << 4;
+            b = (b - (2 << 4)) * 255 / (12 << 4);
+        } else if (synth_volume == 3) {
+            if (b < (3 << 4)) b = 3 << 4;
+            if (b > (13 << 4)) b = 13 << 4;
+            b = (b - (3 << 4)) * 255 / (10 << 4);
+        } else if (synth_volume == 4) {
+            b = sam_sample_remap[i];
+        }
+        synth_volume_map[i] = b;
+    }
+}
+
 void SamOutputByte(unsigned int pos, unsigned char b) {
     // Adjust b to increase volume, based on synth_volume setting.
-    if (synth_volume == 0) {
-        // pass
-    } else if (synth_volume == 1) {
-        b |= b >> 4;
-    } else if (synth_volume == 2) {
-        if (b < (2 << 4)) b = 2 << 4;
-        if (b > (14 << 4)) b = 14 << 4;
-        b = ((uint32_t)b - (2 << 4)) * 255 / (12 << 4);
-    } else if (synth_volume == 3) {
-        if (b < (3 << 4)) b = 3 << 4;
-        if (b > (13 << 4)) b = 13 << 4;
-        b = ((uint32_t)b - (3 << 4)) * 255 / (10 << 4);
-    } else if (synth_volume == 4) {
-        b = sam_sample_remap[b >> 4];
-    }
+    b = synth_volume_map[b >> 4];
 
     if (synth_mode == 0) {
         // Traditional micro:bit v1
@@ -256,9 +379,10 @@ void SamOutputByte(unsigned int pos, unsigned char b) {
 
         if (synth_mode == 1 || synth_mode == 3) {
             // No smoothing, just output b as many times as needed to get to idx_full.
-            while (last_idx < idx_full) {
-                last_idx += 1;
-                speech_output_sample(b);
+            if (last_idx < idx_full) {
+                unsigned int n = idx_full - last_idx;
+                last_idx = idx_full;
+                speech_output_run(b, n);
             }
         } else {
             // Apply linear interpolation from last_b to b.
@@ -361,6 +485,36 @@ STATIC mp_obj_t make_speech_iter(void) {
 
 #endif
 
+// The cache holds (text, phonemes) pairs, most recently used first.
+STATIC mp_obj_t translate_cache_lookup(const char *txt, size_t len) {
+    mp_obj_t *cache = MP_STATE_PORT(speech_translate_cache);
+    for (size_t i = 0; i < TRANSLATE_CACHE_SIZE && cache[2 * i] != MP_OBJ_NULL; ++i) {
+        size_t key_len;
+        const char *key = mp_obj_str_get_data(cache[2 * i], &key_len);
+        if (key_len == len && memcmp(key, txt, len) == 0) {
+            mp_obj_t text = cache[2 * i];
+            mp_obj_t phonemes = cache[2 * i + 1];
+            memmove(&cache[2], &cache[0], 2 * i * sizeof(mp_obj_t));
+            cache[0] = text;
+            cache[1] = phonemes;
+            return phonemes;
+        }
+    }
+    return MP_OBJ_NULL;
+}
+
+STATIC void translate_cache_insert(mp_obj_t text, mp_obj_t phonemes) {
+    mp_obj_t *cache = MP_STATE_PORT(speech_translate_cache);
+    memmove(&cache[2], &cache[0], 2 * (TRANSLATE_CACHE_SIZE - 1) * sizeof(mp_obj_t));
+    cache[0] = text;
+    cache[1] = phonemes;
+}
+
+void microbit_speech_deinit(void) {
+    microbit_speech_stop();
+    memset(MP_STATE_PORT(speech_translate_cache), 0, sizeof(MP_STATE_PORT(speech_translate_cache)));
+}
+
 STATIC mp_obj_t translate(mp_obj_t words) {
     mp_uint_t len, outlen;
     const char *txt = mp_obj_str_get_data(words, &len);
@@ -369,7 +523,12 @@ STATIC mp_obj_t translate(mp_obj_t words) {
     if (len > 80) {
         mp_raise_ValueError(MP_ERROR_TEXT("text too long"));
     }
+    mp_obj_t cached = translate_cache_lookup(txt, len);
+    if (cached != MP_OBJ_NULL) {
+        return cached;
+    }
     reciter_memory *mem = m_new(reciter_memory, 1);
+    MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_SPEECH, sizeof(reciter_memory));
     MP_STATE_PORT(speech_data) = mem;
     for (mp_uint_t i = 0; i < len; i++) {
         mem->input[i] = txt[i];
@@ -387,11 +546,15 @@ STATIC mp_obj_t translate(mp_obj_t words) {
     mp_obj_t res = mp_obj_new_str_of_type(&mp_type_str, (byte *)mem->input, outlen);
     // Prevent input becoming invisible to GC due to tail-call optimisation.
     MP_STATE_PORT(speech_data) = NULL;
+    translate_cache_insert(words, res);
     return res;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(translate_obj, translate);
 
-STATIC mp_obj_t articulate(mp_obj_t phonemes, mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args, bool sing) {
+// If render is non-NULL then the samples are appended to it rather than played, and the
+// pin and wait arguments are ignored.  If wait is false then this returns straight away,
+// and the speech renders in the background as the speech channel needs more data.
+STATIC mp_obj_t articulate(mp_obj_t phonemes, mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args, bool sing, vstr_t *render) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_pitch,    MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = DEFAULT_PITCH} },
         { MP_QSTR_speed,    MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = DEFAULT_SPEED} },
@@ -401,13 +564,20 @@ STATIC mp_obj_t articulate(mp_obj_t phonemes, mp_uint_t n_args, const mp_obj_t *
         { MP_QSTR_mode,     MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = MICROPY_PY_SPEECH_DEFAULT_MODE} },
         { MP_QSTR_volume,   MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 4} },
         { MP_QSTR_pin,      MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&microbit_pin_default_audio_obj)} },
+        { MP_QSTR_wait,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
     };
 
     // parse args
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
+    #if USE_DEDICATED_AUDIO_CHANNEL
+    // Stop any speech still rendering in the background.
+    microbit_speech_stop();
+    #endif
+
     sam_memory *sam = m_new(sam_memory, 1);
+    MICROBIT_ALLOC_TRACE(MICROBIT_ALLOC_SITE_SPEECH, sizeof(sam_memory));
     MP_STATE_PORT(speech_data) = sam;
 
     // set the current saved speech state
@@ -419,6 +589,7 @@ STATIC mp_obj_t articulate(mp_obj_t phonemes, mp_uint_t n_args, const mp_obj_t *
     debug = args[4].u_bool;
     synth_mode = args[5].u_int;
     synth_volume = args[6].u_int;
+    sam_volume_map_init();
 
     mp_uint_t len;
     const char *input = mp_obj_str_get_data(phonemes, &len);
@@ -433,8 +604,14 @@ STATIC mp_obj_t articulate(mp_obj_t phonemes, mp_uint_t n_args, const mp_obj_t *
 
     #if USE_DEDICATED_AUDIO_CHANNEL
     sam_output_reset(NULL);
-    microbit_pin_audio_select(args[7].u_obj, microbit_pin_mode_audio_play);
-    microbit_hal_audio_speech_init(sample_rate);
+    speech_render_vstr = render;
+    if (render == NULL) {
+        microbit_pin_audio_select(args[7].u_obj, microbit_pin_mode_audio_play);
+        microbit_hal_audio_speech_init(sample_rate);
+    } else if (synth_mode == 0) {
+        MP_STATE_PORT(speech_data) = NULL;
+        mp_raise_ValueError(MP_ERROR_TEXT("mode not supported"));
+    }
     #else
     speech_iterator_t *src = make_speech_iter();
     sam_output_reset(src->buf);
@@ -442,13 +619,39 @@ STATIC mp_obj_t articulate(mp_obj_t phonemes, mp_uint_t n_args, const mp_obj_t *
     #endif
 
     SetInput(sam, input, len);
+
+    #if USE_DEDICATED_AUDIO_CHANNEL
+    if (render == NULL && !args[8].u_bool) {
+        if (!SAMPrepare(sam)) {
+            MP_STATE_PORT(speech_data) = NULL;
+            mp_raise_ValueError((mp_rom_error_text_t)sam_error);
+        }
+        speech_render_scheduled = false;
+        speech_render_finishing = false;
+        MP_STATE_PORT(speech_background_data) = sam;
+        MP_STATE_PORT(speech_data) = NULL;
+        mp_sched_lock();
+        speech_render_task(mp_const_none);
+        mp_sched_unlock();
+        return mp_const_none;
+    }
+    #endif
+
     if (!SAMMain(sam)) {
         microbit_audio_stop();
         MP_STATE_PORT(speech_data) = NULL;
+        #if USE_DEDICATED_AUDIO_CHANNEL
+        speech_render_vstr = NULL;
+        #endif
         mp_raise_ValueError((mp_rom_error_text_t)sam_error);
     }
 
     #if USE_DEDICATED_AUDIO_CHANNEL
+    if (render != NULL) {
+        speech_render_vstr = NULL;
+        MP_STATE_PORT(speech_data) = NULL;
+        return mp_obj_new_bytes_from_vstr(render);
+    }
     // Finish writing out current buffer.
     while (speech_output_buffer_idx != 0) {
         speech_output_sample(128);
@@ -472,17 +675,30 @@ STATIC mp_obj_t articulate(mp_obj_t phonemes, mp_uint_t n_args, const mp_obj_t *
 
 STATIC mp_obj_t say(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     mp_obj_t phonemes = translate(pos_args[0]);
-    return articulate(phonemes, n_args-1, pos_args+1, kw_args, false);
+    return articulate(phonemes, n_args-1, pos_args+1, kw_args, false, NULL);
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(say_obj, 1, say);
 
+#if USE_DEDICATED_AUDIO_CHANNEL
+// Render speech once into a bytes object of 8-bit unsigned samples, which can then be
+// replayed with audio.play() without running SAM again.  The sample rate depends on the
+// mode: 19000Hz for modes 1 and 2, 38000Hz for modes 3 and 4.
+STATIC mp_obj_t render(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_obj_t phonemes = translate(pos_args[0]);
+    vstr_t vstr;
+    vstr_init(&vstr, 1024);
+    return articulate(phonemes, n_args-1, pos_args+1, kw_args, false, &vstr);
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(render_obj, 1, render);
+#endif
+
 STATIC mp_obj_t pronounce(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    return articulate(pos_args[0], n_args-1, pos_args+1, kw_args, false);
+    return articulate(pos_args[0], n_args-1, pos_args+1, kw_args, false, NULL);
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(pronounce_obj, 1, pronounce);
 
 STATIC mp_obj_t sing(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    return articulate(pos_args[0], n_args-1, pos_args+1, kw_args, true);
+    return articulate(pos_args[0], n_args-1, pos_args+1, kw_args, true, NULL);
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(sing_obj, 1, sing);
 
@@ -492,6 +708,9 @@ STATIC const mp_map_elem_t _globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_sing), (mp_obj_t)&sing_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_pronounce), (mp_obj_t)&pronounce_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_translate), (mp_obj_t)&translate_obj },
+    #if USE_DEDICATED_AUDIO_CHANNEL
+    { MP_OBJ_NEW_QSTR(MP_QSTR_render), (mp_obj_t)&render_obj },
+    #endif
 };
 STATIC MP_DEFINE_CONST_DICT(_globals, _globals_table);
 
@@ -503,3 +722,7 @@ const mp_obj_module_t speech_module = {
 MP_REGISTER_MODULE(MP_QSTR_speech, speech_module);
 
 MP_REGISTER_ROOT_POINTER(void *speech_data);
+MP_REGISTER_ROOT_POINTER(mp_obj_t speech_translate_cache[2 * TRANSLATE_CACHE_SIZE]);
+#if USE_DEDICATED_AUDIO_CHANNEL
+MP_REGISTER_ROOT_POINTER(void *speech_background_data);
+#endif
@@ -0,0 +1,55 @@
+# Awaitable versions of the micro:bit calls that otherwise block until they finish.
+#
+# Each starts the work in the background and then waits for the driver in the asyncio
+# event loop, so other tasks run meanwhile and the CPU sleeps when there is nothing to do.
+
+from asyncio import core
+from microbit import display
+import music
+import radio
+import speech
+import _aiomicrobit
+
+
+async def _wait(source):
+    yield core._io_queue.queue_read(_aiomicrobit.Ready(source))
+
+
+async def scroll(text, delay=150, *, monospace=False):
+    display.scroll(text, delay, wait=False, monospace=monospace)
+    await _wait(_aiomicrobit.DISPLAY)
+
+
+async def show(image, delay=400, *, clear=False):
+    display.show(image, delay, wait=False, clear=clear)
+    await _wait(_aiomicrobit.DISPLAY)
+
+
+async def play(tune, pin=None):
+    if pin is None:
+        music.play(tune, wait=False)
+    else:
+        music.play(tune, pin, wait=False)
+    await _wait(_aiomicrobit.MUSIC)
+
+
+async def say(words, **kwargs):
+    speech.say(words, wait=False, **kwargs)
+    await _wait(_aiomicrobit.SPEECH)
+
+
+async def receive_bytes():
+    while True:
+        await _wait(_aiomicrobit.RADIO)
+        # Another task may have taken the packet first.
+        message = radio.receive_bytes()
+        if message is not None:
+            return message
+
+
+async def receive():
+    while True:
+        await _wait(_aiomicrobit.RADIO)
+        message = radio.receive()
+        if message is not None:
+            return message
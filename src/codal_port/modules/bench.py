@@ -0,0 +1,169 @@
+# Benchmarks for the codal_port subsystems, frozen into the firmware by "make bench".
+#
+# Run them from the REPL with bench.run(), or a few with bench.run("vm", "gc").  Each
+# result is printed as one line of the form
+#
+#     bench <name> <value> <unit>
+#
+# so the serial output of two firmware builds can be collected and compared by a script.
+# Timings use time.ticks_us(), which reads mp_hal_ticks_us().
+
+import audio
+import gc
+import microbit
+import os
+import radio
+import speech
+import time
+import _bench
+from microbit import display, Image
+
+_FILE = "_bench.dat"
+
+
+def _report(name, value, unit):
+    print("bench", name, value, unit)
+
+
+def _loop(n):
+    i = 0
+    x = 0
+    while i < n:
+        x = (x + i) & 0xFFFF
+        i += 1
+    return x
+
+
+def bench_vm(n=20000):
+    # Loop iterations per second, with and without the background work of the VM hook.
+    for hook in (True, False):
+        prev = _bench.vm_hook(hook)
+        t0 = time.ticks_us()
+        _loop(n)
+        dt = time.ticks_diff(time.ticks_us(), t0)
+        _bench.vm_hook(prev)
+        _report("vm_loop_hook" if hook else "vm_loop_nohook", n * 1000000 // dt, "iter/s")
+
+
+def bench_radio(n=200, listen_ms=1000):
+    # Send rate of full-size packets, then the receive rate from a board running
+    # bench.radio_peer(), if there is one.
+    radio.config(length=251, queue=16)
+    radio.on()
+    payload = bytes(240)
+    t0 = time.ticks_us()
+    for _ in range(n):
+        radio.send_bytes(payload)
+    dt = time.ticks_diff(time.ticks_us(), t0)
+    _report("radio_send", n * 1000000 // dt, "pkt/s")
+    received = 0
+    t0 = time.ticks_ms()
+    while time.ticks_diff(time.ticks_ms(), t0) < listen_ms:
+        if radio.receive_bytes() is not None:
+            received += 1
+    _report("radio_receive", received * 1000 // listen_ms, "pkt/s")
+    radio.off()
+
+
+def radio_peer():
+    # Sends packets for bench_radio() on the board under test, until reset.
+    radio.config(length=251)
+    radio.on()
+    payload = bytes(240)
+    while True:
+        radio.send_bytes(payload)
+
+
+def bench_fs(n=20, size=512):
+    data = bytes(size)
+    t_open = t_write = t_read = 0
+    for _ in range(n):
+        t0 = time.ticks_us()
+        f = open(_FILE, "wb")
+        t1 = time.ticks_us()
+        f.write(data)
+        f.close()
+        t2 = time.ticks_us()
+        t_open += time.ticks_diff(t1, t0)
+        t_write += time.ticks_diff(t2, t1)
+        t0 = time.ticks_us()
+        with open(_FILE, "rb") as f:
+            f.read()
+        t_read += time.ticks_diff(time.ticks_us(), t0)
+        os.remove(_FILE)
+    _report("fs_open", t_open // n, "us")
+    _report("fs_write", t_write // n, "us")
+    _report("fs_read", t_read // n, "us")
+    t0 = time.ticks_us()
+    os.compact()
+    _report("fs_sweep", time.ticks_diff(time.ticks_us(), t0), "us")
+
+
+def bench_display(n=100):
+    frames = (Image.HEART, Image.HAPPY, Image.SAD, Image.YES)
+    t0 = time.ticks_us()
+    for i in range(n):
+        display.show(frames[i & 3])
+    dt = time.ticks_diff(time.ticks_us(), t0)
+    display.clear()
+    _report("display_frame", dt // n, "us")
+
+
+def _frames(n):
+    frame = audio.AudioFrame()
+    for i in range(len(frame)):
+        frame[i] = 128 + (i & 16) * 4
+    for _ in range(n):
+        yield frame
+
+
+def bench_audio(n=500):
+    # Under-runs while bytecode keeps the CPU busy during playback.
+    audio.play(_frames(n), wait=False)
+    while audio.is_playing():
+        _loop(500)
+    _report("audio_underruns", audio.underruns(), "count")
+
+
+def bench_speech(text="hello, this is a benchmark of speech rendering"):
+    # The current SAM renderer, then the one-value-per-call renderer it replaced.
+    for old in (False, True):
+        prev = _bench.speech_renderer(old)
+        t0 = time.ticks_us()
+        samples = speech.render(text)
+        dt = time.ticks_diff(time.ticks_us(), t0)
+        _bench.speech_renderer(prev)
+        suffix = "_old" if old else ""
+        _report("speech_render" + suffix, dt, "us")
+        # Microseconds of audio rendered per millisecond of CPU time, at 19000Hz.
+        _report("speech_speed" + suffix, len(samples) * 1000000 // 19000 * 1000 // dt, "us/ms")
+
+
+def bench_gc(n=500):
+    keep = [bytearray(16) for _ in range(n)]
+    microbit.gc_pauses(reset=True)
+    t0 = time.ticks_us()
+    gc.collect()
+    _report("gc_collect", time.ticks_diff(time.ticks_us(), t0), "us")
+    count, last_us, max_us = microbit.gc_pauses()
+    _report("gc_pause_max", max_us, "us")
+    del keep
+
+
+_BENCHES = (
+    ("vm", bench_vm),
+    ("radio", bench_radio),
+    ("fs", bench_fs),
+    ("display", bench_display),
+    ("audio", bench_audio),
+    ("speech", bench_speech),
+    ("gc", bench_gc),
+)
+
+
+def run(*names):
+    for name, fn in _BENCHES:
+        if not names or name in names:
+            gc.collect()
+            fn()
+    print("bench done")
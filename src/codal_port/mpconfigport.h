@@ -34,18 +34,56 @@
 // Memory allocation policy
 #define MICROPY_ALLOC_PATH_MAX                  (128)
 
-// MicroPython emitters
-#define MICROPY_EMIT_INLINE_THUMB               (1)
+#ifndef MICROPY_HW_HOST
+#define MICROPY_HW_HOST                         (0) // the simulator build, set by "make host", see ../host
+#endif
+
+// MicroPython emitters, which generate Thumb code so are left out of the host build
+#define MICROPY_EMIT_THUMB                      (!MICROPY_HW_HOST) // @micropython.native and @micropython.viper
+#define MICROPY_EMIT_INLINE_THUMB               (!MICROPY_HW_HOST)
+
+// Load and save .mpy files, needed by MICROPY_MBFS_MPY_CACHE
+#define MICROPY_PERSISTENT_CODE_LOAD            (1)
+#define MICROPY_PERSISTENT_CODE_SAVE            (1)
 
 // Python internal features
+#define MICROPY_PY_PROFILE                      (1) // the profile module, see modprofile.c
 #define MICROPY_VM_HOOK_COUNT                   (64)
 #define MICROPY_VM_HOOK_INIT \
     static unsigned int vm_hook_divisor = MICROPY_VM_HOOK_COUNT;
+#ifndef MICROPY_HW_BENCH
+#define MICROPY_HW_BENCH                        (0) // the _bench module, set by "make bench", see modbench.c
+#endif
+#if MICROPY_HW_BENCH
+// The benchmarks time bytecode with and without the background work done by the poll.
+#define MICROBIT_VM_HOOK_POLL_ENABLED \
+    extern bool microbit_bench_vm_hook_enabled; \
+    if (microbit_bench_vm_hook_enabled)
+#else
+#define MICROBIT_VM_HOOK_POLL_ENABLED
+#endif
+#if MICROPY_PY_PROFILE
+// While profiling, the hook also samples the running function and times the background work.
+#define MICROBIT_VM_HOOK_BACKGROUND_PROCESSING \
+    extern bool microbit_profile_active; \
+    extern void microbit_profile_vm_hook(const void *fun); \
+    if (microbit_profile_active) { \
+        microbit_profile_vm_hook(code_state->fun_bc); \
+    } else { \
+        microbit_hal_background_processing_poll(); \
+    }
+#else
+#define MICROBIT_VM_HOOK_BACKGROUND_PROCESSING \
+    microbit_hal_background_processing_poll();
+#endif
+// The poll only does the expensive CODAL background work when it's due.
 #define MICROPY_VM_HOOK_POLL \
     if (--vm_hook_divisor == 0) { \
         vm_hook_divisor = MICROPY_VM_HOOK_COUNT; \
-        extern void microbit_hal_background_processing(void); \
-        microbit_hal_background_processing(); \
+        extern void microbit_hal_background_processing_poll(void); \
+        MICROBIT_VM_HOOK_POLL_ENABLED { \
+            MICROBIT_VM_HOOK_BACKGROUND_PROCESSING \
+        } \
     }
 #define MICROPY_VM_HOOK_LOOP                    MICROPY_VM_HOOK_POLL
 #define MICROPY_VM_HOOK_RETURN                  MICROPY_VM_HOOK_POLL
@@ -54,6 +92,7 @@
 #define MICROPY_KBD_EXCEPTION                   (1)
 #define MICROPY_HELPER_REPL                     (1)
 #define MICROPY_REPL_AUTO_INDENT                (1)
+#define MICROPY_REPL_STDIN_BUFFER_MAX           (256) // raw-paste window, see mphalport.c
 #define MICROPY_LONGINT_IMPL                    (MICROPY_LONGINT_IMPL_MPZ)
 #define MICROPY_ENABLE_SOURCE_LINE              (1)
 #define MICROPY_FLOAT_IMPL                      (MICROPY_FLOAT_IMPL_FLOAT)
@@ -61,6 +100,12 @@
 #define MICROPY_MODULE_BUILTIN_INIT             (1)
 #define MICROPY_USE_INTERNAL_ERRNO              (1)
 #define MICROPY_ENABLE_SCHEDULER                (1)
+// Called by select.poll while it waits, which is where the asyncio event loop sleeps.
+#define MICROPY_EVENT_POLL_HOOK \
+    do { \
+        extern void microbit_event_poll_hook(void); \
+        microbit_event_poll_hook(); \
+    } while (0);
 
 // Fine control over Python builtins, classes, modules, etc
 #define MICROPY_PY_BUILTINS_STR_UNICODE         (1)
@@ -75,18 +120,48 @@
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT      (1)
 #define MICROPY_PY_IO                           (0)
 #define MICROPY_PY_SYS_MAXSIZE                  (1)
+#define MICROPY_PY_SYS_STDFILES                 (1)
+#define MICROPY_PY_SYS_STDIO_BUFFER             (1) // sys.stdout.buffer writes a bytes object in one go
 #define MICROPY_PY_SYS_PLATFORM                 "microbit"
 
 // Extended modules
+#define MICROPY_PY_ASYNCIO                      (1) // frozen from extmod, see manifest.py
 #define MICROPY_PY_ERRNO                        (1)
 #define MICROPY_PY_RANDOM                       (1)
 #define MICROPY_PY_RANDOM_SEED_INIT_FUNC        (rng_generate_random_word())
 #define MICROPY_PY_RANDOM_EXTRA_FUNCS           (1)
+#define MICROPY_PY_SELECT                       (1) // for asyncio, see modaiomicrobit.c
 #define MICROPY_PY_TIME                         (1)
 #define MICROPY_PY_MACHINE_PULSE                (1)
+#define MICROPY_PY_FFT                          (1) // the fft module, see modfft.c
+#define MICROPY_PY_FILTER                       (1) // the filter module, see modfilter.c
+#define MICROPY_PY_BLE                          (0) // the ble module, needs MICROBIT_BLE_ENABLED in codal.json, see modble.c
 
 #define MICROPY_HW_ENABLE_RNG                   (1)
+#define MICROPY_HW_LATENCY_STATS                (0) // microbit.stats(), see drv_stats.h
+#define MICROPY_HW_ALLOC_TRACE                  (0) // microbit.alloc_stats(), see drv_alloc.h
+#define MICROPY_HW_TICKLESS_TIMER               (1) // see drv_system.c
+
+// Size of the GC heap, and of the arena for long-lived driver buffers such as the radio
+// queues, which is kept apart from the heap.  Both can be overridden at build time.
+#ifndef MICROPY_HW_HEAP_SIZE
+#define MICROPY_HW_HEAP_SIZE                    (63 * 1024)
+#endif
+#ifndef MICROPY_HW_ARENA_SIZE
+#define MICROPY_HW_ARENA_SIZE                   (1024)
+#endif
 #define MICROPY_MBFS                            (1)
+#define MICROPY_MBFS_MPY_CACHE                  (1)
+// Uncomment to link filesystem chunks with 16-bit numbers, for a filesystem bigger than
+// 252 chunks; _fs_start in filesystem.ld must then be moved down to make room.  Chunks can
+// also be made bigger with MBFS_LOG_CHUNK_SIZE (default 7, ie 128 bytes).  Both change the
+// format of the filesystem.
+// #define MICROPY_MBFS_CHUNK_INDEX_16BIT          (1)
+// #define MBFS_LOG_CHUNK_SIZE                     (8)
+#define MICROPY_HW_AUDIO_MIXER_CHANNELS         (4)
+#define MICROPY_HW_AUDIO_FRAME_POOL_SIZE        (8) // at most 32
+#define MICROPY_HW_MUSIC_SYNTH                  (1) // music on its own mixer channel, see modmusic.c
+#define MICROPY_HW_EVENT_QUEUE_DEPTH            (32) // microbit.events(), see drv_event.c
 
 // Custom errno list.
 #define MICROPY_PY_ERRNO_LIST \
@@ -121,7 +196,11 @@
 
 #define MP_STATE_PORT MP_STATE_VM
 
+#if MICROPY_HW_HOST
+#define MICROPY_MAKE_POINTER_CALLABLE(p) ((void *)(p))
+#else
 #define MICROPY_MAKE_POINTER_CALLABLE(p) ((void *)((uint32_t)(p) | 1))
+#endif
 
 #define MP_SSIZE_MAX (0x7fffffff)
 
@@ -26,6 +26,20 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "drv_gc.h"
+#include "drv_radio.h"
+#include "drv_system.h"
+#include "microbitfs_ext.h"
+#include "modaudio.h"
+
+// Longest time select.poll sleeps before re-checking its timeout.
+#define MICROBIT_EVENT_POLL_MS (1)
+
+// The host may send a whole raw-paste window before the REPL reads any of it, and a
+// second one once it is acknowledged, so both must fit in the serial receive ring.
+#if 2 * MICROPY_REPL_STDIN_BUFFER_MAX > MICROBIT_HAL_SERIAL_STDIN_RING_SIZE
+#error "MICROPY_REPL_STDIN_BUFFER_MAX too large for the serial receive ring"
+#endif
 
 void mp_hal_delay_us(mp_uint_t us) {
     if (us <= 0) {
@@ -43,6 +57,30 @@ void mp_hal_delay_ms(mp_uint_t ms) {
     uint32_t start = mp_hal_ticks_ms();
     while (mp_hal_ticks_ms() - start < ms) {
         mp_handle_pending(true);
+        #if MICROPY_MBFS
+        // The CPU stalls while a flash page is erased, which would starve the audio and
+        // radio interrupts, so the filesystem is only swept while neither is in use.
+        if (ms - (mp_hal_ticks_ms() - start) >= MICROBIT_FILESYSTEM_SWEEP_STEP_MS
+            && !microbit_audio_is_playing()
+            && !microbit_radio_is_enabled()
+            && microbit_filesystem_background()) {
+            continue;
+        }
+        #endif
+        if (microbit_gc_background(ms - (mp_hal_ticks_ms() - start))) {
+            continue;
+        }
+        // The system timer may be idle, so make sure something wakes us at the end.
+        microbit_system_timer_wake_within(ms - (mp_hal_ticks_ms() - start));
         microbit_hal_idle();
     }
 }
+
+// Called by select.poll between checks of its objects, which is where asyncio sleeps.
+// Driver events wake the CPU with their own interrupts, but poll's timeout is not passed
+// in, so when the system timer is otherwise idle it must come back to check it.
+void microbit_event_poll_hook(void) {
+    mp_handle_pending(true);
+    microbit_system_timer_wake_within(MICROBIT_EVENT_POLL_MS);
+    microbit_hal_idle();
+}
@@ -45,6 +45,10 @@ static inline void enable_irq(uint32_t state) {
     target_enable_irq();
 }
 
+#if MICROPY_HW_HOST
+// The host build has no cycle counter, PRIMASK or FICR, see ../host/mphalport.c.
+mp_uint_t mp_hal_ticks_cpu(void);
+#else
 static inline mp_uint_t mp_hal_ticks_cpu(void) {
     if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) || !(CoreDebug->DEMCR & CoreDebug_DEMCR_TRCENA_Msk)) {
         CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
@@ -53,9 +57,15 @@ static inline mp_uint_t mp_hal_ticks_cpu(void) {
     }
     return DWT->CYCCNT;
 }
+#endif
 
 void mp_hal_set_interrupt_char(int c);
 
+#if MICROPY_HW_HOST
+uint32_t mp_hal_disable_irq(void);
+void mp_hal_enable_irq(uint32_t state);
+void mp_hal_unique_id(uint32_t id[2]);
+#else
 static inline uint32_t mp_hal_disable_irq(void) {
     uint32_t state = __get_PRIMASK();
     __disable_irq();
@@ -70,6 +80,7 @@ static inline void mp_hal_unique_id(uint32_t id[2]) {
     id[0] = NRF_FICR->DEVICEID[0];
     id[1] = NRF_FICR->DEVICEID[1];
 }
+#endif
 
 static inline uint64_t mp_hal_time_ns(void) {
     // Not currently implemented.
@@ -0,0 +1,54 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_HOST_DRIVERS_FLASH_H
+#define MICROPY_INCLUDED_HOST_DRIVERS_FLASH_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Stands in for ports/nrf/drivers/flash.h on the host build.  The microbitfs region is
+// ordinary memory mapped onto a file at its address in filesystem.ld, see flash.c, so
+// these write it directly.  Like NOR flash, erasing sets every bit of a page and writing
+// can only clear bits, so code that writes over data without erasing is caught.
+
+#define FLASH_PAGESIZE (4096)
+
+static inline void flash_page_erase(uint32_t address) {
+    memset((uint8_t *)(uintptr_t)(address & ~(FLASH_PAGESIZE - 1)), 0xff, FLASH_PAGESIZE);
+}
+
+static inline void flash_write_byte(uint32_t address, uint8_t value) {
+    *(uint8_t *)(uintptr_t)address &= value;
+}
+
+static inline void flash_write_bytes(uint32_t address, const uint8_t *src, uint32_t num_bytes) {
+    uint8_t *dest = (uint8_t *)(uintptr_t)address;
+    for (uint32_t i = 0; i < num_bytes; ++i) {
+        dest[i] &= src[i];
+    }
+}
+
+#endif // MICROPY_INCLUDED_HOST_DRIVERS_FLASH_H
@@ -0,0 +1,253 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "py/mperrno.h"
+#include "drv_arena.h"
+#include "drv_radio.h"
+#include "drv_radiostream.h"
+#include "drv_radiosync.h"
+
+// A loopback radio with the interface of codal_port/drv_radio.c.  Every packet that is
+// sent is received straight back by the same device, on the channel and group it was
+// sent on, so radio, stream and sync code can be exercised (and timed) without a second
+// board.  Replies made by the stream layer are looped back in turn, and there is no
+// hopping, CRC failure or air time.
+
+// 1 byte for len, 1 byte for RSSI, 4 bytes for time, 1 byte for group, 1 byte for channel
+#define RADIO_PACKET_OVERHEAD (1 + 1 + 4 + 1 + 1)
+
+// Marks the point where the producer wrapped back to the start of the RX queue.
+#define RADIO_RX_QUEUE_WRAP (0xff)
+
+// The RSSI recorded for looped back packets, as a positive number of -dBm.
+#define RADIO_LOOPBACK_RSSI (30)
+
+// The RX queue has the same layout and wrapping as on the board.
+static uint8_t *rx_queue = NULL; // start of the RX queue, within radio_buf
+static size_t rx_queue_size = 0; // size in bytes of the RX queue
+static size_t rx_head = 0; // offset where the next packet is written
+static size_t rx_tail = 0; // offset of the next packet to be read
+
+// Sends complete as soon as they are made, so the TX queue is never used, but it is
+// allocated so the arena sees the same sizes as on the board.
+static size_t tx_queue_len = 0;
+static uint32_t tx_last_end_us = 0;
+
+static uint8_t *reply_buf = NULL; // within radio_buf
+static microbit_radio_config_t radio_config;
+static bool radio_enabled = false;
+
+static microbit_radio_stats_t radio_stats;
+static uint32_t rx_pushed = 0;
+static uint32_t rx_popped = 0;
+
+STATIC bool rx_queue_reserve(size_t head, size_t len, size_t *offset) {
+    size_t tail = rx_tail;
+    if (head >= tail) {
+        // Free space is at the end of the ring and before the tail at the start.
+        if (head + len <= rx_queue_size) {
+            *offset = head;
+            return true;
+        }
+        if (len < tail) {
+            if (head < rx_queue_size) {
+                rx_queue[head] = RADIO_RX_QUEUE_WRAP;
+            }
+            *offset = 0;
+            return true;
+        }
+    } else {
+        // Producer has wrapped, free space is between the head and the tail.
+        if (head + len < tail) {
+            *offset = head;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Receive a packet that has just been sent, as the RADIO IRQ does on the board.
+STATIC void radio_loopback(const uint8_t *pkt) {
+    uint8_t *rx_pkt = MP_STATE_PORT(radio_buf);
+    memmove(rx_pkt, pkt, 1 + pkt[0]);
+    uint32_t time = mp_hal_ticks_us();
+    ++radio_stats.rx_packets;
+
+    // Stream fragments and acks are handled here, and any reply is received in turn.
+    int reply_len = microbit_radio_stream_handle_rx(rx_pkt, reply_buf);
+    while (reply_len > 0) {
+        ++radio_stats.tx_packets;
+        ++radio_stats.rx_packets;
+        memcpy(rx_pkt, reply_buf, 1 + reply_buf[0]);
+        reply_len = microbit_radio_stream_handle_rx(rx_pkt, reply_buf);
+    }
+
+    size_t len = rx_pkt[0];
+    size_t offset;
+    if (reply_len >= 0 || microbit_radio_sync_handle_rx(rx_pkt, time)) {
+        // Not for the RX queue.
+    } else if (!rx_queue_reserve(rx_head, RADIO_PACKET_OVERHEAD + len, &offset)) {
+        ++radio_stats.rx_queue_full;
+    } else {
+        uint8_t *rx_buf = &rx_queue[offset];
+        memcpy(rx_buf, rx_pkt, 1 + len);
+        rx_buf[1 + len] = RADIO_LOOPBACK_RSSI;
+        rx_buf[1 + len + 1] = time & 0xff;
+        rx_buf[1 + len + 2] = (time >> 8) & 0xff;
+        rx_buf[1 + len + 3] = (time >> 16) & 0xff;
+        rx_buf[1 + len + 4] = (time >> 24) & 0xff;
+        rx_buf[1 + len + 5] = radio_config.prefix0;
+        rx_buf[1 + len + 6] = radio_config.num_hop_channels ? radio_config.hop_channels[0] : radio_config.channel;
+        rx_head = offset + RADIO_PACKET_OVERHEAD + len;
+        uint32_t depth = ++rx_pushed - rx_popped;
+        if (depth > radio_stats.rx_queue_peak) {
+            radio_stats.rx_queue_peak = depth;
+        }
+        microbit_radio_rx_callback();
+    }
+}
+
+void microbit_radio_enable(microbit_radio_config_t *config) {
+    if (microbit_hal_ble_running()) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    microbit_radio_disable();
+
+    // Laid out as on the board: tx/rx buffer, reply buffer, TX queue, RX queue.
+    size_t max_payload = config->max_payload + RADIO_PACKET_OVERHEAD;
+    tx_queue_len = config->tx_queue_len;
+    rx_queue_size = max_payload * (config->queue_len + 1);
+    MP_STATE_PORT(radio_buf) = microbit_arena_alloc(max_payload + 1 + MICROBIT_RADIO_STREAM_ACK_LEN + tx_queue_len * max_payload + rx_queue_size);
+    reply_buf = MP_STATE_PORT(radio_buf) + max_payload;
+    rx_queue = reply_buf + 1 + MICROBIT_RADIO_STREAM_ACK_LEN + tx_queue_len * max_payload;
+    rx_head = 0;
+    rx_tail = 0;
+    rx_pushed = 0;
+    rx_popped = 0;
+    microbit_radio_stream_reset();
+
+    radio_config = *config;
+    radio_enabled = true;
+}
+
+void microbit_radio_disable(void) {
+    microbit_radio_stream_reset();
+    radio_enabled = false;
+    if (MP_STATE_PORT(radio_buf) != NULL) {
+        microbit_arena_free(MP_STATE_PORT(radio_buf), rx_queue + rx_queue_size - MP_STATE_PORT(radio_buf));
+        MP_STATE_PORT(radio_buf) = NULL;
+        reply_buf = NULL;
+        rx_queue = NULL;
+    }
+}
+
+bool microbit_radio_is_enabled(void) {
+    return radio_enabled;
+}
+
+void microbit_radio_update_config(microbit_radio_config_t *config) {
+    radio_config = *config;
+}
+
+// Construct a packet in dest, truncating the data to the maximum payload length.
+STATIC void radio_build_packet(uint8_t *dest, const void *buf, size_t len, const void *buf2, size_t len2) {
+    size_t max_len = radio_config.max_payload;
+    if (len + len2 > max_len) {
+        if (len > max_len) {
+            len = max_len;
+            len2 = 0;
+        } else {
+            len2 = max_len - len;
+        }
+    }
+    dest[0] = len + len2;
+    memcpy(dest + 1, buf, len);
+    if (len2 != 0) {
+        memcpy(dest + 1 + len, buf2, len2);
+    }
+}
+
+// This assumes the radio is enabled.
+void microbit_radio_send(const void *buf, size_t len, const void *buf2, size_t len2) {
+    uint8_t *pkt = MP_STATE_PORT(radio_buf);
+    radio_build_packet(pkt, buf, len, buf2, len2);
+    tx_last_end_us = mp_hal_ticks_us();
+    ++radio_stats.tx_packets;
+    radio_loopback(pkt);
+}
+
+// The packet is sent straight away, so the TX queue is never full.
+bool microbit_radio_send_async(const void *buf, size_t len, const void *buf2, size_t len2) {
+    microbit_radio_send(buf, len, buf2, len2);
+    return true;
+}
+
+uint32_t microbit_radio_send_timed(const void *buf, size_t len, const void *buf2, size_t len2) {
+    microbit_radio_send(buf, len, buf2, len2);
+    return tx_last_end_us;
+}
+
+size_t microbit_radio_tx_queue_space(void) {
+    return tx_queue_len;
+}
+
+uint32_t microbit_radio_get_last_tx_time_us(void) {
+    return tx_last_end_us;
+}
+
+const uint8_t *microbit_radio_peek(void) {
+    size_t tail = rx_tail;
+    if (!radio_enabled || tail == rx_head) {
+        return NULL;
+    }
+    if (tail == rx_queue_size || rx_queue[tail] == RADIO_RX_QUEUE_WRAP) {
+        tail = 0;
+        rx_tail = 0;
+    }
+    return &rx_queue[tail];
+}
+
+void microbit_radio_pop(void) {
+    const uint8_t *buf = microbit_radio_peek();
+    if (buf != NULL) {
+        rx_tail = buf - rx_queue + RADIO_PACKET_OVERHEAD + buf[0];
+        ++rx_popped;
+    }
+}
+
+void microbit_radio_get_stats(microbit_radio_stats_t *stats, bool reset) {
+    *stats = radio_stats;
+    stats->rx_queue_depth = rx_pushed - rx_popped;
+    if (reset) {
+        memset(&radio_stats, 0, sizeof(radio_stats));
+    }
+}
+
+MP_REGISTER_ROOT_POINTER(uint8_t *radio_buf);
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// For mmap(), fstat() and lseek().
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "host.h"
+
+// From filesystem.ld, which the host build links with so that microbitfs sees the
+// same addresses as on the board.
+extern uint8_t _fs_start[];
+extern uint8_t _fs_end[];
+
+// The flash file holds the microbitfs region and nothing else, so it keeps the files
+// from one run to the next.  A new file starts out erased.
+void host_flash_init(const char *filename) {
+    size_t size = _fs_end - _fs_start;
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(filename);
+        exit(1);
+    }
+    if ((size_t)st.st_size < size) {
+        uint8_t page[4096];
+        memset(page, 0xff, sizeof(page));
+        lseek(fd, st.st_size, SEEK_SET);
+        for (size_t n = st.st_size; n < size;) {
+            size_t chunk = size - n < sizeof(page) ? size - n : sizeof(page);
+            if (write(fd, page, chunk) != (ssize_t)chunk) {
+                perror(filename);
+                exit(1);
+            }
+            n += chunk;
+        }
+    }
+    void *p = mmap(_fs_start, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    close(fd);
+}
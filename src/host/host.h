@@ -0,0 +1,72 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_HOST_HOST_H
+#define MICROPY_INCLUDED_HOST_HOST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The host build runs codal_port as a single process on a PC.  There are no interrupts:
+// the work that CODAL does from them on the board (the system timer callback, audio
+// pulls, serial input, SPI completion) is dispatched from microbit_hal_idle() and from
+// the VM hook's background poll instead, see microbithal.c.
+
+// Files and options given on the command line, see main.c.
+typedef struct _host_config_t {
+    const char *flash_filename; // backs the microbitfs region
+    const char *audio_prefix; // audio channels are written to <prefix>-<channel>.wav
+} host_config_t;
+
+extern host_config_t host_config;
+
+// Restore the terminal, finish the audio files and exit the process.
+__attribute__((noreturn)) void host_exit(int status);
+
+// Microseconds since the process started.
+uint64_t host_ticks_us64(void);
+
+// Run anything that is due, as an interrupt would have on the board.  Does nothing if
+// called from within a dispatch, or while "interrupts" are disabled.
+void host_dispatch(void);
+
+// Nesting depth of target_disable_irq(), see mphalport.c.
+extern volatile unsigned int host_irq_disable_depth;
+
+// Map the microbitfs region of flash onto the given file, see flash.c.
+void host_flash_init(const char *filename);
+
+// Serial input, from stdin.  Returns the file descriptor to wait on, or -1 at EOF.
+void host_serial_rx_poll(void);
+int host_serial_rx_fd(void);
+
+// Audio channels, see microbithal_audio.c.  The poll plays whatever is due and returns
+// the time that the next pull is due, or UINT64_MAX if all channels are idle.  A channel
+// that starts playing calls host_audio_wake() so the poll runs in time for it.
+uint64_t host_audio_poll(uint64_t now_us);
+void host_audio_wake(uint64_t due_us);
+void host_audio_deinit(void);
+
+#endif // MICROPY_INCLUDED_HOST_HOST_H
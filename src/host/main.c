@@ -0,0 +1,113 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// For getopt(), termios and srandom().
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "microbithal.h"
+#include "host.h"
+
+#define HOST_DEFAULT_FLASH_FILENAME "microbit-flash.bin"
+
+extern void mp_main(void);
+
+// Time from startup until mp_main() was called, as in codal_app/main.cpp.
+extern uint32_t boot_time_us;
+
+host_config_t host_config = {
+    .flash_filename = HOST_DEFAULT_FLASH_FILENAME,
+    .audio_prefix = NULL,
+};
+
+static struct termios saved_termios;
+static bool termios_saved = false;
+
+void host_exit(int status) {
+    if (termios_saved) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_termios);
+    }
+    host_audio_deinit();
+    exit(status);
+}
+
+// The REPL does its own echo and line editing, as it would over the serial port, so a
+// terminal is put in raw mode.  Ctrl-C then reaches the REPL instead of killing the
+// process, and ctrl-D at an empty prompt soft resets; closing stdin exits.
+static void host_terminal_init(void) {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_termios) != 0) {
+        return;
+    }
+    termios_saved = true;
+    struct termios t = saved_termios;
+    t.c_iflag = 0;
+    t.c_oflag = 0;
+    t.c_lflag = 0;
+    t.c_cc[VMIN] = 1;
+    t.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &t);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+        "usage: %s [-f flash_file] [-a audio_prefix]\n"
+        "  -f  file backing the filesystem, created if it doesn't exist (default " HOST_DEFAULT_FLASH_FILENAME ")\n"
+        "  -a  write each audio channel to <audio_prefix>-<channel>.wav\n",
+        argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "f:a:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                host_config.flash_filename = optarg;
+                break;
+            case 'a':
+                host_config.audio_prefix = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc) {
+        usage(argv[0]);
+    }
+
+    srandom(time(NULL));
+    host_flash_init(host_config.flash_filename);
+    host_terminal_init();
+
+    boot_time_us = host_ticks_us64();
+    mp_main();
+    host_exit(0);
+}
@@ -0,0 +1,726 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// For clock_gettime(), nanosleep() and select().
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <time.h>
+
+#include "py/mphal.h"
+#include "microbithal.h"
+#include "drv_image.h"
+#include "host.h"
+
+#define HAL_ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+// Same as the periodic CODAL timer event that main.cpp sets up, until the first call to
+// microbit_hal_timer_set_next_us() replaces it.
+#define TIMER_STARTUP_PERIOD_US (6000)
+
+// Longest time microbit_hal_idle() sleeps, like CODAL's own periodic wake ups.
+#define IDLE_MAX_SLEEP_US (5000)
+
+// Serial input is read at most this often from the VM hook, because it needs a syscall.
+#define BACKGROUND_PROCESSING_PERIOD_US (5000)
+
+#define NUM_PINS (34)
+
+extern void microbit_hal_timer_callback(void);
+extern void microbit_hal_pin_sample_callback(size_t half);
+extern void microbit_hal_microphone_recording_callback(size_t half);
+extern void microbit_hal_spi_transfer_done_callback(void);
+
+// Time from startup until mp_main() was called, set by main().
+uint32_t boot_time_us;
+
+static struct timespec start_time;
+
+static uint64_t timer_next_us = TIMER_STARTUP_PERIOD_US;
+static uint32_t timer_period_us = TIMER_STARTUP_PERIOD_US;
+static uint64_t audio_next_us = UINT64_MAX;
+static uint64_t background_processing_last_us;
+static bool dispatching = false;
+
+static uint8_t pin_level[NUM_PINS];
+static uint8_t pin_pull_state[NUM_PINS];
+static uint16_t pin_analog_value[NUM_PINS];
+static int pin_analog_period_us[NUM_PINS];
+
+static uint8_t display_pixels[25];
+
+// A stream of samples that the board would take in the background, from an ADC channel
+// or the microphone.  The host produces them at the same rate, into the caller's buffer.
+typedef struct _host_sampler_t {
+    bool active;
+    bool loop;
+    uint8_t *buf;
+    size_t num_samples;
+    size_t sample_size;
+    size_t pos;
+    uint32_t period_us;
+    uint64_t next_us;
+} host_sampler_t;
+
+static host_sampler_t pin_sampler;
+static int pin_sampler_pin;
+static host_sampler_t mic_sampler;
+
+static bool spi_transfer_pending = false;
+static size_t spi_transfer_len;
+static uint8_t *spi_transfer_dest;
+
+uint64_t host_ticks_us64(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    if (start_time.tv_sec == 0 && start_time.tv_nsec == 0) {
+        start_time = t;
+    }
+    return (uint64_t)(t.tv_sec - start_time.tv_sec) * 1000000 + (t.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+static void sampler_start(host_sampler_t *s, void *buf, size_t num_samples, size_t sample_size, uint32_t rate, bool loop) {
+    s->active = false;
+    s->loop = loop;
+    s->buf = buf;
+    s->num_samples = num_samples;
+    s->sample_size = sample_size;
+    s->pos = 0;
+    s->period_us = rate == 0 ? 1000000 : 1000000 / rate;
+    if (s->period_us == 0) {
+        s->period_us = 1;
+    }
+    s->next_us = host_ticks_us64() + s->period_us;
+    s->active = true;
+}
+
+// Store the samples that are due, calling back as each half of the buffer fills, with
+// the same order of events as the CODAL sinks in microbithal.cpp and microbithal_microphone.cpp.
+static void sampler_poll(host_sampler_t *s, uint64_t now_us, int value, void (*callback)(size_t)) {
+    while (s->active && s->next_us <= now_us) {
+        s->next_us += s->period_us;
+        if (s->sample_size == 1) {
+            s->buf[s->pos] = value;
+        } else {
+            ((uint16_t *)s->buf)[s->pos] = value;
+        }
+        if (++s->pos == s->num_samples / 2 && s->loop) {
+            callback(0);
+        } else if (s->pos == s->num_samples) {
+            s->pos = 0;
+            if (!s->loop) {
+                s->active = false;
+            }
+            callback(1);
+        }
+    }
+}
+
+void host_dispatch(void) {
+    if (dispatching || host_irq_disable_depth > 0) {
+        return;
+    }
+    dispatching = true;
+    uint64_t now_us = host_ticks_us64();
+
+    if (now_us >= timer_next_us) {
+        if (timer_period_us != 0) {
+            timer_next_us += timer_period_us;
+            if (timer_next_us <= now_us) {
+                timer_next_us = now_us + timer_period_us;
+            }
+        } else {
+            timer_next_us = UINT64_MAX;
+        }
+        microbit_hal_timer_callback();
+    }
+
+    if (now_us >= audio_next_us) {
+        audio_next_us = host_audio_poll(now_us);
+    }
+
+    if (pin_sampler.active) {
+        sampler_poll(&pin_sampler, now_us, pin_sampler.sample_size == 1
+            ? microbit_hal_pin_read_analog_u10(pin_sampler_pin) >> 2
+            : microbit_hal_pin_read_analog_u10(pin_sampler_pin), microbit_hal_pin_sample_callback);
+    }
+    if (mic_sampler.active) {
+        sampler_poll(&mic_sampler, now_us, 128, microbit_hal_microphone_recording_callback);
+    }
+
+    if (spi_transfer_pending) {
+        // Nothing is connected, so MISO reads as idle high.
+        spi_transfer_pending = false;
+        if (spi_transfer_dest != NULL) {
+            memset(spi_transfer_dest, 0xff, spi_transfer_len);
+        }
+        microbit_hal_spi_transfer_done_callback();
+    }
+
+    dispatching = false;
+}
+
+void microbit_hal_background_processing(void) {
+    background_processing_last_us = host_ticks_us64();
+    host_serial_rx_poll();
+    host_dispatch();
+}
+
+// Called every few bytecodes from the VM hook, where it stands in for the interrupts.
+void microbit_hal_background_processing_poll(void) {
+    if (host_ticks_us64() - background_processing_last_us >= BACKGROUND_PROCESSING_PERIOD_US) {
+        microbit_hal_background_processing();
+    } else {
+        host_dispatch();
+    }
+}
+
+// Sleep until the next timer or audio deadline, or until serial input arrives.
+void microbit_hal_idle(void) {
+    microbit_hal_background_processing();
+    uint64_t now_us = host_ticks_us64();
+    uint64_t wake_us = now_us + IDLE_MAX_SLEEP_US;
+    if (timer_next_us < wake_us) {
+        wake_us = timer_next_us;
+    }
+    if (audio_next_us < wake_us) {
+        wake_us = audio_next_us;
+    }
+    if (spi_transfer_pending || (pin_sampler.active && pin_sampler.next_us < wake_us)
+        || (mic_sampler.active && mic_sampler.next_us < wake_us)) {
+        wake_us = now_us;
+    }
+    if (wake_us > now_us) {
+        struct timeval tv = { .tv_sec = 0, .tv_usec = wake_us - now_us };
+        int fd = host_serial_rx_fd();
+        fd_set fds;
+        FD_ZERO(&fds);
+        if (fd >= 0) {
+            FD_SET(fd, &fds);
+        }
+        select(fd + 1, &fds, NULL, NULL, &tv);
+    }
+    microbit_hal_background_processing();
+}
+
+uint64_t microbit_hal_ticks_us64(void) {
+    return host_ticks_us64();
+}
+
+void microbit_hal_timer_set_next_us(int64_t us) {
+    timer_period_us = 0;
+    if (us >= 0) {
+        timer_next_us = host_ticks_us64() + us;
+    } else {
+        timer_next_us = UINT64_MAX;
+    }
+}
+
+// Called when an audio channel starts playing, so the poll runs in time for it.
+void host_audio_wake(uint64_t due_us) {
+    if (due_us < audio_next_us) {
+        audio_next_us = due_us;
+    }
+}
+
+__attribute__((noreturn)) void microbit_hal_reset(void) {
+    // There is nothing to restart into, so a reset ends the simulation.
+    host_exit(0);
+}
+
+void microbit_hal_panic(int code) {
+    fprintf(stderr, "\r\npanic %d\r\n", code);
+    host_exit(1);
+}
+
+uint32_t microbit_hal_boot_time_us(void) {
+    return boot_time_us;
+}
+
+int microbit_hal_temperature(void) {
+    return 21;
+}
+
+// Nothing can wake the host from a sleep except the timer.
+void microbit_hal_power_clear_wake_sources(void) {
+}
+
+void microbit_hal_power_wake_on_button(int button, bool wake_on_active) {
+    (void)button;
+    (void)wake_on_active;
+}
+
+void microbit_hal_power_wake_on_pin(int pin, bool wake_on_active) {
+    (void)pin;
+    (void)wake_on_active;
+}
+
+void microbit_hal_power_off(void) {
+    host_exit(0);
+}
+
+bool microbit_hal_power_deep_sleep(bool wake_on_ms, uint32_t ms) {
+    if (!wake_on_ms) {
+        // Would sleep until a button or pin wakes it, which never happens.
+        host_exit(0);
+    }
+    struct timespec t = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+    nanosleep(&t, NULL);
+    return true;
+}
+
+void microbit_hal_power_light_sleep_begin(void) {
+}
+
+bool microbit_hal_power_wake_source_active(void) {
+    return false;
+}
+
+// Pins read back the level last written to them, or their pull if they were never driven.
+void microbit_hal_pin_set_pull(int pin, int pull) {
+    pin_pull_state[pin] = pull;
+    pin_level[pin] = pull == MICROBIT_HAL_PIN_PULL_UP;
+}
+
+int microbit_hal_pin_get_pull(int pin) {
+    return pin_pull_state[pin];
+}
+
+int microbit_hal_pin_set_analog_period_us(int pin, int period) {
+    if (pin == MICROBIT_HAL_PIN_MIXER) {
+        return 0;
+    }
+    pin_analog_period_us[pin] = period;
+    return 0;
+}
+
+int microbit_hal_pin_get_analog_period_us(int pin) {
+    return pin_analog_period_us[pin] == 0 ? -1 : pin_analog_period_us[pin];
+}
+
+void microbit_hal_pin_set_touch_mode(int pin, int mode) {
+    (void)pin;
+    (void)mode;
+}
+
+int microbit_hal_pin_read(int pin) {
+    return pin_level[pin];
+}
+
+void microbit_hal_pin_write(int pin, int value) {
+    pin_level[pin] = value != 0;
+    pin_analog_period_us[pin] = 0;
+}
+
+int microbit_hal_pin_read_analog_u10(int pin) {
+    if (pin_analog_period_us[pin] != 0) {
+        return pin_analog_value[pin];
+    }
+    return pin_level[pin] ? 1023 : 0;
+}
+
+void microbit_hal_pin_write_analog_u10(int pin, int value) {
+    if (pin == MICROBIT_HAL_PIN_MIXER) {
+        return;
+    }
+    pin_analog_value[pin] = value;
+    if (pin_analog_period_us[pin] == 0) {
+        pin_analog_period_us[pin] = 20000;
+    }
+}
+
+int microbit_hal_pin_sample_start(int pin, uint32_t rate_hz, void *buf, size_t num_samples, size_t sample_size) {
+    microbit_hal_pin_sample_stop();
+    pin_sampler_pin = pin;
+    sampler_start(&pin_sampler, buf, num_samples, sample_size, rate_hz, true);
+    return 0;
+}
+
+void microbit_hal_pin_sample_stop(void) {
+    pin_sampler.active = false;
+}
+
+// Pins never change by themselves, so there are no edges or touches.
+int microbit_hal_pin_set_edge_events(int pin, bool enable) {
+    (void)pin;
+    (void)enable;
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+int microbit_hal_pin_touch_state(int pin, int *was_touched, int *num_touches) {
+    (void)pin;
+    if (was_touched != NULL) {
+        *was_touched = 0;
+    }
+    if (num_touches != NULL) {
+        *num_touches = 0;
+    }
+    return 0;
+}
+
+// Same encoding as microbithal_ws2812.cpp, so the cost of preparing a frame is measured.
+#define WS2812_WORD_0 (0x8000 | 6)
+#define WS2812_WORD_1 (0x8000 | 13)
+#define WS2812_WORD_LOW (0x8000)
+
+void microbit_hal_ws2812_encode(uint16_t *seq, size_t stride, const uint8_t *buf, size_t len, size_t total_len, int brightness) {
+    for (size_t i = 0; i < len; ++i) {
+        unsigned int b = buf[i];
+        if (brightness < 255) {
+            b = (b * (brightness + 1)) >> 8;
+        }
+        for (unsigned int mask = 0x80; mask != 0; mask >>= 1) {
+            *seq = (b & mask) ? WS2812_WORD_1 : WS2812_WORD_0;
+            seq += stride;
+        }
+    }
+    for (size_t i = len * 8; i < MICROBIT_HAL_WS2812_SEQ_LEN(total_len); ++i) {
+        *seq = WS2812_WORD_LOW;
+        seq += stride;
+    }
+}
+
+// Frames are "sent" straight away.
+int microbit_hal_ws2812_start(const int *pins, size_t num_pins, const uint16_t *seq, size_t seq_len) {
+    (void)pins;
+    (void)seq;
+    if (num_pins == 0 || num_pins > MICROBIT_HAL_WS2812_MAX_STRIPS || seq_len > MICROBIT_HAL_WS2812_MAX_SEQ_LEN) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+bool microbit_hal_ws2812_busy(void) {
+    return false;
+}
+
+void microbit_hal_pin_write_ws2812(int pin, const uint8_t *buf, size_t len) {
+    (void)pin;
+    (void)buf;
+    (void)len;
+}
+
+// Nothing is connected to the I2C bus.
+int microbit_hal_i2c_init(int scl, int sda, int freq) {
+    (void)scl;
+    (void)sda;
+    (void)freq;
+    return 0;
+}
+
+int microbit_hal_i2c_readfrom(uint8_t addr, uint8_t *buf, size_t len, int stop) {
+    (void)addr;
+    (void)buf;
+    (void)len;
+    (void)stop;
+    return MICROBIT_HAL_DEVICE_ERROR;
+}
+
+int microbit_hal_i2c_writeto(uint8_t addr, const uint8_t *buf, size_t len, int stop) {
+    (void)addr;
+    (void)buf;
+    (void)len;
+    (void)stop;
+    return MICROBIT_HAL_DEVICE_ERROR;
+}
+
+// The UART is always stdin/stdout.
+int microbit_hal_uart_init(int tx, int rx, int baudrate, int bits, int parity, int stop) {
+    (void)tx;
+    (void)rx;
+    (void)baudrate;
+    (void)bits;
+    (void)parity;
+    (void)stop;
+    return 0;
+}
+
+bool microbit_hal_ble_running(void) {
+    return false;
+}
+
+int microbit_hal_ble_stream_init(void) {
+    return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+}
+
+bool microbit_hal_ble_connected(void) {
+    return false;
+}
+
+size_t microbit_hal_ble_stream_space(void) {
+    return 0;
+}
+
+size_t microbit_hal_ble_stream_write(const uint8_t *buf, size_t len) {
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+int microbit_hal_spi_init(int sclk, int mosi, int miso, int frequency, int bits, int mode) {
+    (void)sclk;
+    (void)mosi;
+    (void)miso;
+    (void)frequency;
+    (void)bits;
+    (void)mode;
+    return 0;
+}
+
+int microbit_hal_spi_transfer(size_t len, const uint8_t *src, uint8_t *dest) {
+    (void)src;
+    if (dest != NULL) {
+        memset(dest, 0xff, len);
+    }
+    return 0;
+}
+
+// Completes from the next dispatch, as it would from the SPIM interrupt.
+int microbit_hal_spi_transfer_start(size_t len, const uint8_t *src, uint8_t *dest) {
+    (void)src;
+    spi_transfer_len = len;
+    spi_transfer_dest = dest;
+    spi_transfer_pending = true;
+    return 0;
+}
+
+void microbit_hal_spi_transfer_abort(void) {
+    spi_transfer_pending = false;
+}
+
+int microbit_hal_button_state(int button, int *was_pressed, int *num_presses) {
+    (void)button;
+    if (was_pressed != NULL) {
+        *was_pressed = 0;
+    }
+    if (num_presses != NULL) {
+        *num_presses = 0;
+    }
+    return 0;
+}
+
+void microbit_hal_display_enable(int value) {
+    (void)value;
+}
+
+int microbit_hal_display_get_pixel(int x, int y) {
+    return display_pixels[y * 5 + x];
+}
+
+void microbit_hal_display_set_pixel(int x, int y, int bright) {
+    if (bright < 0) {
+        bright = 0;
+    } else if (bright > 9) {
+        bright = 9;
+    }
+    display_pixels[y * 5 + x] = bright;
+}
+
+void microbit_hal_display_commit(const uint8_t *buf) {
+    for (int i = 0; i < 25; ++i) {
+        display_pixels[i] = buf[i] > 9 ? 9 : buf[i];
+    }
+}
+
+int microbit_hal_display_read_light_level(void) {
+    return 0;
+}
+
+// The simulated board lies still and flat, face up.
+void microbit_hal_accelerometer_init(void) {
+}
+
+void microbit_hal_accelerometer_get_sample(int axis[3]) {
+    axis[0] = 0;
+    axis[1] = 0;
+    axis[2] = -1024;
+}
+
+int microbit_hal_accelerometer_get_gesture(void) {
+    return MICROBIT_HAL_ACCELEROMETER_EVT_FACE_UP;
+}
+
+void microbit_hal_accelerometer_set_range(int r) {
+    (void)r;
+}
+
+int microbit_hal_accelerometer_fifo_enable(int rate_hz) {
+    (void)rate_hz;
+    return MICROBIT_HAL_DEVICE_NO_RESOURCES;
+}
+
+int microbit_hal_accelerometer_fifo_read(int16_t *buf, size_t max_samples) {
+    (void)buf;
+    (void)max_samples;
+    return MICROBIT_HAL_DEVICE_ERROR;
+}
+
+int microbit_hal_compass_is_calibrated(void) {
+    return 1;
+}
+
+void microbit_hal_compass_clear_calibration(void) {
+}
+
+void microbit_hal_compass_calibrate(void) {
+}
+
+void microbit_hal_compass_get_sample(int axis[3]) {
+    axis[0] = 0;
+    axis[1] = 0;
+    axis[2] = 0;
+}
+
+void microbit_hal_compass_get_samples(int axis[3], int mag_ned[3], int accel_ned[3]) {
+    microbit_hal_compass_get_sample(axis);
+    microbit_hal_compass_get_sample(mag_ned);
+    accel_ned[0] = 0;
+    accel_ned[1] = 0;
+    accel_ned[2] = 1024;
+}
+
+int microbit_hal_compass_get_field_strength(void) {
+    return 0;
+}
+
+int microbit_hal_compass_get_heading(void) {
+    return 0;
+}
+
+// The microphone hears silence.
+void microbit_hal_microphone_init(void) {
+}
+
+void microbit_hal_microphone_set_threshold(int kind, int value) {
+    (void)kind;
+    (void)value;
+}
+
+int microbit_hal_microphone_get_level(void) {
+    return 0;
+}
+
+void microbit_hal_microphone_start_recording(uint8_t *buf, size_t len, uint32_t rate, bool loop) {
+    sampler_start(&mic_sampler, buf, len, 1, rate, loop);
+}
+
+void microbit_hal_microphone_stop_recording(void) {
+    mic_sampler.active = false;
+}
+
+bool microbit_hal_microphone_is_recording(void) {
+    return mic_sampler.active;
+}
+
+size_t microbit_hal_microphone_get_recording_pos(void) {
+    return mic_sampler.pos;
+}
+
+// Rows of the CODAL system font, in the format of BitmapFont::get(), taken from the
+// constant images that make_font_images.py generates from the same font.
+#define FONT_FIRST_CHAR (32)
+#define FONT_LAST_CHAR (126)
+
+static uint8_t font_data[FONT_LAST_CHAR - FONT_FIRST_CHAR + 1][5];
+static bool font_data_init_done = false;
+
+const uint8_t *microbit_hal_get_font_data(char c) {
+    unsigned char index = c;
+    if (index < FONT_FIRST_CHAR || index > FONT_LAST_CHAR) {
+        return NULL;
+    }
+    if (!font_data_init_done) {
+        font_data_init_done = true;
+        for (size_t i = 0; i < HAL_ARRAY_SIZE(font_data); ++i) {
+            microbit_image_obj_t *img = microbit_const_image_for_char(FONT_FIRST_CHAR + i);
+            for (int y = 0; y < 5; ++y) {
+                uint8_t row = 0;
+                for (int x = 0; x < 5; ++x) {
+                    row = row << 1 | (image_get_pixel(img, x, y) != 0);
+                }
+                font_data[i][y] = row;
+            }
+        }
+    }
+    return font_data[index - FONT_FIRST_CHAR];
+}
+
+// Log rows go to stdout when mirroring is on, and are otherwise dropped.
+static bool log_mirroring = false;
+static bool log_in_row = false;
+
+void microbit_hal_log_delete(bool full_erase) {
+    (void)full_erase;
+    log_in_row = false;
+}
+
+void microbit_hal_log_set_mirroring(bool serial) {
+    log_mirroring = serial;
+}
+
+void microbit_hal_log_set_timestamp(int period) {
+    (void)period;
+}
+
+int microbit_hal_log_begin_row(void) {
+    log_in_row = true;
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+int microbit_hal_log_end_row(void) {
+    if (!log_in_row) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+    log_in_row = false;
+    if (log_mirroring) {
+        mp_hal_stdout_tx_strn("\r\n", 2);
+    }
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+int microbit_hal_log_data(const char *key, const char *value) {
+    if (!log_in_row) {
+        return MICROBIT_HAL_DEVICE_ERROR;
+    }
+    if (log_mirroring) {
+        mp_hal_stdout_tx_strn(key, strlen(key));
+        mp_hal_stdout_tx_strn("=", 1);
+        mp_hal_stdout_tx_strn(value, strlen(value));
+        mp_hal_stdout_tx_strn(" ", 1);
+    }
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+void microbit_hal_log_set_policy(int policy, uint32_t max_delay_ms) {
+    (void)policy;
+    (void)max_delay_ms;
+}
+
+int microbit_hal_log_flush(void) {
+    return MICROBIT_HAL_DEVICE_OK;
+}
@@ -0,0 +1,293 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "microbithal.h"
+#include "host.h"
+
+// Each of the three mixer channels of microbithal_audio.cpp plays into its own sink,
+// paced in real time by its sample rate: a channel is pulled when the buffer it is playing
+// has had time to finish, and goes idle if the pull gives it nothing new, just as the
+// CODAL mixer would.  If an audio prefix was given on the command line then the samples
+// of each channel are also written to a WAV file, <prefix>-<channel>.wav, which holds the
+// sound that was played with any gaps between sounds left out.  The volume and the routing
+// to the speaker or a pin are not applied.
+typedef struct _audio_channel_t {
+    const char *name;
+    bool started;
+    bool playing;
+    bool fresh; // buf has been written since it last played
+    uint32_t sample_rate;
+    const uint8_t *buf;
+    size_t len;
+    uint64_t due_us; // when the playing buffer finishes and the channel is pulled again
+    void (*callback)(void); // NULL for the music channel, which is synthesised on pull
+    FILE *wav;
+    uint32_t wav_samples;
+} audio_channel_t;
+
+static audio_channel_t data_channel = { .name = "data" };
+static audio_channel_t speech_channel = { .name = "speech" };
+static audio_channel_t music_channel = { .name = "music" };
+
+static audio_channel_t *const audio_channels[] = {
+    &data_channel,
+    &speech_channel,
+    &music_channel,
+};
+
+#define NUM_AUDIO_CHANNELS (sizeof(audio_channels) / sizeof(audio_channels[0]))
+
+static uint8_t data_ring[MICROBIT_HAL_AUDIO_MAX_BUFFERS][MICROBIT_HAL_AUDIO_MAX_CHUNK];
+static size_t data_ring_len[MICROBIT_HAL_AUDIO_MAX_BUFFERS];
+static uint8_t *speech_buf;
+static size_t speech_buf_len;
+static uint8_t music_buf[MICROBIT_HAL_AUDIO_MUSIC_CHUNK_SIZE];
+
+static int audio_direct_pin = -1;
+static uint64_t expression_end_us;
+
+#define WAV_HEADER_SIZE (44)
+
+static void wav_put_u32(uint8_t *p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+// Write the header for 8-bit unsigned mono samples, with the sizes for num_samples.
+static void wav_write_header(FILE *f, uint32_t sample_rate, uint32_t num_samples) {
+    uint8_t h[WAV_HEADER_SIZE];
+    memcpy(&h[0], "RIFF", 4);
+    wav_put_u32(&h[4], WAV_HEADER_SIZE - 8 + num_samples);
+    memcpy(&h[8], "WAVEfmt ", 8);
+    wav_put_u32(&h[16], 16); // size of the fmt chunk
+    wav_put_u32(&h[20], 1 | 1 << 16); // PCM, 1 channel
+    wav_put_u32(&h[24], sample_rate);
+    wav_put_u32(&h[28], sample_rate); // bytes per second
+    wav_put_u32(&h[32], 1 | 8 << 16); // 1 byte per frame, 8 bits per sample
+    memcpy(&h[36], "data", 4);
+    wav_put_u32(&h[40], num_samples);
+    fseek(f, 0, SEEK_SET);
+    fwrite(h, 1, sizeof(h), f);
+}
+
+// Play the buffer that was written to the channel, and work out when it will finish.
+static void audio_channel_emit(audio_channel_t *ch) {
+    ch->fresh = false;
+    ch->due_us += (uint64_t)ch->len * 1000000 / ch->sample_rate;
+    if (host_config.audio_prefix == NULL) {
+        return;
+    }
+    if (ch->wav == NULL) {
+        // The header gets its sizes when the file is finished, by host_audio_deinit().
+        char filename[256];
+        snprintf(filename, sizeof(filename), "%s-%s.wav", host_config.audio_prefix, ch->name);
+        ch->wav = fopen(filename, "wb");
+        if (ch->wav == NULL) {
+            return;
+        }
+        wav_write_header(ch->wav, ch->sample_rate, 0);
+    }
+    fwrite(ch->buf, 1, ch->len, ch->wav);
+    ch->wav_samples += ch->len;
+}
+
+// Hand a buffer to the channel.  If it's idle then the buffer starts playing now,
+// otherwise it's played when the channel is next pulled.
+static void audio_channel_write(audio_channel_t *ch, const uint8_t *buf, size_t len) {
+    ch->buf = buf;
+    ch->len = len;
+    ch->fresh = true;
+    if (!ch->playing) {
+        ch->playing = true;
+        ch->due_us = host_ticks_us64();
+        audio_channel_emit(ch);
+        host_audio_wake(ch->due_us);
+    }
+}
+
+// Start pulling from the channel, for the music channel which has no buffer written to it.
+static void audio_channel_restart(audio_channel_t *ch) {
+    if (!ch->playing) {
+        ch->playing = true;
+        ch->due_us = host_ticks_us64();
+        host_audio_wake(ch->due_us);
+    }
+}
+
+static void audio_channel_init(audio_channel_t *ch, uint32_t sample_rate, void (*callback)(void)) {
+    ch->started = true;
+    ch->sample_rate = sample_rate;
+    ch->callback = callback;
+}
+
+static void audio_channel_pull(audio_channel_t *ch) {
+    if (ch->callback != NULL) {
+        ch->callback();
+    } else if (microbit_hal_audio_music_ready_callback(music_buf, sizeof(music_buf)) != 0) {
+        ch->buf = music_buf;
+        ch->len = sizeof(music_buf);
+        ch->fresh = true;
+    }
+    if (ch->fresh) {
+        audio_channel_emit(ch);
+    } else {
+        // Nothing to play; restarted by the next write.
+        ch->playing = false;
+    }
+}
+
+uint64_t host_audio_poll(uint64_t now_us) {
+    uint64_t next_us = UINT64_MAX;
+    for (size_t i = 0; i < NUM_AUDIO_CHANNELS; ++i) {
+        audio_channel_t *ch = audio_channels[i];
+        while (ch->playing && ch->due_us <= now_us) {
+            audio_channel_pull(ch);
+        }
+        if (ch->playing && ch->due_us < next_us) {
+            next_us = ch->due_us;
+        }
+    }
+    return next_us;
+}
+
+void host_audio_deinit(void) {
+    for (size_t i = 0; i < NUM_AUDIO_CHANNELS; ++i) {
+        audio_channel_t *ch = audio_channels[i];
+        if (ch->wav != NULL) {
+            wav_write_header(ch->wav, ch->sample_rate, ch->wav_samples);
+            fclose(ch->wav);
+            ch->wav = NULL;
+        }
+    }
+}
+
+void microbit_hal_audio_select_pin(int pin) {
+    (void)pin;
+}
+
+void microbit_hal_audio_select_speaker(bool enable) {
+    (void)enable;
+}
+
+void microbit_hal_audio_set_volume(int value) {
+    (void)value;
+}
+
+// CODAL's sound expression synthesiser is not simulated.  An expression is active for as
+// long as its effects would take to play, if it is given as effect data, and a built-in
+// expression finishes straight away.
+#define SOUND_EXPR_DURATION_OFFSET (9)
+#define SOUND_EXPR_DURATION_LENGTH (4)
+#define SOUND_EXPR_TOTAL_LENGTH (72)
+
+bool microbit_hal_audio_is_expression_active(void) {
+    return host_ticks_us64() < expression_end_us;
+}
+
+void microbit_hal_audio_play_expression(const char *expr) {
+    uint32_t duration_ms = 0;
+    for (;;) {
+        size_t len = strcspn(expr, ",");
+        if (len != SOUND_EXPR_TOTAL_LENGTH || strspn(expr, "0123456789") != len) {
+            break;
+        }
+        for (size_t i = 0; i < SOUND_EXPR_DURATION_LENGTH; ++i) {
+            duration_ms = duration_ms * 10 + expr[SOUND_EXPR_DURATION_OFFSET + i] - '0';
+        }
+        if (expr[len] == '\0') {
+            break;
+        }
+        expr += len + 1;
+    }
+    expression_end_us = host_ticks_us64() + (uint64_t)duration_ms * 1000;
+}
+
+void microbit_hal_audio_play_effects(const microbit_hal_sound_effect_t *effects, size_t num_effects) {
+    uint32_t duration_ms = 0;
+    for (size_t i = 0; i < num_effects; ++i) {
+        duration_ms += effects[i].duration;
+    }
+    expression_end_us = host_ticks_us64() + (uint64_t)duration_ms * 1000;
+}
+
+void microbit_hal_audio_stop_expression(void) {
+    expression_end_us = 0;
+}
+
+// Direct output plays through the data channel like the mixer does.
+int microbit_hal_audio_select_direct(int pin) {
+    audio_direct_pin = pin;
+    return MICROBIT_HAL_DEVICE_OK;
+}
+
+bool microbit_hal_audio_direct_is_active(void) {
+    return audio_direct_pin >= 0;
+}
+
+// The data channel pulls for each chunk, so there is no queue to fill.
+bool microbit_hal_audio_direct_queue_full(void) {
+    return false;
+}
+
+void microbit_hal_audio_init(uint32_t sample_rate) {
+    audio_channel_init(&data_channel, sample_rate, microbit_hal_audio_ready_callback);
+}
+
+uint8_t *microbit_hal_audio_get_buffer(size_t index, size_t num_samples) {
+    data_ring_len[index] = num_samples;
+    return data_ring[index];
+}
+
+bool microbit_hal_audio_write_buffer(size_t index) {
+    audio_channel_write(&data_channel, data_ring[index], data_ring_len[index]);
+    return true;
+}
+
+void microbit_hal_audio_speech_init(uint32_t sample_rate) {
+    audio_channel_init(&speech_channel, sample_rate, microbit_hal_audio_speech_ready_callback);
+}
+
+// The data is copied, as CODAL does, because the caller reuses its buffer straight away.
+void microbit_hal_audio_speech_write_data(const uint8_t *buf, size_t num_samples) {
+    if (speech_buf_len != num_samples) {
+        free(speech_buf);
+        speech_buf = malloc(num_samples);
+        speech_buf_len = num_samples;
+    }
+    memcpy(speech_buf, buf, num_samples);
+    audio_channel_write(&speech_channel, speech_buf, num_samples);
+}
+
+void microbit_hal_audio_music_init(uint32_t sample_rate) {
+    audio_channel_init(&music_channel, sample_rate, NULL);
+    audio_channel_restart(&music_channel);
+}
@@ -0,0 +1,232 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 MicroPython contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// For poll() and random().
+#define _XOPEN_SOURCE 700
+
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "py/mphal.h"
+#include "host.h"
+
+#define MP_STREAM_POLL_RD       (0x0001)
+#define MP_STREAM_POLL_WR       (0x0004)
+
+extern void microbit_hal_serial_interrupt_callback(void);
+extern void mp_handle_pending(bool);
+
+int last_interrupt_char;
+unsigned int num_interrupt_chars;
+static int interrupt_char = -1; // counted as it arrives, or -1 if none
+
+volatile unsigned int host_irq_disable_depth;
+
+// Receive ring, as in codal_app/mphalport.cpp, filled from stdin by host_serial_rx_poll()
+// rather than by the UART interrupt.  The interrupt character is counted as it arrives,
+// so ctrl-C stops a running script.
+static uint8_t serial_rx_stdin_ring[MICROBIT_HAL_SERIAL_STDIN_RING_SIZE];
+static uint8_t *serial_rx_ring = serial_rx_stdin_ring;
+static size_t serial_rx_ring_size = sizeof(serial_rx_stdin_ring);
+static size_t serial_rx_ring_head;
+static size_t serial_rx_ring_len;
+static uint32_t serial_rx_overflow = 0;
+static bool serial_rx_eof = false;
+
+// Interrupts can't be disabled, but the nesting is tracked so that host_dispatch() doesn't
+// run anything from inside an atomic section.
+void target_disable_irq(void) {
+    ++host_irq_disable_depth;
+}
+
+void target_enable_irq(void) {
+    --host_irq_disable_depth;
+}
+
+uint32_t mp_hal_disable_irq(void) {
+    target_disable_irq();
+    return 0;
+}
+
+void mp_hal_enable_irq(uint32_t state) {
+    (void)state;
+    target_enable_irq();
+}
+
+mp_uint_t mp_hal_ticks_cpu(void) {
+    return host_ticks_us64();
+}
+
+void mp_hal_unique_id(uint32_t id[2]) {
+    id[0] = 0x686f7374; // "host"
+    id[1] = 0;
+}
+
+int host_serial_rx_fd(void) {
+    return serial_rx_eof ? -1 : STDIN_FILENO;
+}
+
+// Move whatever stdin has ready into the ring, without waiting.
+void host_serial_rx_poll(void) {
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+    while (!serial_rx_eof && poll(&pfd, 1, 0) > 0) {
+        uint8_t buf[64];
+        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+        if (n <= 0) {
+            serial_rx_eof = true;
+            break;
+        }
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] == interrupt_char) {
+                ++num_interrupt_chars;
+                microbit_hal_serial_interrupt_callback();
+            }
+            if (serial_rx_ring_len < serial_rx_ring_size) {
+                serial_rx_ring[(serial_rx_ring_head + serial_rx_ring_len) % serial_rx_ring_size] = buf[i];
+                ++serial_rx_ring_len;
+            } else {
+                ++serial_rx_overflow;
+            }
+        }
+    }
+}
+
+// Returns the next received byte, or -1 if there is none.
+static int serial_rx_getc(void) {
+    host_serial_rx_poll();
+    if (serial_rx_ring_len == 0) {
+        return -1;
+    }
+    int c = serial_rx_ring[serial_rx_ring_head];
+    serial_rx_ring_head = (serial_rx_ring_head + 1) % serial_rx_ring_size;
+    --serial_rx_ring_len;
+    return c;
+}
+
+void mp_hal_set_interrupt_char(int c) {
+    if (c != -1) {
+        last_interrupt_char = c;
+    }
+    interrupt_char = c;
+}
+
+uintptr_t mp_hal_stdio_poll(uintptr_t poll_flags) {
+    uintptr_t ret = 0;
+    if (poll_flags & MP_STREAM_POLL_RD) {
+        host_serial_rx_poll();
+        if (serial_rx_ring_len > 0) {
+            ret |= MP_STREAM_POLL_RD;
+        }
+    }
+    if (poll_flags & MP_STREAM_POLL_WR) {
+        ret |= MP_STREAM_POLL_WR;
+    }
+    return ret;
+}
+
+void mp_hal_stdout_tx_strn(const char *str, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, str, len);
+        if (n <= 0) {
+            return;
+        }
+        str += n;
+        len -= n;
+    }
+}
+
+void microbit_hal_serial_tx_flush(void) {
+}
+
+// When stdin ends, there is nothing more for the REPL to do, so the simulation ends.
+int mp_hal_stdin_rx_chr(void) {
+    for (;;) {
+        int c;
+        while ((c = serial_rx_getc()) < 0) {
+            if (serial_rx_eof) {
+                host_exit(0);
+            }
+            mp_handle_pending(true);
+            microbit_hal_idle();
+        }
+        if (c == last_interrupt_char && num_interrupt_chars) {
+            --num_interrupt_chars;
+        } else {
+            return c;
+        }
+    }
+}
+
+// Read up to len bytes that have already been received, without waiting.
+size_t microbit_hal_serial_read(uint8_t *buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+        int c = serial_rx_getc();
+        if (c < 0) {
+            break;
+        }
+        if (c == last_interrupt_char && num_interrupt_chars) {
+            --num_interrupt_chars;
+        } else {
+            buf[n++] = c;
+        }
+    }
+    return n;
+}
+
+// Use buf as the receive ring, or the built-in one if buf is NULL.
+void microbit_hal_serial_set_rx_ring(uint8_t *buf, size_t size) {
+    if (buf == NULL) {
+        buf = serial_rx_stdin_ring;
+        size = sizeof(serial_rx_stdin_ring);
+    }
+    serial_rx_ring = buf;
+    serial_rx_ring_size = size;
+    serial_rx_ring_head = 0;
+    serial_rx_ring_len = 0;
+}
+
+uint32_t microbit_hal_serial_get_rx_overflow(bool reset) {
+    uint32_t n = serial_rx_overflow;
+    if (reset) {
+        serial_rx_overflow = 0;
+    }
+    return n;
+}
+
+uint32_t mp_hal_ticks_us(void) {
+    return host_ticks_us64();
+}
+
+uint32_t mp_hal_ticks_ms(void) {
+    return host_ticks_us64() / 1000;
+}
+
+// This is needed by the microbitfs implementation.
+uint32_t rng_generate_random_word(void) {
+    return (uint32_t)random() << 16 ^ (uint32_t)random();
+}
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+
+"""
+Make hex files that update only part of the flash of a micro:bit running MicroPython.
+
+Usage:
+    ./partialhex.py firmware <new.hex> --base <old.hex> [-o <update.hex>]
+    ./partialhex.py fs <firmware.hex> <file> [<file> ...] [-o <fs.hex>]
+
+The regions of the flash are found from the layout table that addlayouttable.py adds
+to the firmware.
+
+The "firmware" command compares the MicroPython region (and the page holding the layout
+table) of a new firmware with the one already on the board, and outputs only the pages
+that differ.  Frozen modules are part of the MicroPython region, so changing one only
+updates the pages it lives in.
+
+The "fs" command builds a filesystem holding the given files, in the same format that
+microbitfs.c uses, and outputs the filesystem region on its own.  Flashing it replaces
+all files on the board but leaves the firmware as it is.
+
+Output goes to stdout if no filename is given.  Every page in the output is complete, so
+a flasher that erases each page before programming it leaves no stale data behind.
+"""
+
+import argparse
+import binascii
+import os
+import struct
+import sys
+
+IHEX_TYPE_DATA = 0
+IHEX_TYPE_EOF = 1
+IHEX_TYPE_EXT_SEG_ADDR = 2
+IHEX_TYPE_EXT_LIN_ADDR = 4
+
+NRF_PAGE_SIZE_LOG2 = 12
+NRF_PAGE_SIZE = 1 << NRF_PAGE_SIZE_LOG2
+
+LAYOUT_MAGIC1 = 0x597F30FE
+LAYOUT_MAGIC2 = 0xC1B1D79D
+
+REGION_ID_MICROPYTHON = 2
+REGION_ID_FILESYSTEM = 3
+
+# Defaults of microbitfs.c for this port, see mpconfigport.h.
+MBFS_LOG_CHUNK_SIZE = 7
+MBFS_MAX_FILENAME_LENGTH = 120
+
+
+def read_hex(filename):
+    """Return the contents of a hex file as a dict of page address to bytearray."""
+    pages = {}
+    base = 0
+    with open(filename, "rt") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith(":"):
+                continue
+            record = binascii.unhexlify(line[1:])
+            length, addr, type = struct.unpack(">BHB", record[:4])
+            data = record[4 : 4 + length]
+            if type == IHEX_TYPE_DATA:
+                for i, b in enumerate(data):
+                    a = base + addr + i
+                    page = pages.setdefault(a & -NRF_PAGE_SIZE, bytearray(b"\xff" * NRF_PAGE_SIZE))
+                    page[a % NRF_PAGE_SIZE] = b
+            elif type == IHEX_TYPE_EXT_SEG_ADDR:
+                base = struct.unpack(">H", data)[0] << 4
+            elif type == IHEX_TYPE_EXT_LIN_ADDR:
+                base = struct.unpack(">H", data)[0] << 16
+            elif type == IHEX_TYPE_EOF:
+                break
+    return pages
+
+
+def make_ihex_record(addr, type, data):
+    record = struct.pack(">BHB", len(data), addr & 0xFFFF, type) + data
+    checksum = (-(sum(record))) & 0xFF
+    return ":%s%02X" % (str(binascii.hexlify(record), "utf8").upper(), checksum)
+
+
+def write_hex(dest, pages):
+    upper = None
+    for addr in sorted(pages):
+        data = pages[addr]
+        for i in range(0, len(data), 16):
+            if (addr + i) >> 16 != upper:
+                upper = (addr + i) >> 16
+                print(make_ihex_record(0, IHEX_TYPE_EXT_LIN_ADDR, struct.pack(">H", upper)), file=dest)
+            print(make_ihex_record(addr + i, IHEX_TYPE_DATA, bytes(data[i : i + 16])), file=dest)
+    print(make_ihex_record(0, IHEX_TYPE_EOF, b""), file=dest)
+
+
+def find_layout(pages):
+    """Return (table_addr, {region_id: (addr, len)}) from the layout table in pages."""
+    for page_addr in sorted(pages):
+        page = pages[page_addr]
+        magic1, version, table_len, num_reg, psize_log2, magic2 = struct.unpack(
+            "<IHHHHI", page[-16:]
+        )
+        if magic1 != LAYOUT_MAGIC1 or magic2 != LAYOUT_MAGIC2:
+            continue
+        table = page[-16 - table_len : -16]
+        regions = {}
+        for i in range(num_reg):
+            region_id, _, reg_page, reg_len, _ = struct.unpack("<BBHI8s", table[i * 16 : i * 16 + 16])
+            regions[region_id] = (reg_page << psize_log2, reg_len)
+        return page_addr + NRF_PAGE_SIZE - 16 - table_len, regions
+    sys.exit("error: no layout table found, was the firmware made by addlayouttable.py?")
+
+
+def region_pages(regions, region_id):
+    addr, length = regions[region_id]
+    return range(addr, (addr + length + NRF_PAGE_SIZE - 1) & -NRF_PAGE_SIZE, NRF_PAGE_SIZE)
+
+
+def firmware_update(new_pages, base_pages):
+    layout_addr, regions = find_layout(new_pages)
+    erased = bytearray(b"\xff" * NRF_PAGE_SIZE)
+    candidates = list(region_pages(regions, REGION_ID_MICROPYTHON))
+    if layout_addr & -NRF_PAGE_SIZE not in candidates:
+        candidates.append(layout_addr & -NRF_PAGE_SIZE)
+    return {
+        addr: new_pages.get(addr, erased)
+        for addr in candidates
+        if new_pages.get(addr, erased) != base_pages.get(addr, erased)
+    }
+
+
+class FileSystem:
+    """Builds an image of microbitfs, laid out as microbit_filesystem_init() would."""
+
+    def __init__(self, fs_start, fs_end, log_chunk_size, index_16bit):
+        self.chunk_size = 1 << log_chunk_size
+        self.index_size = 2 if index_16bit else 1
+        self.offset_size = 2 if self.chunk_size > 256 else 1
+        self.data_per_chunk = self.chunk_size - 2 * self.index_size
+        max_chunks = 2048 if index_16bit else 252
+
+        # Same limits as init_limits(): the last page is kept spare for the persistent data.
+        end = (fs_end & -NRF_PAGE_SIZE) - NRF_PAGE_SIZE
+        start = (end - self.chunk_size * max_chunks + NRF_PAGE_SIZE - 1) & -NRF_PAGE_SIZE
+        while start < fs_start:
+            start += NRF_PAGE_SIZE
+        self.start = start
+        self.end = end
+        self.num_chunks = (end - start) // self.chunk_size
+        self.image = bytearray(b"\xff" * (end + NRF_PAGE_SIZE - start))
+        self.next_chunk = 1
+
+        # The persistent data marker goes in the spare page, and the chunks start at the
+        # first page.
+        self.put_index(end - start, (1 << (8 * self.index_size)) - 3)
+
+    def put_index(self, pos, value):
+        self.image[pos : pos + self.index_size] = value.to_bytes(self.index_size, "little")
+
+    def chunk_pos(self, index):
+        return (index - 1) * self.chunk_size
+
+    def alloc_chunk(self):
+        if self.next_chunk > self.num_chunks:
+            sys.exit("error: files do not fit in the filesystem")
+        index = self.next_chunk
+        self.next_chunk += 1
+        return index
+
+    def add_file(self, name, data):
+        name = name.encode("utf8")
+        if len(name) > MBFS_MAX_FILENAME_LENGTH:
+            sys.exit("error: file name too long: %s" % name)
+        first = chunk = self.alloc_chunk()
+        self.put_index(self.chunk_pos(chunk), (1 << (8 * self.index_size)) - 2)  # FILE_START
+        header = self.chunk_pos(chunk) + self.index_size
+        self.image[header + self.offset_size] = len(name)
+        self.image[header + self.offset_size + 1 : header + self.offset_size + 1 + len(name)] = name
+        offset = self.offset_size + 1 + len(name)
+        pos = 0
+        while True:
+            n = min(len(data) - pos, self.data_per_chunk - offset)
+            data_pos = self.chunk_pos(chunk) + self.index_size
+            self.image[data_pos + offset : data_pos + offset + n] = data[pos : pos + n]
+            pos += n
+            offset += n
+            if offset < self.data_per_chunk:
+                break
+            # Like advance(), the next chunk is taken as soon as this one is full.
+            next_chunk = self.alloc_chunk()
+            self.put_index(self.chunk_pos(chunk) + self.chunk_size - self.index_size, next_chunk)
+            self.put_index(self.chunk_pos(next_chunk), chunk)
+            chunk = next_chunk
+            offset = 0
+        end_offset_pos = self.chunk_pos(first) + self.index_size
+        self.image[end_offset_pos : end_offset_pos + self.offset_size] = offset.to_bytes(
+            self.offset_size, "little"
+        )
+
+    def pages(self):
+        return {
+            self.start + i: self.image[i : i + NRF_PAGE_SIZE]
+            for i in range(0, len(self.image), NRF_PAGE_SIZE)
+        }
+
+
+def main():
+    arg_parser = argparse.ArgumentParser(
+        description="Make hex files that update part of the flash of the micro:bit."
+    )
+    arg_parser.add_argument(
+        "-o",
+        "--output",
+        default=sys.stdout,
+        type=argparse.FileType("wt"),
+        help="output file (default is stdout)",
+    )
+    subparsers = arg_parser.add_subparsers(dest="command", required=True)
+    fw_parser = subparsers.add_parser("firmware", help="pages of new firmware that changed")
+    fw_parser.add_argument("firmware", help="new MicroPython firmware")
+    fw_parser.add_argument("--base", required=True, help="firmware already on the board")
+    fs_parser = subparsers.add_parser("fs", help="filesystem region holding the given files")
+    fs_parser.add_argument("firmware", help="MicroPython firmware, for its layout table")
+    fs_parser.add_argument("files", nargs="*", help="files to put in the filesystem")
+    fs_parser.add_argument(
+        "--log-chunk-size",
+        type=int,
+        default=MBFS_LOG_CHUNK_SIZE,
+        help="MBFS_LOG_CHUNK_SIZE of the firmware",
+    )
+    fs_parser.add_argument(
+        "--index-16bit",
+        action="store_true",
+        help="firmware was built with MICROPY_MBFS_CHUNK_INDEX_16BIT",
+    )
+    args = arg_parser.parse_args()
+
+    if args.command == "firmware":
+        pages = firmware_update(read_hex(args.firmware), read_hex(args.base))
+    else:
+        _, regions = find_layout(read_hex(args.firmware))
+        fs_addr, fs_len = regions[REGION_ID_FILESYSTEM]
+        fs = FileSystem(fs_addr, fs_addr + fs_len, args.log_chunk_size, args.index_16bit)
+        for filename in args.files:
+            with open(filename, "rb") as f:
+                fs.add_file(os.path.basename(filename), f.read())
+        pages = fs.pages()
+
+    if args.output is not sys.stdout:
+        print("{} pages, {} bytes".format(len(pages), len(pages) * NRF_PAGE_SIZE))
+    write_hex(args.output, pages)
+
+
+if __name__ == "__main__":
+    main()